@@ -0,0 +1,135 @@
+#include "Suites.h"
+#include "BoardFixture.h"
+#include <string>
+#include <vector>
+#include "../Tetris/Rollback.h"
+#include "../Tetris/Simulation.h"
+
+namespace Benchmarks {
+	static constexpr size_t fixtureCount = 64;
+	static constexpr size_t pieceCount = 16;
+	static constexpr int randomPiecesPerRun = 1000;
+	static constexpr Timing::Tick simulatedTicks = 60 * Timing::TicksPerSecond;
+
+	void runBoardBenchmarks(Harness& harness, unsigned seed)
+	{
+		std::mt19937 random(seed);
+		std::uint32_t randomState{ Rules::getSeededRandomState(seed) };
+
+		std::vector<Blocks::Cells> boards;
+		for (size_t i{ 0 }; i < fixtureCount; ++i)
+			boards.push_back(BoardFixture::toBoard(BoardFixture::randomGarbage(random)));
+		//pieces at the spawn position used by the game
+		std::vector<Rules::Piece> pieces;
+		for (size_t i{ 0 }; i < pieceCount; ++i) {
+			randomState = Rules::getNextRandomState(randomState);
+			pieces.push_back(Rules::getSpawnPiece(Rules::getPieceOfState(randomState)));
+		}
+
+		size_t board{ 0 };
+		Blocks::Cells cells{};
+		Rules::Columns columns{};
+		Rules::Piece piece{};
+		auto nextFixture = [&] {
+			cells = boards[board % boards.size()];
+			columns = Rules::getColumns(cells);
+			piece = pieces[board % pieces.size()];
+			board += 1;
+		};
+		auto moveWhileFits = [&](sf::Vector2i offset) -> std::uint64_t {
+			std::uint64_t steps{ 1 };
+			for (Rules::Piece moved{ Rules::getMoved(piece, offset) }; Rules::fits(cells, moved); moved = Rules::getMoved(moved, offset)) {
+				piece = moved;
+				steps += 1;
+			}
+			return steps;
+		};
+
+		harness.measure("moveDown", nextFixture, [&] { return moveWhileFits({ 0, 1 }); });
+		//the same fall as one query, what gravity uses
+		harness.measure("dropDistance", nextFixture, [&]() -> std::uint64_t {
+			std::uint64_t distance{ 0 };
+			for (const auto& candidate : pieces)
+				distance += Rules::getDropDistance(columns, candidate);
+			doNotOptimize(distance);
+			return pieces.size();
+		});
+		//every run starts from the spawn position on a fresh board, so each walks all the way to a wall
+		harness.measure("moveLeft", nextFixture, [&] { return moveWhileFits({ -1, 0 }); });
+		harness.measure("moveRight", nextFixture, [&] { return moveWhileFits({ 1, 0 }); });
+		harness.measure("rotate", nextFixture, [&]() -> std::uint64_t {
+			for (int i{ 0 }; i < 4; ++i) {
+				const Rules::Piece rotated{ Rules::getRotated(piece) };
+				if (Rules::fits(cells, rotated))
+					piece = rotated;
+			}
+			return 4;
+		});
+		harness.measure("fits", nextFixture, [&]() -> std::uint64_t {
+			std::uint64_t placeable{ 0 };
+			for (const auto& candidate : pieces)
+				placeable += Rules::fits(cells, candidate);
+			doNotOptimize(placeable);
+			return pieces.size();
+		});
+
+		for (int fullRows{ 0 }; fullRows <= 4; ++fullRows) {
+			std::vector<Blocks::Cells> clearBoards;
+			for (size_t i{ 0 }; i < fixtureCount; ++i)
+				clearBoards.push_back(BoardFixture::toBoard(BoardFixture::garbageWithFullRows(random, fullRows)));
+			harness.measure("clearFullRows/" + std::to_string(fullRows),
+				[&] { cells = clearBoards[board++ % clearBoards.size()]; },
+				[&]() -> std::uint64_t {
+					doNotOptimize(Rules::clearFullRows(cells));
+					return 1;
+				});
+		}
+
+		//what a new game does to the board, the cells and their column bits emptied
+		harness.measure("resetBoard", nextFixture, [&]() -> std::uint64_t {
+			cells.fill(Blocks::Empty);
+			columns = {};
+			doNotOptimize(cells[Blocks::BlockCountX * Blocks::BlockCountY - 1] + columns[0]);
+			return 1;
+		});
+		harness.measure("getNextPiece", [] {}, [&]() -> std::uint64_t {
+			for (int i{ 0 }; i < randomPiecesPerRun; ++i) {
+				randomState = Rules::getNextRandomState(randomState);
+				piece = Rules::getSpawnPiece(Rules::getPieceOfState(randomState));
+			}
+			return randomPiecesPerRun;
+		});
+		//a whole minute of an idle game, gravity, locks and line clears without input
+		for (const unsigned level : { 0u, 10u, 16u }) {
+			harness.measure("simulateMinute/level" + std::to_string(level), [] {}, [&]() -> std::uint64_t {
+				Rules::Simulation simulation(seed);
+				simulation.setStartLevel(level);
+				while (simulation.advance(simulatedTicks)) {}
+				doNotOptimize(simulation.getScore());
+				return 1;
+			});
+		}
+
+		//a versus match tick by tick the way a rollback plays it, per tick
+		const Rules::Match match(Rules::Simulation(seed), Rules::Simulation(seed + 1));
+		harness.measure("matchTick", [] {}, [&]() -> std::uint64_t {
+			Rules::Match played(match);
+			played.advance(simulatedTicks);
+			doNotOptimize(played.getChecksum());
+			return simulatedTicks;
+		});
+		//the deepest rollback there is, an opponent input as late as it can be, restored and played again up to the current tick
+		Rules::RollbackMatch rollback(match, 0);
+		rollback.advance(Rules::RollbackMatch::maxRollbackTicks - 1);
+		std::uint64_t remoteInputs{ 0 };
+		harness.measure("rollback/" + std::to_string(Rules::RollbackMatch::maxRollbackTicks), [] {}, [&]() -> std::uint64_t {
+			const Timing::Tick oldest = rollback.getTick() + 2 - Rules::RollbackMatch::maxRollbackTicks;
+			rollback.addRemoteInput(remoteInputs, { oldest, Rules::MoveLeft, remoteInputs % 2 == 0 });
+			rollback.setRemoteKnownUntil(oldest);
+			rollback.advance(rollback.getTick() + 1);
+			remoteInputs += 1;
+			doNotOptimize(rollback.getMatch().getChecksum());
+			return 1;
+		});
+	}
+}
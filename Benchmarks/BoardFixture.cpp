@@ -0,0 +1,78 @@
+#include "BoardFixture.h"
+#include <algorithm>
+
+namespace Benchmarks {
+	static constexpr int minGarbageHeight = 2;
+	static constexpr int maxGarbageHeight = 8;
+
+	static std::uint8_t randomPiece(std::mt19937& random)
+	{
+		std::uniform_int_distribution<int> piece(1, BoardFixture::pieceTypes);
+		return static_cast<std::uint8_t>(piece(random));
+	}
+
+	BoardFixture::Cells BoardFixture::randomGarbage(std::mt19937& random)
+	{
+		Cells cells{};
+		std::uniform_int_distribution<int> height(minGarbageHeight, maxGarbageHeight);
+		std::uniform_int_distribution<int> column(0, Blocks::BlockCountX - 1);
+		std::bernoulli_distribution filled(0.6);
+		const int garbageHeight = height(random);
+		for (int y{ Blocks::BlockCountY - garbageHeight }; y < Blocks::BlockCountY; ++y) {
+			for (auto& cell : cells[y])
+				cell = filled(random) ? randomPiece(random) : 0;
+			cells[y][column(random)] = 0;
+		}
+		return cells;
+	}
+
+	BoardFixture::Cells BoardFixture::garbageWithFullRows(std::mt19937& random, int fullRows)
+	{
+		Cells cells{};
+		std::uniform_int_distribution<int> column(0, Blocks::BlockCountX - 1);
+		std::bernoulli_distribution filled(0.6);
+		//choose which of the garbage rows are complete, the others keep a hole
+		std::array<int, maxGarbageHeight> rows{};
+		for (int i{ 0 }; i < maxGarbageHeight; ++i)
+			rows[i] = Blocks::BlockCountY - 1 - i;
+		std::shuffle(rows.begin(), rows.end(), random);
+		for (int i{ 0 }; i < maxGarbageHeight; ++i) {
+			auto& row = cells[rows[i]];
+			for (auto& cell : row)
+				cell = i < fullRows || filled(random) ? randomPiece(random) : 0;
+			if (i >= fullRows)
+				row[column(random)] = 0;
+		}
+		return cells;
+	}
+
+	Blocks::Cells BoardFixture::toBoard(const Cells& cells)
+	{
+		Blocks::Cells board{};
+		for (int y{ 0 }; y < Blocks::BlockCountY; ++y)
+			for (int x{ 0 }; x < Blocks::BlockCountX; ++x)
+				board[y * Blocks::BlockCountX + x] = static_cast<Blocks::PieceType>(cells[y][x]);
+		return board;
+	}
+
+	void BoardFixture::apply(Blocks::BlockMap& map, const Cells& cells)
+	{
+		map.m_Cells = toBoard(cells);
+		map.onCellsChanged();
+	}
+
+	const std::vector<sf::Sprite>& BoardFixture::getWalls(const Blocks::BlockMap& map)
+	{
+		return map.m_WallsSprites;
+	}
+
+	const std::array<sf::Sprite, 4>& BoardFixture::getSprites(const Blocks::Block& block)
+	{
+		return block.m_Sprites;
+	}
+
+	const sf::Texture& BoardFixture::getTile(const Blocks::BlockMap& map)
+	{
+		return map.m_TileTexture;
+	}
+}
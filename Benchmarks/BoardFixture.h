@@ -0,0 +1,34 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "../Tetris/Block.h"
+
+namespace Benchmarks {
+
+	//seeded board layouts that can be stamped into a BlockMap, friend of the Blocks classes
+	class BoardFixture
+	{
+	public:
+		//one Blocks::PieceType per cell, 0 is an empty cell
+		using Cells = std::array<std::array<std::uint8_t, Blocks::BlockCountX>, Blocks::BlockCountY>;
+		static constexpr int pieceTypes = Blocks::PieceTypeCount - 1;
+
+		//garbage up to a random height with a hole in every row
+		static Cells randomGarbage(std::mt19937& random);
+		//garbage where exactly fullRows of the garbage rows are complete
+		static Cells garbageWithFullRows(std::mt19937& random, int fullRows);
+
+		//the layout as the board of the game rules
+		static Blocks::Cells toBoard(const Cells& cells);
+		static void apply(Blocks::BlockMap& map, const Cells& cells);
+
+		static const std::vector<sf::Sprite>& getWalls(const Blocks::BlockMap& map);
+		static const std::array<sf::Sprite, 4>& getSprites(const Blocks::Block& block);
+		//greyscale tile every cell is drawn with, tinted by the palette
+		static const sf::Texture& getTile(const Blocks::BlockMap& map);
+	};
+}
@@ -0,0 +1,206 @@
+#include "Harness.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static std::atomic<std::uint64_t> allocations{ 0 };
+
+//counting replacements of the global allocation functions, the benchmark binary is the only user
+void* operator new(std::size_t size)
+{
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* memory = std::malloc(size == 0 ? 1 : size))
+		return memory;
+	throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+	return ::operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+namespace Benchmarks {
+	using Clock = std::chrono::steady_clock;
+
+	std::uint64_t allocationCount()
+	{
+		return allocations.load(std::memory_order_relaxed);
+	}
+
+	void doNotOptimize(std::uint64_t value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		//an empty asm that takes value in a register, the compiler has to produce it and can not look inside
+		asm volatile("" : : "r"(value) : "memory");
+#else
+		//msvc has no inline assembly on x64, a volatile store is kept just the same
+		static volatile std::uint64_t sink;
+		sink = value;
+#endif
+	}
+
+	CacheMissCounter::CacheMissCounter()
+		:m_Descriptor(-1)
+	{
+#ifdef __linux__
+		perf_event_attr attributes{};
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.size = sizeof(attributes);
+		attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+		attributes.disabled = 1;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+		m_Descriptor = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+#endif
+	}
+
+	CacheMissCounter::~CacheMissCounter()
+	{
+#ifdef __linux__
+		if (m_Descriptor >= 0)
+			close(m_Descriptor);
+#endif
+	}
+
+	bool CacheMissCounter::isAvailable() const
+	{
+		return m_Descriptor >= 0;
+	}
+
+	void CacheMissCounter::start()
+	{
+#ifdef __linux__
+		if (m_Descriptor >= 0) {
+			ioctl(m_Descriptor, PERF_EVENT_IOC_RESET, 0);
+			ioctl(m_Descriptor, PERF_EVENT_IOC_ENABLE, 0);
+		}
+#endif
+	}
+
+	std::uint64_t CacheMissCounter::stop()
+	{
+		std::uint64_t count{ 0 };
+#ifdef __linux__
+		if (m_Descriptor >= 0) {
+			ioctl(m_Descriptor, PERF_EVENT_IOC_DISABLE, 0);
+			if (read(m_Descriptor, &count, sizeof(count)) != sizeof(count))
+				count = 0;
+		}
+#endif
+		return count;
+	}
+
+	Harness::Harness(double minSeconds)
+		:m_MinSeconds(minSeconds), m_TimerOverheadNs(0.0)
+	{
+		//calibrate the clock overhead with the same pattern measure uses
+		static constexpr int calibrationRounds = 100000;
+		std::chrono::nanoseconds total{ 0 };
+		for (int i{ 0 }; i < calibrationRounds; ++i) {
+			const auto begin = Clock::now();
+			const auto end = Clock::now();
+			total += end - begin;
+		}
+		m_TimerOverheadNs = static_cast<double>(total.count()) / calibrationRounds;
+	}
+
+	void Harness::measure(const std::string& name, const std::function<void()>& prepare, const std::function<std::uint64_t()>& run)
+	{
+		//one untimed round warms caches and lazy initialisation
+		prepare();
+		run();
+
+		std::uint64_t operations{ 0 }, calls{ 0 }, allocated{ 0 }, cacheMisses{ 0 };
+		std::chrono::nanoseconds elapsed{ 0 };
+		const auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(m_MinSeconds));
+		while (Clock::now() < deadline) {
+			prepare();
+			const std::uint64_t allocationsBefore = allocationCount();
+			m_CacheMisses.start();
+			const auto begin = Clock::now();
+			operations += run();
+			const auto end = Clock::now();
+			cacheMisses += m_CacheMisses.stop();
+			allocated += allocationCount() - allocationsBefore;
+			elapsed += end - begin;
+			calls += 1;
+		}
+
+		const double ops = static_cast<double>(std::max<std::uint64_t>(operations, 1));
+		const double netNs = std::max(0.0, static_cast<double>(elapsed.count()) - m_TimerOverheadNs * calls);
+		m_Results.push_back({ name, operations, netNs / ops, allocated / ops, m_CacheMisses.isAvailable(), cacheMisses / ops, {} });
+	}
+
+	void Harness::addCounter(const std::string& name, double perOp)
+	{
+		if (!m_Results.empty())
+			m_Results.back().counters.emplace_back(name, perOp);
+	}
+
+	void Harness::printTable(std::ostream& out) const
+	{
+		out << std::left << std::setw(28) << "benchmark" << std::right << std::setw(14) << "ops"
+			<< std::setw(12) << "ns/op" << std::setw(12) << "allocs/op" << std::setw(14) << "misses/op" << '\n';
+		for (const auto& result : m_Results) {
+			out << std::left << std::setw(28) << result.name << std::right << std::setw(14) << result.operations
+				<< std::fixed << std::setprecision(2) << std::setw(12) << result.nsPerOp
+				<< std::setw(12) << result.allocationsPerOp;
+			if (result.hasCacheMisses)
+				out << std::setw(14) << result.cacheMissesPerOp;
+			else
+				out << std::setw(14) << "n/a";
+			for (const auto& counter : result.counters)
+				out << "  " << counter.first << '=' << counter.second;
+			out << '\n';
+		}
+	}
+
+	void Harness::writeJson(std::ostream& out) const
+	{
+		out << "{\n  \"benchmarks\": [\n" << std::setprecision(4) << std::fixed;
+		for (size_t i{ 0 }; i < m_Results.size(); ++i) {
+			const auto& result = m_Results[i];
+			out << "    { \"name\": \"" << result.name << "\", \"operations\": " << result.operations
+				<< ", \"ns_per_op\": " << result.nsPerOp << ", \"allocations_per_op\": " << result.allocationsPerOp
+				<< ", \"cache_misses_per_op\": ";
+			if (result.hasCacheMisses)
+				out << result.cacheMissesPerOp;
+			else
+				out << "null";
+			for (const auto& counter : result.counters)
+				out << ", \"" << counter.first << "\": " << counter.second;
+			out << (i + 1 == m_Results.size() ? " }\n" : " },\n");
+		}
+		out << "  ]\n}\n";
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Benchmarks {
+
+	struct Result
+	{
+		std::string name;
+		std::uint64_t operations;
+		double nsPerOp;
+		double allocationsPerOp;
+		bool hasCacheMisses;
+		double cacheMissesPerOp;
+		//benchmark specific values, e.g. draw calls per frame
+		std::vector<std::pair<std::string, double>> counters;
+	};
+
+	//number of global operator new calls since the start of the process
+	std::uint64_t allocationCount();
+
+	//keeps a computed value alive so the optimiser cannot drop the work producing it
+	void doNotOptimize(std::uint64_t value);
+
+	//hardware cache miss counter, backed by perf events on linux and unavailable elsewhere
+	class CacheMissCounter
+	{
+	public:
+		CacheMissCounter();
+		~CacheMissCounter();
+		CacheMissCounter(const CacheMissCounter&) = delete;
+		CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+		bool isAvailable()const;
+		void start();
+		std::uint64_t stop();
+	private:
+		int m_Descriptor;
+	};
+
+	class Harness
+	{
+	public:
+		explicit Harness(double minSeconds);
+
+		//prepare runs untimed before every timed call of run, run returns the number of operations it did
+		void measure(const std::string& name, const std::function<void()>& prepare, const std::function<std::uint64_t()>& run);
+		//attaches a per operation value to the last measured benchmark
+		void addCounter(const std::string& name, double perOp);
+		void printTable(std::ostream& out)const;
+		void writeJson(std::ostream& out)const;
+	private:
+		double m_MinSeconds;
+		//cost of reading the clock twice, subtracted from every timed call
+		double m_TimerOverheadNs;
+		CacheMissCounter m_CacheMisses;
+		std::vector<Result> m_Results;
+	};
+}
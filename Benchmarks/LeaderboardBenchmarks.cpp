@@ -0,0 +1,69 @@
+#include "Suites.h"
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include "../Tetris/Leaderboard.h"
+
+namespace Benchmarks {
+	//years of games at a busy cabinet
+	static constexpr size_t leaderboardGames = 1000000;
+	static const char* const leaderboardPath = "benchmark.leaderboard";
+
+	static std::uint32_t randomScore(std::mt19937& random)
+	{
+		//most games end early, a few go on for long
+		return static_cast<std::uint32_t>(std::gamma_distribution<double>(2.0, 3000.0)(random));
+	}
+
+	void runLeaderboardBenchmarks(Harness& harness, unsigned seed)
+	{
+		std::mt19937 random(seed);
+		std::vector<std::uint32_t> scores(leaderboardGames);
+		for (auto& score : scores)
+			score = randomScore(random);
+		//best first, every game lands at the end of the index and filling it takes no time
+		std::sort(scores.begin(), scores.end(), std::greater<std::uint32_t>());
+		std::remove(leaderboardPath);
+		std::remove((std::string{ leaderboardPath } + ".index").c_str());
+		Storage::Leaderboard leaderboard;
+		if (!leaderboard.open(leaderboardPath))
+			return;
+		for (size_t i{ 0 }; i < scores.size(); ++i)
+			leaderboard.add({ scores[i], scores[i] / 100, 0, 6000, static_cast<std::uint32_t>(i), Storage::noReplay });
+
+		//a game with a random score, it moves the index entries of every worse game
+		harness.measure("leaderboardAdd/1M", [] {}, [&]() -> std::uint64_t {
+			const std::uint32_t score = randomScore(random);
+			doNotOptimize(leaderboard.add({ score, score / 100, 0, 6000, 0, Storage::noReplay }));
+			return 1;
+		});
+		//a new best game, the worst case, it moves the whole index
+		std::uint32_t best{ scores.front() };
+		harness.measure("leaderboardAddBest/1M", [] {}, [&]() -> std::uint64_t {
+			best += 1;
+			doNotOptimize(leaderboard.add({ best, best / 100, 0, 6000, 0, Storage::noReplay }));
+			return 1;
+		});
+		std::vector<Storage::LeaderboardEntry> top;
+		harness.measure("leaderboardTop/10", [] {}, [&]() -> std::uint64_t {
+			leaderboard.getTop(10, top);
+			doNotOptimize(top.back().score);
+			return 1;
+		});
+		harness.measure("leaderboardPlace", [] {}, [&]() -> std::uint64_t {
+			doNotOptimize(leaderboard.getPlace(randomScore(random)));
+			return 1;
+		});
+		//what the high score list waits for after a start
+		harness.measure("leaderboardOpen/1M", [&] { leaderboard.close(); }, [&]() -> std::uint64_t {
+			doNotOptimize(leaderboard.open(leaderboardPath) ? leaderboard.getCount() : 0);
+			return 1;
+		});
+		leaderboard.close();
+		std::remove(leaderboardPath);
+		std::remove((std::string{ leaderboardPath } + ".index").c_str());
+	}
+}
@@ -0,0 +1,250 @@
+#include "Suites.h"
+#include "BoardFixture.h"
+#include "../Tetris/Resources.h"
+#include <SFML/Graphics.hpp>
+#include <SFML/OpenGL.hpp>
+#include <iostream>
+
+namespace Benchmarks {
+	static constexpr unsigned frameWidth = 800;
+	static constexpr unsigned frameHeight = 944;
+	static constexpr int tileSize = 64;
+	static constexpr int wallTileSize = 16;
+	//the batch atlas holds the greyscale piece tile with the wall tile right of it
+	static const sf::IntRect pieceTile{ 0, 0, tileSize, tileSize };
+	static const sf::IntRect wallTile{ tileSize, 0, wallTileSize, wallTileSize };
+
+	//tints the greyscale tile with the palette colour of every cell, the board is a single quad
+	static const char* const cellLookupShader = R"(
+		uniform sampler2D cells;
+		uniform sampler2D tile;
+		uniform vec4 palette[8];
+		uniform vec2 boardSize;
+		void main()
+		{
+			vec2 cell = gl_TexCoord[0].xy * boardSize;
+			int id = int(floor(texture2D(cells, (floor(cell) + 0.5) / boardSize).r * 255.0 + 0.5));
+			if (id == 0)
+				discard;
+			gl_FragColor = texture2D(tile, fract(cell)) * palette[id] * gl_Color;
+		}
+	)";
+
+	static void appendQuad(sf::VertexArray& vertices, sf::Vector2f position, sf::Vector2f size, const sf::IntRect& tile, sf::Color colour = sf::Color::White)
+	{
+		const sf::Vector2f uv(static_cast<float>(tile.left), static_cast<float>(tile.top));
+		const sf::Vector2f uvSize(static_cast<float>(tile.width), static_cast<float>(tile.height));
+		vertices.append({ position, colour, uv });
+		vertices.append({ { position.x + size.x, position.y }, colour, { uv.x + uvSize.x, uv.y } });
+		vertices.append({ position + size, colour, uv + uvSize });
+		vertices.append({ { position.x, position.y + size.y }, colour, { uv.x, uv.y + uvSize.y } });
+	}
+
+	struct Scene
+	{
+		explicit Scene(unsigned seed)
+			:generator(seed), palette(Blocks::getDefaultPalette())
+		{
+			sf::Image tile, walls, atlasImage;
+			Resources::loadImage(tile, Resources::blockTile);
+			Resources::loadImage(walls, Resources::wallTile);
+			map.loadTiles(tile, walls);
+			generator.loadTile(tile);
+			std::mt19937 random(seed);
+			cells = BoardFixture::randomGarbage(random);
+			BoardFixture::apply(map, cells);
+			current = generator.getRandomBlock();
+			current.move({ 272.f, 3 * Blocks::blockSize });
+			next = generator.getRandomBlock();
+			next.move({ 24.f, 792.f });
+			atlasImage.create(tileSize + wallTileSize, tileSize, sf::Color::Transparent);
+			atlasImage.copy(tile, 0, 0);
+			atlasImage.copy(walls, tileSize, 0);
+			atlas.loadFromImage(atlasImage);
+			Resources::loadFont(font, Resources::scoreFont);
+			score.setFont(font);
+			score.setCharacterSize(80);
+			score.setPosition({ 312.f, 804.f });
+			score.setFillColor({ 255, 255, 103 });
+			score.setString("0000001200");
+			//the original board: a sprite for every cell, an empty one without a texture still costs its draw
+			const sf::Texture& boardTile = BoardFixture::getTile(map);
+			const float tileScale = Blocks::blockSize / boardTile.getSize().x;
+			for (int y{ 0 }; y < Blocks::BlockCountY; ++y)
+				for (int x{ 0 }; x < Blocks::BlockCountX; ++x) {
+					if (cells[y][x] == 0)
+						continue;
+					sf::Sprite& sprite = cellSprites[y * Blocks::BlockCountX + x];
+					sprite.setTexture(boardTile);
+					sprite.setColor(palette[cells[y][x]]);
+					sprite.setScale(tileScale, tileScale);
+					sprite.setPosition(Blocks::wallSize + x * Blocks::blockSize, y * Blocks::blockSize);
+				}
+		}
+
+		void appendWalls(sf::VertexArray& vertices)const
+		{
+			for (const auto& wall : BoardFixture::getWalls(map))
+				appendQuad(vertices, wall.getPosition(), { 16.f, 16.f }, wallTile);
+		}
+
+		void appendCells(sf::VertexArray& vertices)const
+		{
+			for (int y{ 0 }; y < Blocks::BlockCountY; ++y)
+				for (int x{ 0 }; x < Blocks::BlockCountX; ++x)
+					if (cells[y][x] != 0)
+						appendQuad(vertices, { Blocks::wallSize + x * Blocks::blockSize, y * Blocks::blockSize },
+							{ Blocks::blockSize, Blocks::blockSize }, pieceTile, palette[cells[y][x]]);
+		}
+
+		void appendBlocks(sf::VertexArray& vertices)const
+		{
+			for (const auto* block : { &current, &next })
+				for (const auto& sprite : BoardFixture::getSprites(*block))
+					appendQuad(vertices, sprite.getPosition(), { Blocks::blockSize, Blocks::blockSize },
+						pieceTile, sprite.getColor());
+		}
+
+		Blocks::BlockGenerator generator;
+		Blocks::Palette palette;
+		Blocks::BlockMap map;
+		BoardFixture::Cells cells;
+		Blocks::Block current;
+		Blocks::Block next;
+		std::array<sf::Sprite, Blocks::BlockCountX * Blocks::BlockCountY> cellSprites;
+		sf::Texture atlas;
+		sf::Font font;
+		sf::Text score;
+	};
+
+	static void measureFrames(Harness& harness, const std::string& name, sf::RenderTexture& target, const std::function<unsigned()>& drawScene)
+	{
+		unsigned drawCalls{ 0 };
+		//finishing the previous frame untimed keeps gpu work of one frame out of the next one
+		harness.measure(name, [] { glFinish(); }, [&]() -> std::uint64_t {
+			target.clear();
+			drawCalls = drawScene();
+			target.display();
+			return 1;
+		});
+		harness.addCounter("draw_calls", drawCalls);
+	}
+
+	void runRenderBenchmarks(Harness& harness, unsigned seed)
+	{
+		sf::RenderTexture target;
+		if (!target.create(frameWidth, frameHeight)) {
+			std::cerr << "render benchmarks skipped, no offscreen render target\n";
+			return;
+		}
+		target.setActive(true);
+		std::cout << "renderer: " << reinterpret_cast<const char*>(glGetString(GL_RENDERER)) << '\n';
+
+		Scene scene(seed);
+
+		//the renderer the game ships: the board is one draw, through the cell lookup shader when available or as one batch of the cells,
+		//the walls and blocks are drawn per sprite
+		scene.map.useCellShader(true);
+		measureFrames(harness, "render/game", target, [&]() -> unsigned {
+			target.draw(scene.current);
+			target.draw(scene.next);
+			target.draw(scene.map);
+			target.draw(scene.score);
+			return 4 + 4 + 1 + static_cast<unsigned>(BoardFixture::getWalls(scene.map).size()) + 1;
+		});
+
+		//the original renderer: one draw per sprite, empty board cells included
+		measureFrames(harness, "render/per_sprite", target, [&]() -> unsigned {
+			unsigned draws{ 0 };
+			for (const auto* block : { &scene.current, &scene.next })
+				for (const auto& sprite : BoardFixture::getSprites(*block)) {
+					target.draw(sprite);
+					draws += 1;
+				}
+			for (const auto& sprite : scene.cellSprites) {
+				target.draw(sprite);
+				draws += 1;
+			}
+			for (const auto& wall : BoardFixture::getWalls(scene.map)) {
+				target.draw(wall);
+				draws += 1;
+			}
+			target.draw(scene.score);
+			return draws + 1;
+		});
+
+		//everything but the text rebuilt into one atlas batch per frame
+		sf::VertexArray batch(sf::Quads);
+		measureFrames(harness, "render/vertex_array", target, [&]() -> unsigned {
+			batch.clear();
+			scene.appendWalls(batch);
+			scene.appendCells(batch);
+			scene.appendBlocks(batch);
+			target.draw(batch, &scene.atlas);
+			target.draw(scene.score);
+			return 2;
+		});
+
+		//walls and board uploaded once, only the falling and next block are streamed
+		sf::VertexArray staticGeometry(sf::Quads), blocks(sf::Quads);
+		scene.appendWalls(staticGeometry);
+		scene.appendCells(staticGeometry);
+		sf::VertexBuffer staticBuffer(sf::Quads, sf::VertexBuffer::Static);
+		if (sf::VertexBuffer::isAvailable() && staticBuffer.create(staticGeometry.getVertexCount()) && staticBuffer.update(&staticGeometry[0])) {
+			measureFrames(harness, "render/vertex_buffer", target, [&]() -> unsigned {
+				blocks.clear();
+				scene.appendBlocks(blocks);
+				target.draw(staticBuffer, &scene.atlas);
+				target.draw(blocks, &scene.atlas);
+				target.draw(scene.score);
+				return 3;
+			});
+		}
+		else
+			std::cerr << "render/vertex_buffer skipped, vertex buffers are not available\n";
+
+		//board as a cell id texture drawn through one quad, walls stay in a static buffer
+		sf::Shader shader;
+		sf::Texture cellTexture;
+		sf::VertexArray walls(sf::Quads);
+		scene.appendWalls(walls);
+		sf::VertexBuffer wallBuffer(sf::Quads, sf::VertexBuffer::Static);
+		if (sf::Shader::isAvailable() && sf::VertexBuffer::isAvailable() && shader.loadFromMemory(cellLookupShader, sf::Shader::Fragment)
+			&& cellTexture.create(Blocks::BlockCountX, Blocks::BlockCountY) && wallBuffer.create(walls.getVertexCount()) && wallBuffer.update(&walls[0])) {
+			std::vector<sf::Uint8> pixels(Blocks::BlockCountX * Blocks::BlockCountY * 4, 0);
+			for (int y{ 0 }; y < Blocks::BlockCountY; ++y)
+				for (int x{ 0 }; x < Blocks::BlockCountX; ++x)
+					if (scene.cells[y][x] != 0)
+						pixels[(y * Blocks::BlockCountX + x) * 4] = scene.cells[y][x];
+			cellTexture.update(pixels.data());
+			std::array<sf::Glsl::Vec4, Blocks::PieceTypeCount> palette;
+			for (size_t i{ 0 }; i < palette.size(); ++i)
+				palette[i] = sf::Glsl::Vec4(scene.palette[i]);
+			shader.setUniform("cells", sf::Shader::CurrentTexture);
+			shader.setUniform("tile", BoardFixture::getTile(scene.map));
+			shader.setUniformArray("palette", palette.data(), palette.size());
+			shader.setUniform("boardSize", sf::Glsl::Vec2(Blocks::BlockCountX, Blocks::BlockCountY));
+
+			sf::VertexArray board(sf::Quads, 4);
+			const sf::Vector2f boardSize(Blocks::BlockCountX * Blocks::blockSize, Blocks::BlockCountY * Blocks::blockSize);
+			board[0] = sf::Vertex({ Blocks::wallSize, 0.f }, { 0.f, 0.f });
+			board[1] = sf::Vertex({ Blocks::wallSize + boardSize.x, 0.f }, { Blocks::BlockCountX, 0.f });
+			board[2] = sf::Vertex({ Blocks::wallSize + boardSize.x, boardSize.y }, { Blocks::BlockCountX, Blocks::BlockCountY });
+			board[3] = sf::Vertex({ Blocks::wallSize, boardSize.y }, { 0.f, Blocks::BlockCountY });
+			sf::RenderStates boardStates(&cellTexture);
+			boardStates.shader = &shader;
+
+			measureFrames(harness, "render/shader_lookup", target, [&]() -> unsigned {
+				blocks.clear();
+				scene.appendBlocks(blocks);
+				target.draw(wallBuffer, &scene.atlas);
+				target.draw(board, boardStates);
+				target.draw(blocks, &scene.atlas);
+				target.draw(scene.score);
+				return 4;
+			});
+		}
+		else
+			std::cerr << "render/shader_lookup skipped, shaders are not available\n";
+	}
+}
@@ -0,0 +1,47 @@
+#include "Suites.h"
+#include <chrono>
+#include <string>
+#include "../Tetris/Royale.h"
+
+namespace Benchmarks {
+	//no royale of bots lasts that long, it only keeps a stuck one from running forever
+	static constexpr Timing::Tick maxMatchTicks = 60 * 60 * Timing::TicksPerSecond;
+	static constexpr Timing::Tick stepTicks = Timing::TicksPerSecond;
+
+	static Rules::Royale startRoyale(std::uint32_t seed)
+	{
+		Rules::Royale royale(seed, 0);
+		royale.addBots(0);
+		return royale;
+	}
+
+	void runRoyaleBenchmarks(Harness& harness, unsigned seed)
+	{
+		//a whole match of 99 bots per operation, every match from a seed of its own
+		std::uint32_t matchSeed{ seed };
+		std::uint64_t matches{ 0 }, ticks{ 0 };
+		std::chrono::nanoseconds elapsed{ 0 };
+		harness.measure("royaleMatch", [] {}, [&]() -> std::uint64_t {
+			const auto begin = std::chrono::steady_clock::now();
+			Rules::Royale royale{ startRoyale(matchSeed++) };
+			royale.advance(maxMatchTicks);
+			elapsed += std::chrono::steady_clock::now() - begin;
+			doNotOptimize(royale.getChecksum());
+			matches += 1;
+			ticks += royale.getTick();
+			return 1;
+		});
+		//one thread, so this is per core, matches on more cores are independent of each other
+		harness.addCounter("matches_per_s_per_core", matches / std::chrono::duration<double>(elapsed).count());
+		harness.addCounter("ticks", static_cast<double>(ticks) / matches);
+
+		//a second of the opening, all 99 boards still in play, per tick
+		const Rules::Royale opening{ startRoyale(seed) };
+		Rules::Royale royale{ opening };
+		harness.measure("royaleTick/99", [&] { royale = opening; }, [&]() -> std::uint64_t {
+			royale.advance(stepTicks);
+			doNotOptimize(royale.getChecksum());
+			return stepTicks;
+		});
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Harness.h"
+
+namespace Benchmarks {
+	//BlockMap and BlockGenerator operations on seeded random boards
+	void runBoardBenchmarks(Harness& harness, unsigned seed);
+	//the game scene drawn offscreen with several draw strategies, cpu time and draw calls per frame
+	void runRenderBenchmarks(Harness& harness, unsigned seed);
+	//whole 99 player royales of bots, headless, and single ticks of one
+	void runRoyaleBenchmarks(Harness& harness, unsigned seed);
+	//adds and queries on a leaderboard of a million games in a file in the working directory
+	void runLeaderboardBenchmarks(Harness& harness, unsigned seed);
+}
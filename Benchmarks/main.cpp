@@ -0,0 +1,42 @@
+#include "Suites.h"
+#include <fstream>
+#include <iostream>
+#include <string>
+
+//usage: Benchmarks [--suite board|render|royale|leaderboard|all] [--seed N] [--min-time seconds] [--json path]
+//on hosts without a gpu the render suite runs on mesa's software gl: put mesa's opengl32.dll
+//next to the executable on windows, or run under xvfb-run with LIBGL_ALWAYS_SOFTWARE=1 on linux
+int main(int argc, char* argv[])
+{
+	unsigned seed{ 1 };
+	double minSeconds{ 0.2 };
+	std::string jsonPath;
+	std::string suite{ "all" };
+	for (int i{ 1 }; i + 1 < argc; ++i) {
+		const std::string arg{ argv[i] };
+		if (arg == "--suite")
+			suite = argv[++i];
+		else if (arg == "--seed")
+			seed = static_cast<unsigned>(std::stoul(argv[++i]));
+		else if (arg == "--min-time")
+			minSeconds = std::stod(argv[++i]);
+		else if (arg == "--json")
+			jsonPath = argv[++i];
+	}
+
+	Benchmarks::Harness harness(minSeconds);
+	if (suite == "board" || suite == "all")
+		Benchmarks::runBoardBenchmarks(harness, seed);
+	if (suite == "render" || suite == "all")
+		Benchmarks::runRenderBenchmarks(harness, seed);
+	if (suite == "royale" || suite == "all")
+		Benchmarks::runRoyaleBenchmarks(harness, seed);
+	if (suite == "leaderboard" || suite == "all")
+		Benchmarks::runLeaderboardBenchmarks(harness, seed);
+
+	harness.printTable(std::cout);
+	if (!jsonPath.empty()) {
+		std::ofstream json(jsonPath);
+		harness.writeJson(json);
+	}
+}
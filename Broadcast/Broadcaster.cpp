@@ -0,0 +1,123 @@
+#include "Broadcaster.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#else
+#include <sys/socket.h>
+#endif
+
+namespace Network {
+	//a few seconds of a game, more only delays a spectator further when it falls behind
+	static constexpr int spectatorSendBuffer = 4 * 1024;
+	//a spectator this many segments behind the newest skips to it, one behind is only finishing the segment before
+	static constexpr std::uint64_t skipSegmentsBehind = 2;
+	//one that does not even get a frame out in this many is not reading at all
+	static constexpr std::uint64_t dropSegmentsBehind = 16;
+
+	void SpectatorSocket::setSendBufferSize(int bytes)
+	{
+		setsockopt(getHandle(), SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+	}
+
+	void SpectatorSocket::setReceiveBufferSize(int bytes)
+	{
+		setsockopt(getHandle(), SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&bytes), sizeof(bytes));
+	}
+
+	Broadcaster::Broadcaster(Timing::Tick keyframeInterval)
+		:m_KeyframeInterval(std::max<Timing::Tick>(1, keyframeInterval)), m_NextKeyframe(0), m_Stats{}
+	{
+	}
+
+	bool Broadcaster::listen(unsigned short port)
+	{
+		m_Listener.setBlocking(false);
+		return m_Listener.listen(port) == sf::Socket::Done;
+	}
+
+	void Broadcaster::publish(const SpectatorView& view, Timing::Tick tick)
+	{
+		const bool isKeyframe = !m_Current || tick >= m_NextKeyframe;
+		if (isKeyframe) {
+			std::shared_ptr<Segment> segment{ new Segment{ m_Current ? m_Current->index + 1 : 0, {}, nullptr } };
+			if (m_Current)
+				m_Current->next = segment;
+			m_Current = segment;
+			m_NextKeyframe = tick + m_KeyframeInterval;
+		}
+		const size_t size = m_Current->bytes.size();
+		if (!m_Encoder.encode(view, tick, isKeyframe, m_Current->bytes))
+			return;
+		m_Stats.frames += 1;
+		m_Stats.keyframes += isKeyframe ? 1 : 0;
+		m_Stats.bytesEncoded += m_Current->bytes.size() - size;
+	}
+
+	void Broadcaster::serve()
+	{
+		for (;;) {
+			std::unique_ptr<SpectatorSocket> socket(new SpectatorSocket);
+			if (m_Listener.accept(*socket) != sf::Socket::Done)
+				break;
+			socket->setBlocking(false);
+			socket->setSendBufferSize(spectatorSendBuffer);
+			m_Spectators.push_back({ std::move(socket), nullptr, 0, 0, false });
+			m_Stats.joined += 1;
+		}
+		for (auto& spectator : m_Spectators)
+			send(spectator);
+		const auto isBroken = [](const Spectator& spectator) { return spectator.isBroken; };
+		const size_t before = m_Spectators.size();
+		m_Spectators.erase(std::remove_if(m_Spectators.begin(), m_Spectators.end(), isBroken), m_Spectators.end());
+		m_Stats.dropped += before - m_Spectators.size();
+	}
+
+	BroadcastStats Broadcaster::getStats() const
+	{
+		BroadcastStats stats{ m_Stats };
+		stats.spectators = m_Spectators.size();
+		return stats;
+	}
+
+	void Broadcaster::send(Spectator& spectator)
+	{
+		//a new spectator starts at the newest keyframe
+		if (!spectator.segment) {
+			if (!m_Current)
+				return;
+			spectator.segment = m_Current;
+		}
+		while (spectator.offset == spectator.segment->bytes.size() && spectator.segment->next) {
+			spectator.segment = spectator.segment->next;
+			spectator.offset = 0;
+			spectator.frameEnd = 0;
+		}
+		const std::uint64_t behind = m_Current->index - spectator.segment->index;
+		if (behind >= dropSegmentsBehind) {
+			spectator.isBroken = true;
+			return;
+		}
+		const bool isBehind = behind >= skipSegmentsBehind;
+		if (isBehind && spectator.offset == spectator.frameEnd) {
+			spectator.segment = m_Current;
+			spectator.offset = 0;
+			spectator.frameEnd = 0;
+			m_Stats.skips += 1;
+		}
+		//one that is behind only finishes the frame it is in, the rest of its segment is skipped anyway
+		const std::vector<std::uint8_t>& bytes = spectator.segment->bytes;
+		const size_t end = isBehind && spectator.offset != 0 ? spectator.frameEnd : bytes.size();
+		if (spectator.offset >= end)
+			return;
+		size_t sent{ 0 };
+		const sf::Socket::Status status = spectator.socket->send(bytes.data() + spectator.offset, end - spectator.offset, sent);
+		spectator.offset += sent;
+		m_Stats.bytesSent += sent;
+		while (spectator.frameEnd < spectator.offset)
+			spectator.frameEnd += spectatorSizeBytes + (bytes[spectator.frameEnd] | static_cast<size_t>(bytes[spectator.frameEnd + 1]) << 8);
+		spectator.isBroken = status == sf::Socket::Disconnected || status == sf::Socket::Error;
+	}
+}
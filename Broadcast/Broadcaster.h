@@ -0,0 +1,81 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Scheduler.h"
+#include "SpectatorStream.h"
+
+namespace Network {
+	static constexpr unsigned short defaultBroadcastPort = 47200;
+
+	//a tcp socket whose kernel buffers can be made small
+	//bytes the kernel holds cannot be skipped any more, with small buffers a backlog stays where it can be
+	class SpectatorSocket : public sf::TcpSocket
+	{
+	public:
+		//only once the socket is connected or accepted
+		void setSendBufferSize(int bytes);
+		void setReceiveBufferSize(int bytes);
+	};
+
+	struct BroadcastStats
+	{
+		std::uint64_t spectators;
+		std::uint64_t joined;
+		//too far behind for too long, or gone
+		std::uint64_t dropped;
+		std::uint64_t frames;
+		std::uint64_t keyframes;
+		std::uint64_t bytesEncoded;
+		std::uint64_t bytesSent;
+		//times a spectator jumped to the newest keyframe
+		std::uint64_t skips;
+	};
+
+	//fans the frames of one game out to every spectator connected over tcp
+	//a frame is encoded once into the current segment, a spectator only keeps the segment it is in and how much of it it got
+	//every segment starts with a keyframe, a spectator too far behind finishes the frame it is in and skips to the newest one
+	class Broadcaster
+	{
+	public:
+		explicit Broadcaster(Timing::Tick keyframeInterval);
+
+		bool listen(unsigned short port);
+		//the view of the game at tick, a frame when something changed and a new segment every keyframe interval
+		void publish(const SpectatorView& view, Timing::Tick tick);
+		//takes new spectators and sends everyone what they have not got yet, never waits
+		void serve();
+		BroadcastStats getStats()const;
+	private:
+		struct Segment
+		{
+			std::uint64_t index;
+			std::vector<std::uint8_t> bytes;
+			//set once the next keyframe is encoded, a segment nobody is in any more goes away with its last spectator
+			std::shared_ptr<const Segment> next;
+		};
+
+		struct Spectator
+		{
+			std::unique_ptr<SpectatorSocket> socket;
+			std::shared_ptr<const Segment> segment;
+			size_t offset;
+			//end of the frame the offset is in, equal to the offset between two frames
+			size_t frameEnd;
+			bool isBroken;
+		};
+
+		void send(Spectator& spectator);
+
+		sf::TcpListener m_Listener;
+		SpectatorEncoder m_Encoder;
+		Timing::Tick m_KeyframeInterval;
+		Timing::Tick m_NextKeyframe;
+		std::shared_ptr<Segment> m_Current;
+		std::vector<Spectator> m_Spectators;
+		BroadcastStats m_Stats;
+	};
+}
@@ -0,0 +1,135 @@
+#include "SpectatorLoad.h"
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Broadcaster.h"
+#include "SpectatorStream.h"
+
+namespace Network {
+	static const sf::Time connectTimeout = sf::seconds(5);
+	static const sf::Time pollInterval = sf::milliseconds(4);
+	static constexpr size_t receiveSize = 16 * 1024;
+	//a slow spectator takes this much every interval, a fraction of what a game streams
+	static constexpr size_t slowReadSize = 16;
+	static const sf::Time slowReadInterval = sf::milliseconds(100);
+	//its kernel would otherwise take in the backlog of minutes for it
+	static constexpr int slowReceiveBuffer = 2 * 1024;
+
+	struct Watcher
+	{
+		std::unique_ptr<SpectatorSocket> socket;
+		SpectatorDecoder decoder;
+		bool isSlow;
+		bool isBroken;
+		sf::Time nextRead;
+		//arrival time minus tick time of the earliest frame so far, in microseconds
+		std::int64_t earliest;
+		bool hasEarliest;
+	};
+
+	void SpectatorLoadTotals::add(const SpectatorLoadTotals& totals)
+	{
+		spectators += totals.spectators;
+		failed += totals.failed;
+		broken += totals.broken;
+		frames += totals.frames;
+		keyframes += totals.keyframes;
+		skippedFrames += totals.skippedFrames;
+		mismatches += totals.mismatches;
+		bytes += totals.bytes;
+		lag.add(totals.lag);
+	}
+
+	//spectator i of the whole load is slow when i % 100 is below slowPercent
+	static void watch(const sf::IpAddress& address, unsigned short port, size_t first, size_t count, unsigned slowPercent,
+		const std::atomic<bool>& running, SpectatorLoadTotals& prompt, SpectatorLoadTotals& slow)
+	{
+		sf::Clock clock;
+		sf::SocketSelector selector;
+		size_t selected{ 0 };
+		std::vector<Watcher> watchers;
+		for (size_t i{ first }; i < first + count && running; ++i) {
+			const bool isSlow = i % 100 < slowPercent;
+			std::unique_ptr<SpectatorSocket> socket(new SpectatorSocket);
+			if (socket->connect(address, port, connectTimeout) != sf::Socket::Done) {
+				(isSlow ? slow : prompt).failed += 1;
+				continue;
+			}
+			socket->setBlocking(false);
+			//a slow one is read on its own schedule, in the selector it would be ready all the time
+			if (isSlow)
+				socket->setReceiveBufferSize(slowReceiveBuffer);
+			else {
+				selector.add(*socket);
+				selected += 1;
+			}
+			(isSlow ? slow : prompt).spectators += 1;
+			watchers.push_back({ std::move(socket), {}, isSlow, false, sf::Time::Zero, 0, false });
+		}
+
+		Instrumentation::Histogram lag;
+		std::vector<std::uint8_t> received(receiveSize);
+		while (running) {
+			const bool isReady = selected != 0 && selector.wait(pollInterval);
+			if (selected == 0)
+				sf::sleep(pollInterval);
+			const sf::Time now = clock.getElapsedTime();
+			for (auto& watcher : watchers) {
+				if (watcher.isBroken || (watcher.isSlow ? now < watcher.nextRead : !isReady || !selector.isReady(*watcher.socket)))
+					continue;
+				size_t size{ 0 };
+				const sf::Socket::Status status = watcher.socket->receive(received.data(), watcher.isSlow ? slowReadSize : received.size(), size);
+				if (watcher.isSlow)
+					watcher.nextRead = now + slowReadInterval;
+				if (status == sf::Socket::Done) {
+					const std::uint64_t frames = watcher.decoder.getFrames();
+					(watcher.isSlow ? slow : prompt).bytes += size;
+					watcher.isBroken = !watcher.decoder.feed(received.data(), size);
+					if (watcher.isBroken || watcher.isSlow || watcher.decoder.getFrames() == frames)
+						continue;
+					const std::int64_t offset = now.asMicroseconds() - static_cast<std::int64_t>(Timing::ticksToMicroseconds(watcher.decoder.getTick()));
+					if (!watcher.hasEarliest || offset < watcher.earliest)
+						watcher.earliest = offset;
+					watcher.hasEarliest = true;
+					lag.record(static_cast<std::uint64_t>(offset - watcher.earliest));
+				}
+				else if (status == sf::Socket::Disconnected || status == sf::Socket::Error)
+					watcher.isBroken = true;
+				if (watcher.isBroken && !watcher.isSlow) {
+					selector.remove(*watcher.socket);
+					selected -= 1;
+				}
+			}
+		}
+
+		for (const auto& watcher : watchers) {
+			SpectatorLoadTotals& totals = watcher.isSlow ? slow : prompt;
+			totals.broken += watcher.isBroken ? 1 : 0;
+			totals.frames += watcher.decoder.getFrames();
+			totals.keyframes += watcher.decoder.getKeyframes();
+			totals.skippedFrames += watcher.decoder.getSkippedFrames();
+			totals.mismatches += watcher.decoder.getMismatches();
+		}
+		lag.addTo(prompt.lag);
+	}
+
+	void runSpectators(const sf::IpAddress& address, unsigned short port, size_t count, unsigned slowPercent, size_t threadCount,
+		const std::atomic<bool>& running, SpectatorLoadTotals& prompt, SpectatorLoadTotals& slow)
+	{
+		threadCount = std::max<size_t>(1, std::min(threadCount, count));
+		std::vector<SpectatorLoadTotals> prompts(threadCount, SpectatorLoadTotals{}), slows(threadCount, SpectatorLoadTotals{});
+		std::vector<std::thread> threads;
+		for (size_t i{ 0 }; i < threadCount; ++i) {
+			const size_t first = count * i / threadCount;
+			threads.emplace_back(watch, address, port, first, count * (i + 1) / threadCount - first, slowPercent,
+				std::cref(running), std::ref(prompts[i]), std::ref(slows[i]));
+		}
+		for (auto& thread : threads)
+			thread.join();
+		for (size_t i{ 0 }; i < threadCount; ++i) {
+			prompt.add(prompts[i]);
+			slow.add(slows[i]);
+		}
+	}
+}
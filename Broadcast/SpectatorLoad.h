@@ -0,0 +1,33 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "Histogram.h"
+
+namespace Network {
+	//what a group of spectators got, added up over the threads
+	struct SpectatorLoadTotals
+	{
+		std::uint64_t spectators;
+		std::uint64_t failed;
+		//streams that did not parse or were closed by the broadcaster
+		std::uint64_t broken;
+		std::uint64_t frames;
+		std::uint64_t keyframes;
+		std::uint64_t skippedFrames;
+		//keyframes that disagreed with the board the deltas before them built
+		std::uint64_t mismatches;
+		std::uint64_t bytes;
+		//how much later than its tick a frame arrived, over the earliest frame of the same spectator
+		Instrumentation::HistogramCounts lag;
+
+		void add(const SpectatorLoadTotals& totals);
+	};
+
+	//connects count spectators to a broadcaster on threadCount threads and decodes their streams until running turns false
+	//slowPercent of them read a trickle only, so the broadcaster has to make them skip
+	void runSpectators(const sf::IpAddress& address, unsigned short port, size_t count, unsigned slowPercent, size_t threadCount,
+		const std::atomic<bool>& running, SpectatorLoadTotals& prompt, SpectatorLoadTotals& slow);
+}
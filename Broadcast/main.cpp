@@ -0,0 +1,201 @@
+#include "Broadcaster.h"
+#include "SpectatorLoad.h"
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Bot.h"
+#include "Replay.h"
+#include "ResidentMemory.h"
+
+static std::atomic<bool> running{ true };
+
+static void stop(int)
+{
+	running = false;
+}
+
+//the game that is broadcast, a bot playing from a seed or a replay played back at its own pace over and over
+class Source
+{
+public:
+	Source(std::uint32_t seed, Timing::Tick botTicks)
+		:m_Game(seed), m_Bot(seed, botTicks), m_HasReplay(false), m_NextInput(0), m_Origin(0)
+	{
+	}
+
+	bool loadReplay(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		const std::vector<std::uint8_t> bytes{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+		if (!Storage::decodeReplay(bytes.data(), bytes.size(), m_Replay))
+			return false;
+		m_HasReplay = true;
+		restart(0);
+		return true;
+	}
+
+	//plays the game on to tick, which is one after the tick before
+	void advance(Timing::Tick tick)
+	{
+		if (!m_HasReplay) {
+			while (m_Game.advance(tick)) {}
+			Rules::Input input{ Rules::InputCount };
+			bool isPressed{ false };
+			if (m_Bot.getNextTick() <= tick && m_Bot.act(m_Game, input, isPressed))
+				m_Game.apply(input, isPressed);
+			return;
+		}
+		if (tick - m_Origin > m_Replay.endTick)
+			restart(tick);
+		const Timing::Tick gameTick = tick - m_Origin;
+		while (m_Game.advance(gameTick)) {}
+		for (; m_NextInput < m_Replay.inputs.size() && m_Replay.inputs[m_NextInput].tick == gameTick; ++m_NextInput) {
+			const std::uint8_t code = m_Replay.inputs[m_NextInput].code;
+			m_Game.apply(static_cast<Rules::Input>(code & ~Storage::replayPressedBit), (code & Storage::replayPressedBit) != 0);
+		}
+	}
+
+	const Rules::Simulation& getGame()const
+	{
+		return m_Game;
+	}
+private:
+	void restart(Timing::Tick tick)
+	{
+		m_Game = Rules::Simulation(m_Replay.seed);
+		m_Game.setStartLevel(m_Replay.startLevel);
+		m_NextInput = 0;
+		m_Origin = tick;
+	}
+
+	Rules::Simulation m_Game;
+	Rules::Bot m_Bot;
+	bool m_HasReplay;
+	Storage::Replay m_Replay;
+	size_t m_NextInput;
+	Timing::Tick m_Origin;
+};
+
+static void reportLoad(const char* name, const Network::SpectatorLoadTotals& totals, float seconds)
+{
+	std::cout << name << ": " << totals.spectators << " spectators, " << totals.failed << " failed to connect, " << totals.broken << " broken, "
+		<< std::fixed << std::setprecision(1) << totals.frames / seconds << " frames/s, " << totals.bytes / seconds / 1024.f << " KiB/s, "
+		<< totals.keyframes << " keyframes, " << totals.skippedFrames << " frames skipped, " << totals.mismatches << " keyframe mismatches";
+	if (totals.lag.getTotal() != 0)
+		std::cout << ", lag p50 " << totals.lag.getPercentile(50) / 1000.f << " ms p99 " << totals.lag.getPercentile(99) / 1000.f << " ms";
+	std::cout << '\n';
+}
+
+//usage: Broadcast [--port N] [--seed N] [--bot-pace ticks] [--replay file] [--keyframe-interval seconds] [--stats-interval seconds] [--duration seconds]
+//       Broadcast --spectate count [--server address] [--port N] [--slow percent] [--threads N] [--duration seconds]
+//streams one game to every spectator that connects over tcp, a bot game or a replay on a loop
+//--spectate is the load generator, it connects that many spectators, checks their streams and reports what they got
+int main(int argc, char* argv[])
+{
+	unsigned short port{ Network::defaultBroadcastPort };
+	sf::IpAddress server{ sf::IpAddress::LocalHost };
+	std::uint32_t seed{ 1 };
+	Timing::Tick botTicks{ 12 };
+	std::string replayPath;
+	float keyframeInterval{ 1.f };
+	float statsInterval{ 5.f };
+	float duration{ 0.f };
+	size_t spectators{ 0 };
+	unsigned slowPercent{ 5 };
+	size_t threadCount{ std::max(1u, std::thread::hardware_concurrency()) };
+	for (int i{ 1 }; i + 1 < argc; ++i) {
+		const std::string arg{ argv[i] };
+		if (arg == "--port")
+			port = static_cast<unsigned short>(std::stoul(argv[++i]));
+		else if (arg == "--seed")
+			seed = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+		else if (arg == "--bot-pace")
+			botTicks = std::stoul(argv[++i]);
+		else if (arg == "--replay")
+			replayPath = argv[++i];
+		else if (arg == "--keyframe-interval")
+			keyframeInterval = std::stof(argv[++i]);
+		else if (arg == "--stats-interval")
+			statsInterval = std::stof(argv[++i]);
+		else if (arg == "--duration")
+			duration = std::stof(argv[++i]);
+		else if (arg == "--spectate")
+			spectators = std::stoul(argv[++i]);
+		else if (arg == "--server")
+			server = sf::IpAddress(argv[++i]);
+		else if (arg == "--slow")
+			slowPercent = std::min(100u, static_cast<unsigned>(std::stoul(argv[++i])));
+		else if (arg == "--threads")
+			threadCount = std::max<size_t>(1, std::stoul(argv[++i]));
+	}
+	std::signal(SIGINT, stop);
+	std::thread timer([duration] {
+		for (sf::Clock elapsed; running && (duration <= 0.f || elapsed.getElapsedTime().asSeconds() < duration);)
+			sf::sleep(sf::milliseconds(100));
+		running = false;
+	});
+
+	if (spectators != 0) {
+		sf::Clock clock;
+		Network::SpectatorLoadTotals prompt{}, slow{};
+		Network::runSpectators(server, port, spectators, slowPercent, threadCount, running, prompt, slow);
+		timer.join();
+		const float seconds = std::max(clock.getElapsedTime().asSeconds(), 0.001f);
+		reportLoad("prompt", prompt, seconds);
+		reportLoad("slow", slow, seconds);
+		return prompt.mismatches + slow.mismatches == 0 && prompt.broken == 0 ? 0 : 1;
+	}
+
+	Source source(seed, botTicks);
+	if (!replayPath.empty() && !source.loadReplay(replayPath)) {
+		std::cerr << "failed to read replay " << replayPath << '\n';
+		running = false;
+		timer.join();
+		return 1;
+	}
+	Network::Broadcaster broadcaster(Timing::secondsToTicks(keyframeInterval));
+	if (!broadcaster.listen(port)) {
+		std::cerr << "failed to listen on port " << port << '\n';
+		running = false;
+		timer.join();
+		return 1;
+	}
+	std::cout << "broadcasting on port " << port << '\n';
+
+	//the game runs on the wall clock, every tick of it is published in order
+	sf::Clock clock;
+	Timing::Tick tick{ 0 };
+	sf::Time lastReport;
+	Network::BroadcastStats last = broadcaster.getStats();
+	while (running) {
+		const Timing::Tick now = Timing::microsecondsToTicks(clock.getElapsedTime().asMicroseconds());
+		for (; tick < now; ++tick) {
+			source.advance(tick + 1);
+			broadcaster.publish(Network::getSpectatorView(source.getGame()), tick + 1);
+		}
+		broadcaster.serve();
+		sf::sleep(sf::milliseconds(1));
+
+		const sf::Time elapsed = clock.getElapsedTime();
+		if ((elapsed - lastReport).asSeconds() < statsInterval && running)
+			continue;
+		const Network::BroadcastStats stats = broadcaster.getStats();
+		const float seconds = std::max((elapsed - lastReport).asSeconds(), 0.001f);
+		const std::uint64_t encoded = stats.bytesEncoded - last.bytesEncoded;
+		std::cout << std::fixed << std::setprecision(1) << stats.spectators << " spectators (" << stats.joined << " joined, " << stats.dropped << " dropped), "
+			<< (stats.frames - last.frames) / seconds << " frames/s, " << encoded / seconds / 1024.f << " KiB/s encoded, "
+			<< (stats.bytesSent - last.bytesSent) / seconds / 1024.f << " KiB/s sent, "
+			<< (encoded == 0 ? 0.f : static_cast<float>(stats.bytesSent - last.bytesSent) / encoded) << " bytes sent per byte encoded, "
+			<< stats.skips - last.skips << " skips, " << Instrumentation::getResidentMemory() / 1024 << " KiB resident\n";
+		last = stats;
+		lastReport = elapsed;
+	}
+	timer.join();
+}
@@ -0,0 +1,278 @@
+#include <SFML/Network.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Histogram.h"
+#include "Simulation.h"
+#include "../Server/Protocol.h"
+
+//a client that only sends keys, its game is wherever the server says it is
+struct Bot
+{
+	std::uint32_t token;
+	unsigned short serverPort;
+	bool isJoined;
+	std::uint32_t session;
+	//inputs not acknowledged yet, the first of them has sequence firstPending
+	std::vector<sf::Uint8> pending;
+	std::uint32_t firstPending;
+	//when each of the pending inputs was sent first
+	std::vector<sf::Time> firstSent;
+	bool hasNewInput;
+	sf::Time lastSend;
+	sf::Time nextInput;
+};
+
+//what a thread of bots saw, added up by the main thread once it has stopped
+struct BotTotals
+{
+	std::uint64_t joined;
+	std::uint64_t packetsSent;
+	std::uint64_t packetsReceived;
+	std::uint64_t inputsAcknowledged;
+	Instrumentation::HistogramCounts inputRoundTrip;
+};
+
+struct StatsReply
+{
+	sf::Uint8 shards;
+	sf::Uint32 sessions;
+	sf::Uint64 ticks;
+	sf::Uint64 steps;
+	sf::Uint32 stepLatency50;
+	sf::Uint32 stepLatency99;
+	sf::Uint64 residentMemory;
+	sf::Uint32 sessionSize;
+};
+
+static const sf::Time joinRetry = sf::seconds(1);
+static const sf::Time resendInterval = sf::milliseconds(200);
+//how long a thread of bots waits on its socket at most between two rounds over its bots
+static const sf::Time pollInterval = sf::milliseconds(4);
+static const sf::Time warmup = sf::seconds(3);
+//joins and leaves go out in bursts of at most this many per round, the answers to thousands at once would overflow the socket buffers
+static constexpr size_t burstSize = 64;
+
+static void sendTo(sf::UdpSocket& socket, sf::Packet& packet, const sf::IpAddress& address, unsigned short port, BotTotals& totals)
+{
+	if (socket.send(packet, address, port) == sf::Socket::Done)
+		totals.packetsSent += 1;
+}
+
+//every bot of the thread presses a random key about every inputInterval until running turns false, then leaves
+static void runBots(std::vector<Bot> bots, const sf::IpAddress& address, sf::Time inputInterval, const std::atomic<bool>& running, BotTotals& totals)
+{
+	sf::UdpSocket socket;
+	socket.setBlocking(false);
+	if (socket.bind(sf::Socket::AnyPort) != sf::Socket::Done)
+		return;
+	sf::SocketSelector selector;
+	selector.add(socket);
+	std::minstd_rand random(bots.empty() ? 1 : bots.front().token + 1);
+	//a session is only unique on its shard
+	std::unordered_map<std::uint64_t, size_t> sessions;
+	const auto sessionKey = [](unsigned short port, std::uint32_t session) { return static_cast<std::uint64_t>(port) << 32 | session; };
+	const std::uint32_t firstToken = bots.empty() ? 0 : bots.front().token;
+	Instrumentation::Histogram roundTrip;
+	sf::Clock clock;
+	for (auto& bot : bots)
+		bot.nextInput = sf::microseconds(static_cast<sf::Int64>(random() % static_cast<std::uint32_t>(inputInterval.asMicroseconds() + 1)));
+
+	while (running) {
+		const sf::Time now = clock.getElapsedTime();
+		size_t joins{ 0 };
+		for (auto& bot : bots) {
+			sf::Packet packet;
+			if (!bot.isJoined) {
+				if (now - bot.lastSend < joinRetry || ++joins > burstSize)
+					continue;
+				packet << Network::serverProtocolVersion << static_cast<sf::Uint8>(Network::JoinRequest) << bot.token;
+				sendTo(socket, packet, address, bot.serverPort, totals);
+				bot.lastSend = now;
+				continue;
+			}
+			if (now >= bot.nextInput) {
+				const auto input = static_cast<sf::Uint8>(random() % Rules::InputCount);
+				bot.pending.push_back(static_cast<sf::Uint8>(input | (random() % 3 != 0 ? Network::serverPressedBit : 0)));
+				bot.firstSent.push_back(sf::Time::Zero);
+				bot.hasNewInput = true;
+				//spread out, so the bots do not all press at once
+				bot.nextInput += inputInterval / 2ll + sf::microseconds(static_cast<sf::Int64>(random() % static_cast<std::uint32_t>(inputInterval.asMicroseconds() + 1)));
+			}
+			if (bot.pending.empty() || (!bot.hasNewInput && now - bot.lastSend < resendInterval))
+				continue;
+			const size_t count = std::min(bot.pending.size(), Network::maxServerInputsPerPacket);
+			packet << Network::serverProtocolVersion << static_cast<sf::Uint8>(Network::InputBatch) << bot.session << bot.firstPending << static_cast<sf::Uint8>(count);
+			for (size_t i{ 0 }; i < count; ++i) {
+				packet << bot.pending[i];
+				if (bot.firstSent[i] == sf::Time::Zero)
+					bot.firstSent[i] = now;
+			}
+			sendTo(socket, packet, address, bot.serverPort, totals);
+			bot.hasNewInput = false;
+			bot.lastSend = now;
+		}
+
+		if (!selector.wait(pollInterval))
+			continue;
+		sf::Packet packet;
+		sf::IpAddress sender;
+		unsigned short port{ 0 };
+		while (socket.receive(packet, sender, port) == sf::Socket::Done) {
+			totals.packetsReceived += 1;
+			sf::Uint8 version{ 0 }, type{ 0 };
+			sf::Uint32 first{ 0 }, second{ 0 };
+			if (!(packet >> version >> type >> first >> second) || version != Network::serverProtocolVersion)
+				continue;
+			if (type == Network::JoinAccepted) {
+				//first is the token, second the session
+				if (first < firstToken || first - firstToken >= bots.size() || bots[first - firstToken].isJoined)
+					continue;
+				Bot& bot = bots[first - firstToken];
+				bot.isJoined = true;
+				bot.session = second;
+				sessions[sessionKey(port, second)] = first - firstToken;
+				totals.joined += 1;
+			}
+			else if (type == Network::SessionState) {
+				//first is the session, second the inputs it applied
+				const auto found = sessions.find(sessionKey(port, first));
+				if (found == sessions.end())
+					continue;
+				Bot& bot = bots[found->second];
+				const sf::Time received = clock.getElapsedTime();
+				while (bot.firstPending < second && !bot.pending.empty()) {
+					roundTrip.record(static_cast<std::uint64_t>((received - bot.firstSent.front()).asMicroseconds()));
+					bot.pending.erase(bot.pending.begin());
+					bot.firstSent.erase(bot.firstSent.begin());
+					bot.firstPending += 1;
+					totals.inputsAcknowledged += 1;
+				}
+			}
+		}
+	}
+
+	size_t leaves{ 0 };
+	for (const auto& bot : bots) {
+		if (!bot.isJoined)
+			continue;
+		if (++leaves % burstSize == 0)
+			sf::sleep(pollInterval);
+		sf::Packet packet;
+		packet << Network::serverProtocolVersion << static_cast<sf::Uint8>(Network::LeaveRequest) << bot.session;
+		sendTo(socket, packet, address, bot.serverPort, totals);
+	}
+	roundTrip.addTo(totals.inputRoundTrip);
+}
+
+//the totals of every shard, asked for on the first port
+static bool requestStats(sf::UdpSocket& socket, const sf::IpAddress& address, unsigned short port, StatsReply& reply)
+{
+	sf::SocketSelector selector;
+	selector.add(socket);
+	for (int attempt{ 0 }; attempt < 10; ++attempt) {
+		sf::Packet request;
+		request << Network::serverProtocolVersion << static_cast<sf::Uint8>(Network::StatsRequest);
+		socket.send(request, address, port);
+		if (!selector.wait(sf::milliseconds(200)))
+			continue;
+		sf::Packet packet;
+		sf::IpAddress sender;
+		unsigned short senderPort{ 0 };
+		sf::Uint8 version{ 0 }, type{ 0 };
+		while (socket.receive(packet, sender, senderPort) == sf::Socket::Done)
+			if ((packet >> version >> type) && version == Network::serverProtocolVersion && type == Network::StatsReply
+				&& (packet >> reply.shards >> reply.sessions >> reply.ticks >> reply.steps >> reply.stepLatency50 >> reply.stepLatency99
+					>> reply.residentMemory >> reply.sessionSize))
+				return true;
+	}
+	return false;
+}
+
+//usage: LoadTest [--server address] [--port N] [--bots N] [--threads N] [--duration seconds] [--input-interval ms]
+//joins thousands of bots to a server on localhost, each pressing random keys, and reports what the server managed
+int main(int argc, char* argv[])
+{
+	sf::IpAddress address{ sf::IpAddress::LocalHost };
+	unsigned short port{ Network::defaultServerPort };
+	size_t botCount{ 2000 };
+	size_t threadCount{ 4 };
+	float duration{ 10.f };
+	sf::Time inputInterval{ sf::milliseconds(250) };
+	for (int i{ 1 }; i + 1 < argc; ++i) {
+		const std::string arg{ argv[i] };
+		if (arg == "--server")
+			address = sf::IpAddress(argv[++i]);
+		else if (arg == "--port")
+			port = static_cast<unsigned short>(std::stoul(argv[++i]));
+		else if (arg == "--bots")
+			botCount = std::stoul(argv[++i]);
+		else if (arg == "--threads")
+			threadCount = std::max<size_t>(1, std::stoul(argv[++i]));
+		else if (arg == "--duration")
+			duration = std::stof(argv[++i]);
+		else if (arg == "--input-interval")
+			inputInterval = sf::milliseconds(std::stoi(argv[++i]));
+	}
+
+	sf::UdpSocket statsSocket;
+	StatsReply before{}, start{}, end{};
+	if (statsSocket.bind(sf::Socket::AnyPort) != sf::Socket::Done || !requestStats(statsSocket, address, port, before)) {
+		std::cerr << "no server answers on " << address << ':' << port << '\n';
+		return 1;
+	}
+
+	//the bots are spread over the shards and the threads round robin
+	std::vector<std::vector<Bot>> botsOfThreads(threadCount);
+	for (size_t i{ 0 }; i < botCount; ++i) {
+		Bot bot{};
+		bot.token = static_cast<std::uint32_t>(i);
+		bot.serverPort = static_cast<unsigned short>(port + i % before.shards);
+		bot.lastSend = -joinRetry;
+		botsOfThreads[i * threadCount / botCount].push_back(bot);
+	}
+	std::atomic<bool> running{ true };
+	std::vector<BotTotals> totals(threadCount, BotTotals{});
+	std::vector<std::thread> threads;
+	for (size_t i{ 0 }; i < threadCount; ++i)
+		threads.emplace_back(runBots, botsOfThreads[i], address, inputInterval, std::cref(running), std::ref(totals[i]));
+
+	//rates are taken after every bot had the time to join
+	sf::sleep(warmup);
+	const bool hasStart = requestStats(statsSocket, address, port, start);
+	sf::Clock measured;
+	sf::sleep(sf::seconds(duration));
+	const bool hasEnd = requestStats(statsSocket, address, port, end);
+	const float seconds = measured.getElapsedTime().asSeconds();
+	running = false;
+	for (auto& thread : threads)
+		thread.join();
+
+	BotTotals all{};
+	for (const auto& total : totals) {
+		all.joined += total.joined;
+		all.packetsSent += total.packetsSent;
+		all.packetsReceived += total.packetsReceived;
+		all.inputsAcknowledged += total.inputsAcknowledged;
+		all.inputRoundTrip.add(total.inputRoundTrip);
+	}
+	std::cout << all.joined << " of " << botCount << " bots joined over " << static_cast<unsigned>(before.shards) << " shards, "
+		<< all.packetsSent << " packets sent, " << all.packetsReceived << " received\n"
+		<< "input round trip p50 " << all.inputRoundTrip.getPercentile(50) << " us p99 " << all.inputRoundTrip.getPercentile(99)
+		<< " us over " << all.inputsAcknowledged << " inputs\n";
+	if (!hasStart || !hasEnd) {
+		std::cerr << "the server stopped answering\n";
+		return 1;
+	}
+	const std::uint64_t sessions = std::max<std::uint64_t>(end.sessions, 1);
+	std::cout << end.sessions << " sessions: " << static_cast<double>(end.ticks - start.ticks) / seconds << " ticks/s, "
+		<< static_cast<double>(end.steps - start.steps) / seconds << " steps/s, step latency p50 " << end.stepLatency50 << " us p99 " << end.stepLatency99 << " us\n"
+		<< "memory per session " << (end.residentMemory > before.residentMemory ? (end.residentMemory - before.residentMemory) / sessions : 0)
+		<< " B resident, " << end.sessionSize << " B session struct\n";
+}
@@ -0,0 +1,492 @@
+#include "BatchVerifier.h"
+#include <algorithm>
+#include <cstdlib>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Bot.h"
+#include "ByteOrder.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+namespace Verification {
+	static const std::string replayExtension = ".replay";
+	//a thread hands its records to the output in chunks, one lock per few hundred replays
+	static constexpr size_t recordFlushSize = 64 * 1024;
+	//a frame beyond this is not a replay, the connection is dropped
+	static constexpr std::uint32_t maxFrameSize = 1024 * 1024;
+	static constexpr size_t frameHeaderSize = sizeof(std::uint32_t);
+	//submissions waiting for a thread, the sockets are not read while that many are queued
+	static constexpr size_t maxQueuedSubmissions = 4096;
+	static const sf::Time pollInterval = sf::milliseconds(1);
+	static constexpr size_t receiveSize = 64 * 1024;
+
+	std::uint64_t VerifierTotals::getReplays() const
+	{
+		std::uint64_t replays{ 0 };
+		for (const auto count : verdicts)
+			replays += count;
+		return replays;
+	}
+
+	void VerifierTotals::add(const VerifierTotals& totals)
+	{
+		for (size_t i{ 0 }; i < verdicts.size(); ++i)
+			verdicts[i] += totals.verdicts[i];
+		ticks += totals.ticks;
+		bytes += totals.bytes;
+	}
+
+	//what a thread keeps from one replay to the next so that verifying allocates nothing once it is warm
+	struct Worker
+	{
+		Storage::Replay replay;
+		std::vector<std::uint8_t> bytes;
+		std::string records;
+		VerifierTotals totals;
+	};
+
+	static void verify(const std::string& name, const std::uint8_t* data, size_t size, Worker& worker)
+	{
+		Storage::ReplayVerdict verdict{ Storage::ReplayMalformed };
+		if (Storage::decodeReplay(data, size, worker.replay))
+			verdict = Storage::verifyReplay(worker.replay);
+		worker.totals.verdicts[verdict] += 1;
+		worker.totals.bytes += size;
+		worker.records += name;
+		if (verdict == Storage::ReplayAccepted) {
+			worker.totals.ticks += worker.replay.endTick;
+			worker.records += " accept " + std::to_string(worker.replay.score) + ' ' + std::to_string(worker.replay.lines) + ' ' + std::to_string(worker.replay.endTick) + '\n';
+		}
+		else {
+			worker.records += " reject ";
+			worker.records += Storage::getVerdictName(verdict);
+			worker.records += '\n';
+		}
+	}
+
+	static void flushRecords(std::string& records, std::ostream& out, std::mutex& outMutex)
+	{
+		if (records.empty())
+			return;
+		std::lock_guard<std::mutex> lock(outMutex);
+		out.write(records.data(), records.size());
+		records.clear();
+	}
+
+	static bool hasReplayExtension(const std::string& name)
+	{
+		return name.size() > replayExtension.size() && name.compare(name.size() - replayExtension.size(), replayExtension.size(), replayExtension) == 0;
+	}
+
+	//names of the replay files, sorted so that the threads take them in a stable order
+	static std::vector<std::string> listReplays(const std::string& directory)
+	{
+		std::vector<std::string> names;
+#ifdef _WIN32
+		WIN32_FIND_DATAA found;
+		const HANDLE search = FindFirstFileA((directory + "\\*" + replayExtension).c_str(), &found);
+		if (search != INVALID_HANDLE_VALUE) {
+			do {
+				if ((found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0 && hasReplayExtension(found.cFileName))
+					names.push_back(found.cFileName);
+			} while (FindNextFileA(search, &found));
+			FindClose(search);
+		}
+#else
+		if (DIR* listing = opendir(directory.c_str())) {
+			while (const dirent* entry = readdir(listing))
+				if (hasReplayExtension(entry->d_name))
+					names.push_back(entry->d_name);
+			closedir(listing);
+		}
+#endif
+		std::sort(names.begin(), names.end());
+		return names;
+	}
+
+	static std::string joinPath(const std::string& directory, const std::string& name)
+	{
+#ifdef _WIN32
+		return directory + '\\' + name;
+#else
+		return directory + '/' + name;
+#endif
+	}
+
+	//replays are a few kilobytes, reading them into a buffer the thread reuses is cheaper than mapping each
+	static bool readFile(const std::string& path, std::vector<std::uint8_t>& bytes)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file)
+			return false;
+		const std::streamoff size = file.tellg();
+		if (size <= 0 || size > maxFrameSize)
+			return false;
+		bytes.resize(static_cast<size_t>(size));
+		file.seekg(0);
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(bytes.data()), size));
+	}
+
+	VerifierTotals verifyDirectory(const std::string& directory, size_t threadCount, std::ostream& out)
+	{
+		const std::vector<std::string> names = listReplays(directory);
+		//the files are taken one at a time from a shared counter, a long game on one thread does not hold up the others
+		std::atomic<size_t> next{ 0 };
+		std::mutex outMutex;
+		std::vector<Worker> workers(std::max<size_t>(1, threadCount));
+		const auto work = [&](Worker& worker) {
+			for (size_t index = next++; index < names.size(); index = next++) {
+				if (readFile(joinPath(directory, names[index]), worker.bytes))
+					verify(names[index], worker.bytes.data(), worker.bytes.size(), worker);
+				else
+					verify(names[index], nullptr, 0, worker);
+				if (worker.records.size() >= recordFlushSize)
+					flushRecords(worker.records, out, outMutex);
+			}
+			flushRecords(worker.records, out, outMutex);
+		};
+		std::vector<std::thread> threads;
+		for (size_t i{ 1 }; i < workers.size(); ++i)
+			threads.emplace_back(work, std::ref(workers[i]));
+		work(workers[0]);
+		for (auto& thread : threads)
+			thread.join();
+
+		VerifierTotals totals{};
+		for (const auto& worker : workers)
+			totals.add(worker.totals);
+		return totals;
+	}
+
+	struct Submission
+	{
+		std::uint64_t connection;
+		std::uint64_t sequence;
+		std::vector<std::uint8_t> bytes;
+	};
+
+	struct Connection
+	{
+		std::unique_ptr<sf::TcpSocket> socket;
+		std::uint64_t id;
+		//received bytes of frames that are not complete yet and records not sent yet
+		std::vector<std::uint8_t> inbox;
+		std::string outbox;
+		std::uint64_t submitted;
+		std::uint64_t answered;
+		//the submitter closed its side, it still gets the records of what it sent
+		bool isDrained;
+		bool isBroken;
+	};
+
+	//submissions go to the threads through a queue, records come back through another
+	struct SubmissionQueue
+	{
+		std::mutex mutex;
+		std::condition_variable ready;
+		std::deque<Submission> submissions;
+		//records by connection, the socket thread sends them on
+		std::vector<std::pair<std::uint64_t, std::string>> records;
+		bool isStopping;
+	};
+
+	//moves the complete frames out of the inbox, false when the submitter sent something that is not a frame
+	static bool takeFrames(Connection& connection, SubmissionQueue& queue)
+	{
+		size_t offset{ 0 };
+		std::vector<Submission> frames;
+		while (connection.inbox.size() - offset >= frameHeaderSize) {
+			const std::uint32_t size = Storage::loadLittleEndian<std::uint32_t>(connection.inbox.data(), offset);
+			if (size == 0 || size > maxFrameSize)
+				return false;
+			if (connection.inbox.size() - offset - frameHeaderSize < size)
+				break;
+			const auto begin = connection.inbox.begin() + static_cast<std::ptrdiff_t>(offset + frameHeaderSize);
+			frames.push_back({ connection.id, connection.submitted++, std::vector<std::uint8_t>(begin, begin + size) });
+			offset += frameHeaderSize + size;
+		}
+		connection.inbox.erase(connection.inbox.begin(), connection.inbox.begin() + static_cast<std::ptrdiff_t>(offset));
+		if (frames.empty())
+			return true;
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			for (auto& frame : frames)
+				queue.submissions.push_back(std::move(frame));
+		}
+		queue.ready.notify_all();
+		return true;
+	}
+
+	static void verifySubmissions(SubmissionQueue& queue, Worker& worker)
+	{
+		std::unique_lock<std::mutex> lock(queue.mutex);
+		for (;;) {
+			queue.ready.wait(lock, [&queue] { return queue.isStopping || !queue.submissions.empty(); });
+			if (queue.submissions.empty())
+				return;
+			Submission submission = std::move(queue.submissions.front());
+			queue.submissions.pop_front();
+			lock.unlock();
+			verify(std::to_string(submission.sequence), submission.bytes.data(), submission.bytes.size(), worker);
+			lock.lock();
+			queue.records.emplace_back(submission.connection, std::move(worker.records));
+			worker.records.clear();
+		}
+	}
+
+	VerifierTotals serveSubmissions(sf::TcpListener& listener, size_t threadCount, std::ostream& out, const std::atomic<bool>& running)
+	{
+		SubmissionQueue queue;
+		queue.isStopping = false;
+		std::vector<Worker> workers(std::max<size_t>(1, threadCount));
+		std::vector<std::thread> threads;
+		for (auto& worker : workers)
+			threads.emplace_back(verifySubmissions, std::ref(queue), std::ref(worker));
+
+		//the socket thread only moves bytes, every replay is decoded and played by the workers
+		sf::SocketSelector selector;
+		selector.add(listener);
+		std::vector<Connection> connections;
+		std::uint64_t nextId{ 0 };
+		std::vector<std::uint8_t> received(receiveSize);
+		std::vector<std::pair<std::uint64_t, std::string>> records;
+		while (running) {
+			size_t queued{ 0 };
+			{
+				std::lock_guard<std::mutex> lock(queue.mutex);
+				queued = queue.submissions.size();
+				records.swap(queue.records);
+			}
+			for (auto& record : records) {
+				out.write(record.second.data(), record.second.size());
+				for (auto& connection : connections)
+					if (connection.id == record.first) {
+						connection.outbox += record.second;
+						connection.answered += 1;
+					}
+			}
+			records.clear();
+
+			for (auto& connection : connections) {
+				if (connection.outbox.empty() || connection.isBroken)
+					continue;
+				size_t sent{ 0 };
+				const sf::Socket::Status status = connection.socket->send(connection.outbox.data(), connection.outbox.size(), sent);
+				connection.outbox.erase(0, sent);
+				connection.isBroken = status == sf::Socket::Disconnected || status == sf::Socket::Error;
+			}
+			const auto isDone = [&selector](Connection& connection) {
+				const bool isFinished = connection.isBroken || (connection.isDrained && connection.answered == connection.submitted && connection.outbox.empty());
+				if (isFinished)
+					selector.remove(*connection.socket);
+				return isFinished;
+			};
+			connections.erase(std::remove_if(connections.begin(), connections.end(), isDone), connections.end());
+
+			//a full queue is left to fill the submitters' socket buffers, that slows them down to what the threads keep up with
+			if (queued >= maxQueuedSubmissions) {
+				sf::sleep(pollInterval);
+				continue;
+			}
+			if (!selector.wait(pollInterval))
+				continue;
+			if (selector.isReady(listener)) {
+				std::unique_ptr<sf::TcpSocket> socket(new sf::TcpSocket);
+				if (listener.accept(*socket) == sf::Socket::Done) {
+					socket->setBlocking(false);
+					selector.add(*socket);
+					connections.push_back({ std::move(socket), nextId++, {}, {}, 0, 0, false, false });
+				}
+			}
+			for (auto& connection : connections) {
+				if (connection.isDrained || connection.isBroken || !selector.isReady(*connection.socket))
+					continue;
+				size_t size{ 0 };
+				const sf::Socket::Status status = connection.socket->receive(received.data(), received.size(), size);
+				if (status == sf::Socket::Done) {
+					connection.inbox.insert(connection.inbox.end(), received.begin(), received.begin() + static_cast<std::ptrdiff_t>(size));
+					connection.isBroken = !takeFrames(connection, queue);
+				}
+				else if (status == sf::Socket::Disconnected) {
+					connection.isDrained = true;
+					selector.remove(*connection.socket);
+				}
+				else if (status == sf::Socket::Error)
+					connection.isBroken = true;
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.isStopping = true;
+		}
+		queue.ready.notify_all();
+		for (auto& thread : threads)
+			thread.join();
+		for (const auto& record : queue.records)
+			out.write(record.second.data(), record.second.size());
+
+		VerifierTotals totals{};
+		for (const auto& worker : workers)
+			totals.add(worker.totals);
+		return totals;
+	}
+
+	bool submitDirectory(const std::string& directory, const sf::IpAddress& address, unsigned short port, std::ostream& out)
+	{
+		const std::vector<std::string> names = listReplays(directory);
+		sf::TcpSocket socket;
+		if (socket.connect(address, port, sf::seconds(5)) != sf::Socket::Done)
+			return false;
+		//one thread sends while this one reads the records, neither side's socket buffer fills up with the other waiting
+		std::atomic<bool> isSent{ true };
+		std::thread sender([&] {
+			std::vector<std::uint8_t> frame;
+			for (const auto& name : names) {
+				if (!readFile(joinPath(directory, name), frame)) {
+					//a replay that can not be read still takes its place in the sequence
+					frame.assign(1, 0);
+				}
+				const auto size = static_cast<std::uint32_t>(frame.size());
+				std::uint8_t header[frameHeaderSize];
+				Storage::storeLittleEndian(header, 0, size);
+				if (socket.send(header, sizeof(header)) != sf::Socket::Done || socket.send(frame.data(), frame.size()) != sf::Socket::Done) {
+					isSent = false;
+					return;
+				}
+			}
+		});
+
+		//the records come back named by sequence, the file names are put in their place
+		size_t answered{ 0 };
+		bool isMalformed{ false };
+		std::string pending;
+		std::vector<char> received(receiveSize);
+		while (answered < names.size() && !isMalformed) {
+			size_t size{ 0 };
+			if (socket.receive(received.data(), received.size(), size) != sf::Socket::Done)
+				break;
+			pending.append(received.data(), size);
+			size_t begin{ 0 };
+			for (size_t end = pending.find('\n'); end != std::string::npos; end = pending.find('\n', begin)) {
+				//a line that does not start with a sequence and a space ends the submission as failed
+				const char* first = pending.c_str() + begin;
+				char* last{ nullptr };
+				const unsigned long sequence = std::strtoul(first, &last, 10);
+				const size_t space = static_cast<size_t>(last - pending.c_str());
+				if (*first < '0' || *first > '9' || space >= end || *last != ' ') {
+					isMalformed = true;
+					break;
+				}
+				if (sequence < names.size())
+					out << names[sequence] << pending.substr(space, end + 1 - space);
+				answered += 1;
+				begin = end + 1;
+			}
+			pending.erase(0, begin);
+		}
+		sender.join();
+		socket.disconnect();
+		return isSent && !isMalformed && answered == names.size();
+	}
+
+	//what the game reached at its current tick is what the replay claims, the verifier has to arrive at the same
+	static void endReplay(const Rules::Simulation& game, Storage::Replay& replay)
+	{
+		replay.endTick = game.getTick();
+		replay.score = game.getScore();
+		replay.lines = game.getLines();
+		replay.checksum = game.getChecksum();
+	}
+
+	//a bot from a random seed and start level with a few key events a second, the replay ends on the last tick before its first top out
+	static void playBot(std::uint32_t seed, Storage::Replay& replay)
+	{
+		replay.seed = seed;
+		replay.startLevel = static_cast<std::uint8_t>(seed % 8);
+		replay.inputs.clear();
+		Rules::Simulation game(seed);
+		game.setStartLevel(replay.startLevel);
+		Rules::Bot bot(seed, 12 + seed % 12);
+		for (;;) {
+			const Timing::Tick inputTick = std::max(bot.getNextTick(), game.getTick() + 1);
+			const Rules::Simulation before(game);
+			while (game.advance(inputTick)) {}
+			if (game.getTopOuts() != 0) {
+				//the new game has replaced the lost one by now, it is played again a tick at a time to find the last tick of the old
+				game = before;
+				for (;;) {
+					Rules::Simulation after(game);
+					while (after.advance(game.getTick() + 1)) {}
+					if (after.getTopOuts() != 0)
+						break;
+					game = after;
+				}
+				endReplay(game, replay);
+				return;
+			}
+			Rules::Input key{ Rules::InputCount };
+			bool isPressed{ false };
+			if (!bot.act(game, key, isPressed))
+				continue;
+			//timers due at the tick of the input run after it, the game can end right there and the input is left out then
+			const Rules::Simulation unpressed(game);
+			game.apply(key, isPressed);
+			while (game.advance(inputTick)) {}
+			if (game.getTopOuts() != 0) {
+				endReplay(unpressed, replay);
+				return;
+			}
+			replay.inputs.push_back({ inputTick, static_cast<std::uint8_t>(key | (isPressed ? Storage::replayPressedBit : 0)) });
+		}
+	}
+
+	bool generateReplays(const std::string& directory, size_t count, std::uint32_t seed, unsigned tamperedPercent, size_t threadCount)
+	{
+		std::atomic<size_t> next{ 0 };
+		std::atomic<bool> isWritten{ true };
+		const auto work = [&] {
+			Storage::Replay replay;
+			std::vector<std::uint8_t> bytes;
+			for (size_t index = next++; index < count && isWritten; index = next++) {
+				std::uint32_t random = Rules::getSeededRandomState(seed + static_cast<std::uint32_t>(index) * 7919);
+				playBot(random, replay);
+				//a forged claim, a forged board or a file damaged on its way
+				random = Rules::getNextRandomState(random);
+				const bool isTampered = random % 100 < tamperedPercent;
+				const std::uint32_t tampering = random / 100 % 3;
+				if (isTampered && tampering == 0)
+					replay.score += 100;
+				else if (isTampered && tampering == 1)
+					replay.checksum ^= 1;
+				Storage::encodeReplay(replay, bytes);
+				if (isTampered && tampering == 2)
+					bytes[bytes.size() / 2] ^= 0x10;
+
+				std::string name = std::to_string(index);
+				name.insert(0, name.size() < 8 ? 8 - name.size() : 0, '0');
+				std::ofstream file(joinPath(directory, name + replayExtension), std::ios::binary | std::ios::trunc);
+				if (!file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size()))
+					isWritten = false;
+			}
+		};
+		std::vector<std::thread> threads;
+		for (size_t i{ 1 }; i < std::max<size_t>(1, threadCount); ++i)
+			threads.emplace_back(work);
+		work();
+		for (auto& thread : threads)
+			thread.join();
+		return isWritten;
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include "Replay.h"
+
+namespace Verification {
+	//the replays a verifier went through, added up over its threads
+	struct VerifierTotals
+	{
+		std::array<std::uint64_t, Storage::ReplayVerdictCount> verdicts;
+		//game ticks played back and replay bytes read
+		std::uint64_t ticks;
+		std::uint64_t bytes;
+
+		std::uint64_t getReplays()const;
+		void add(const VerifierTotals& totals);
+	};
+
+	//a record is a line per replay, its name followed by "accept score lines ticks" or "reject reason"
+	//records are written in the order the replays finish, not the order they came in
+
+	//verifies every .replay file of directory on threadCount threads
+	VerifierTotals verifyDirectory(const std::string& directory, size_t threadCount, std::ostream& out);
+	//verifies replays sent over tcp until running turns false, each as a 32 bit little endian size and the replay
+	//a submitter gets the record of each of its replays back, named by the replay's position on its connection from 0
+	VerifierTotals serveSubmissions(sf::TcpListener& listener, size_t threadCount, std::ostream& out, const std::atomic<bool>& running);
+	//sends every .replay file of directory to a verifier serving submissions and writes the records it answers with
+	bool submitDirectory(const std::string& directory, const sf::IpAddress& address, unsigned short port, std::ostream& out);
+	//writes count replays of bots playing from random seeds until just before they top out, tamperedPercent of them forged
+	bool generateReplays(const std::string& directory, size_t count, std::uint32_t seed, unsigned tamperedPercent, size_t threadCount);
+}
@@ -0,0 +1,117 @@
+#include "BatchVerifier.h"
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <iostream>
+#include <string>
+#include <thread>
+
+static std::atomic<bool> running{ true };
+
+static void stop(int)
+{
+	running = false;
+}
+
+static void report(const Verification::VerifierTotals& totals, sf::Time elapsed, size_t threadCount)
+{
+	const float seconds = std::max(elapsed.asSeconds(), 0.001f);
+	const std::uint64_t replays = totals.getReplays();
+	std::cerr << "verified " << replays << " replays on " << threadCount << " threads in " << seconds << " s: "
+		<< totals.verdicts[Storage::ReplayAccepted] << " accepted, " << replays - totals.verdicts[Storage::ReplayAccepted] << " rejected\n";
+	for (size_t verdict{ Storage::ReplayMalformed }; verdict < Storage::ReplayVerdictCount; ++verdict)
+		if (totals.verdicts[verdict] != 0)
+			std::cerr << "  " << Storage::getVerdictName(static_cast<Storage::ReplayVerdict>(verdict)) << ": " << totals.verdicts[verdict] << '\n';
+	std::cerr << replays / seconds << " games/s, " << replays / seconds / threadCount << " games/s per thread, "
+		<< totals.ticks / seconds / 1e6f << " M ticks/s, " << totals.bytes / seconds / 1e6f << " MB/s";
+	if (replays != 0)
+		std::cerr << ", " << static_cast<float>(totals.ticks) / totals.verdicts[Storage::ReplayAccepted] / Timing::TicksPerSecond << " s per accepted game";
+	std::cerr << '\n';
+}
+
+//usage: ReplayVerifier <directory> [--threads N]
+//       ReplayVerifier --listen port [--threads N] [--duration seconds]
+//       ReplayVerifier --submit <directory> [--server address] [--port N]
+//       ReplayVerifier --generate <directory> count [--seed N] [--tampered percent] [--threads N]
+//plays submitted replays back without rendering on every core and writes an accept or reject record per replay to stdout,
+//the rates go to stderr, --generate fills an existing directory with bot games to verify
+int main(int argc, char* argv[])
+{
+	std::string directory;
+	std::string mode{ "directory" };
+	size_t count{ 0 };
+	unsigned short port{ 47100 };
+	sf::IpAddress server{ sf::IpAddress::LocalHost };
+	size_t threadCount{ std::max(1u, std::thread::hardware_concurrency()) };
+	std::uint32_t seed{ 1 };
+	unsigned tamperedPercent{ 5 };
+	float duration{ 0.f };
+	for (int i{ 1 }; i < argc; ++i) {
+		const std::string arg{ argv[i] };
+		if (arg == "--listen" && i + 1 < argc) {
+			mode = "listen";
+			port = static_cast<unsigned short>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--submit" && i + 1 < argc) {
+			mode = "submit";
+			directory = argv[++i];
+		}
+		else if (arg == "--generate" && i + 2 < argc) {
+			mode = "generate";
+			directory = argv[++i];
+			count = std::stoul(argv[++i]);
+		}
+		else if (arg == "--server" && i + 1 < argc)
+			server = sf::IpAddress(argv[++i]);
+		else if (arg == "--port" && i + 1 < argc)
+			port = static_cast<unsigned short>(std::stoul(argv[++i]));
+		else if (arg == "--threads" && i + 1 < argc)
+			threadCount = std::max<size_t>(1, std::stoul(argv[++i]));
+		else if (arg == "--seed" && i + 1 < argc)
+			seed = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+		else if (arg == "--tampered" && i + 1 < argc)
+			tamperedPercent = std::min(100u, static_cast<unsigned>(std::stoul(argv[++i])));
+		else if (arg == "--duration" && i + 1 < argc)
+			duration = std::stof(argv[++i]);
+		else
+			directory = arg;
+	}
+
+	sf::Clock clock;
+	if (mode == "generate") {
+		if (!Verification::generateReplays(directory, count, seed, tamperedPercent, threadCount)) {
+			std::cerr << "failed to write replays to " << directory << '\n';
+			return 1;
+		}
+		std::cerr << "wrote " << count << " replays to " << directory << " in " << clock.getElapsedTime().asSeconds() << " s\n";
+		return 0;
+	}
+	if (mode == "submit")
+		return Verification::submitDirectory(directory, server, port, std::cout) ? 0 : 1;
+	if (mode == "listen") {
+		sf::TcpListener listener;
+		listener.setBlocking(false);
+		if (listener.listen(port) != sf::Socket::Done) {
+			std::cerr << "failed to listen on port " << port << '\n';
+			return 1;
+		}
+		std::signal(SIGINT, stop);
+		std::cerr << "verifying submissions on port " << port << '\n';
+		std::thread timer([duration] {
+			for (sf::Clock elapsed; running && (duration <= 0.f || elapsed.getElapsedTime().asSeconds() < duration);)
+				sf::sleep(sf::milliseconds(100));
+			running = false;
+		});
+		const Verification::VerifierTotals totals = Verification::serveSubmissions(listener, threadCount, std::cout, running);
+		timer.join();
+		report(totals, clock.getElapsedTime(), threadCount);
+		return 0;
+	}
+	if (directory.empty()) {
+		std::cerr << "no replay directory given\n";
+		return 1;
+	}
+	const Verification::VerifierTotals totals = Verification::verifyDirectory(directory, threadCount, std::cout);
+	report(totals, clock.getElapsedTime(), threadCount);
+	return 0;
+}
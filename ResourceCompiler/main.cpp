@@ -0,0 +1,234 @@
+#include "../Tetris/AssetPack.h"
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//usage: ResourceCompiler <Recources directory> <output .cpp>
+//decodes the assets the game uses and writes them as byte arrays for Resources.h
+//the output is only rewritten when it changes, so an unchanged asset set does not trigger a rebuild
+//
+//usage: ResourceCompiler --pack <output .pack> <theme>=<directory>...
+//builds an AssetPack, every theme directory holds a block_textures.png laid out like the one in Recources
+//and optionally font.ttf and palette.txt (one "r g b" line per piece in the order I L S J T Z O)
+
+static const sf::IntRect blockTileRect{ 80, 8, 64, 64 };
+static const sf::IntRect wallTileRect{ 352, 248, 16, 16 };
+
+static sf::Image crop(const sf::Image& atlas, const sf::IntRect& rect)
+{
+	sf::Image image;
+	image.create(rect.width, rect.height);
+	image.copy(atlas, 0, 0, rect);
+	return image;
+}
+
+static unsigned luminance(sf::Color pixel)
+{
+	return (299u * pixel.r + 587u * pixel.g + 114u * pixel.b) / 1000u;
+}
+
+//stretch luminance so the brightest texel keeps the full palette colour
+static void desaturate(sf::Image& image)
+{
+	const sf::Vector2u size = image.getSize();
+	unsigned maxLuminance{ 1 };
+	for (unsigned y{ 0 }; y < size.y; ++y)
+		for (unsigned x{ 0 }; x < size.x; ++x)
+			maxLuminance = std::max(maxLuminance, luminance(image.getPixel(x, y)));
+	for (unsigned y{ 0 }; y < size.y; ++y)
+		for (unsigned x{ 0 }; x < size.x; ++x) {
+			const sf::Color pixel = image.getPixel(x, y);
+			const auto grey = static_cast<sf::Uint8>(std::min(255u, luminance(pixel) * 255u / maxLuminance));
+			image.setPixel(x, y, sf::Color(grey, grey, grey, pixel.a));
+		}
+}
+
+static void writeBytes(std::ostream& out, const char* type, const std::string& name, const unsigned char* bytes, size_t size)
+{
+	out << "\tstatic const " << type << ' ' << name << "[] = {";
+	for (size_t i{ 0 }; i < size; ++i) {
+		if (i % 24 == 0)
+			out << "\n\t\t";
+		out << static_cast<unsigned>(bytes[i]) << ',';
+	}
+	out << "\n\t};\n";
+}
+
+static void writeImage(std::ostream& out, const std::string& name, const sf::Image& image)
+{
+	const sf::Vector2u size = image.getSize();
+	writeBytes(out, "sf::Uint8", name + "Pixels", image.getPixelsPtr(), size.x * size.y * 4);
+	out << "\tconst ImageData " << name << "{ " << size.x << ", " << size.y << ", " << name << "Pixels };\n\n";
+}
+
+static void writeFile(std::ostream& out, const std::string& name, const std::vector<char>& file)
+{
+	writeBytes(out, "unsigned char", name + "Bytes", reinterpret_cast<const unsigned char*>(file.data()), file.size());
+	out << "\tconst FileData " << name << "{ " << name << "Bytes, sizeof(" << name << "Bytes) };\n\n";
+}
+
+static bool readFile(const std::string& path, std::vector<char>& bytes)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		return false;
+	bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return true;
+}
+
+struct PackBlob
+{
+	Resources::PackEntry entry;
+	std::vector<unsigned char> bytes;
+};
+
+static void addBlob(std::vector<PackBlob>& blobs, const std::string& name, Resources::PackEntryType type,
+	unsigned width, unsigned height, const unsigned char* bytes, size_t size)
+{
+	PackBlob blob{};
+	//the entry is zeroed, so the copy stays terminated
+	std::memcpy(blob.entry.name, name.c_str(), std::min(name.size(), Resources::packNameLength - 1));
+	blob.entry.type = type;
+	blob.entry.width = width;
+	blob.entry.height = height;
+	blob.entry.size = size;
+	blob.bytes.assign(bytes, bytes + size);
+	blobs.push_back(std::move(blob));
+}
+
+static void addImage(std::vector<PackBlob>& blobs, const std::string& name, const sf::Image& image)
+{
+	const sf::Vector2u size = image.getSize();
+	addBlob(blobs, name, Resources::PackEntryType::Image, size.x, size.y, image.getPixelsPtr(), size.x * size.y * 4);
+}
+
+static bool addTheme(std::vector<PackBlob>& blobs, const std::string& theme, const std::string& directory)
+{
+	if (theme.empty() || theme.size() + std::strlen("/blockTile") >= Resources::packNameLength) {
+		std::cerr << "ResourceCompiler: theme name \"" << theme << "\" is empty or too long\n";
+		return false;
+	}
+	sf::Image atlas;
+	if (!atlas.loadFromFile(directory + "/block_textures.png")) {
+		std::cerr << "ResourceCompiler: cannot decode " << directory << "/block_textures.png\n";
+		return false;
+	}
+	sf::Image blockTile = crop(atlas, blockTileRect);
+	desaturate(blockTile);
+	addImage(blobs, theme + "/blockTile", blockTile);
+	addImage(blobs, theme + "/wallTile", crop(atlas, wallTileRect));
+
+	std::vector<char> font;
+	if (readFile(directory + "/font.ttf", font))
+		addBlob(blobs, theme + "/font", Resources::PackEntryType::File, 0, 0, reinterpret_cast<const unsigned char*>(font.data()), font.size());
+
+	std::ifstream paletteFile(directory + "/palette.txt");
+	if (paletteFile) {
+		//same layout as Blocks::Palette, the first colour belongs to empty cells and stays transparent
+		std::vector<unsigned char> palette(4, 0);
+		unsigned r, g, b;
+		while (paletteFile >> r >> g >> b)
+			palette.insert(palette.end(), { static_cast<unsigned char>(r), static_cast<unsigned char>(g), static_cast<unsigned char>(b), 255 });
+		if (palette.size() != 8 * 4) {
+			std::cerr << "ResourceCompiler: " << directory << "/palette.txt needs 7 colours\n";
+			return false;
+		}
+		addBlob(blobs, theme + "/palette", Resources::PackEntryType::File, 0, 0, palette.data(), palette.size());
+	}
+	return true;
+}
+
+static std::uint64_t alignUp(std::uint64_t offset)
+{
+	return (offset + Resources::packAlignment - 1) / Resources::packAlignment * Resources::packAlignment;
+}
+
+static int buildPack(int argc, char* argv[])
+{
+	std::vector<PackBlob> blobs;
+	for (int i{ 3 }; i < argc; ++i) {
+		const std::string argument{ argv[i] };
+		const size_t separator = argument.find('=');
+		if (separator == std::string::npos || !addTheme(blobs, argument.substr(0, separator), argument.substr(separator + 1)))
+			return 1;
+	}
+
+	Resources::PackHeader header{};
+	std::memcpy(header.magic, Resources::packMagic, sizeof(header.magic));
+	header.version = Resources::packVersion;
+	header.entryCount = static_cast<std::uint32_t>(blobs.size());
+	std::uint64_t offset = sizeof(header) + blobs.size() * sizeof(Resources::PackEntry);
+	for (auto& blob : blobs) {
+		offset = alignUp(offset);
+		blob.entry.offset = offset;
+		offset += blob.entry.size;
+	}
+
+	std::ofstream pack(argv[2], std::ios::binary);
+	pack.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	for (const auto& blob : blobs)
+		pack.write(reinterpret_cast<const char*>(&blob.entry), sizeof(blob.entry));
+	std::uint64_t written = sizeof(header) + blobs.size() * sizeof(Resources::PackEntry);
+	for (const auto& blob : blobs) {
+		const std::vector<char> padding(static_cast<size_t>(blob.entry.offset - written), 0);
+		pack.write(padding.data(), padding.size());
+		pack.write(reinterpret_cast<const char*>(blob.bytes.data()), blob.bytes.size());
+		written = blob.entry.offset + blob.entry.size;
+	}
+	if (!pack) {
+		std::cerr << "ResourceCompiler: cannot write " << argv[2] << '\n';
+		return 1;
+	}
+	std::cout << "packed " << blobs.size() << " assets, " << written << " bytes\n";
+	return 0;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc > 3 && std::string(argv[1]) == "--pack")
+		return buildPack(argc, argv);
+	if (argc != 3) {
+		std::cerr << "usage: ResourceCompiler <Recources directory> <output .cpp>\n"
+			"       ResourceCompiler --pack <output .pack> <theme>=<directory>...\n";
+		return 1;
+	}
+	const std::string directory = std::string(argv[1]) + '/';
+
+	sf::Image atlas;
+	std::vector<char> font;
+	if (!atlas.loadFromFile(directory + "block_textures.png")) {
+		std::cerr << "ResourceCompiler: cannot decode " << directory << "block_textures.png\n";
+		return 1;
+	}
+	if (!readFile(directory + "courbd.ttf", font)) {
+		std::cerr << "ResourceCompiler: cannot read " << directory << "courbd.ttf\n";
+		return 1;
+	}
+	sf::Image blockTile = crop(atlas, blockTileRect);
+	desaturate(blockTile);
+
+	std::ostringstream out;
+	out << "//generated by ResourceCompiler from Recources, do not edit\n#include \"Resources.h\"\n\nnamespace Resources {\n";
+	writeImage(out, "blockTile", blockTile);
+	writeImage(out, "wallTile", crop(atlas, wallTileRect));
+	writeFile(out, "scoreFont", font);
+	out << "}\n";
+
+	std::vector<char> previous;
+	const std::string generated = out.str();
+	if (readFile(argv[2], previous) && std::string(previous.begin(), previous.end()) == generated)
+		return 0;
+	std::ofstream file(argv[2], std::ios::binary);
+	if (!(file << generated)) {
+		std::cerr << "ResourceCompiler: cannot write " << argv[2] << '\n';
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,132 @@
+#include <SFML/Network.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_set>
+
+static constexpr unsigned short defaultPort = 47400;
+static const sf::Time pollInterval = sf::milliseconds(100);
+//the submitter sends a request at once, one that does not is not waited for
+static const sf::Time requestTimeout = sf::seconds(2);
+//a full batch of the submitter is about 15KB
+static constexpr size_t maxRequestSize = 1024 * 1024;
+
+static std::atomic<bool> running{ true };
+
+static void stop(int)
+{
+	running = false;
+}
+
+//reads one request, false when it does not arrive whole in time
+static bool receiveRequest(sf::TcpSocket& socket, std::string& head, std::string& body)
+{
+	sf::SocketSelector selector;
+	selector.add(socket);
+	sf::Clock clock;
+	std::string request;
+	size_t headSize{ std::string::npos }, contentLength{ 0 };
+	char buffer[4096];
+	while (headSize == std::string::npos || request.size() < headSize + contentLength) {
+		const sf::Time left = requestTimeout - clock.getElapsedTime();
+		size_t received{ 0 };
+		if (request.size() > maxRequestSize || left <= sf::Time::Zero || !selector.wait(left)
+			|| socket.receive(buffer, sizeof(buffer), received) != sf::Socket::Done)
+			return false;
+		request.append(buffer, received);
+		if (headSize != std::string::npos || request.find("\r\n\r\n") == std::string::npos)
+			continue;
+		headSize = request.find("\r\n\r\n") + 4;
+		std::string lower{ request.substr(0, headSize) };
+		std::transform(lower.begin(), lower.end(), lower.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+		const size_t field = lower.find("\r\ncontent-length:");
+		if (field != std::string::npos)
+			contentLength = std::stoul(lower.substr(field + 17, lower.find("\r\n", field + 2) - field - 17));
+	}
+	head = request.substr(0, headSize);
+	body = request.substr(headSize, contentLength);
+	return true;
+}
+
+static void answer(sf::TcpSocket& socket, const std::string& status, const std::string& body)
+{
+	const std::string response{ "HTTP/1.1 " + status + "\r\nContent-Type: application/json\r\nContent-Length: " + std::to_string(body.size())
+		+ "\r\nConnection: close\r\n\r\n" + body };
+	socket.send(response.data(), response.size());
+}
+
+//usage: ScoreStub [--port N] [--fail percent] [--log file]
+//a stand-in for the score endpoint, it takes posts of {"scores":[...]} on any path and answers 200, or 503 to --fail percent of them
+//a game whose id it has seen before is counted once, a submitter resends a batch whose answer it did not get
+//--log appends the body of every accepted batch to file, one line each
+int main(int argc, char* argv[])
+{
+	unsigned short port{ defaultPort };
+	unsigned failPercent{ 0 };
+	std::string logPath;
+	for (int i{ 1 }; i + 1 < argc; ++i) {
+		const std::string arg{ argv[i] };
+		if (arg == "--port")
+			port = static_cast<unsigned short>(std::stoul(argv[++i]));
+		else if (arg == "--fail")
+			failPercent = std::min(100u, static_cast<unsigned>(std::stoul(argv[++i])));
+		else if (arg == "--log")
+			logPath = argv[++i];
+	}
+	sf::TcpListener listener;
+	if (listener.listen(port) != sf::Socket::Done) {
+		std::cerr << "failed to listen on port " << port << '\n';
+		return 1;
+	}
+	std::ofstream log;
+	if (!logPath.empty())
+		log.open(logPath, std::ios::app);
+	std::signal(SIGINT, stop);
+	std::cout << "taking scores on http port " << port << '\n';
+
+	std::mt19937 random(std::random_device{}());
+	std::unordered_set<std::string> seen;
+	size_t batches{ 0 }, failed{ 0 };
+	sf::SocketSelector selector;
+	selector.add(listener);
+	while (running) {
+		sf::TcpSocket socket;
+		if (!selector.wait(pollInterval) || listener.accept(socket) != sf::Socket::Done)
+			continue;
+		std::string head, body;
+		if (!receiveRequest(socket, head, body))
+			continue;
+		if (head.compare(0, 5, "POST ") != 0) {
+			answer(socket, "405 Method Not Allowed", "{\"error\":\"only POST is taken\"}");
+			continue;
+		}
+		if (random() % 100 < failPercent) {
+			failed += 1;
+			answer(socket, "503 Service Unavailable", "{\"error\":\"failing on purpose\"}");
+			std::cout << "failed a request on purpose, " << failed << " so far\n";
+			continue;
+		}
+		//every game is an object with an "id" that is 16 hex digits in quotes
+		static const std::string idField{ "\"id\":\"" };
+		size_t games{ 0 }, fresh{ 0 };
+		for (size_t at{ body.find(idField) }; at != std::string::npos; at = body.find(idField, at + idField.size())) {
+			games += 1;
+			fresh += seen.insert(body.substr(at + idField.size(), 16)).second ? 1 : 0;
+		}
+		if (body.compare(0, 10, "{\"scores\":") != 0 || games == 0) {
+			answer(socket, "400 Bad Request", "{\"error\":\"expected {\\\"scores\\\":[...]}\"}");
+			std::cout << "refused a request that was not a batch of scores\n";
+			continue;
+		}
+		batches += 1;
+		if (log.is_open())
+			log << body << '\n' << std::flush;
+		answer(socket, "200 OK", "{\"accepted\":" + std::to_string(games) + "}");
+		std::cout << "batch " << batches << " of " << games << " games, " << fresh << " new, " << seen.size() << " games in total\n";
+	}
+}
@@ -0,0 +1,234 @@
+#include "GameServer.h"
+#include <chrono>
+#include <thread>
+#include "Protocol.h"
+#include "ResidentMemory.h"
+
+namespace Network {
+	//60 steps a second like the game's frames, the ticks of a game in between are played in one go
+	static const sf::Time stepInterval = sf::microseconds(Timing::ticksToMicroseconds(4));
+	static const sf::Time stateInterval = sf::milliseconds(250);
+	//a client that went away without leaving
+	static const sf::Time sessionTimeout = sf::seconds(10);
+	//sessions beyond these are not accepted, a shard has to finish a step well within its interval
+	static constexpr size_t maxSessionsPerShard = 16384;
+
+	Shard::Shard()
+		:m_NextId(1), m_SeedState(Rules::getSeededRandomState(static_cast<std::uint32_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count()))),
+		m_SessionCount(0), m_Ticks(0), m_Steps(0)
+	{
+	}
+
+	bool Shard::open(unsigned short port)
+	{
+		m_Socket.setBlocking(false);
+		return m_Socket.bind(port) == sf::Socket::Done;
+	}
+
+	void Shard::run(const std::atomic<bool>& running, const GameServer& server)
+	{
+		sf::SocketSelector selector;
+		selector.add(m_Socket);
+		sf::Clock clock;
+		sf::Time nextStep = stepInterval;
+		while (running) {
+			const sf::Time now = clock.getElapsedTime();
+			if (now < nextStep) {
+				if (selector.wait(nextStep - now))
+					receive(clock.getElapsedTime(), server);
+				continue;
+			}
+			step(now);
+			const sf::Time done = clock.getElapsedTime();
+			m_StepLatency.record(static_cast<std::uint64_t>((done - nextStep).asMicroseconds()));
+			m_Steps.store(m_Steps.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			//a shard that fell behind does not run steps back to back, the games go by the clock anyway
+			nextStep += stepInterval;
+			if (nextStep <= done)
+				nextStep = done + stepInterval;
+		}
+	}
+
+	void Shard::addStatsTo(ServerStats& stats) const
+	{
+		stats.shards += 1;
+		stats.sessions += m_SessionCount.load(std::memory_order_relaxed);
+		stats.ticks += m_Ticks.load(std::memory_order_relaxed);
+		stats.steps += m_Steps.load(std::memory_order_relaxed);
+		m_StepLatency.addTo(stats.stepLatency);
+	}
+
+	void Shard::receive(sf::Time now, const GameServer& server)
+	{
+		sf::Packet packet;
+		sf::IpAddress sender;
+		unsigned short port{ 0 };
+		while (m_Socket.receive(packet, sender, port) == sf::Socket::Done) {
+			sf::Uint8 version{ 0 }, type{ 0 };
+			if (!(packet >> version >> type) || version != serverProtocolVersion)
+				continue;
+			//the session, or the client's token for a join
+			sf::Uint32 id{ 0 };
+			Session* session{ nullptr };
+			switch (type)
+			{
+			case JoinRequest:
+				if (packet >> id)
+					join(id, sender, port, now);
+				break;
+			case InputBatch:
+				if ((packet >> id) && (session = findSession(id, sender, port)) != nullptr)
+					applyInputs(*session, packet, now);
+				break;
+			case LeaveRequest:
+				if ((packet >> id) && (session = findSession(id, sender, port)) != nullptr)
+					removeSession(m_SessionIndices[id]);
+				break;
+			case StatsRequest:
+				sendStats(sender, port, server);
+				break;
+			default:
+				break;
+			}
+		}
+	}
+
+	void Shard::step(sf::Time now)
+	{
+		std::uint64_t ticks{ 0 };
+		//backwards, a removed session is replaced by the last one
+		for (size_t i{ m_Sessions.size() }; i-- > 0;) {
+			Session& session = m_Sessions[i];
+			if (now - session.lastHeard > sessionTimeout) {
+				removeSession(i);
+				continue;
+			}
+			const Timing::Tick tick = getSessionTick(session, now);
+			ticks += tick - session.game.getTick();
+			//locks need nothing from the server, the game just goes on
+			while (session.game.advance(tick)) {}
+			if (now - session.lastStateSent >= stateInterval)
+				sendState(session, now);
+		}
+		m_Ticks.store(m_Ticks.load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+	}
+
+	void Shard::join(std::uint32_t token, const sf::IpAddress& address, unsigned short port, sf::Time now)
+	{
+		if (m_Sessions.size() >= maxSessionsPerShard)
+			return;
+		m_SeedState = Rules::getNextRandomState(m_SeedState);
+		const std::uint32_t id = m_NextId++;
+		Session session{ Rules::Simulation(m_SeedState), address, port, id, Timing::microsecondsToTicks(now.asMicroseconds()), 0, now, now };
+		m_SessionIndices[id] = m_Sessions.size();
+		m_Sessions.push_back(session);
+		m_SessionCount.store(m_Sessions.size(), std::memory_order_relaxed);
+
+		sf::Packet packet;
+		packet << serverProtocolVersion << static_cast<sf::Uint8>(JoinAccepted) << token << id << m_SeedState;
+		m_Socket.send(packet, address, port);
+	}
+
+	void Shard::applyInputs(Session& session, sf::Packet& packet, sf::Time now)
+	{
+		sf::Uint32 firstInput{ 0 };
+		sf::Uint8 count{ 0 };
+		if (!(packet >> firstInput >> count) || count > maxServerInputsPerPacket || firstInput > session.inputsApplied)
+			return;
+		session.lastHeard = now;
+		//the keys land at the tick they arrive, whatever tick the client saw them at
+		while (session.game.advance(getSessionTick(session, now))) {}
+		const std::uint32_t inputsApplied = session.inputsApplied;
+		for (sf::Uint32 sequence{ firstInput }; sequence < firstInput + count; ++sequence) {
+			sf::Uint8 code{ 0 };
+			if (!(packet >> code))
+				break;
+			const auto input = static_cast<Rules::Input>(code & ~serverPressedBit);
+			if (sequence < session.inputsApplied || input >= Rules::InputCount)
+				continue;
+			session.game.apply(input, (code & serverPressedBit) != 0);
+			session.inputsApplied += 1;
+		}
+		if (session.inputsApplied != inputsApplied)
+			sendState(session, now);
+	}
+
+	void Shard::sendState(Session& session, sf::Time now)
+	{
+		sf::Packet packet;
+		packet << serverProtocolVersion << static_cast<sf::Uint8>(SessionState) << session.id << session.inputsApplied
+			<< static_cast<sf::Uint32>(session.game.getTick()) << session.game.getScore() << session.game.getLines()
+			<< static_cast<sf::Uint16>(session.game.getTopOuts()) << static_cast<sf::Uint64>(session.game.getChecksum());
+		m_Socket.send(packet, session.address, session.port);
+		session.lastStateSent = now;
+	}
+
+	void Shard::sendStats(const sf::IpAddress& address, unsigned short port, const GameServer& server)
+	{
+		const ServerStats stats = server.getStats();
+		sf::Packet packet;
+		packet << serverProtocolVersion << static_cast<sf::Uint8>(StatsReply) << static_cast<sf::Uint8>(stats.shards)
+			<< static_cast<sf::Uint32>(stats.sessions) << static_cast<sf::Uint64>(stats.ticks) << static_cast<sf::Uint64>(stats.steps)
+			<< static_cast<sf::Uint32>(stats.stepLatency.getPercentile(50)) << static_cast<sf::Uint32>(stats.stepLatency.getPercentile(99))
+			<< static_cast<sf::Uint64>(Instrumentation::getResidentMemory()) << static_cast<sf::Uint32>(sizeof(Session));
+		m_Socket.send(packet, address, port);
+	}
+
+	Session* Shard::findSession(std::uint32_t id, const sf::IpAddress& address, unsigned short port)
+	{
+		//a session only takes packets from where it was joined
+		const auto index = m_SessionIndices.find(id);
+		if (index == m_SessionIndices.end())
+			return nullptr;
+		Session& session = m_Sessions[index->second];
+		return session.address == address && session.port == port ? &session : nullptr;
+	}
+
+	void Shard::removeSession(size_t index)
+	{
+		m_SessionIndices.erase(m_Sessions[index].id);
+		if (index + 1 != m_Sessions.size()) {
+			m_Sessions[index] = m_Sessions.back();
+			m_SessionIndices[m_Sessions[index].id] = index;
+		}
+		m_Sessions.pop_back();
+		m_SessionCount.store(m_Sessions.size(), std::memory_order_relaxed);
+	}
+
+	Timing::Tick Shard::getSessionTick(const Session& session, sf::Time now) const
+	{
+		const Timing::Tick tick = Timing::microsecondsToTicks(now.asMicroseconds());
+		return tick > session.origin ? tick - session.origin : 0;
+	}
+
+	GameServer::GameServer(size_t shardCount)
+	{
+		for (size_t i{ 0 }; i < shardCount; ++i)
+			m_Shards.emplace_back(new Shard());
+	}
+
+	bool GameServer::open(unsigned short firstPort)
+	{
+		for (size_t i{ 0 }; i < m_Shards.size(); ++i)
+			if (!m_Shards[i]->open(static_cast<unsigned short>(firstPort + i)))
+				return false;
+		return true;
+	}
+
+	void GameServer::run(const std::atomic<bool>& running)
+	{
+		std::vector<std::thread> workers;
+		for (auto& shard : m_Shards)
+			workers.emplace_back(&Shard::run, shard.get(), std::cref(running), std::cref(*this));
+		for (auto& worker : workers)
+			worker.join();
+	}
+
+	ServerStats GameServer::getStats() const
+	{
+		ServerStats stats{};
+		for (const auto& shard : m_Shards)
+			shard->addStatsTo(stats);
+		return stats;
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Histogram.h"
+#include "Simulation.h"
+
+namespace Network {
+	//the counters of all shards added up
+	struct ServerStats
+	{
+		size_t shards;
+		std::uint64_t sessions;
+		//game ticks played, over all sessions
+		std::uint64_t ticks;
+		std::uint64_t steps;
+		//from when a step was due until it was done
+		Instrumentation::HistogramCounts stepLatency;
+	};
+
+	//a game the server plays for one client
+	struct Session
+	{
+		Rules::Simulation game;
+		sf::IpAddress address;
+		unsigned short port;
+		std::uint32_t id;
+		//the shard tick the game started at, its own ticks count from 0
+		Timing::Tick origin;
+		std::uint32_t inputsApplied;
+		sf::Time lastHeard;
+		sf::Time lastStateSent;
+	};
+
+	class GameServer;
+
+	//a worker thread with a socket and sessions of its own, the counters are all it shares
+	//it waits on its socket until the next step is due, then plays every session on to the current tick
+	class Shard
+	{
+	public:
+		Shard();
+
+		bool open(unsigned short port);
+		//serves until running turns false, stats requests are answered with the totals of every shard of the server
+		void run(const std::atomic<bool>& running, const GameServer& server);
+		void addStatsTo(ServerStats& stats)const;
+	private:
+		void receive(sf::Time now, const GameServer& server);
+		void step(sf::Time now);
+		void join(std::uint32_t token, const sf::IpAddress& address, unsigned short port, sf::Time now);
+		void applyInputs(Session& session, sf::Packet& packet, sf::Time now);
+		void sendState(Session& session, sf::Time now);
+		void sendStats(const sf::IpAddress& address, unsigned short port, const GameServer& server);
+		Session* findSession(std::uint32_t id, const sf::IpAddress& address, unsigned short port);
+		void removeSession(size_t index);
+		Timing::Tick getSessionTick(const Session& session, sf::Time now)const;
+
+		sf::UdpSocket m_Socket;
+		std::vector<Session> m_Sessions;
+		std::unordered_map<std::uint32_t, size_t> m_SessionIndices;
+		std::uint32_t m_NextId;
+		std::uint32_t m_SeedState;
+		//written by the shard thread only, read by whoever answers a stats request
+		std::atomic<std::uint64_t> m_SessionCount;
+		std::atomic<std::uint64_t> m_Ticks;
+		std::atomic<std::uint64_t> m_Steps;
+		Instrumentation::Histogram m_StepLatency;
+	};
+
+	//ranked games run here so no client can play them for itself
+	class GameServer
+	{
+	public:
+		explicit GameServer(size_t shardCount);
+
+		//one udp port per shard from firstPort on
+		bool open(unsigned short firstPort);
+		//every shard on a thread of its own, returns once running turned false and all of them stopped
+		void run(const std::atomic<bool>& running);
+		//adds the counters up, the shards go on meanwhile
+		ServerStats getStats()const;
+	private:
+		std::vector<std::unique_ptr<Shard>> m_Shards;
+	};
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <SFML/Config.hpp>
+#include <cstddef>
+#include <cstdint>
+
+//ranked games run on the server, a client sends nothing but its keys and gets the state of its game back
+//every message is one udp datagram, version and type first
+//a server has one port per shard from its first port on, a client can join a game on any of them
+namespace Network {
+	static constexpr sf::Uint8 serverProtocolVersion = 1;
+	static constexpr unsigned short defaultServerPort = 47000;
+	//inputs beyond these wait for a later packet
+	static constexpr size_t maxServerInputsPerPacket = 64;
+	//an input is its Rules::Input, this bit is set when the key went down
+	static constexpr sf::Uint8 serverPressedBit = 0x80;
+
+	enum ServerMessage : std::uint8_t
+	{
+		//client token u32, a lost answer is asked for again and leaves a session behind that times out
+		JoinRequest,
+		//client token u32, session u32, seed u32
+		JoinAccepted,
+		//session u32, sequence of the first input u32, count u8, then the inputs
+		//the server applies the inputs it does not have yet in order, each at its tick when it arrives
+		InputBatch,
+		//session u32, inputs applied u32, tick u32, score u32, lines u32, top outs u16, checksum u64
+		//sent for every batch with new inputs and a few times a second anyway
+		SessionState,
+		//session u32
+		LeaveRequest,
+		//nothing
+		StatsRequest,
+		//shards u8, sessions u32, ticks u64, steps u64, step latency p50 and p99 in microseconds u32 each,
+		//resident memory u64, bytes of one session u32, all shards added up
+		StatsReply,
+		ServerMessageCount
+	};
+}
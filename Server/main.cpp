@@ -0,0 +1,103 @@
+#include "GameServer.h"
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include "Metrics.h"
+#include "Protocol.h"
+#include "ResidentMemory.h"
+
+static std::atomic<bool> running{ true };
+
+static void stop(int)
+{
+	running = false;
+}
+
+//usage: Server [--port N] [--shards N] [--stats-interval seconds] [--duration seconds] [--metrics port]
+//hosts ranked games on udp ports from --port on, one per shard, until ctrl+c or the duration is over
+//--metrics serves the stats over http at /metrics for a scraper on every interface, curl localhost:port/metrics shows them
+int main(int argc, char* argv[])
+{
+	unsigned short port{ Network::defaultServerPort };
+	size_t shardCount{ std::max(1u, std::thread::hardware_concurrency()) };
+	float statsInterval{ 5.f };
+	float duration{ 0.f };
+	unsigned short metricsPort{ 0 };
+	for (int i{ 1 }; i + 1 < argc; ++i) {
+		const std::string arg{ argv[i] };
+		if (arg == "--port")
+			port = static_cast<unsigned short>(std::stoul(argv[++i]));
+		else if (arg == "--shards")
+			shardCount = std::max<size_t>(1, std::stoul(argv[++i]));
+		else if (arg == "--stats-interval")
+			statsInterval = std::stof(argv[++i]);
+		else if (arg == "--duration")
+			duration = std::stof(argv[++i]);
+		else if (arg == "--metrics")
+			metricsPort = static_cast<unsigned short>(std::stoul(argv[++i]));
+	}
+
+	Network::GameServer server(shardCount);
+	if (!server.open(port)) {
+		std::cerr << "failed to open ports " << port << " to " << port + shardCount - 1 << '\n';
+		return 1;
+	}
+	std::signal(SIGINT, stop);
+	std::cout << "serving on ports " << port << " to " << port + shardCount - 1 << '\n';
+	std::thread serving(&Network::GameServer::run, &server, std::cref(running));
+
+	//the tick rate is over the time since the scrape before, only the endpoint thread touches these
+	sf::Clock scrapeClock;
+	sf::Time lastScrape;
+	std::uint64_t lastScrapeTicks{ 0 };
+	std::unique_ptr<Instrumentation::MetricsEndpoint> metrics;
+	if (metricsPort != 0) {
+		metrics.reset(new Instrumentation::MetricsEndpoint([&](Instrumentation::MetricsWriter& writer) {
+			const Network::ServerStats stats = server.getStats();
+			const sf::Time now = scrapeClock.getElapsedTime();
+			const float seconds = std::max((now - lastScrape).asSeconds(), 0.001f);
+			writer.gauge("server_shards", "Shards serving games.", static_cast<double>(stats.shards));
+			writer.gauge("server_sessions", "Games being played.", static_cast<double>(stats.sessions));
+			writer.counter("server_ticks_total", "Game ticks played over all sessions.", static_cast<double>(stats.ticks));
+			writer.gauge("server_tick_rate", "Game ticks per second over all sessions since the scrape before.", (stats.ticks - lastScrapeTicks) / seconds);
+			writer.counter("server_steps_total", "Shard steps taken.", static_cast<double>(stats.steps));
+			writer.summary("server_step_latency_seconds", "Time from when a step was due until it was done.", stats.stepLatency);
+			writer.gauge("process_resident_memory_bytes", "Bytes of the process in physical memory.", static_cast<double>(Instrumentation::getResidentMemory()));
+			lastScrape = now;
+			lastScrapeTicks = stats.ticks;
+		}));
+		//a server is scraped from the monitoring host, unlike a cabinet
+		if (metrics->start(metricsPort, sf::IpAddress::Any))
+			std::cout << "metrics on http port " << metricsPort << '\n';
+		else
+			std::cerr << "failed to serve metrics on port " << metricsPort << '\n';
+	}
+
+	//a line per interval, rates over the interval and latency since the start
+	sf::Clock clock;
+	sf::Time lastReport;
+	Network::ServerStats last = server.getStats();
+	while (running) {
+		sf::sleep(sf::milliseconds(100));
+		const sf::Time now = clock.getElapsedTime();
+		if (duration > 0.f && now.asSeconds() >= duration)
+			running = false;
+		if ((now - lastReport).asSeconds() < statsInterval && running)
+			continue;
+		const Network::ServerStats stats = server.getStats();
+		const float seconds = (now - lastReport).asSeconds();
+		const std::uint64_t resident = Instrumentation::getResidentMemory();
+		std::cout << std::fixed << std::setprecision(0) << stats.sessions << " sessions, "
+			<< static_cast<float>(stats.ticks - last.ticks) / seconds << " ticks/s, step latency p50 " << stats.stepLatency.getPercentile(50)
+			<< " us p99 " << stats.stepLatency.getPercentile(99) << " us, " << resident / 1024 << " KiB resident, "
+			<< (stats.sessions == 0 ? 0 : resident / stats.sessions) << " B per session\n";
+		last = stats;
+		lastReport = now;
+	}
+	serving.join();
+}
@@ -0,0 +1,74 @@
+#include "AssetLoader.h"
+#include <algorithm>
+#include <iostream>
+
+namespace Resources {
+	AssetLoader::AssetLoader()
+		:m_NextDecode(0), m_NextUpload(0), m_RequiredJobs(0)
+	{
+	}
+
+	AssetLoader::~AssetLoader()
+	{
+		//decode steps are short and finite, closing during the loading screen just waits for them
+		for (auto& worker : m_Workers)
+			worker.join();
+	}
+
+	void AssetLoader::add(const std::string& name, Step decode, Step upload, bool isRequired)
+	{
+		m_Jobs.emplace_back(new Job{ name, std::move(decode), std::move(upload), isRequired, { Pending } });
+		//every job up to the last required one has to be uploaded first
+		if (isRequired)
+			m_RequiredJobs = m_Jobs.size();
+	}
+
+	void AssetLoader::start(unsigned workerCount)
+	{
+		if (workerCount == 0)
+			workerCount = std::max(1u, std::thread::hardware_concurrency() - 1);
+		workerCount = std::min(workerCount, static_cast<unsigned>(m_Jobs.size()));
+		for (unsigned i{ 0 }; i < workerCount; ++i)
+			m_Workers.emplace_back(&AssetLoader::decodeJobs, this);
+	}
+
+	void AssetLoader::decodeJobs()
+	{
+		//jobs are handed out by index in the order they were added, uploads wait for them in that order
+		for (size_t job = m_NextDecode++; job < m_Jobs.size(); job = m_NextDecode++) {
+			const bool decoded = m_Jobs[job]->decode();
+			m_Jobs[job]->state.store(decoded ? Decoded : Failed, std::memory_order_release);
+		}
+	}
+
+	void AssetLoader::uploadReady(sf::Time budget)
+	{
+		sf::Clock clock;
+		while (m_NextUpload < m_Jobs.size()) {
+			Job& job = *m_Jobs[m_NextUpload];
+			const int state = job.state.load(std::memory_order_acquire);
+			if (state == Pending)
+				return;
+			if (state == Failed || !job.upload())
+				std::cerr << "failed to load " << job.name << '\n';
+			m_NextUpload += 1;
+			if (clock.getElapsedTime() >= budget)
+				return;
+		}
+	}
+
+	float AssetLoader::getProgress() const
+	{
+		return m_Jobs.empty() ? 1.f : static_cast<float>(m_NextUpload) / m_Jobs.size();
+	}
+
+	bool AssetLoader::isReady() const
+	{
+		return m_NextUpload >= m_RequiredJobs;
+	}
+
+	bool AssetLoader::isFinished() const
+	{
+		return m_NextUpload == m_Jobs.size();
+	}
+}
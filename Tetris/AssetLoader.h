@@ -0,0 +1,62 @@
+#pragma once
+
+#include <SFML/System.hpp>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Resources {
+
+	//decodes assets on worker threads, the gl upload of each one happens on the thread owning the context
+	//jobs are added up front, then start runs the decode steps in parallel and uploadReady runs the
+	//upload steps in the order the jobs were added, so a later job can rely on an earlier one
+	class AssetLoader
+	{
+	public:
+		using Step = std::function<bool()>;
+
+		AssetLoader();
+		~AssetLoader();
+		AssetLoader(const AssetLoader&) = delete;
+		AssetLoader& operator=(const AssetLoader&) = delete;
+
+		//required jobs have to be uploaded before play starts, the others may finish while the game runs
+		void add(const std::string& name, Step decode, Step upload, bool isRequired);
+		//0 workers picks one less than the hardware threads
+		void start(unsigned workerCount = 0);
+
+		//uploads decoded jobs until the budget is used up, at least one if one is ready
+		//a job whose decode or upload failed is reported on std::cerr and skipped
+		void uploadReady(sf::Time budget);
+		//uploaded jobs over all jobs
+		float getProgress()const;
+		bool isReady()const;
+		bool isFinished()const;
+	private:
+		enum State
+		{
+			Pending,
+			Decoded,
+			Failed
+		};
+		struct Job
+		{
+			std::string name;
+			Step decode;
+			Step upload;
+			bool isRequired;
+			std::atomic<int> state;
+		};
+		void decodeJobs();
+
+		std::vector<std::unique_ptr<Job>> m_Jobs;
+		std::vector<std::thread> m_Workers;
+		std::atomic<size_t> m_NextDecode;
+		//only touched by the uploading thread
+		size_t m_NextUpload;
+		size_t m_RequiredJobs;
+	};
+}
@@ -0,0 +1,102 @@
+#include "AssetPack.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Resources {
+	AssetPack::AssetPack()
+		:m_Entries(nullptr), m_EntryCount(0)
+	{
+	}
+
+	bool AssetPack::open(const std::string& path)
+	{
+		m_Entries = nullptr;
+		m_EntryCount = 0;
+		if (!m_File.open(path))
+			return false;
+		const unsigned char* data = m_File.getData();
+		const std::uint64_t size = m_File.getSize();
+		PackHeader header;
+		if (size < sizeof(header)) {
+			m_File.close();
+			return false;
+		}
+		std::memcpy(&header, data, sizeof(header));
+		const std::uint64_t tableEnd = sizeof(header) + static_cast<std::uint64_t>(header.entryCount) * sizeof(PackEntry);
+		if (std::memcmp(header.magic, packMagic, sizeof(packMagic)) != 0 || header.version != packVersion || tableEnd > size) {
+			m_File.close();
+			return false;
+		}
+		//the table follows the 16 byte header, so the mapping keeps it aligned for PackEntry
+		const auto* entries = reinterpret_cast<const PackEntry*>(data + sizeof(header));
+		for (std::uint32_t i{ 0 }; i < header.entryCount; ++i) {
+			const PackEntry& entry = entries[i];
+			const bool nameIsTerminated = std::memchr(entry.name, '\0', packNameLength) != nullptr;
+			const bool isInside = entry.offset >= tableEnd && entry.offset <= size && entry.size <= size - entry.offset;
+			const bool isImage = entry.type == PackEntryType::Image
+				&& entry.size == static_cast<std::uint64_t>(entry.width) * entry.height * 4 && entry.size != 0;
+			if (!nameIsTerminated || !isInside || !(isImage || entry.type == PackEntryType::File)) {
+				m_File.close();
+				return false;
+			}
+		}
+		m_Entries = entries;
+		m_EntryCount = header.entryCount;
+		return true;
+	}
+
+	bool AssetPack::isOpen() const
+	{
+		return m_File.isOpen();
+	}
+
+	const PackEntry* AssetPack::findEntry(const std::string& name, PackEntryType type) const
+	{
+		//a handful of entries per theme, a linear scan of the mapped table is enough
+		for (std::uint32_t i{ 0 }; i < m_EntryCount; ++i)
+			if (m_Entries[i].type == type && name == m_Entries[i].name)
+				return &m_Entries[i];
+		return nullptr;
+	}
+
+	bool AssetPack::findImage(const std::string& name, ImageData& image) const
+	{
+		const PackEntry* entry = findEntry(name, PackEntryType::Image);
+		if (!entry)
+			return false;
+		image = { entry->width, entry->height, m_File.getData() + entry->offset };
+		return true;
+	}
+
+	bool AssetPack::findFile(const std::string& name, FileData& file) const
+	{
+		const PackEntry* entry = findEntry(name, PackEntryType::File);
+		if (!entry)
+			return false;
+		file = { m_File.getData() + entry->offset, static_cast<std::size_t>(entry->size) };
+		return true;
+	}
+
+	bool AssetPack::findSkin(const std::string& theme, Skin& skin) const
+	{
+		if (!findImage(theme + "/blockTile", skin.blockTile) || !findImage(theme + "/wallTile", skin.wallTile))
+			return false;
+		if (!findFile(theme + "/font", skin.font))
+			skin.font = { nullptr, 0 };
+		if (!findFile(theme + "/palette", skin.palette))
+			skin.palette = { nullptr, 0 };
+		return true;
+	}
+
+	std::vector<std::string> AssetPack::getThemes() const
+	{
+		std::vector<std::string> themes;
+		for (std::uint32_t i{ 0 }; i < m_EntryCount; ++i) {
+			const std::string name{ m_Entries[i].name };
+			const std::string theme = name.substr(0, name.find('/'));
+			if (std::find(themes.begin(), themes.end(), theme) == themes.end())
+				themes.push_back(theme);
+		}
+		return themes;
+	}
+}
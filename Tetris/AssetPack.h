@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "Resources.h"
+
+namespace Resources {
+
+	//pack layout, little endian as written by ResourceCompiler --pack:
+	//header, table of contents, then the blobs, each aligned to packAlignment
+	//images are stored decoded as rgba so the mapped pixels go to sf::Texture::update as they are
+	static constexpr char packMagic[4] = { 'T', 'P', 'A', 'K' };
+	static constexpr std::uint32_t packVersion = 1;
+	static constexpr std::uint64_t packAlignment = 64;
+	static constexpr size_t packNameLength = 48;
+
+	enum class PackEntryType : std::uint32_t
+	{
+		Image = 1,
+		File = 2
+	};
+
+	struct PackHeader
+	{
+		char magic[4];
+		std::uint32_t version;
+		std::uint32_t entryCount;
+		std::uint32_t reserved;
+	};
+
+	//names are "<theme>/<asset>", zero padded
+	struct PackEntry
+	{
+		char name[packNameLength];
+		PackEntryType type;
+		std::uint32_t width;
+		std::uint32_t height;
+		std::uint32_t reserved;
+		std::uint64_t offset;
+		std::uint64_t size;
+	};
+	static_assert(sizeof(PackHeader) == 16 && sizeof(PackEntry) == 80, "pack structs are written as they are");
+
+	class AssetPack
+	{
+	public:
+		AssetPack();
+
+		//maps the pack and validates its table of contents, nothing is decoded
+		bool open(const std::string& path);
+		bool isOpen()const;
+
+		bool findImage(const std::string& name, ImageData& image)const;
+		bool findFile(const std::string& name, FileData& file)const;
+		//a theme needs at least a block and a wall tile
+		bool findSkin(const std::string& theme, Skin& skin)const;
+		std::vector<std::string> getThemes()const;
+	private:
+		const PackEntry* findEntry(const std::string& name, PackEntryType type)const;
+
+		Storage::MappedFile m_File;
+		const PackEntry* m_Entries;
+		std::uint32_t m_EntryCount;
+	};
+}
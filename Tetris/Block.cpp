@@ -1,4 +1,5 @@
 #include "Block.h"
+#include "Simulation.h"
 #include <SFML/Graphics.hpp>
 #include <array>
 #include <chrono>
@@ -6,18 +7,60 @@
 #include <sstream>
 
 namespace Blocks {
-	static constexpr int BlockCountX = 12;
-	static constexpr int BlockCountY = 12;
-	static constexpr float blockSize = 64.f;
-	static constexpr float wallSize = 16.f;
+	//empty cells only show a faint grid, occupied ones the greyscale tile tinted by the palette
+	static const char* const cellLookupShader = R"(
+		uniform sampler2D cells;
+		uniform sampler2D tile;
+		uniform sampler2D palette;
+		uniform vec2 boardSize;
+		uniform float paletteSize;
+		uniform vec4 gridColor;
+		void main()
+		{
+			vec2 cell = gl_TexCoord[0].xy * boardSize;
+			vec2 local = fract(cell);
+			float id = floor(texture2D(cells, (floor(cell) + 0.5) / boardSize).r * 255.0 + 0.5);
+			if (id < 0.5) {
+				vec2 edge = min(local, 1.0 - local) * 64.0;
+				if (min(edge.x, edge.y) >= 1.0)
+					discard;
+				gl_FragColor = gridColor;
+				return;
+			}
+			vec4 colour = texture2D(palette, vec2((id + 0.5) / paletteSize, 0.5));
+			gl_FragColor = texture2D(tile, local) * colour * gl_Color;
+		}
+	)";
 
-	Block::Block(const std::array<sf::Vector2f, 4>& _SpritesPosition, const sf::Vector2f& _RotationCenter, sf::Texture& texture)
-		: m_RotationCenter(_RotationCenter* blockSize)
+	Palette getDefaultPalette()
 	{
-		for (int i{ 0 }; i < 4; ++i) {
-			m_Sprites[i].setTexture(texture);
-			m_Sprites[i].setPosition(_SpritesPosition[i] * blockSize);
-		}
+		return { sf::Color::Transparent,
+			sf::Color(0, 230, 240),//I
+			sf::Color(245, 160, 0),//L
+			sf::Color(40, 220, 40),//S
+			sf::Color(40, 90, 245),//J
+			sf::Color(170, 40, 240),//T
+			sf::Color(240, 40, 40),//Z
+			sf::Color(245, 230, 0) };//O
+	}
+
+	Palette getColourblindPalette()
+	{
+		return { sf::Color::Transparent,
+			sf::Color(86, 180, 233),//I sky blue
+			sf::Color(230, 159, 0),//L orange
+			sf::Color(0, 158, 115),//S bluish green
+			sf::Color(0, 114, 178),//J blue
+			sf::Color(204, 121, 167),//T reddish purple
+			sf::Color(213, 94, 0),//Z vermillion
+			sf::Color(240, 228, 66) };//O yellow
+	}
+
+	Block::Block(const std::array<sf::Vector2i, 4>& cells, PieceType type)
+		: m_Type(type)
+	{
+		for (int i{ 0 }; i < 4; ++i)
+			m_Sprites[i].setPosition(sf::Vector2f(cells[i]) * blockSize);
 	}
 
 	void Block::draw(sf::RenderTarget& target, sf::RenderStates states) const
@@ -30,58 +73,39 @@ namespace Blocks {
 	{
 		for (auto& sprite : m_Sprites)
 			sprite.move(amount);
-		m_RotationCenter += amount;
 	}
 
-	void Block::rotate()
+	void Block::applyPalette(const Palette& palette)
 	{
-		for (auto& sprite : m_Sprites) {
-			auto rotVector = sprite.getPosition() - m_RotationCenter;
-			auto newPos = sf::Vector2f{ rotVector.y * (-1.f), rotVector.x } + m_RotationCenter;//rotation matrix for pi/2
-			sprite.setPosition(newPos);
-		}
-	}
-
-	std::array<sf::Vector2f, 4> Block::getCoordsAfterRotation()const
-	{
-		std::array<sf::Vector2f, 4> tmp;
-		for (int i = 0; i < 4; ++i) {
-			auto rotVector = m_Sprites[i].getPosition() - m_RotationCenter;
-			tmp[i] = sf::Vector2f{ rotVector.y * (-1.f), rotVector.x } + m_RotationCenter;//rotation matrix for pi/2
-		}
-		return tmp;
+		for (auto& sprite : m_Sprites)
+			sprite.setColor(palette[m_Type]);
 	}
 
-
-	bool BlockMap::isGameOver() const
+	void Block::setTile(const sf::Texture& tile)
 	{
-		return m_StateOfCurrentBlock == MoveCode::GameOver;
+		for (auto& sprite : m_Sprites)
+			sprite.setTexture(tile, true);
 	}
 
-	bool BlockMap::isBlockMovedNormally() const
+	PieceType Block::getType() const
 	{
-		return m_StateOfCurrentBlock == MoveCode::BlockMovedNormally;
+		return m_Type;
 	}
 
-	bool BlockMap::isBlockCollided() const
+	void Block::setCellPositions(const std::array<sf::Vector2i, 4>& cells)
 	{
-		return m_StateOfCurrentBlock == MoveCode::BlockCollided;
+		for (int i{ 0 }; i < 4; ++i)
+			m_Sprites[i].setPosition(wallSize + cells[i].x * blockSize, cells[i].y * blockSize);
 	}
 
-	BlockMap::BlockMap(float moveDownTime)
-		:m_MoveDownTime(moveDownTime), m_CurrentTime(0), m_Score(0), m_PreviousScore(1), m_InvalidPosition( -10000.f, -10000.f )
+	BlockMap::BlockMap()
+		:m_Score(0), m_PreviousScore(1), m_Cells{}, m_Palette(getDefaultPalette()),
+		m_CellPixels(BlockCountX * BlockCountY * 4, 0), m_BoardQuad(sf::Quads, 4), m_CellShaderIsLoaded(false), m_UseCellShader(false),
+		m_CellVertices(sf::Quads)
 	{
 		//generate space for dynammic containers //TODO: rewrite with pregenerated walls
 		m_WallsSprites.resize(183);//9+9+18
-		m_SpriteMatrix.resize(BlockCountY);
-		for (auto& row : m_SpriteMatrix)
-			row.resize(BlockCountX);
-		//set not visible coords
-		resetBoard();
 
-		//load wall textures
-		if (!m_WallsTexture.loadFromFile("Recources/block_textures.png", sf::IntRect(352, 248, 16, 16)))
-			static_assert(1, "failed to load textures");
 		//generate left&right walls
 		for (int i{ 0 }; i < 48; ++i) {
 			m_WallsSprites[i].setPosition({ 0.f, static_cast<float>(i) * wallSize });
@@ -101,115 +125,133 @@ namespace Blocks {
 			m_WallsSprites[i + 165].setPosition({ 0.f, static_cast<float>(i + 49) * wallSize });
 			m_WallsSprites[i + 174].setPosition({ 288.f, static_cast<float>(i + 49) * wallSize });
 		}
+		//the whole playfield is one quad, texture coords are in cells of the cell texture
+		const sf::Vector2f boardSize{ BlockCountX * blockSize, BlockCountY * blockSize };
+		m_BoardQuad[0] = sf::Vertex({ wallSize, 0.f }, { 0.f, 0.f });
+		m_BoardQuad[1] = sf::Vertex({ wallSize + boardSize.x, 0.f }, { static_cast<float>(BlockCountX), 0.f });
+		m_BoardQuad[2] = sf::Vertex({ wallSize + boardSize.x, boardSize.y }, { static_cast<float>(BlockCountX), static_cast<float>(BlockCountY) });
+		m_BoardQuad[3] = sf::Vertex({ wallSize, boardSize.y }, { 0.f, static_cast<float>(BlockCountY) });
+		//set empty cells
+		resetBoard();
+	}
+
+	bool BlockMap::loadTiles(const sf::Image& blockTile, const sf::Image& wallTile)
+	{
+		if (!m_TileTexture.loadFromImage(blockTile) || !m_WallsTexture.loadFromImage(wallTile))
+			return false;
 		//assign textures
 		for (auto& wall : m_WallsSprites)
-			wall.setTexture(m_WallsTexture);
+			wall.setTexture(m_WallsTexture, true);
+		if (!m_CellShaderIsLoaded && sf::Shader::isAvailable() && m_CellTexture.create(BlockCountX, BlockCountY) && m_PaletteTexture.create(PieceTypeCount, 1)
+			&& m_CellShader.loadFromMemory(cellLookupShader, sf::Shader::Fragment)) {
+			m_CellShader.setUniform("cells", sf::Shader::CurrentTexture);
+			m_CellShader.setUniform("tile", m_TileTexture);
+			m_CellShader.setUniform("palette", m_PaletteTexture);
+			m_CellShader.setUniform("boardSize", sf::Glsl::Vec2(BlockCountX, BlockCountY));
+			m_CellShader.setUniform("paletteSize", static_cast<float>(PieceTypeCount));
+			m_CellShader.setUniform("gridColor", sf::Glsl::Vec4(sf::Color(32, 32, 32)));
+			m_CellShaderIsLoaded = true;
+			m_UseCellShader = true;
+		}
+		//uploads the palette and the cells set so far
+		setPalette(m_Palette);
+		return true;
 	}
 
-	void BlockMap::draw(sf::RenderTarget& target, sf::RenderStates states) const
+	bool BlockMap::useCellShader(bool enable)
 	{
-		for (const auto& sprite_vec : m_SpriteMatrix)
-			for (const auto& sprite : sprite_vec)
-				target.draw(sprite, states);
-		for (const auto& wall : m_WallsSprites)
-			target.draw(wall, states);
+		m_UseCellShader = enable && m_CellShaderIsLoaded;
+		onCellsChanged();
+		return m_UseCellShader;
 	}
 
-	void BlockMap::addBlockToMap(Block& blck)
+	void BlockMap::setPalette(const Palette& palette)
 	{
-		for (auto& sprite : blck.m_Sprites) {
-			m_SpriteMatrix[static_cast<size_t>(sprite.getPosition().y / blockSize)][static_cast<size_t>((sprite.getPosition().x - wallSize) / blockSize)] = std::move(sprite);
-		}
+		m_Palette = palette;
+		if (m_CellShaderIsLoaded)
+			m_PaletteTexture.update(reinterpret_cast<const sf::Uint8*>(m_Palette.data()));
+		onCellsChanged();
 	}
 
-	bool BlockMap::checkIfBlockCanBePlaced(Block& blck)const
+	bool BlockMap::setTiles(const Resources::ImageData& blockTile, const Resources::ImageData& wallTile)
 	{
-		for (const auto& sprite : blck.m_Sprites) {
-			size_t x = static_cast<size_t>((sprite.getPosition().x - wallSize) / blockSize), y = static_cast<size_t>((sprite.getPosition().y) / blockSize);
-			if (m_SpriteMatrix[y][x].getPosition() != m_InvalidPosition)
-				return false;
-		}
-		return true;
+		//checked up front so a bad skin does not leave the board half replaced
+		if (m_TileTexture.getSize() != sf::Vector2u(blockTile.width, blockTile.height)
+			|| m_WallsTexture.getSize() != sf::Vector2u(wallTile.width, wallTile.height))
+			return false;
+		return Resources::updateTexture(m_TileTexture, blockTile) && Resources::updateTexture(m_WallsTexture, wallTile);
 	}
 
-	void BlockMap::moveBlockDown(Block& blck, float dltTime)//-1 game over; 0 block is moved dowm normally; 1 block has collided with another block
+	void BlockMap::onCellsChanged()
 	{
-		m_CurrentTime += dltTime;
-		if (m_CurrentTime >= m_MoveDownTime)
-		{
-			for (const auto& sprite : blck.m_Sprites) {
-				//map blocks position to a grid
-				auto newPos = sprite.getPosition() + sf::Vector2f{ 0, blockSize };
-				int x = static_cast<int>((newPos.x - wallSize) / blockSize), y = static_cast<int>((newPos.y) / blockSize);
-				if (y == BlockCountY || m_SpriteMatrix[y][x].getPosition() != m_InvalidPosition) {
-					//add block to map and reset godown time
-					addBlockToMap(blck);
-					m_CurrentTime = 0;
-					//increase score depending on nr of rows collided
-					m_Score += destroyFullRows();
-					//checking if the game is over
-					if (blockCollidedAtZeroY(blck))
-						m_StateOfCurrentBlock = MoveCode::GameOver;
-					else
-						m_StateOfCurrentBlock = MoveCode::BlockCollided;
-					return;
-				}
-			}
-			blck.move({ 0, blockSize });
-			m_CurrentTime = 0;
+		//only called when cells change, i.e. on placement, row clear and reset
+		if (m_UseCellShader) {
+			for (size_t i{ 0 }; i < m_Cells.size(); ++i)
+				m_CellPixels[i * 4] = m_Cells[i];
+			m_CellTexture.update(m_CellPixels.data());
+			return;
 		}
-		m_StateOfCurrentBlock = MoveCode::BlockMovedNormally;
+		m_CellVertices.clear();
+		const sf::Vector2f tileSize{ m_TileTexture.getSize() };
+		for (int y{ 0 }; y < BlockCountY; ++y)
+			for (int x{ 0 }; x < BlockCountX; ++x) {
+				const PieceType cell = m_Cells[y * BlockCountX + x];
+				if (cell == Empty)
+					continue;
+				const sf::Vector2f position{ wallSize + x * blockSize, y * blockSize };
+				const sf::Color colour = m_Palette[cell];
+				m_CellVertices.append({ position, colour, { 0.f, 0.f } });
+				m_CellVertices.append({ position + sf::Vector2f{ blockSize, 0.f }, colour, { tileSize.x, 0.f } });
+				m_CellVertices.append({ position + sf::Vector2f{ blockSize, blockSize }, colour, tileSize });
+				m_CellVertices.append({ position + sf::Vector2f{ 0.f, blockSize }, colour, { 0.f, tileSize.y } });
+			}
 	}
 
-	void BlockMap::moveBlockLeft(Block& blck)const
+	void BlockMap::draw(sf::RenderTarget& target, sf::RenderStates states) const
 	{
-		for (const auto& sprite : blck.m_Sprites)
-		{
-			auto newPos = sprite.getPosition() + sf::Vector2f{ -blockSize, 0.f };
-			int x = static_cast<int>((newPos.x - wallSize) / blockSize), y = static_cast<int>((newPos.y) / blockSize);
-			if (x < 0 || m_SpriteMatrix[y][x].getPosition() != m_InvalidPosition)
-				return;
+		if (m_UseCellShader) {
+			sf::RenderStates boardStates{ states };
+			boardStates.texture = &m_CellTexture;
+			boardStates.shader = &m_CellShader;
+			target.draw(m_BoardQuad, boardStates);
 		}
-		blck.move({ -blockSize, 0.f });
+		else {
+			sf::RenderStates boardStates{ states };
+			boardStates.texture = &m_TileTexture;
+			target.draw(m_CellVertices, boardStates);
+		}
+		for (const auto& wall : m_WallsSprites)
+			target.draw(wall, states);
 	}
 
-	void BlockMap::moveBlockRight(Block& blck)const
+	PieceType BlockMap::getCell(int x, int y) const
 	{
-		for (const auto& sprite : blck.m_Sprites)
-		{
-			auto newPos = sprite.getPosition() + sf::Vector2f{ blockSize, 0.f };
-			int x = static_cast<int>((newPos.x - wallSize) / blockSize), y = static_cast<int>((newPos.y) / blockSize);
-			if (x >= BlockCountX || m_SpriteMatrix[y][x].getPosition() != m_InvalidPosition)
-				return;
-		}
-		blck.move({ blockSize, 0.f });
+		return m_Cells[y * BlockCountX + x];
 	}
 
-	void BlockMap::rotateBlock(Block& blck)
+	const Cells& BlockMap::getCells() const
 	{
-		auto newPositionOfBlock = blck.getCoordsAfterRotation();
-		for (const auto& newPos : newPositionOfBlock)
-		{
-			int x = static_cast<int>((newPos.x - wallSize) / blockSize), y = static_cast<int>((newPos.y) / blockSize);
-			if (x >= BlockCountX || y >= BlockCountY || x < 0 || y < 0 || m_SpriteMatrix[y][x].getPosition() != m_InvalidPosition)
-				return;
-		}
-		blck.rotate();
+		return m_Cells;
 	}
 
-	bool BlockMap::blockCollidedAtZeroY(Block& blck)const
+	unsigned BlockMap::getScoreValue() const
 	{
-		for (const auto& sprite : blck.m_Sprites)
-			if (sprite.getPosition().y == 0)
-				return true;
-		return false;
+		return m_Score;
+	}
+
+	void BlockMap::restore(const Cells& cells, unsigned score)
+	{
+		m_Score = score;
+		if (cells == m_Cells)
+			return;
+		m_Cells = cells;
+		onCellsChanged();
 	}
 
 	void BlockMap::resetBoard()
 	{
-		for (auto& row : m_SpriteMatrix)
-			for (auto& sprite : row)
-				sprite.setPosition(m_InvalidPosition);
+		m_Cells.fill(Empty);
+		onCellsChanged();
 		m_Score = 0;
 	}
 
@@ -224,69 +266,50 @@ namespace Blocks {
 		return m_ChachedScore;
 	}
 
-	int BlockMap::destroyFullRows()
+	BlockGenerator::BlockGenerator() :
+		BlockGenerator(static_cast<unsigned int>(std::chrono::high_resolution_clock::now().time_since_epoch().count()))
 	{
-		unsigned numberOfFullRows{ 0 };
-		for (size_t i{ 0 }; i < m_SpriteMatrix.size(); ++i)
-		{
-			bool rowIsFull{ true };
-			for (auto sprite = m_SpriteMatrix[i].begin(); sprite != m_SpriteMatrix[i].end(); ++sprite) {
-				if (sprite->getPosition() == m_InvalidPosition)
-				{
-					rowIsFull = false;
-					break;
-				}
-			}
-			if (rowIsFull) {
-				numberOfFullRows += 1;
-				for (auto& sprite : m_SpriteMatrix[i])
-					sprite.setPosition(m_InvalidPosition);
-				swapRowsUpwards(i);
-			}
-		}
-		return numberOfFullRows * numberOfFullRows * 100;
 	}
 
-	void BlockMap::swapRowsUpwards(int currentPosition)
+	BlockGenerator::BlockGenerator(unsigned seed) :
+		m_RandomState(Rules::getSeededRandomState(seed))
 	{
-		int nextPosition{ currentPosition - 1 };
-		while (nextPosition > 0)
-		{
-			for (auto sprite = m_SpriteMatrix[nextPosition].begin(); sprite != m_SpriteMatrix[nextPosition].end(); ++sprite) {
-				if (sprite->getPosition() != m_InvalidPosition) {
-					sprite->setPosition(sprite->getPosition() + sf::Vector2f{ 0.f, blockSize });
-				}
-			}
-			std::swap(m_SpriteMatrix[currentPosition], m_SpriteMatrix[nextPosition]);
-			nextPosition--;
-			currentPosition--;
-		}
+		m_BlockTypes.reserve(PieceTypeCount - 1);
+		for (int type{ I }; type < PieceTypeCount; ++type)
+			m_BlockTypes.push_back(Block(Rules::getLayout(static_cast<PieceType>(type)).cells, static_cast<PieceType>(type)));
+		setPalette(getDefaultPalette());
 	}
-	BlockGenerator::BlockGenerator() :
-		m_UniformDistribution{ 0, 6 }
+
+	Block BlockGenerator::getRandomBlock()
 	{
-		m_BlockTypes.reserve(7);
-		m_TextureTypes.resize(3);
-		//seeding m_Generator
-		m_Generator.seed(static_cast<unsigned int>(std::chrono::high_resolution_clock::now().time_since_epoch().count()));
-		//binding generator to distribution
-		m_GetRandomBlockIndex = std::bind(std::ref(m_UniformDistribution), std::ref(m_Generator));
-		//loading block textures
-		for (size_t i{ 0 }; i < 3; ++i)
-			if (!m_TextureTypes[i].loadFromFile("Recources/block_textures.png", sf::IntRect(80, 8 + static_cast<int>(blockSize + 8) * i, 64, 64)))
-				static_assert(1, "failed to load textures");
-		//creating block types
-		m_BlockTypes.push_back(Block({ { {0.0f, 0.0f}, {1.0f, 0.0f}, {2.0f, 0.0f}, {3.0f, 0.0f}  } }, { 1.0f, 0.0f }, m_TextureTypes[0]));//I
-		m_BlockTypes.push_back(Block({ { {0.0f, 1.0f}, {1.0f, 1.0f}, {2.0f, 1.0f}, {2.0f, 0.0f}  } }, { 1.0f, 1.0f }, m_TextureTypes[1]));//L
-		m_BlockTypes.push_back(Block({ { {0.0f, 1.0f}, {1.0f, 1.0f}, {1.0f, 0.0f}, {2.0f, 0.0f}  } }, { 1.0f, 1.0f }, m_TextureTypes[1]));//S
-		m_BlockTypes.push_back(Block({ { {0.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 1.0f}, {2.0f, 1.0f}  } }, { 1.0f, 1.0f }, m_TextureTypes[0]));//J
-		m_BlockTypes.push_back(Block({ { {0.0f, 1.0f}, {1.0f, 1.0f}, {2.0f, 1.0f}, {1.0f, 0.0f}  } }, { 1.0f, 1.0f }, m_TextureTypes[2]));//T
-		m_BlockTypes.push_back(Block({ { {0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {2.0f, 1.0f}  } }, { 1.0f, 1.0f }, m_TextureTypes[2]));//Z
-		m_BlockTypes.push_back(Block({ { {1.0f, 0.0f}, {2.0f, 0.0f}, {1.0f, 1.0f}, {2.0f, 1.0f}  } }, { 1.0f, 1.0f }, m_TextureTypes[1]));//O
+		m_RandomState = Rules::getNextRandomState(m_RandomState);
+		return getBlock(Rules::getPieceOfState(m_RandomState));
+	}
+
+	Block BlockGenerator::getBlock(PieceType type) const
+	{
+		return m_BlockTypes[type - I];
+	}
+
+	void BlockGenerator::setPalette(const Palette& palette)
+	{
+		for (auto& block : m_BlockTypes)
+			block.applyPalette(palette);
+	}
+
+	bool BlockGenerator::loadTile(const sf::Image& blockTile)
+	{
+		//colours come from the palette
+		if (!m_TileTexture.loadFromImage(blockTile))
+			return false;
+		for (auto& block : m_BlockTypes)
+			block.setTile(m_TileTexture);
+		return true;
 	}
 
-	Block BlockGenerator::getRandomBlock()const
+	bool BlockGenerator::setTile(const Resources::ImageData& blockTile)
 	{
-		return m_BlockTypes[m_GetRandomBlockIndex()];
+		//blocks handed out earlier point at this texture as well
+		return Resources::updateTexture(m_TileTexture, blockTile);
 	}
-}
\ No newline at end of file
+}
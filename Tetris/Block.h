@@ -3,86 +3,110 @@
 #include <SFML/Graphics.hpp>
 #include <array>
 #include <vector>
-#include <random>
-#include <functional>
+#include <cstdint>
+#include "Board.h"
+#include "Resources.h"
+
+namespace Benchmarks {
+	class BoardFixture;
+}
 
 namespace Blocks {
+	static constexpr float blockSize = 64.f;
+	static constexpr float wallSize = 16.f;
+
+	//colour of every piece type, applied to the greyscale tile; Empty is unused
+	using Palette = std::array<sf::Color, PieceTypeCount>;
+	Palette getDefaultPalette();
+	//Okabe-Ito colours, distinguishable with the common colour vision deficiencies
+	Palette getColourblindPalette();
 
 	class Block : public sf::Drawable
 	{
 	public:
-		Block(const std::array<sf::Vector2f, 4>& _SpritesPosition, const sf::Vector2f& _RotationCenter, sf::Texture& texture);
+		//cells of the layout, the block is drawn with its top left cell at 0, 0
+		Block(const std::array<sf::Vector2i, 4>& cells, PieceType type);
 		Block() = default;
 
 		void draw(sf::RenderTarget& target, sf::RenderStates states)const override;
 		void move(const sf::Vector2f& amount);
-		void rotate();
+		void applyPalette(const Palette& palette);
+		void setTile(const sf::Texture& tile);
+		PieceType getType()const;
+		//draws the block on these board cells
+		void setCellPositions(const std::array<sf::Vector2i, 4>& cells);
 	private:
-		std::array<sf::Vector2f, 4> getCoordsAfterRotation()const;
-
 		std::array<sf::Sprite, 4> m_Sprites;
-		sf::Vector2f m_RotationCenter;
-		friend class BlockMap;
+		PieceType m_Type{ Empty };
+		friend class Benchmarks::BoardFixture;
 	};
 
+	//the drawable of every piece type with the shared tile texture
 	class BlockGenerator {
 	public:
 		BlockGenerator();
-		Block getRandomBlock()const;
+		explicit BlockGenerator(unsigned seed);
+		Block getRandomBlock();
+		//the prototype of a piece at its layout, without any move applied
+		Block getBlock(PieceType type)const;
+		void setPalette(const Palette& palette);
+		//creates the tile texture, needs a gl context, blocks handed out before have no texture
+		bool loadTile(const sf::Image& blockTile);
+		//tiles of a skin have to match the size of the loaded ones
+		bool setTile(const Resources::ImageData& blockTile);
 	private:
-		std::function<int()> m_GetRandomBlockIndex;
 		//recources
 		std::vector<Block> m_BlockTypes;
-		std::vector<sf::Texture> m_TextureTypes;
-		std::default_random_engine m_Generator;
-		std::uniform_int_distribution<int> m_UniformDistribution;
+		sf::Texture m_TileTexture;
+		std::uint32_t m_RandomState;
+		friend class Benchmarks::BoardFixture;
 	};
 
+	//draws the board cells, the game rules live in Rules::Simulation
 	class BlockMap :public sf::Drawable
 	{
 	public:
-		BlockMap(float moveDownTime);
+		BlockMap();
 
 		void draw(sf::RenderTarget& target, sf::RenderStates states)const override;
-		//check the state of current block
-		bool isGameOver()const;
-		bool isBlockMovedNormally()const;
-		bool isBlockCollided()const;
-
 		sf::String getScore();
 
-		bool checkIfBlockCanBePlaced(Block& blck)const;
-		//move
-		void moveBlockDown(Block& blck, float dltTime);
-		void moveBlockLeft(Block& blck)const;
-		void moveBlockRight(Block& blck)const;
-		void rotateBlock(Block& blck);
+		PieceType getCell(int x, int y)const;
+		const Cells& getCells()const;
+		unsigned getScoreValue()const;
+		//replaces cells and score, the cell texture is only updated when the cells differ
+		void restore(const Cells& cells, unsigned score);
 		void resetBoard();
+		//draw the board as one quad through the cell lookup shader, returns whether the shader is used
+		bool useCellShader(bool enable);
+		void setPalette(const Palette& palette);
+		//creates the textures and the cell shader, needs a gl context, nothing is drawn before
+		bool loadTiles(const sf::Image& blockTile, const sf::Image& wallTile);
+		bool setTiles(const Resources::ImageData& blockTile, const Resources::ImageData& wallTile);
 	private:
-		enum class MoveCode
-		{
-			GameOver = -1,
-			BlockMovedNormally = 0,
-			BlockCollided = 1
-		};
-		void addBlockToMap(Block& blck);
-		bool blockCollidedAtZeroY(Block& blck)const;
-		int destroyFullRows();
-		void swapRowsUpwards(int currentPosition);
-		//block move
-		MoveCode m_StateOfCurrentBlock;
-		float m_MoveDownTime;
-		float m_CurrentTime;
+		void onCellsChanged();
 		//score
 		unsigned m_Score;
 		unsigned m_PreviousScore;
 		sf::String m_ChachedScore;
 
-		const sf::Vector2f m_InvalidPosition;
-		//sprites map
-		std::vector<std::vector<sf::Sprite>> m_SpriteMatrix;
+		//cells map, row major
+		Cells m_Cells;
+		Palette m_Palette;
+		//cell lookup, one texel per cell holding its piece type in red
+		std::vector<sf::Uint8> m_CellPixels;
+		sf::Texture m_CellTexture;
+		sf::Texture m_PaletteTexture;
+		sf::VertexArray m_BoardQuad;
+		sf::Shader m_CellShader;
+		bool m_CellShaderIsLoaded;
+		bool m_UseCellShader;
+		//fallback without shaders, one tinted quad per occupied cell rebuilt when cells change
+		sf::VertexArray m_CellVertices;
 		//recources
+		sf::Texture m_TileTexture;
 		sf::Texture m_WallsTexture;
 		std::vector<sf::Sprite> m_WallsSprites;
+		friend class Benchmarks::BoardFixture;
 	};
 }
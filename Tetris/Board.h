@@ -0,0 +1,20 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace Blocks {
+	static constexpr int BlockCountX = 12;
+	static constexpr int BlockCountY = 12;
+
+	//what a board cell holds, one byte per cell
+	enum PieceType : std::uint8_t
+	{
+		Empty = 0,
+		I, L, S, J, T, Z, O,
+		PieceTypeCount
+	};
+
+	//board cells, row major
+	using Cells = std::array<PieceType, BlockCountX * BlockCountY>;
+}
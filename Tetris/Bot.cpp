@@ -0,0 +1,179 @@
+#include "Bot.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Rules {
+	//the weights of a placement per unit, a line clear makes up for a few holes but not for many
+	static constexpr int heightWeight = -51;
+	static constexpr int lineWeight = 76;
+	static constexpr int holeWeight = -36;
+	static constexpr int bumpinessWeight = -18;
+	//a rotation that does not fit at the spawn row is tried again as the piece falls
+	static constexpr unsigned maxAttempts = 24;
+	//rows a candidate may sink below the current one to fit, pieces rotated at spawn stick out above the board
+	static constexpr int maxSink = 3;
+
+	static std::uint32_t nextRandom(std::uint32_t& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	static int countTrailingZeros(std::uint32_t bits)
+	{
+#ifdef _MSC_VER
+		unsigned long index{ 0 };
+		_BitScanForward(&index, bits);
+		return static_cast<int>(index);
+#else
+		return __builtin_ctz(bits);
+#endif
+	}
+
+	//no popcnt, not every cpu the game runs on has it
+	static int countBits(std::uint32_t bits)
+	{
+		bits = bits - (bits >> 1 & 0x55555555u);
+		bits = (bits & 0x33333333u) + (bits >> 2 & 0x33333333u);
+		return static_cast<int>(((bits + (bits >> 4)) & 0x0f0f0f0fu) * 0x01010101u >> 24);
+	}
+
+	//the cells relative to the rotation cell, equal for the same rotation of the same piece anywhere on the board
+	static bool isSameRotation(const Piece& piece, const Piece& other)
+	{
+		for (size_t i{ 0 }; i < piece.cells.size(); ++i)
+			if (piece.cells[i] - piece.rotationCell != other.cells[i] - other.rotationCell)
+				return false;
+		return true;
+	}
+
+	//the weighted sum of height, cleared lines, holes and bumpiness once the piece is locked where it is
+	//on column bits, every placement of every piece is evaluated and copying the cells for each would cost most of the time
+	static int evaluate(Columns columns, const Piece& piece)
+	{
+		for (const auto& cell : piece.cells)
+			columns[cell.x] = static_cast<std::uint16_t>(columns[cell.x] | 1 << cell.y);
+		std::uint32_t fullRows{ (1u << Blocks::BlockCountY) - 1 };
+		for (const auto column : columns)
+			fullRows &= column;
+		const int lines{ countBits(fullRows) };
+		//from the top down, the rows above a cleared one move down and the full rows further down stay where they are
+		for (std::uint32_t rows{ fullRows }; rows != 0; rows &= rows - 1) {
+			const int y{ countTrailingZeros(rows) };
+			const std::uint32_t above = (1u << y) - 1;
+			for (auto& column : columns)
+				column = static_cast<std::uint16_t>((column & ~(above | 1u << y)) | (column & above) << 1);
+		}
+		//this runs for every placement the bot considers, a bit scan and a bit count per column instead of loops over its rows
+		int height{ 0 }, holes{ 0 }, bumpiness{ 0 }, previous{ -1 };
+		for (const auto column : columns) {
+			//the floor stops the scan of an empty column
+			const int columnHeight = Blocks::BlockCountY - countTrailingZeros(column | 1u << Blocks::BlockCountY);
+			holes += columnHeight - countBits(column);
+			height += columnHeight;
+			if (previous >= 0)
+				bumpiness += std::abs(columnHeight - previous);
+			previous = columnHeight;
+		}
+		return heightWeight * height + lineWeight * lines + holeWeight * holes + bumpinessWeight * bumpiness;
+	}
+
+	Bot::Bot(std::uint32_t seed, Timing::Tick ticksPerAction)
+		:m_Random(seed | 1), m_TicksPerAction(std::max<Timing::Tick>(1, ticksPerAction)), m_NextTick(0), m_HasPlan(false), m_Target{},
+		m_LastRow(0), m_IsHolding(false), m_Held(InputCount), m_Attempts(0)
+	{
+	}
+
+	Timing::Tick Bot::getNextTick() const
+	{
+		return m_NextTick;
+	}
+
+	bool Bot::act(const Simulation& game, Input& input, bool& isPressed)
+	{
+		m_NextTick = game.getTick() + m_TicksPerAction + nextRandom(m_Random) % (m_TicksPerAction / 5 + 1);
+		if (m_IsHolding) {
+			m_IsHolding = false;
+			input = m_Held;
+			isPressed = false;
+			return true;
+		}
+		if (!game.isPieceActive()) {
+			m_HasPlan = false;
+			return false;
+		}
+		const Piece& piece = game.getCurrentPiece();
+		if (!m_HasPlan || piece.type != m_Target.type || piece.rotationCell.y < m_LastRow)
+			plan(game);
+		m_LastRow = piece.rotationCell.y;
+
+		if (m_Attempts >= maxAttempts)
+			return false;
+		m_Attempts += 1;
+		if (!isSameRotation(piece, m_Target))
+			input = Rotate;
+		else if (piece.rotationCell.x < m_Target.rotationCell.x)
+			input = MoveRight;
+		else if (piece.rotationCell.x > m_Target.rotationCell.x)
+			input = MoveLeft;
+		else {
+			input = SoftDrop;
+			m_Attempts = maxAttempts;
+		}
+		isPressed = true;
+		m_IsHolding = true;
+		m_Held = input;
+		return true;
+	}
+
+	void Bot::plan(const Simulation& game)
+	{
+		const Blocks::Cells& cells = game.getCells();
+		const Columns columns = getColumns(cells);
+		const Piece& piece = game.getCurrentPiece();
+		std::array<Piece, 4> rotations{ { piece } };
+		for (size_t rotation{ 1 }; rotation < rotations.size(); ++rotation)
+			rotations[rotation] = getRotated(rotations[rotation - 1]);
+		int best{ 0 };
+		bool hasBest{ false };
+		for (size_t rotation{ 0 }; rotation < rotations.size(); ++rotation) {
+			const Piece& rotated = rotations[rotation];
+			//the O has one rotation and the I, S and Z have two, the others would only be evaluated again
+			bool isRepeated{ false };
+			for (size_t earlier{ 0 }; earlier < rotation && !isRepeated; ++earlier)
+				isRepeated = isSameRotation(rotated, rotations[earlier]);
+			if (isRepeated)
+				continue;
+			int left{ Blocks::BlockCountX }, right{ -1 };
+			for (const auto& cell : rotated.cells) {
+				left = std::min(left, cell.x);
+				right = std::max(right, cell.x);
+			}
+			for (int offset{ -left }; offset < Blocks::BlockCountX - right; ++offset) {
+				Piece moved = getMoved(rotated, { offset, 0 });
+				int sink{ 0 };
+				for (; sink <= maxSink && !fits(cells, moved); ++sink)
+					moved = getMoved(moved, { 0, 1 });
+				if (sink > maxSink)
+					continue;
+				const int value = evaluate(columns, getMoved(moved, { 0, getDropDistance(columns, moved) }));
+				if (!hasBest || value > best) {
+					best = value;
+					hasBest = true;
+					m_Target = getMoved(rotated, { offset, 0 });
+				}
+			}
+		}
+		if (!hasBest)
+			m_Target = piece;
+		m_HasPlan = true;
+		m_Attempts = 0;
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include "Scheduler.h"
+#include "Simulation.h"
+
+namespace Rules {
+	//plays a simulation the way a player does, through key presses some ticks apart
+	//for every new piece it picks the rotation and column that leave the lowest, flattest board with the fewest holes,
+	//then taps the piece there and soft drops it, nothing about the game is read that a player could not see
+	class Bot
+	{
+	public:
+		//ticksPerAction is the time between two key events, a fifth of it is added at random each time
+		Bot(std::uint32_t seed, Timing::Tick ticksPerAction);
+
+		//the tick the bot wants to act at next, the game is advanced to it before act is called
+		Timing::Tick getNextTick()const;
+		//at most one key event at the current tick of the game, false when the bot waits
+		bool act(const Simulation& game, Input& input, bool& isPressed);
+	private:
+		void plan(const Simulation& game);
+
+		std::uint32_t m_Random;
+		Timing::Tick m_TicksPerAction;
+		Timing::Tick m_NextTick;
+		bool m_HasPlan;
+		//where the piece should end up before it is dropped, its rotation and its column
+		Piece m_Target;
+		//the row the piece was in at the last action, a piece above it is a new one
+		int m_LastRow;
+		//a key is released by the action after the one that pressed it
+		bool m_IsHolding;
+		Input m_Held;
+		//rotations and moves tried for the current piece, a piece that can not get to the target is dropped where it is
+		unsigned m_Attempts;
+	};
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Storage {
+	//every file and stream of the game is little endian whatever the machine, numbers are written and read a byte at a time
+
+	//at a fixed offset
+	template<typename T>
+	inline void storeLittleEndian(std::uint8_t* data, size_t offset, T value)
+	{
+		for (size_t i{ 0 }; i < sizeof(T); ++i)
+			data[offset + i] = static_cast<std::uint8_t>(static_cast<std::uint64_t>(value) >> (8 * i));
+	}
+
+	template<typename T>
+	inline T loadLittleEndian(const std::uint8_t* data, size_t offset)
+	{
+		std::uint64_t bits{ 0 };
+		for (size_t i{ 0 }; i < sizeof(T); ++i)
+			bits |= static_cast<std::uint64_t>(data[offset + i]) << (8 * i);
+		return static_cast<T>(bits);
+	}
+
+	//at offset, which is moved past the value
+	template<typename T>
+	inline void putLittleEndian(std::uint8_t* data, size_t& offset, T value)
+	{
+		storeLittleEndian(data, offset, value);
+		offset += sizeof(T);
+	}
+
+	template<typename T>
+	inline T getLittleEndian(const std::uint8_t* data, size_t& offset)
+	{
+		const T value = loadLittleEndian<T>(data, offset);
+		offset += sizeof(T);
+		return value;
+	}
+
+	template<typename T>
+	inline void appendLittleEndian(std::vector<std::uint8_t>& bytes, T value)
+	{
+		for (size_t i{ 0 }; i < sizeof(T); ++i)
+			bytes.push_back(static_cast<std::uint8_t>(static_cast<std::uint64_t>(value) >> (8 * i)));
+	}
+
+	//false without moving offset when fewer than sizeof(T) of the size bytes are left
+	template<typename T>
+	inline bool readLittleEndian(const std::uint8_t* data, size_t size, size_t& offset, T& value)
+	{
+		if (offset > size || size - offset < sizeof(T))
+			return false;
+		value = getLittleEndian<T>(data, offset);
+		return true;
+	}
+
+	//fnv-1a, the checksum of every file that has one
+	inline std::uint32_t fnv1a(const std::uint8_t* data, size_t size)
+	{
+		std::uint32_t hash{ 2166136261u };
+		for (size_t i{ 0 }; i < size; ++i)
+			hash = (hash ^ data[i]) * 16777619u;
+		return hash;
+	}
+
+	//folded to 16 bits for small records, enough to find the torn tail of an append
+	inline std::uint16_t foldedFnv1a(const std::uint8_t* data, size_t size)
+	{
+		const std::uint32_t hash = fnv1a(data, size);
+		return static_cast<std::uint16_t>(hash ^ (hash >> 16));
+	}
+}
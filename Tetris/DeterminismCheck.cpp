@@ -0,0 +1,199 @@
+#include "DeterminismCheck.h"
+#include <array>
+#include <cstdint>
+#include <iomanip>
+#include <vector>
+#include "Rollback.h"
+#include "Simulation.h"
+
+namespace Instrumentation {
+	//games long enough to top out several times
+	static constexpr int inputsPerGame = 20000;
+	//the second copy of a game goes through a save and restore every that many inputs
+	static constexpr int inputsPerRestore = 97;
+	//garbage as an opponent would send it
+	static constexpr int inputsPerGarbage = 389;
+
+	//the rollback match runs for two minutes, one input every fourth frame on average, then the wire is drained
+	static constexpr Timing::Tick rollbackMatchTicks = 120 * Timing::TicksPerSecond;
+	static constexpr Timing::Tick drainTicks = 2 * Timing::TicksPerSecond;
+	static constexpr Timing::Tick frameTicks = 4;
+	//one way delays of 50 to 200ms, one packet in ten is lost
+	static constexpr Timing::Tick minDelay = 12;
+	static constexpr Timing::Tick delaySpread = 37;
+	static constexpr std::uint32_t lossPerMille = 100;
+	static constexpr std::uint64_t maxInputsPerPacket = 64;
+
+	struct ExpectedGame
+	{
+		std::uint32_t seed;
+		unsigned startLevel;
+		std::uint64_t checksum;
+	};
+	//reached by the reference build, a build that differs does not replay the same games
+	//the start levels cover slow gravity, several cells per tick and 20G
+	static constexpr std::array<ExpectedGame, 4> expectedGames{ {
+		{ 1, 0, 0x457904fbe3edd98bull },
+		{ 2, 0, 0x9f4eb553f430b694ull },
+		{ 12345, 13, 0x72d38a0b8bd0ebf2ull },
+		{ 4000000000u, 16, 0x6dda48971fc65f86ull }
+	} };
+
+	//xorshift32, inputs must not depend on the standard library's distributions either
+	static std::uint32_t nextInput(std::uint32_t& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	static std::uint64_t combine(std::uint64_t trail, std::uint64_t checksum)
+	{
+		return (trail ^ checksum) * 1099511628211ull;
+	}
+
+	//the checksum of every lock folded into one, or 0 when the restored copy went its own way
+	static std::uint64_t playGame(std::uint32_t seed, unsigned startLevel, unsigned& locks)
+	{
+		Rules::Simulation game(seed);
+		game.setStartLevel(startLevel);
+		Rules::Simulation restored(game);
+		std::uint32_t random{ seed | 1 };
+		std::uint64_t trail{ 14695981039346656037ull };
+		Timing::Tick tick{ 0 };
+		locks = 0;
+		for (int input{ 0 }; input < inputsPerGame; ++input) {
+			tick += 1 + nextInput(random) % 60;
+			for (;;) {
+				const bool hasLocked = game.advance(tick);
+				if (restored.advance(tick) != hasLocked || restored.getChecksum() != game.getChecksum())
+					return 0;
+				if (!hasLocked)
+					break;
+				trail = combine(trail, game.getChecksum());
+				locks += 1;
+			}
+			//saved where the game saves, after advancing, an input that locks is only reported by the next advance
+			if (input % inputsPerRestore == 0) {
+				Storage::SnapshotBuffer buffer;
+				Storage::Snapshot snapshot;
+				const size_t size = Storage::encodeSnapshot(restored.takeSnapshot(), buffer);
+				restored = Rules::Simulation(~seed);
+				restored.setStartLevel(startLevel);
+				if (!Storage::decodeSnapshot(buffer.data(), size, snapshot) || !restored.restoreSnapshot(snapshot))
+					return 0;
+			}
+			const auto key = static_cast<Rules::Input>(nextInput(random) % Rules::InputCount);
+			const bool isPressed = nextInput(random) % 3 != 0;
+			game.apply(key, isPressed);
+			restored.apply(key, isPressed);
+			if (input % inputsPerGarbage == 0) {
+				game.addGarbage(input / inputsPerGarbage % 4 + 1);
+				restored.addGarbage(input / inputsPerGarbage % 4 + 1);
+			}
+		}
+		return combine(trail, game.getChecksum());
+	}
+
+	//what a packet of the versus link carries, without the link
+	struct Transfer
+	{
+		Timing::Tick due;
+		size_t to;
+		Timing::Tick tick;
+		std::uint64_t inputsReceived;
+		std::uint64_t firstInput;
+		std::vector<Rules::TimedInput> inputs;
+	};
+
+	static void deliver(const Transfer& transfer, Rules::RollbackMatch& side)
+	{
+		side.acknowledgeLocalInputs(transfer.inputsReceived);
+		bool isValid{ true };
+		for (size_t i{ 0 }; i < transfer.inputs.size() && isValid; ++i)
+			isValid = side.addRemoteInput(transfer.firstInput + i, transfer.inputs[i]);
+		if (isValid)
+			side.setRemoteKnownUntil(transfer.tick);
+	}
+
+	//false when a side ends up anywhere else than the match played with every input on time
+	static bool playRollbackMatch(std::ostream& out)
+	{
+		Rules::Simulation first(7), second(8);
+		first.setStartLevel(13);
+		second.setStartLevel(13);
+		const Rules::Match start(first, second);
+		std::array<Rules::RollbackMatch, Rules::Match::playerCount> sides{ { { start, 0 }, { start, 1 } } };
+		std::array<std::vector<Rules::TimedInput>, Rules::Match::playerCount> applied;
+		std::vector<Transfer> wire;
+		std::uint32_t random{ 0x2545f491 };
+		Timing::Tick now{ 0 };
+		for (; now < rollbackMatchTicks + drainTicks; now += frameTicks) {
+			const bool isDraining = now >= rollbackMatchTicks;
+			for (size_t player{ 0 }; player < sides.size(); ++player) {
+				Rules::RollbackMatch& side = sides[player];
+				side.advance(now);
+				if (!isDraining && nextInput(random) % 4 == 0) {
+					const auto key = static_cast<Rules::Input>(nextInput(random) % Rules::InputCount);
+					const bool isPressed = nextInput(random) % 3 != 0;
+					side.applyLocal(key, isPressed);
+					applied[player].push_back({ side.getTick(), key, isPressed });
+				}
+				Transfer transfer{ now + minDelay + nextInput(random) % delaySpread, 1 - player, side.getTick(), side.getRemoteInputCount(), side.getAcknowledgedLocalInputs(), {} };
+				for (std::uint64_t sequence{ transfer.firstInput }; sequence < side.getLocalInputCount() && transfer.inputs.size() < maxInputsPerPacket; ++sequence)
+					transfer.inputs.push_back(side.getLocalInput(sequence));
+				if (isDraining || nextInput(random) % 1000 >= lossPerMille)
+					wire.push_back(transfer);
+			}
+			//in the order they arrive, not the order they were sent
+			for (size_t i{ 0 }; i < wire.size();) {
+				if (wire[i].due > now) {
+					++i;
+					continue;
+				}
+				deliver(wire[i], sides[wire[i].to]);
+				wire[i] = wire.back();
+				wire.pop_back();
+			}
+		}
+		for (auto& side : sides)
+			side.advance(now);
+
+		//the same inputs at the same ticks, the way a rollback replays them
+		Rules::Match reference(start);
+		std::array<size_t, Rules::Match::playerCount> next{};
+		for (Timing::Tick tick{ 0 }; tick <= now; ++tick) {
+			reference.advance(tick);
+			for (size_t player{ 0 }; player < applied.size(); ++player)
+				for (; next[player] < applied[player].size() && applied[player][next[player]].tick == tick; ++next[player])
+					reference.apply(player, applied[player][next[player]].input, applied[player][next[player]].isPressed);
+		}
+
+		const std::uint64_t checksum = reference.getChecksum();
+		bool isSame{ true };
+		for (const auto& side : sides) {
+			const Rules::RollbackStats& stats = side.getStats();
+			const bool isSideSame = side.getTick() == now && side.getMatch().getChecksum() == checksum;
+			out << "rollback side " << side.getLocalPlayer() << ": " << stats.rollbacks << " rollbacks, deepest " << stats.deepestRollback
+				<< " ticks, checksum " << std::hex << std::setw(16) << std::setfill('0') << side.getMatch().getChecksum()
+				<< std::dec << std::setfill(' ') << (isSideSame ? " ok" : " differs from the match with every input on time") << "\n";
+			isSame = isSame && isSideSame;
+		}
+		return isSame;
+	}
+
+	bool checkDeterminism(std::ostream& out)
+	{
+		bool isDeterministic{ true };
+		for (const auto& expected : expectedGames) {
+			unsigned locks{ 0 };
+			const std::uint64_t checksum = playGame(expected.seed, expected.startLevel, locks);
+			const bool isExpected = checksum == expected.checksum;
+			out << "seed " << expected.seed << " from level " << expected.startLevel << ": " << locks << " locks, checksum " << std::hex << std::setw(16) << std::setfill('0') << checksum
+				<< std::dec << std::setfill(' ') << (isExpected ? " ok" : checksum == 0 ? " restored copy diverged" : " differs from the reference build") << "\n";
+			isDeterministic = isDeterministic && isExpected;
+		}
+		return playRollbackMatch(out) && isDeterministic;
+	}
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <ostream>
+
+namespace Instrumentation {
+	//plays seeded games with generated inputs, without a window, and compares their state checksums
+	//with the ones every build has to reach; a second copy of each game is saved and restored
+	//along the way and has to stay identical, returns false on any difference
+	//then two rollback matches exchange their inputs late and out of order and have to end up where
+	//a match with every input on time does
+	bool checkDeterminism(std::ostream& out);
+}
@@ -1,49 +1,300 @@
 #include "Game.h"
+#include "Resources.h"
+#include "ResidentMemory.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
 #include <memory>
+#include <sstream>
+#include <thread>
 #include <SFML/Graphics.hpp>
 
-static constexpr float moveDownTime = 0.6f;
+//prime so injected inputs drift across the frame instead of locking to its phase
+static constexpr float injectedInputInterval = 0.097f;
+//longer frames are not caught up, e.g. while the window is dragged
+static constexpr float maxFrameTime = 0.25f;
+//how often the input thread pumps the window queue
+static constexpr sf::Int64 inputSamplingPeriod = 1000;//1ms
+//gl uploads per frame are capped so the loading screen and later frames keep their pace
+static constexpr sf::Int64 assetUploadBudget = 4000;//4ms
+//enough for about 150 pieces
+static constexpr size_t defaultRewindBudget = 16 * 1024;
+static const sf::Vector2f loadingBarSize{ 400.f, 24.f };
+//the opponent's board is drawn at half size right of ours, the window grows by that much
+static const sf::Vector2f opponentBoardOrigin{ 800.f, 0.f };
+static constexpr unsigned versusWindowWidth = 1200;
+//a side further ahead of the other than this lets a tick pass without playing it, so both get the inputs of the other equally late
+static constexpr std::int64_t maxTicksAhead = 2;
+//the other 98 boards of a royale in a grid right of ours, each one pixel per cell with a pixel of space around it
+static constexpr unsigned thumbnailColumns = 10;
+static constexpr unsigned thumbnailRows = 10;
+static constexpr unsigned thumbnailCells = Blocks::BlockCountX + 1;
+static constexpr float thumbnailScale = 3.f;
+static const sf::Vector2f thumbnailOrigin{ 805.f, 8.f };
+static const sf::Color thumbnailBackground{ 40, 40, 40 };
+static const std::array<const char*, Rules::TargetingCount> targetingNames{ { "random", "knockouts", "attackers", "badges" } };
+//the high scores cover the board while tab is held
+static constexpr size_t highScoresShown = 10;
+static const sf::Vector2f highScoresOrigin{ 64.f, 40.f };
+static const sf::Vector2f highScoresSize{ 672.f, 700.f };
+
+static constexpr Timing::Tick maxFrameTicks = Timing::secondsToTicks(maxFrameTime);
+
+//fnv-1a over the gravity of every level, both sides of a match have to play with the same
+static std::uint32_t getSettingsHash(const Rules::GravityTable& gravity)
+{
+	std::uint32_t hash{ 2166136261u };
+	for (std::uint32_t level : gravity)
+		hash = (hash ^ level) * 16777619u;
+	return hash;
+}
 
 Game::Game() :
-	m_SpaceKeyIsReleased(true),
-	m_BlockMap(moveDownTime)
+	m_Seed(static_cast<std::uint32_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count())),
+	m_Simulation(m_Seed),
+	m_Running(false),
+	m_FramesPerSecond(0),
+	m_Level(0),
+	m_SavePath(Storage::getDefaultSavePath()),
+	m_ResumeSavedGame(true),
+	m_HasSavedGame(false),
+	m_JournalSequence(0),
+	m_HasJournal(false),
+	m_JournalFirstSequence(0),
+	m_RewindBuffer(defaultRewindBudget),
+	m_IsRoyale(false),
+	m_Palette(Blocks::getDefaultPalette()),
+	m_ShowsHighScores(false),
+	m_LastPlace(0),
+	m_LastScore(0),
+	m_SubmitsScores(false),
+	m_ScoreEndpoint{},
+	m_ReplayHash(0),
+	m_SeenTopOuts(0),
+	m_LastScrapeTicks(0),
+	m_LastScrapePieces(0)
 {
-	initText();
+	//the window comes first so something is on screen while the assets load
 	initWindow();
-	initBlocks();
 }
 
 void Game::initText() {
-	if (!m_Font.loadFromFile("Recources/courbd.ttf"))
-		static_assert(2, "failed to load font");
-
 	m_Score.setFont(m_Font);
 	m_Score.setCharacterSize(80);
 	m_Score.setPosition({ 312.f , 804.f });
 	m_Score.setFillColor({ 255, 255, 103 });
 	m_Score.setString(m_BlockMap.getScore());
+	m_VersusScore.setFont(m_Font);
+	m_VersusScore.setCharacterSize(40);
+	m_VersusScore.setPosition({ 824.f , 500.f });
+	m_VersusScore.setFillColor({ 255, 255, 103 });
+	m_HighScores.setFont(m_Font);
+	m_HighScores.setCharacterSize(40);
+	m_HighScores.setPosition(highScoresOrigin + sf::Vector2f{ 32.f, 24.f });
+	m_HighScores.setFillColor({ 255, 255, 103 });
+	m_HighScoresBack.setPosition(highScoresOrigin);
+	m_HighScoresBack.setSize(highScoresSize);
+	m_HighScoresBack.setFillColor({ 0, 0, 0, 224 });
+	m_HighScoresBack.setOutlineColor({ 255, 255, 103 });
+	m_HighScoresBack.setOutlineThickness(2.f);
 }
 
-void Game::onUpdate(float dlt)
+void Game::onUpdate(sf::Time now)
 {
-	m_Window->setTitle(std::to_string(static_cast<int>(1 / dlt)).c_str());
-	if (m_BlockArrows)
-		m_BlockMap.moveBlockDown(m_CurrentBlock, dlt * 10);
+	const sf::Time dlt = now - m_LastFrame;
+	m_LastFrame = now;
+	if (dlt > sf::Time::Zero) {
+		m_FramesPerSecond = static_cast<int>(1.f / dlt.asSeconds());
+		m_FrameTimes.record(static_cast<std::uint64_t>(dlt.asMicroseconds()));
+	}
+	const Timing::Tick firstTick = m_Simulation.getTick();
+	//frames longer than maxFrameTime are not caught up, the tick origin slides forward instead
+	//our game stands still once we are knocked out of a royale, the others go on
+	const Timing::Tick lastAllowedTick = (m_Royale ? m_Royale->getTick() : m_Simulation.getTick()) + maxFrameTicks;
+	if (tickAt(now) > lastAllowedTick)
+		m_TickOrigin = now - sf::microseconds(Timing::ticksToMicroseconds(lastAllowedTick));
+
+	processKeys(now);
+	if (m_Match)
+		updateVersus(now);
 	else
-		m_BlockMap.moveBlockDown(m_CurrentBlock, dlt);
+		advanceSimulation(tickAt(now));
+	m_TicksPlayed.add(m_Simulation.getTick() - firstTick);
+	//a rewind can take the count back, that does not unplay the game
+	if (m_Simulation.getTopOuts() > m_SeenTopOuts) {
+		m_GamesPlayed.add(m_Simulation.getTopOuts() - m_SeenTopOuts);
+		if (!m_Match && !m_Royale)
+			submitGame();
+	}
+	m_SeenTopOuts = m_Simulation.getTopOuts();
+	updateScene();
+}
 
-	handleBlockMovement();
+void Game::advanceSimulation(Timing::Tick lastTick)
+{
+	//a match is neither saved nor undone, the rollback keeps states of its own
+	if (m_Match) {
+		m_Match->advance(lastTick);
+		m_Simulation = m_Match->getMatch().getPlayer(m_Match->getLocalPlayer());
+		return;
+	}
+	if (m_Royale) {
+		m_Royale->advance(lastTick);
+		m_Simulation = m_Royale->getGame(0);
+		return;
+	}
+	while (m_Simulation.advance(lastTick)) {
+		checkpoint();
+		m_PiecesLocked.add();
+	}
+}
+
+Timing::Tick Game::tickAt(sf::Time time) const
+{
+	return Timing::microsecondsToTicks((time - m_TickOrigin).asMicroseconds());
+}
+
+void Game::updateScene()
+{
+	m_BlockMap.restore(m_Simulation.getCells(), m_Simulation.getScore());
 	m_Score.setString(m_BlockMap.getScore());
+	m_Level = m_Simulation.getLevel();
+	const Rules::Piece& current = m_Simulation.getCurrentPiece();
+	if (m_CurrentBlock.getType() != current.type)
+		m_CurrentBlock = m_BlockGenerator.getBlock(current.type);
+	m_CurrentBlock.setCellPositions(current.cells);
+	if (m_NextBlock.getType() != m_Simulation.getNextPiece()) {
+		m_NextBlock = m_BlockGenerator.getBlock(m_Simulation.getNextPiece());
+		m_NextBlock.move({ 24.f , 792.f });
+	}
+	if (m_Match) {
+		const Rules::Simulation& opponent = m_Match->getMatch().getPlayer(Rules::Match::playerCount - 1 - m_Match->getLocalPlayer());
+		m_OpponentMap.restore(opponent.getCells(), opponent.getScore());
+		const Rules::Piece& piece = opponent.getCurrentPiece();
+		if (m_OpponentBlock.getType() != piece.type)
+			m_OpponentBlock = m_BlockGenerator.getBlock(piece.type);
+		m_OpponentBlock.setCellPositions(piece.cells);
+		m_VersusScore.setString("won " + std::to_string(opponent.getTopOuts()) + "\nlost " + std::to_string(m_Simulation.getTopOuts())
+			+ "\nscore\n" + m_OpponentMap.getScore());
+	}
+	if (m_Royale)
+		updateRoyale();
 }
 
-void Game::initBlocks()
+void Game::updateRoyale()
 {
-	m_BlockArrows = false;
-	m_CurrentBlock = m_BlockGenerator.getRandomBlock();
-	m_CurrentBlock.move({ 272.f, 0.f });
+	//one texture upload a frame for all of them, the boards are far too small for tiles
+	for (size_t player{ 1 }; player < Rules::Royale::playerCount; ++player) {
+		const Rules::Simulation& game = m_Royale->getGame(player);
+		const bool isAlive = m_Royale->getPlayer(player).isAlive;
+		Blocks::Cells cells = game.getCells();
+		if (isAlive && game.isPieceActive())
+			for (const auto& cell : game.getCurrentPiece().cells)
+				if (cell.y >= 0)
+					cells[cell.y * Blocks::BlockCountX + cell.x] = game.getCurrentPiece().type;
+		const size_t slot = player - 1;
+		const size_t left = slot % thumbnailColumns * thumbnailCells, top = slot / thumbnailColumns * thumbnailCells;
+		for (int y{ 0 }; y < Blocks::BlockCountY; ++y)
+			for (int x{ 0 }; x < Blocks::BlockCountX; ++x) {
+				const Blocks::PieceType cell = cells[y * Blocks::BlockCountX + x];
+				sf::Color colour{ cell == Blocks::Empty ? thumbnailBackground : m_Palette[cell] };
+				//a knocked out board stays as it ended, dimmed
+				if (!isAlive)
+					colour = { static_cast<sf::Uint8>(colour.r / 3), static_cast<sf::Uint8>(colour.g / 3), static_cast<sf::Uint8>(colour.b / 3) };
+				sf::Uint8* pixel = &m_ThumbnailPixels[((top + y) * thumbnailColumns * thumbnailCells + left + x) * 4];
+				pixel[0] = colour.r;
+				pixel[1] = colour.g;
+				pixel[2] = colour.b;
+				pixel[3] = 255;
+			}
+	}
+	m_ThumbnailTexture.update(m_ThumbnailPixels.data());
 
-	m_NextBlock = m_BlockGenerator.getRandomBlock();
-	m_NextBlock.move({ 24.f , 792.f });
+	const Rules::RoyalePlayer& local = m_Royale->getPlayer(0);
+	if (local.target != 0) {
+		const size_t slot = local.target - 1u;
+		m_TargetFrame.setPosition(thumbnailOrigin + thumbnailScale * sf::Vector2f(static_cast<float>(slot % thumbnailColumns * thumbnailCells),
+			static_cast<float>(slot / thumbnailColumns * thumbnailCells)));
+	}
+	std::string status{ "alive " + std::to_string(m_Royale->getAliveCount()) };
+	if (!local.isAlive || m_Royale->isOver())
+		status += "\nplace " + std::to_string(local.placement);
+	m_VersusScore.setString(status + "\nKOs " + std::to_string(local.knockouts) + "  badges " + std::to_string(m_Royale->getBadgeLevel(0))
+		+ "\nincoming " + std::to_string(m_Royale->getIncomingRows(0)) + "\nattackers " + std::to_string(m_Royale->getAttackerCount(0))
+		+ "\n1-4 target " + targetingNames[local.targeting]);
+}
+
+void Game::updateVersus(sf::Time now)
+{
+	m_Versus.receive(m_Match.get(), now);
+	if (m_Versus.getTicksAhead(m_Match->getTick(), now) > maxTicksAhead)
+		m_TickOrigin += sf::microseconds(Timing::ticksToMicroseconds(1));
+	advanceSimulation(tickAt(now));
+	//time stands still without the opponent's inputs, it would only have to be caught up later
+	if (m_Match->getTick() < tickAt(now)) {
+		const sf::Time origin = now - sf::microseconds(Timing::ticksToMicroseconds(m_Match->getTick()));
+		m_VersusWait += origin - m_TickOrigin;
+		m_TickOrigin = origin;
+	}
+	m_Versus.send(m_Match.get(), now);
+}
+
+bool Game::waitForOpponent()
+{
+	m_Versus.setGreeting({ m_Seed, static_cast<std::uint8_t>(m_Simulation.getStartLevel()), getSettingsHash(m_Simulation.getGravityTable()) });
+	m_VersusScore.setString("waiting for\nthe opponent");
+	while (!m_Versus.hasRemoteGreeting()) {
+		while (m_Window->pollEvent(this->event))
+			if (event.type == sf::Event::Closed)
+				return false;
+		const sf::Time now = m_Clock.getElapsedTime();
+		m_Versus.receive(nullptr, now);
+		m_Versus.send(nullptr, now);
+		//the frame rate limit paces the greetings
+		onRender();
+	}
+	return startMatch();
+}
+
+bool Game::startMatch()
+{
+	const Network::Greeting& greeting = m_Versus.getRemoteGreeting();
+	if (greeting.settings != getSettingsHash(m_Simulation.getGravityTable())) {
+		std::cerr << "the opponent plays with another gravity table\n";
+		return false;
+	}
+	//the opponent's game as it runs over there, from its seed and start level
+	Rules::Simulation opponent(greeting.seed);
+	opponent.setGravityTable(m_Simulation.getGravityTable());
+	opponent.setStartLevel(greeting.startLevel);
+	const bool isFirst = m_Versus.isFirstPlayer();
+	m_Match.reset(new Rules::RollbackMatch(isFirst ? Rules::Match(m_Simulation, opponent) : Rules::Match(opponent, m_Simulation), isFirst ? 0 : 1));
+	updateScene();
+	return true;
+}
+
+void Game::startRoyale()
+{
+	//our game is player 0, with the seed, start level and gravity it would have had alone
+	m_Royale.reset(new Rules::Royale(m_Seed, m_Simulation.getStartLevel()));
+	m_Royale->setGravityTable(m_Simulation.getGravityTable());
+	m_Royale->addBots(1);
+	m_Simulation = m_Royale->getGame(0);
+	const unsigned width = thumbnailColumns * thumbnailCells, height = thumbnailRows * thumbnailCells;
+	m_ThumbnailPixels.assign(width * height * 4, 0);
+	m_ThumbnailTexture.create(width, height);
+	m_ThumbnailSprite.setTexture(m_ThumbnailTexture, true);
+	m_ThumbnailSprite.setPosition(thumbnailOrigin);
+	m_ThumbnailSprite.setScale(thumbnailScale, thumbnailScale);
+	m_TargetFrame.setSize(thumbnailScale * sf::Vector2f(static_cast<float>(Blocks::BlockCountX), static_cast<float>(Blocks::BlockCountY)));
+	m_TargetFrame.setFillColor(sf::Color::Transparent);
+	m_TargetFrame.setOutlineColor({ 255, 255, 103 });
+	m_TargetFrame.setOutlineThickness(2.f);
+	updateScene();
 }
 
 void Game::initWindow()
@@ -52,75 +303,573 @@ void Game::initWindow()
 	videoMode.width = 800;
 	m_Window.reset(new sf::RenderWindow(videoMode, "", sf::Style::Titlebar | sf::Style::Close));
 	m_Window->setFramerateLimit(60);
+	//left&right repeat is driven by the scheduler, not by the os
+	m_Window->setKeyRepeatEnabled(false);
 }
 
-void Game::run()
+void Game::loadAssets()
 {
-	sf::Clock clk;
-	float dlt{};
-	while (m_Window->isOpen())
-	{
-		processKeys();
-		dlt = clk.restart().asSeconds();
-		onUpdate(dlt);
-		onRender();
+	//board tiles and the saved game are all play needs, the score font and a theme arrive while the game already runs
+	//uploads run in the order the jobs are added and play waits for every job up to the last required one
+	m_Loader.add("block tiles",
+		[this] { return Resources::loadImage(m_BlockTile, Resources::blockTile) && Resources::loadImage(m_WallTile, Resources::wallTile); },
+		[this] {
+			const bool isLoaded = m_BlockMap.loadTiles(m_BlockTile, m_WallTile) && m_BlockGenerator.loadTile(m_BlockTile)
+				&& (!m_Versus.isOpen() || m_OpponentMap.loadTiles(m_BlockTile, m_WallTile));
+			//blocks copied before have no tile, play starts either way, without tiles it is just invisible
+			m_CurrentBlock = {};
+			m_NextBlock = {};
+			m_OpponentBlock = {};
+			updateScene();
+			return isLoaded;
+		}, true);
+	if (!m_SavePath.empty()) {
+		//a missing save is not an error, the fresh game from the tiles job just stays
+		m_Loader.add("saved game",
+			[this] {
+				m_HasSavedGame = m_ResumeSavedGame && Storage::readSnapshot(m_SavePath, m_SavedGame);
+				m_HasJournal = m_HasSavedGame && Storage::readJournal(Storage::getJournalPath(m_SavePath), m_JournalFirstSequence, m_JournaledInputs);
+				return true;
+			},
+			[this] {
+				if (m_HasSavedGame && restoreSnapshot(m_SavedGame)) {
+					if (m_HasJournal)
+						replayJournal();
+					m_Simulation.releaseInputs();
+				}
+				updateScene();
+				//the locks replayed above are only checkpointed for rewinding, the save written here is the only one until the writer starts,
+				//an older snapshot renamed in after it would leave the new journal with a gap
+				startJournal();
+				m_SnapshotWriter.reset(new Storage::SnapshotWriter(m_SavePath));
+				return true;
+			}, true);
 	}
+	m_Loader.add("score font",
+		[this] { return Resources::loadFont(m_Font, Resources::scoreFont); },
+		[this] { initText(); return true; }, false);
+	if (!m_SkinPackPath.empty())
+		m_Loader.add("theme " + m_SkinTheme,
+			[this] {
+				if (!m_SkinPack.open(m_SkinPackPath) || !m_SkinPack.findSkin(m_SkinTheme, m_Skin))
+					return false;
+				//the font is parsed here, the font job ahead of this one never touches m_SkinFont
+				if (m_Skin.font.size != 0 && !Resources::loadFont(m_SkinFont, m_Skin.font))
+					m_Skin.font = { nullptr, 0 };
+				return true;
+			},
+			[this] { return applySkin(); }, false);
+	m_Loader.start();
 }
 
-void Game::handleBlockMovement()
+bool Game::showLoadingScreen()
 {
-	if (m_BlockMap.isBlockCollided()) {
-		m_CurrentBlock = m_NextBlock;
-		m_NextBlock = m_BlockGenerator.getRandomBlock();
-		m_NextBlock.move({ 24.f , 792.f });
-		m_CurrentBlock.move({ 248.f, -792.f });
-		if (!m_BlockMap.checkIfBlockCanBePlaced(m_CurrentBlock))
-		{
-			m_BlockMap.resetBoard();
-			initBlocks();
+	sf::RectangleShape frame(loadingBarSize), bar;
+	frame.setOrigin(loadingBarSize / 2.f);
+	frame.setPosition(sf::Vector2f(m_Window->getSize()) / 2.f);
+	frame.setFillColor(sf::Color::Transparent);
+	frame.setOutlineColor({ 255, 255, 103 });
+	frame.setOutlineThickness(2.f);
+	bar.setPosition(frame.getPosition() - frame.getOrigin());
+	bar.setFillColor({ 255, 255, 103 });
+	while (!m_Loader.isReady()) {
+		while (m_Window->pollEvent(this->event))
+			if (event.type == sf::Event::Closed)
+				return false;
+		m_Loader.uploadReady(sf::microseconds(assetUploadBudget));
+		bar.setSize({ loadingBarSize.x * m_Loader.getProgress(), loadingBarSize.y });
+		m_Window->clear();
+		m_Window->draw(frame);
+		m_Window->draw(bar);
+		m_Window->display();
+	}
+	return true;
+}
+
+void Game::run()
+{
+	loadAssets();
+	if (!showLoadingScreen() || (m_Versus.isOpen() && !waitForOpponent())) {
+		m_Window->close();
+		return;
+	}
+	if (m_IsRoyale)
+		startRoyale();
+	//the first piece can be undone too
+	checkpoint();
+	m_SeenTopOuts = m_Simulation.getTopOuts();
+	startReplayHash();
+	//a game that is not saved is not kept either
+	if (!m_SavePath.empty() && !m_Leaderboard.open(Storage::getLeaderboardPath(m_SavePath)))
+		std::cerr << "failed to open the leaderboard, finished games are not kept\n";
+	//an unsaved game still keeps its queue where the save would be
+	if (m_SubmitsScores && !m_ScoreSubmitter.open(m_ScoreEndpoint, Network::getScoreQueuePath(m_SavePath.empty() ? Storage::getDefaultSavePath() : m_SavePath)))
+		std::cerr << "failed to read the score queue, scores are not submitted\n";
+	m_TickOrigin = m_Clock.getElapsedTime() - sf::microseconds(Timing::ticksToMicroseconds(m_Simulation.getTick()));
+	m_LastFrame = m_Clock.getElapsedTime();
+	const sf::Time playStart = m_LastFrame;
+	//inputs due while loading or waiting for the opponent would all arrive in the first frame with their wait counted as latency
+	if (m_InputInjector)
+		m_InputInjector->start(playStart);
+	m_Running = true;
+	//the gl context moves to the simulation thread, the window stays here because
+	//the os only delivers its events to the thread that created it
+	m_Window->setActive(false);
+	std::thread simulation(&Game::simulationLoop, this);
+	sampleInput();
+	simulation.join();
+	m_Window->close();
+	autosave();
+
+	if (m_LatencyProbe) {
+		m_LatencyProbe->report(std::cout);
+		if (!m_LatencySamplesPath.empty()) {
+			std::ofstream samples(m_LatencySamplesPath);
+			m_LatencyProbe->writeSamples(samples);
 		}
-		m_BlockArrows = false;
 	}
-	else if (m_BlockMap.isGameOver()) {
-		m_BlockMap.resetBoard();
-		initBlocks();
+	if (m_Match) {
+		m_Versus.report(std::cout, m_Clock.getElapsedTime() - playStart);
+		m_Match->report(std::cout);
+		std::cout << "waited " << m_VersusWait.asMilliseconds() << " ms for the opponent's inputs\n";
 	}
+	if (m_Royale && !m_Royale->getPlayer(0).isAlive)
+		std::cout << "royale place " << static_cast<unsigned>(m_Royale->getPlayer(0).placement) << " with " << m_Royale->getPlayer(0).knockouts << " knockouts\n";
 }
-void Game::processKeys()
+
+void Game::sampleInput()
 {
-	while (m_Window->pollEvent(this->event)) {
-		if (event.type == sf::Event::Closed)
-			m_Window->close();
-		else if (event.type == sf::Event::KeyPressed) {
-			if (event.key.code == sf::Keyboard::Left && !m_BlockArrows) {
-				m_BlockMap.moveBlockLeft(m_CurrentBlock);
-			}
-			else if (event.key.code == sf::Keyboard::Right && !m_BlockArrows) {
-				m_BlockMap.moveBlockRight(m_CurrentBlock);
-			}
-			else if (event.key.code == sf::Keyboard::Space && !m_BlockArrows && m_SpaceKeyIsReleased)
-			{
-				m_SpaceKeyIsReleased = false;
-				m_BlockMap.rotateBlock(m_CurrentBlock);
-			}
-			else if (event.key.code == sf::Keyboard::Down) {
-				m_BlockArrows = true;
+	int shownFramesPerSecond{ -1 };
+	unsigned shownLevel{ 0 };
+	while (m_Running)
+	{
+		//stamp every event as soon as it is seen, the simulation applies it at the matching tick
+		while (m_Window->pollEvent(this->event)) {
+			if (event.type == sf::Event::Closed)
+				m_Running = false;
+			else if (event.type == sf::Event::KeyPressed || event.type == sf::Event::KeyReleased) {
+				//a lost release would leave a shift or soft drop held, so the sampler waits for the simulation to make room,
+				//the event keeps the time it was seen and the wait counts as its delay
+				const TimedEvent input{ event, m_Clock.getElapsedTime() };
+				if (!m_InputQueue.push(input)) {
+					m_InputQueueFull.add();
+					while (m_Running && !m_InputQueue.push(input))
+						std::this_thread::yield();
+				}
+				m_InputEvents.add();
 			}
 		}
-		else if (event.type == sf::Event::KeyReleased)
-		{
-			if (event.key.code == sf::Keyboard::Space)
-				m_SpaceKeyIsReleased = true;
+		if (shownFramesPerSecond != m_FramesPerSecond || shownLevel != m_Level) {
+			shownFramesPerSecond = m_FramesPerSecond;
+			shownLevel = m_Level;
+			m_Window->setTitle(std::to_string(shownFramesPerSecond) + "  level " + std::to_string(shownLevel));
+		}
+		sf::sleep(sf::microseconds(inputSamplingPeriod));
+	}
+}
+
+void Game::simulationLoop()
+{
+	m_Window->setActive(true);
+	while (m_Running)
+	{
+		onUpdate(m_Clock.getElapsedTime());
+		onRender();
+	}
+	m_Window->setActive(false);
+}
+
+void Game::enableLatencyProbe(const std::string& samplesPath)
+{
+	if (!m_LatencyProbe)
+		m_LatencyProbe.reset(new Instrumentation::LatencyProbe());
+	m_LatencySamplesPath = samplesPath;
+}
+
+bool Game::enableScoreSubmission(const std::string& url)
+{
+	m_SubmitsScores = Network::parseScoreEndpoint(url, m_ScoreEndpoint);
+	return m_SubmitsScores;
+}
+
+void Game::submitGame()
+{
+	const Rules::GameResult& game = m_Simulation.getLastGame();
+	//moves the index entries of every worse game, for a new best at a million games that is the whole 8 MB index in about 0.35 ms,
+	//once a game and at its top out, the os writes the pages back
+	if (m_Leaderboard.isOpen()) {
+		m_LastPlace = m_Leaderboard.add({ game.score, game.lines, static_cast<std::uint16_t>(game.level),
+			static_cast<std::uint32_t>(game.endTick - game.startTick), m_Seed, Storage::noReplay });
+		m_LastScore = game.score;
+		if (m_ShowsHighScores)
+			updateHighScores();
+	}
+	//never blocks, the submitter thread writes the queue and talks to the endpoint
+	if (m_ScoreSubmitter.isOpen())
+		m_ScoreSubmitter.submit({ 0, m_Seed, game.score, game.lines, static_cast<std::uint16_t>(game.level),
+			static_cast<std::uint32_t>(game.endTick - game.startTick), m_ReplayHash });
+	startReplayHash();
+}
+
+void Game::startReplayHash()
+{
+	m_ReplayHash = m_Simulation.getChecksum();
+}
+
+void Game::updateHighScores()
+{
+	std::vector<Storage::LeaderboardEntry> top;
+	m_Leaderboard.getTop(highScoresShown, top);
+	std::ostringstream text;
+	text << "high scores\n";
+	for (size_t i{ 0 }; i < top.size(); ++i)
+		text << std::setw(2) << std::setfill(' ') << i + 1 << "  " << std::setw(10) << std::setfill('0') << top[i].score
+			<< std::setw(6) << std::setfill(' ') << top[i].lines << " lines\n";
+	if (top.empty())
+		text << "no games yet\n";
+	if (m_LastPlace != 0)
+		text << "\nlast game " << m_LastPlace << " of " << m_Leaderboard.getCount() << "\nbetter than "
+			<< std::fixed << std::setprecision(1) << m_Leaderboard.getPercentile(m_LastScore) << "%";
+	m_HighScores.setString(text.str());
+}
+
+bool Game::enableMetrics(unsigned short port)
+{
+	m_Metrics.reset(new Instrumentation::MetricsEndpoint([this](Instrumentation::MetricsWriter& writer) { collectMetrics(writer); }));
+	if (m_Metrics->start(port))
+		return true;
+	m_Metrics.reset();
+	return false;
+}
+
+void Game::collectMetrics(Instrumentation::MetricsWriter& writer)
+{
+	//runs on the endpoint thread, everything it reads is written with plain stores by the thread it belongs to
+	Instrumentation::HistogramCounts frameTimes{}, inputDelays{};
+	m_FrameTimes.addTo(frameTimes);
+	m_InputDelays.addTo(inputDelays);
+	const std::uint64_t ticks = m_TicksPlayed.get(), pieces = m_PiecesLocked.get();
+	const sf::Time now = m_Clock.getElapsedTime();
+	const float seconds = std::max((now - m_LastScrape).asSeconds(), 0.001f);
+	writer.summary("tetris_frame_seconds", "Time from one frame to the next.", frameTimes);
+	writer.counter("tetris_ticks_total", "Game ticks played.", static_cast<double>(ticks));
+	writer.gauge("tetris_tick_rate", "Game ticks per second since the scrape before.", (ticks - m_LastScrapeTicks) / seconds);
+	writer.summary("tetris_input_delay_seconds", "Time from a key being sampled until the game applied it.", inputDelays);
+	writer.counter("tetris_input_events_total", "Key presses and releases sampled.", static_cast<double>(m_InputEvents.get()));
+	writer.counter("tetris_input_queue_full_total", "Key events that waited for room in the input queue.", static_cast<double>(m_InputQueueFull.get()));
+	writer.counter("tetris_games_total", "Games played to a top out.", static_cast<double>(m_GamesPlayed.get()));
+	writer.counter("tetris_pieces_total", "Pieces locked.", static_cast<double>(pieces));
+	writer.gauge("tetris_pieces_per_second", "Pieces locked per second since the scrape before.", (pieces - m_LastScrapePieces) / seconds);
+	writer.gauge("process_resident_memory_bytes", "Bytes of the process in physical memory.", static_cast<double>(Instrumentation::getResidentMemory()));
+	if (m_ScoreSubmitter.isOpen()) {
+		writer.gauge("tetris_scores_pending", "Finished games in the score queue.", static_cast<double>(m_ScoreSubmitter.getPending()));
+		writer.counter("tetris_scores_accepted_total", "Finished games the score endpoint accepted.", static_cast<double>(m_ScoreSubmitter.getAccepted()));
+		writer.counter("tetris_scores_rejected_total", "Finished games the score endpoint refused for good.", static_cast<double>(m_ScoreSubmitter.getRejected()));
+		writer.counter("tetris_scores_dropped_total", "Finished games let go because the score queue was full.", static_cast<double>(m_ScoreSubmitter.getDropped() + m_ScoreSubmitter.getLost()));
+		writer.counter("tetris_score_requests_failed_total", "Score requests that failed and are retried.", static_cast<double>(m_ScoreSubmitter.getFailedRequests()));
+	}
+	m_LastScrape = now;
+	m_LastScrapeTicks = ticks;
+	m_LastScrapePieces = pieces;
+}
+
+void Game::enableInputInjection(unsigned inputCount)
+{
+	if (!m_LatencyProbe)
+		enableLatencyProbe();
+	m_InputInjector.reset(new Instrumentation::InputInjector(inputCount, sf::seconds(injectedInputInterval)));
+}
+
+void Game::setPalette(const Blocks::Palette& palette)
+{
+	m_Palette = palette;
+	m_BlockGenerator.setPalette(palette);
+	m_BlockMap.setPalette(palette);
+	m_OpponentMap.setPalette(palette);
+	m_CurrentBlock.applyPalette(palette);
+	m_NextBlock.applyPalette(palette);
+	m_OpponentBlock.applyPalette(palette);
+}
+
+void Game::setSkin(const std::string& packPath, const std::string& theme)
+{
+	m_SkinPackPath = packPath;
+	m_SkinTheme = theme;
+}
+
+bool Game::applySkin()
+{
+	//the map checks both tile sizes first, so a rejected skin changes nothing
+	if (!m_BlockMap.setTiles(m_Skin.blockTile, m_Skin.wallTile) || !m_BlockGenerator.setTile(m_Skin.blockTile))
+		return false;
+	if (m_Versus.isOpen())
+		m_OpponentMap.setTiles(m_Skin.blockTile, m_Skin.wallTile);
+	if (m_Skin.font.size != 0) {
+		m_Score.setFont(m_SkinFont);
+		m_VersusScore.setFont(m_SkinFont);
+		m_HighScores.setFont(m_SkinFont);
+	}
+	if (m_Skin.palette.size == sizeof(Blocks::Palette)) {
+		Blocks::Palette palette;
+		std::memcpy(palette.data(), m_Skin.palette.bytes, sizeof(palette));
+		setPalette(palette);
+	}
+	return true;
+}
+
+void Game::setSavePath(const std::string& path, bool resume)
+{
+	//a versus match or a royale is never saved
+	m_SavePath = m_Versus.isOpen() || m_IsRoyale ? "" : path;
+	m_ResumeSavedGame = resume;
+}
+
+Storage::Snapshot Game::takeSnapshot() const
+{
+	Storage::Snapshot snapshot{ m_Simulation.takeSnapshot() };
+	snapshot.journalSequence = m_JournalSequence;
+	return snapshot;
+}
+
+bool Game::restoreSnapshot(const Storage::Snapshot& snapshot)
+{
+	if (!m_Simulation.restoreSnapshot(snapshot))
+		return false;
+	m_JournalSequence = snapshot.journalSequence;
+	return true;
+}
+
+void Game::setRewindBudget(size_t bytes)
+{
+	m_RewindBuffer = Storage::RewindBuffer(bytes);
+}
+
+bool Game::enableVersus(unsigned short localPort, const sf::IpAddress& remoteAddress, unsigned short remotePort)
+{
+	if (m_IsRoyale || !m_Versus.open(localPort, remoteAddress, remotePort))
+		return false;
+	//both sides play both games, a piece undone or a game resumed on one side only would split them
+	m_RewindBuffer = Storage::RewindBuffer(0);
+	m_SavePath.clear();
+	widenWindow();
+	return true;
+}
+
+bool Game::enableRoyale()
+{
+	if (m_Versus.isOpen())
+		return false;
+	//the bots do not go back with us
+	m_IsRoyale = true;
+	m_RewindBuffer = Storage::RewindBuffer(0);
+	m_SavePath.clear();
+	widenWindow();
+	return true;
+}
+
+void Game::widenWindow()
+{
+	m_Window->setSize({ versusWindowWidth, videoMode.height });
+	m_Window->setView(sf::View(sf::FloatRect(0.f, 0.f, static_cast<float>(versusWindowWidth), static_cast<float>(videoMode.height))));
+}
+
+void Game::simulateVersusConditions(sf::Time latency, unsigned lossPercent)
+{
+	m_Versus.simulateConditions(latency, lossPercent);
+}
+
+void Game::setStartLevel(unsigned level)
+{
+	m_Simulation.setStartLevel(level);
+}
+
+void Game::setGravityTable(const Rules::GravityTable& gravity)
+{
+	m_Simulation.setGravityTable(gravity);
+}
+
+void Game::autosave()
+{
+	//encoding takes well under a microsecond, the file is written on the writer thread
+	if (!m_SnapshotWriter)
+		return;
+	Storage::SnapshotBuffer buffer;
+	const size_t size = Storage::encodeSnapshot(takeSnapshot(), buffer);
+	m_SnapshotWriter->submit(buffer, size);
+}
+
+void Game::checkpoint()
+{
+	Storage::SnapshotBuffer buffer;
+	const size_t size = Storage::encodeSnapshot(takeSnapshot(), buffer);
+	m_RewindBuffer.push(buffer.data(), size);
+	if (m_SnapshotWriter)
+		m_SnapshotWriter->submit(buffer, size);
+}
+
+bool Game::rewind(size_t pieces)
+{
+	//the newest state is the lock being undone, play continues from the one before it
+	const std::uint8_t* data{ nullptr };
+	size_t size{ 0 };
+	Storage::Snapshot snapshot;
+	if (!m_RewindBuffer.get(pieces, data, size) || !Storage::decodeSnapshot(data, size, snapshot))
+		return false;
+	//time does not go back, the timers keep the ticks they had left, and the journal keeps counting
+	snapshot.tick = m_Simulation.getTick();
+	snapshot.journalSequence = m_JournalSequence;
+	if (!restoreSnapshot(snapshot))
+		return false;
+	m_RewindBuffer.dropNewest(pieces);
+	m_Simulation.releaseInputs();
+	//a replay cannot redo a rewind, recovering continues from this save instead
+	autosave();
+	return true;
+}
+
+void Game::replayJournal()
+{
+	//records before the snapshot are part of it already, a journal starting after it has a gap and is of no use
+	if (m_SavedGame.journalSequence < m_JournalFirstSequence || m_SavedGame.journalSequence - m_JournalFirstSequence > m_JournaledInputs.size())
+		return;
+	for (size_t i = static_cast<size_t>(m_SavedGame.journalSequence - m_JournalFirstSequence); i < m_JournaledInputs.size(); ++i) {
+		const Storage::JournalRecord& record = m_JournaledInputs[i];
+		//the game after a rewind is in the save written right after it, when that did not make it this is as far as it goes
+		if (record.key == sf::Keyboard::BackSpace && record.isPressed)
+			break;
+		//the same timers fire as in the crashed session, then the key lands at the same tick
+		advanceSimulation(record.tick);
+		sf::Event keyEvent;
+		keyEvent.type = record.isPressed ? sf::Event::KeyPressed : sf::Event::KeyReleased;
+		keyEvent.key = { static_cast<sf::Keyboard::Key>(record.key), false, false, false, false };
+		applyInput(keyEvent);
+	}
+}
+
+void Game::startJournal()
+{
+	//the journal only extends a save that is on the disk, otherwise a crash would replay it onto an older one
+	Storage::SnapshotBuffer buffer;
+	const size_t size = Storage::encodeSnapshot(takeSnapshot(), buffer);
+	if (Storage::writeFileAtomically(m_SavePath, buffer.data(), size))
+		m_InputJournal.open(Storage::getJournalPath(m_SavePath), m_JournalSequence);
+}
+
+void Game::processKeys(sf::Time now)
+{
+	TimedEvent input;
+	while (m_InputQueue.pop(input)) {
+		//run every timer that expired before the key was sampled, then apply the key at its own tick
+		advanceSimulation(tickAt(input.time));
+		handleEvent(input.event, input.time, now);
+	}
+	if (m_InputInjector) {
+		while (m_InputInjector->pollEvent(input.event, now, input.time)) {
+			advanceSimulation(tickAt(input.time));
+			handleEvent(input.event, input.time, now);
 		}
+		if (m_InputInjector->isFinished())
+			m_Running = false;
+	}
+}
+
+void Game::handleEvent(const sf::Event& keyEvent, sf::Time arrival, sf::Time now)
+{
+	applyInput(keyEvent);
+	if (now > arrival)
+		m_InputDelays.record(static_cast<std::uint64_t>((now - arrival).asMicroseconds()));
+	if (m_LatencyProbe && keyEvent.type == sf::Event::KeyPressed)
+		m_LatencyProbe->onInputApplied(arrival, now, m_Simulation.getTick());
+}
+
+void Game::applyInput(const sf::Event& keyEvent)
+{
+	Rules::Input input{ Rules::InputCount };
+	switch (keyEvent.key.code)
+	{
+	case sf::Keyboard::Left:
+		input = Rules::MoveLeft;
+		break;
+	case sf::Keyboard::Right:
+		input = Rules::MoveRight;
+		break;
+	case sf::Keyboard::Space:
+		input = Rules::Rotate;
+		break;
+	case sf::Keyboard::Down:
+		input = Rules::SoftDrop;
+		break;
+	case sf::Keyboard::BackSpace:
+		//rewinding belongs to the game, not to the simulation
+		break;
+	case sf::Keyboard::Tab:
+		//the list only changes with a finished game, so it is put together when it is shown and then
+		m_ShowsHighScores = keyEvent.type == sf::Event::KeyPressed && m_Leaderboard.isOpen();
+		if (m_ShowsHighScores)
+			updateHighScores();
+		return;
+	case sf::Keyboard::Num1:
+	case sf::Keyboard::Num2:
+	case sf::Keyboard::Num3:
+	case sf::Keyboard::Num4:
+		//targeting belongs to the royale, a game on its own has nobody to target
+		if (m_Royale && keyEvent.type == sf::Event::KeyPressed)
+			m_Royale->setTargeting(0, static_cast<Rules::Targeting>(keyEvent.key.code - sf::Keyboard::Num1));
+		return;
+	default:
+		return;
+	}
+	//the record goes to the ring only, the journal thread writes it
+	const bool isPressed = keyEvent.type == sf::Event::KeyPressed;
+	m_JournalSequence += 1;
+	m_InputJournal.append({ m_Simulation.getTick(), static_cast<std::uint8_t>(keyEvent.key.code), isPressed });
+	if (input != Rules::InputCount && m_Match)
+		m_Match->applyLocal(input, isPressed);
+	else if (input != Rules::InputCount && m_Royale)
+		m_Royale->apply(0, input, isPressed);
+	else if (input != Rules::InputCount) {
+		m_Simulation.apply(input, isPressed);
+		//fnv-1a of the tick, the input and whether it was pressed, undone inputs stay in
+		const std::uint64_t tick = m_Simulation.getTick();
+		for (size_t i{ 0 }; i < sizeof(tick); ++i)
+			m_ReplayHash = (m_ReplayHash ^ ((tick >> (8 * i)) & 0xff)) * 1099511628211ull;
+		m_ReplayHash = (m_ReplayHash ^ input) * 1099511628211ull;
+		m_ReplayHash = (m_ReplayHash ^ (isPressed ? 1u : 0u)) * 1099511628211ull;
 	}
+	else if (isPressed)
+		rewind(1);
 }
 
 void Game::onRender()
 {
+	if (!m_Loader.isFinished())
+		m_Loader.uploadReady(sf::microseconds(assetUploadBudget));
 	m_Window->clear();
-	m_Window->draw(m_CurrentBlock);
-	m_Window->draw(m_NextBlock);
+	//the board goes first, its grid would otherwise cover the falling block
 	m_Window->draw(m_BlockMap);
+	if (m_Simulation.isPieceActive())
+		m_Window->draw(m_CurrentBlock);
+	m_Window->draw(m_NextBlock);
 	m_Window->draw(m_Score);
+	if (m_Versus.isOpen()) {
+		sf::RenderStates opponentStates;
+		opponentStates.transform.translate(opponentBoardOrigin).scale(0.5f, 0.5f);
+		m_Window->draw(m_OpponentMap, opponentStates);
+		if (m_Match && m_Match->getMatch().getPlayer(Rules::Match::playerCount - 1 - m_Match->getLocalPlayer()).isPieceActive())
+			m_Window->draw(m_OpponentBlock, opponentStates);
+		m_Window->draw(m_VersusScore);
+	}
+	if (m_Royale) {
+		m_Window->draw(m_ThumbnailSprite);
+		if (m_Royale->getPlayer(0).target != 0)
+			m_Window->draw(m_TargetFrame);
+		m_Window->draw(m_VersusScore);
+	}
+	if (m_ShowsHighScores) {
+		m_Window->draw(m_HighScoresBack);
+		m_Window->draw(m_HighScores);
+	}
 	m_Window->display();
+	if (m_LatencyProbe)
+		m_LatencyProbe->onFrameDisplayed(m_Clock.getElapsedTime());
 }
@@ -1,35 +1,217 @@
 #pragma once
 #include <SFML/Graphics.hpp>
+#include <atomic>
 #include <memory>
+#include <string>
+#include <vector>
+#include "AssetLoader.h"
+#include "AssetPack.h"
 #include "Block.h"
+#include "InputJournal.h"
+#include "Leaderboard.h"
+#include "LatencyProbe.h"
+#include "Metrics.h"
+#include "RewindBuffer.h"
+#include "Rollback.h"
+#include "Royale.h"
+#include "ScoreSubmitter.h"
+#include "Scheduler.h"
+#include "Simulation.h"
+#include "Snapshot.h"
+#include "SpscQueue.h"
+#include "VersusLink.h"
 
 class Game
 {
 private:
+	//window event stamped by the input thread when it was sampled
+	struct TimedEvent
+	{
+		sf::Event event;
+		sf::Time time;
+	};
+
 	std::unique_ptr<sf::RenderWindow> m_Window;
+	//only touched by the input thread
 	sf::Event event;
 	sf::VideoMode videoMode;
-	//game  vars
-	bool m_SpaceKeyIsReleased;
-	bool m_BlockArrows;
+	//the opponent plays our game from the same seed in a versus match
+	std::uint32_t m_Seed;
+	//the game itself, everything below only shows it
+	Rules::Simulation m_Simulation;
 	Blocks::Block m_CurrentBlock;
 	Blocks::Block m_NextBlock;
 	Blocks::BlockGenerator m_BlockGenerator;
 	Blocks::BlockMap m_BlockMap;
+	//timing
+	sf::Clock m_Clock;
+	sf::Time m_TickOrigin;
+	sf::Time m_LastFrame;
+	//threads
+	std::atomic<bool> m_Running;
+	std::atomic<int> m_FramesPerSecond;
+	//shown in the title next to the frame rate
+	std::atomic<unsigned> m_Level;
+	Concurrency::SpscQueue<TimedEvent, 256> m_InputQueue;
+	//instrumentation, both stay empty in normal play
+	std::unique_ptr<Instrumentation::LatencyProbe> m_LatencyProbe;
+	std::unique_ptr<Instrumentation::InputInjector> m_InputInjector;
+	std::string m_LatencySamplesPath;
 	//recources
 	sf::Text m_Score;
 	sf::Font m_Font;
+	//a skin font reads from the mapped pack, so the pack has to outlive it
+	Resources::AssetPack m_SkinPack;
+	sf::Font m_SkinFont;
+	Resources::Skin m_Skin;
+	std::string m_SkinPackPath;
+	std::string m_SkinTheme;
+	//saved game, read by a loader worker and written on every lock by the snapshot writer
+	std::string m_SavePath;
+	bool m_ResumeSavedGame;
+	bool m_HasSavedGame;
+	Storage::Snapshot m_SavedGame;
+	std::unique_ptr<Storage::SnapshotWriter> m_SnapshotWriter;
+	//every applied input since the saved game, replayed on top of it after a crash
+	std::uint64_t m_JournalSequence;
+	bool m_HasJournal;
+	std::uint64_t m_JournalFirstSequence;
+	std::vector<Storage::JournalRecord> m_JournaledInputs;
+	Storage::InputJournal m_InputJournal;
+	//the game after each of the last locks, undone one piece per backspace
+	Storage::RewindBuffer m_RewindBuffer;
+	//versus play, both games run here and the opponent's board is drawn at half size right of ours
+	//m_Simulation is a copy of our game in the match then
+	Network::VersusLink m_Versus;
+	std::unique_ptr<Rules::RollbackMatch> m_Match;
+	Blocks::BlockMap m_OpponentMap;
+	Blocks::Block m_OpponentBlock;
+	sf::Text m_VersusScore;
+	//time the match stood still waiting for the opponent's inputs
+	sf::Time m_VersusWait;
+	//royale play, we are player 0 and bots play the others, whose boards are drawn right of ours one pixel per cell
+	//m_Simulation is a copy of our game in the royale then, m_VersusScore shows how the royale goes
+	bool m_IsRoyale;
+	std::unique_ptr<Rules::Royale> m_Royale;
+	Blocks::Palette m_Palette;
+	std::vector<sf::Uint8> m_ThumbnailPixels;
+	sf::Texture m_ThumbnailTexture;
+	sf::Sprite m_ThumbnailSprite;
+	sf::RectangleShape m_TargetFrame;
+	//every finished solo game is kept next to the save, the best of them are shown over the board while tab is held
+	Storage::Leaderboard m_Leaderboard;
+	bool m_ShowsHighScores;
+	//of the last finished game, 0 before there is one
+	std::uint64_t m_LastPlace;
+	std::uint32_t m_LastScore;
+	sf::RectangleShape m_HighScoresBack;
+	sf::Text m_HighScores;
+	//every finished solo game goes to the score endpoint when one is set, queued next to the save
+	bool m_SubmitsScores;
+	Network::ScoreEndpoint m_ScoreEndpoint;
+	Network::ScoreSubmitter m_ScoreSubmitter;
+	//of the game being played, what its submission carries
+	std::uint64_t m_ReplayHash;
+	//counted by the thread each belongs to with plain stores, added up by the metrics endpoint on a scrape
+	Instrumentation::Histogram m_FrameTimes;
+	//from a key being sampled until the game applied it
+	Instrumentation::Histogram m_InputDelays;
+	Instrumentation::Counter m_TicksPlayed;
+	Instrumentation::Counter m_PiecesLocked;
+	Instrumentation::Counter m_GamesPlayed;
+	Instrumentation::Counter m_InputEvents;
+	//events the sampler held until the simulation made room in the input queue
+	Instrumentation::Counter m_InputQueueFull;
+	unsigned m_SeenTopOuts;
+	//only touched on the endpoint thread, rates are over the time since the scrape before
+	sf::Time m_LastScrape;
+	std::uint64_t m_LastScrapeTicks;
+	std::uint64_t m_LastScrapePieces;
+	//declared after what it reads so it stops first
+	std::unique_ptr<Instrumentation::MetricsEndpoint> m_Metrics;
+	//decoded by the loader workers, uploaded once play can start
+	sf::Image m_BlockTile;
+	sf::Image m_WallTile;
+	//declared last so its workers are joined before the assets they write to go away
+	Resources::AssetLoader m_Loader;
 
-	//game logic
-	void handleBlockMovement();
-	void initBlocks();
 	void initWindow();
 	void initText();
-	void processKeys();
-	void onUpdate(float dlt);
+	void loadAssets();
+	//returns false when the window was closed while loading
+	bool showLoadingScreen();
+	bool applySkin();
+	Storage::Snapshot takeSnapshot()const;
+	//rejects snapshots that do not fit this board or timer set and leaves the game untouched then
+	bool restoreSnapshot(const Storage::Snapshot& snapshot);
+	void autosave();
+	//keeps the game for rewinding and saves it, both from one encoding, there is no saving yet while a journal is replayed
+	void checkpoint();
+	//continues from before the last pieces locked, false when the buffer does not reach back that far
+	bool rewind(size_t pieces);
+	//applies the journaled inputs that came after the restored snapshot
+	void replayJournal();
+	//writes the current game as the save, then starts an empty journal on top of it
+	void startJournal();
+	void sampleInput();
+	void simulationLoop();
+	void processKeys(sf::Time now);
+	void handleEvent(const sf::Event& keyEvent, sf::Time arrival, sf::Time now);
+	//journals and applies a key at the current tick
+	void applyInput(const sf::Event& keyEvent);
+	void onUpdate(sf::Time now);
+	//every lock on the way is checkpointed
+	void advanceSimulation(Timing::Tick lastTick);
+	Timing::Tick tickAt(sf::Time time)const;
+	//moves board and blocks to where the simulation has them
+	void updateScene();
+	//exchanges inputs with the opponent and runs the match, holding time back when it is ahead
+	void updateVersus(sf::Time now);
+	//greets the opponent until it answers, false when the window was closed or the match cannot be set up
+	bool waitForOpponent();
+	bool startMatch();
+	//room right of the board for the opponent or the thumbnails
+	void widenWindow();
+	void startRoyale();
+	//the boards of the other players into the thumbnail texture, and the royale status
+	void updateRoyale();
 	void onRender();
+	//hands the game that just topped out to the submitter and starts the hash of the next one
+	void submitGame();
+	void startReplayHash();
+	void updateHighScores();
+	void collectMetrics(Instrumentation::MetricsWriter& writer);
 public:
 	Game();
 	void run();
+	//report input-to-display latency when the window closes, optionally with every sample as csv
+	void enableLatencyProbe(const std::string& samplesPath = "");
+	//serves frame times, tick rate, input delay, games, pieces and memory over http at /metrics on port of localhost, call before run
+	bool enableMetrics(unsigned short port);
+	//posts every finished solo game to an http endpoint in the background, call before run
+	//false when url is not http://host[:port][/path]
+	bool enableScoreSubmission(const std::string& url);
+	//play inputCount synthetic key presses, then close the window
+	void enableInputInjection(unsigned inputCount);
+	//colours of the board and of the blocks, call before run
+	void setPalette(const Blocks::Palette& palette);
+	//replace tiles, font and palette with a theme of an asset pack, call before run
+	//the theme is loaded with the other assets, when it cannot be used the built-in look stays
+	void setSkin(const std::string& packPath, const std::string& theme);
+	//where the game is saved on every lock and on exit, an empty path disables saving
+	//resume continues the game found there, call before run
+	void setSavePath(const std::string& path, bool resume);
+	//memory for undoing locked pieces, 0 disables undo, call before run
+	void setRewindBudget(size_t bytes);
+	//level of every new game, a resumed game keeps its own, call before run
+	void setStartLevel(unsigned level);
+	void setGravityTable(const Rules::GravityTable& gravity);
+	//plays against another instance over udp, the game is neither saved nor undone then, call before run
+	//false when the port cannot be opened or a royale is set up already
+	bool enableVersus(unsigned short localPort, const sf::IpAddress& remoteAddress, unsigned short remotePort);
+	//holds back and drops packets to the opponent, to try the match under bad conditions over localhost
+	void simulateVersusConditions(sf::Time latency, unsigned lossPercent);
+	//plays a royale of 99 against 98 bots, the game is neither saved nor undone then, call before run
+	//false when a versus match is set up already
+	bool enableRoyale();
 };
-
@@ -0,0 +1,89 @@
+#include "Histogram.h"
+
+namespace Instrumentation {
+	static constexpr unsigned subBucketBits = 3;
+	static constexpr std::uint64_t linearLimit = 16;
+
+	static size_t getBucket(std::uint64_t microseconds)
+	{
+		if (microseconds < linearLimit)
+			return static_cast<size_t>(microseconds);
+		unsigned exponent{ 0 };
+		for (std::uint64_t rest{ microseconds }; rest > 1; rest >>= 1)
+			exponent += 1;
+		const size_t bucket = linearLimit + (exponent - 4) * 8 + ((microseconds >> (exponent - subBucketBits)) & 7);
+		return bucket < histogramBucketCount ? bucket : histogramBucketCount - 1;
+	}
+
+	//the middle of the values that land in a bucket
+	static std::uint64_t getBucketValue(size_t bucket)
+	{
+		if (bucket < linearLimit)
+			return bucket;
+		const unsigned exponent = static_cast<unsigned>((bucket - linearLimit) / 8 + 4);
+		const std::uint64_t width = 1ull << (exponent - subBucketBits);
+		return (1ull << exponent) + (bucket - linearLimit) % 8 * width + width / 2;
+	}
+
+	std::uint64_t HistogramCounts::getTotal() const
+	{
+		std::uint64_t total{ 0 };
+		for (std::uint64_t count : buckets)
+			total += count;
+		return total;
+	}
+
+	std::uint64_t HistogramCounts::getPercentile(unsigned percent) const
+	{
+		const std::uint64_t total = getTotal();
+		if (total == 0)
+			return 0;
+		const std::uint64_t rank = (total * percent + 99) / 100;
+		std::uint64_t seen{ 0 };
+		for (size_t bucket{ 0 }; bucket < histogramBucketCount; ++bucket) {
+			seen += buckets[bucket];
+			if (seen >= rank && seen != 0)
+				return getBucketValue(bucket);
+		}
+		return getBucketValue(histogramBucketCount - 1);
+	}
+
+	std::uint64_t HistogramCounts::getSum() const
+	{
+		std::uint64_t sum{ 0 };
+		for (size_t bucket{ 0 }; bucket < histogramBucketCount; ++bucket)
+			sum += buckets[bucket] * getBucketValue(bucket);
+		return sum;
+	}
+
+	void HistogramCounts::add(const HistogramCounts& other)
+	{
+		for (size_t bucket{ 0 }; bucket < histogramBucketCount; ++bucket)
+			buckets[bucket] += other.buckets[bucket];
+	}
+
+	void HistogramCounts::subtract(const HistogramCounts& earlier)
+	{
+		for (size_t bucket{ 0 }; bucket < histogramBucketCount; ++bucket)
+			buckets[bucket] -= earlier.buckets[bucket];
+	}
+
+	Histogram::Histogram()
+	{
+		for (auto& bucket : m_Buckets)
+			bucket.store(0, std::memory_order_relaxed);
+	}
+
+	void Histogram::record(std::uint64_t microseconds)
+	{
+		//the only writer, so load and store cannot lose an increment
+		std::atomic<std::uint64_t>& bucket = m_Buckets[getBucket(microseconds)];
+		bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	void Histogram::addTo(HistogramCounts& counts) const
+	{
+		for (size_t bucket{ 0 }; bucket < histogramBucketCount; ++bucket)
+			counts.buckets[bucket] += m_Buckets[bucket].load(std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Instrumentation {
+	//microseconds below 16 get a bucket each, above that every power of two is split into eight buckets, up to over an hour
+	static constexpr size_t histogramBucketCount = 16 + 28 * 8;
+
+	//samples counted per bucket, a percentile read from it is off by less than an eighth
+	struct HistogramCounts
+	{
+		std::array<std::uint64_t, histogramBucketCount> buckets;
+
+		std::uint64_t getTotal()const;
+		//nearest rank, the middle of the bucket the sample falls in, 0 without samples
+		std::uint64_t getPercentile(unsigned percent)const;
+		//every sample taken as the middle of its bucket, off by as little as the percentiles
+		std::uint64_t getSum()const;
+		void add(const HistogramCounts& other);
+		//what was recorded since earlier, both taken from the same histograms
+		void subtract(const HistogramCounts& earlier);
+	};
+
+	//written by one thread and read by any other at any time
+	//a sample costs the writer a bucket lookup and a plain store, no lock and no atomic read-modify-write
+	class Histogram
+	{
+	public:
+		Histogram();
+
+		//only ever from the owning thread
+		void record(std::uint64_t microseconds);
+		void addTo(HistogramCounts& counts)const;
+	private:
+		std::array<std::atomic<std::uint64_t>, histogramBucketCount> m_Buckets;
+	};
+}
@@ -0,0 +1,180 @@
+#include "InputJournal.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include "ByteOrder.h"
+#include "Snapshot.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Storage {
+	static constexpr char journalMagic[4] = { 'T', 'J', 'R', 'N' };
+	static constexpr std::uint16_t journalVersion = 1;
+	//magic, version, reserved and the sequence of the first record
+	static constexpr size_t journalHeaderSize = 16;
+	//tick, key, pressed and a 16 bit checksum
+	static constexpr size_t journalRecordSize = 12;
+	//longest time an applied input waits for its flush, and the most a crash can lose
+	static constexpr std::chrono::milliseconds journalFlushPeriod{ 50 };
+
+	static void encodeRecord(const JournalRecord& record, std::uint8_t* data)
+	{
+		size_t offset{ 0 };
+		putLittleEndian(data, offset, record.tick);
+		putLittleEndian(data, offset, record.key);
+		putLittleEndian(data, offset, static_cast<std::uint8_t>(record.isPressed ? 1 : 0));
+		putLittleEndian(data, offset, foldedFnv1a(data, offset));
+	}
+
+	std::string getJournalPath(const std::string& savePath)
+	{
+		return savePath + ".journal";
+	}
+
+	bool readJournal(const std::string& path, std::uint64_t& firstSequence, std::vector<JournalRecord>& records)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		std::vector<std::uint8_t> bytes;
+		bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		size_t offset{ sizeof(journalMagic) };
+		if (bytes.size() < journalHeaderSize || std::memcmp(bytes.data(), journalMagic, sizeof(journalMagic)) != 0
+			|| getLittleEndian<std::uint16_t>(bytes.data(), offset) != journalVersion)
+			return false;
+		offset += sizeof(std::uint16_t);
+		firstSequence = getLittleEndian<std::uint64_t>(bytes.data(), offset);
+
+		records.clear();
+		for (; bytes.size() - offset >= journalRecordSize; offset += journalRecordSize) {
+			const std::uint8_t* data = bytes.data() + offset;
+			size_t field{ 0 };
+			JournalRecord record;
+			record.tick = getLittleEndian<Timing::Tick>(data, field);
+			record.key = getLittleEndian<std::uint8_t>(data, field);
+			const std::uint8_t isPressed = getLittleEndian<std::uint8_t>(data, field);
+			if (isPressed > 1 || getLittleEndian<std::uint16_t>(data, field) != foldedFnv1a(data, journalRecordSize - sizeof(std::uint16_t)))
+				break;
+			record.isPressed = isPressed == 1;
+			records.push_back(record);
+		}
+		return true;
+	}
+
+#ifdef _WIN32
+	InputJournal::InputJournal()
+		:m_IsOverflowed(false), m_File(INVALID_HANDLE_VALUE), m_Running(true)
+	{
+	}
+#else
+	InputJournal::InputJournal()
+		:m_IsOverflowed(false), m_File(-1), m_Running(true)
+	{
+	}
+#endif
+
+	bool InputJournal::open(const std::string& path, std::uint64_t firstSequence)
+	{
+		//the empty journal replaces the old one atomically, a crash right here leaves one of both
+		std::uint8_t header[journalHeaderSize]{};
+		size_t offset{ 0 };
+		for (char c : journalMagic)
+			putLittleEndian(header, offset, static_cast<std::uint8_t>(c));
+		putLittleEndian(header, offset, journalVersion);
+		putLittleEndian(header, offset, std::uint16_t{ 0 });
+		putLittleEndian(header, offset, firstSequence);
+		if (isOpen() || !writeFileAtomically(path, header, sizeof(header)))
+			return false;
+#ifdef _WIN32
+		m_File = CreateFileA(path.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+#else
+		m_File = ::open(path.c_str(), O_WRONLY | O_APPEND);
+#endif
+		if (!isOpen())
+			return false;
+		m_Batch.reserve(m_Queue.capacity() * journalRecordSize);
+		m_Thread = std::thread(&InputJournal::writeLoop, this);
+		return true;
+	}
+
+	InputJournal::~InputJournal()
+	{
+		m_Running = false;
+		m_Wake.notify_one();
+		if (m_Thread.joinable())
+			m_Thread.join();
+		if (!isOpen())
+			return;
+#ifdef _WIN32
+		CloseHandle(m_File);
+#else
+		::close(m_File);
+#endif
+	}
+
+	bool InputJournal::isOpen() const
+	{
+#ifdef _WIN32
+		return m_File != INVALID_HANDLE_VALUE;
+#else
+		return m_File >= 0;
+#endif
+	}
+
+	void InputJournal::append(const JournalRecord& record)
+	{
+		//records after a lost one would be replayed onto the wrong state, so the journal just ends
+		if (m_IsOverflowed || !isOpen())
+			return;
+		if (!m_Queue.push(record))
+			m_IsOverflowed = true;
+	}
+
+	void InputJournal::writeLoop()
+	{
+		bool isWritable{ true };
+		for (;;) {
+			//read before draining, so records pushed right before shutdown are still written
+			const bool isRunning = m_Running;
+			if (isWritable)
+				isWritable = writeQueued();
+			else {
+				//after a failed write the tail is torn, later records could not be read anyway
+				JournalRecord record;
+				while (m_Queue.pop(record)) {}
+			}
+			if (!isRunning)
+				return;
+			//the game never wakes the writer, everything applied within one period shares a flush
+			std::unique_lock<std::mutex> lock(m_WakeMutex);
+			m_Wake.wait_for(lock, journalFlushPeriod);
+		}
+	}
+
+	bool InputJournal::writeQueued()
+	{
+		m_Batch.clear();
+		JournalRecord record;
+		while (m_Queue.pop(record)) {
+			m_Batch.resize(m_Batch.size() + journalRecordSize);
+			encodeRecord(record, m_Batch.data() + m_Batch.size() - journalRecordSize);
+		}
+		if (m_Batch.empty())
+			return true;
+#ifdef _WIN32
+		DWORD written{ 0 };
+		return WriteFile(m_File, m_Batch.data(), static_cast<DWORD>(m_Batch.size()), &written, nullptr)
+			&& written == m_Batch.size() && FlushFileBuffers(m_File);
+#else
+		return ::write(m_File, m_Batch.data(), m_Batch.size()) == static_cast<ssize_t>(m_Batch.size()) && ::fsync(m_File) == 0;
+#endif
+	}
+}
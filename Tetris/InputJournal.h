@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Scheduler.h"
+#include "SpscQueue.h"
+
+namespace Storage {
+	//one key the game applied, at the tick it was applied
+	struct JournalRecord
+	{
+		Timing::Tick tick;
+		std::uint8_t key;
+		bool isPressed;
+	};
+
+	//the journal kept next to a save, path.journal
+	std::string getJournalPath(const std::string& savePath);
+	//reads the records up to the first torn or corrupt one, a crash in the middle of a write only loses that record
+	//firstSequence is the number of inputs the game had applied before the first record
+	bool readJournal(const std::string& path, std::uint64_t& firstSequence, std::vector<JournalRecord>& records);
+
+	//write-ahead log of every input since the snapshot the session started from
+	//the game thread only pushes into a ring, a writer thread appends the records and flushes them to the disk
+	//in batches, so a crash loses at most the inputs of the last flush period
+	class InputJournal
+	{
+	public:
+		InputJournal();
+		//appends and flushes what is still queued before returning
+		~InputJournal();
+		InputJournal(const InputJournal&) = delete;
+		InputJournal& operator=(const InputJournal&) = delete;
+
+		//replaces the journal at path with an empty one, call once before the first append
+		bool open(const std::string& path, std::uint64_t firstSequence);
+		bool isOpen()const;
+		//single producer, never blocks
+		//when the ring is full the journal ends there, a recovery then stops at the last record before the gap
+		void append(const JournalRecord& record);
+	private:
+		void writeLoop();
+		bool writeQueued();
+
+		Concurrency::SpscQueue<JournalRecord, 1024> m_Queue;
+		//only touched by the producer
+		bool m_IsOverflowed;
+#ifdef _WIN32
+		void* m_File;
+#else
+		int m_File;
+#endif
+		std::vector<std::uint8_t> m_Batch;
+		std::atomic<bool> m_Running;
+		std::mutex m_WakeMutex;
+		std::condition_variable m_Wake;
+		std::thread m_Thread;
+	};
+}
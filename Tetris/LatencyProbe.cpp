@@ -0,0 +1,107 @@
+#include "LatencyProbe.h"
+#include <algorithm>
+#include <array>
+#include <iomanip>
+#include <string>
+
+namespace Instrumentation {
+	static constexpr size_t histogramBuckets = 12;
+	static constexpr sf::Int64 histogramBucketSize = 4000;//4ms
+
+	LatencyProbe::LatencyProbe()
+		:m_FirstPending(0)
+	{
+		m_Samples.reserve(1024);
+	}
+
+	void LatencyProbe::onInputApplied(sf::Time arrival, sf::Time dequeued, Timing::Tick tick)
+	{
+		m_Samples.push_back({ arrival, dequeued, sf::Time::Zero, tick });
+	}
+
+	void LatencyProbe::onFrameDisplayed(sf::Time displayed)
+	{
+		for (; m_FirstPending < m_Samples.size(); ++m_FirstPending) {
+			Sample& sample = m_Samples[m_FirstPending];
+			sample.displayed = displayed;
+			m_Queued.record(static_cast<std::uint64_t>((sample.dequeued - sample.arrival).asMicroseconds()));
+			m_Applied.record(static_cast<std::uint64_t>((sample.displayed - sample.dequeued).asMicroseconds()));
+			m_Total.record(static_cast<std::uint64_t>((sample.displayed - sample.arrival).asMicroseconds()));
+		}
+	}
+
+	void LatencyProbe::reportDistribution(std::ostream& out, const char* name, const Histogram& histogram)
+	{
+		HistogramCounts counts{};
+		histogram.addTo(counts);
+		const auto milliseconds = [&counts](unsigned percent) { return counts.getPercentile(percent) / 1000.f; };
+		out << std::setw(16) << std::left << name << std::right << std::fixed << std::setprecision(2)
+			<< " min " << std::setw(7) << milliseconds(0)
+			<< " p50 " << std::setw(7) << milliseconds(50)
+			<< " p90 " << std::setw(7) << milliseconds(90)
+			<< " p99 " << std::setw(7) << milliseconds(99)
+			<< " max " << std::setw(7) << milliseconds(100)
+			<< " mean " << std::setw(7) << counts.getSum() / 1000.f / counts.getTotal() << " ms\n";
+	}
+
+	void LatencyProbe::report(std::ostream& out) const
+	{
+		out << "input-to-display latency over " << m_FirstPending << " inputs\n";
+		if (m_FirstPending == 0)
+			return;
+		reportDistribution(out, "arrival->dequeue", m_Queued);
+		reportDistribution(out, "dequeue->display", m_Applied);
+		reportDistribution(out, "arrival->display", m_Total);
+
+		std::array<size_t, histogramBuckets> histogram{};
+		for (size_t i{ 0 }; i < m_FirstPending; ++i) {
+			const sf::Int64 value = (m_Samples[i].displayed - m_Samples[i].arrival).asMicroseconds();
+			histogram[std::min<size_t>(static_cast<size_t>(value / histogramBucketSize), histogramBuckets - 1)] += 1;
+		}
+		for (size_t i{ 0 }; i < histogramBuckets; ++i) {
+			out << std::setw(3) << i * histogramBucketSize / 1000 << (i + 1 == histogramBuckets ? "+ ms" : "  ms")
+				<< std::setw(6) << histogram[i] << ' ' << std::string(histogram[i] * 60 / m_FirstPending, '#') << '\n';
+		}
+	}
+
+	void LatencyProbe::writeSamples(std::ostream& out) const
+	{
+		out << "arrival_us,dequeued_us,displayed_us,tick\n";
+		for (size_t i{ 0 }; i < m_FirstPending; ++i) {
+			const auto& sample = m_Samples[i];
+			out << sample.arrival.asMicroseconds() << ',' << sample.dequeued.asMicroseconds() << ','
+				<< sample.displayed.asMicroseconds() << ',' << sample.tick << '\n';
+		}
+	}
+
+	InputInjector::InputInjector(unsigned inputCount, sf::Time interval)
+		:m_InputCount(inputCount), m_Step(0), m_Interval(interval), m_NextArrival(sf::Time::Zero), m_IsStarted(false)
+	{
+	}
+
+	void InputInjector::start(sf::Time origin)
+	{
+		m_NextArrival = origin + m_Interval;
+		m_IsStarted = true;
+	}
+
+	bool InputInjector::pollEvent(sf::Event& event, sf::Time now, sf::Time& arrival)
+	{
+		static constexpr std::array<sf::Keyboard::Key, 3> pattern{ sf::Keyboard::Left, sf::Keyboard::Right, sf::Keyboard::Space };
+		if (!m_IsStarted || isFinished() || now < m_NextArrival)
+			return false;
+		//even steps press a key, odd steps release it half an interval later
+		event.type = m_Step % 2 == 0 ? sf::Event::KeyPressed : sf::Event::KeyReleased;
+		event.key = sf::Event::KeyEvent{};
+		event.key.code = pattern[(m_Step / 2) % pattern.size()];
+		arrival = m_NextArrival;
+		m_NextArrival += m_Interval / 2.f;
+		m_Step += 1;
+		return true;
+	}
+
+	bool InputInjector::isFinished() const
+	{
+		return m_Step >= m_InputCount * 2;
+	}
+}
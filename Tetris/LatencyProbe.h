@@ -0,0 +1,62 @@
+#pragma once
+
+#include <SFML/System.hpp>
+#include <SFML/Window/Event.hpp>
+#include <ostream>
+#include <vector>
+#include "Histogram.h"
+#include "Scheduler.h"
+
+namespace Instrumentation {
+
+	//measures the time from a key press until display() returned for the frame showing its result, so the swap and any vsync wait count
+	class LatencyProbe
+	{
+	public:
+		LatencyProbe();
+
+		//arrival is the moment the input was sampled, dequeued the moment the simulation took it
+		void onInputApplied(sf::Time arrival, sf::Time dequeued, Timing::Tick tick);
+		//called right after display() returned, completes every input applied before the frame was drawn
+		void onFrameDisplayed(sf::Time displayed);
+
+		void report(std::ostream& out)const;
+		//one csv line per input: arrival, dequeue, display (microseconds) and tick
+		void writeSamples(std::ostream& out)const;
+	private:
+		struct Sample
+		{
+			sf::Time arrival;
+			sf::Time dequeued;
+			sf::Time displayed;
+			Timing::Tick tick;
+		};
+		static void reportDistribution(std::ostream& out, const char* name, const Histogram& histogram);
+
+		std::vector<Sample> m_Samples;
+		size_t m_FirstPending;
+		//the histogram the metrics endpoint summarizes input delay with, so both compute percentiles the same way
+		Histogram m_Queued;
+		Histogram m_Applied;
+		Histogram m_Total;
+	};
+
+	//feeds a fixed pattern of key presses into the game so latency can be measured without a keyboard
+	class InputInjector
+	{
+	public:
+		InputInjector(unsigned inputCount, sf::Time interval);
+
+		//the first event is due an interval after origin, nothing is due before this is called
+		void start(sf::Time origin);
+		//returns the next synthetic event due at now, arrival is the time it was meant to happen
+		bool pollEvent(sf::Event& event, sf::Time now, sf::Time& arrival);
+		bool isFinished()const;
+	private:
+		unsigned m_InputCount;
+		unsigned m_Step;
+		sf::Time m_Interval;
+		sf::Time m_NextArrival;
+		bool m_IsStarted;
+	};
+}
@@ -0,0 +1,219 @@
+#include "Leaderboard.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include "ByteOrder.h"
+
+namespace Storage {
+	static constexpr char recordsMagic[4] = { 'T', 'L', 'B', 'R' };
+	static constexpr char indexMagic[4] = { 'T', 'L', 'B', 'I' };
+	static constexpr std::uint16_t leaderboardVersion = 1;
+	//magic, version, a flag or the record size, and the count
+	static constexpr size_t headerSize = 16;
+	static constexpr size_t countOffset = 8;
+	static constexpr size_t isCleanOffset = 6;
+	//score, lines, ticks, seed, replay offset, level, reserved and a checksum
+	static constexpr size_t recordSize = 32;
+	//score and game, best first
+	static constexpr size_t indexEntrySize = 8;
+	//files grow by doubling from here, a year of games at a busy cabinet fits in the first few steps
+	static constexpr size_t initialFileSize = 64 * 1024;
+
+	static void encodeRecord(const LeaderboardEntry& entry, std::uint8_t* data)
+	{
+		storeLittleEndian(data, 0, entry.score);
+		storeLittleEndian(data, 4, entry.lines);
+		storeLittleEndian(data, 8, entry.ticks);
+		storeLittleEndian(data, 12, entry.seed);
+		storeLittleEndian(data, 16, entry.replayOffset);
+		storeLittleEndian(data, 24, entry.level);
+		storeLittleEndian(data, 26, std::uint16_t{ 0 });
+		storeLittleEndian(data, 28, fnv1a(data, 28));
+	}
+
+	static bool isRecordValid(const std::uint8_t* data)
+	{
+		return loadLittleEndian<std::uint32_t>(data, 28) == fnv1a(data, 28);
+	}
+
+	static bool hasHeader(const WritableMappedFile& file, const char (&magic)[4])
+	{
+		return file.getSize() >= headerSize && std::memcmp(file.getData(), magic, sizeof(magic)) == 0
+			&& loadLittleEndian<std::uint16_t>(file.getData(), sizeof(magic)) == leaderboardVersion;
+	}
+
+	static bool isEmpty(const WritableMappedFile& file)
+	{
+		return std::all_of(file.getData(), file.getData() + headerSize, [](std::uint8_t byte) { return byte == 0; });
+	}
+
+	static void writeHeader(WritableMappedFile& file, const char (&magic)[4], std::uint16_t field)
+	{
+		std::memcpy(file.getData(), magic, sizeof(magic));
+		storeLittleEndian(file.getData(), sizeof(magic), leaderboardVersion);
+		storeLittleEndian(file.getData(), isCleanOffset, field);
+		storeLittleEndian(file.getData(), countOffset, std::uint64_t{ 0 });
+	}
+
+	std::string getLeaderboardPath(const std::string& savePath)
+	{
+		return savePath + ".leaderboard";
+	}
+
+	Leaderboard::Leaderboard()
+		:m_Count(0)
+	{
+	}
+
+	Leaderboard::~Leaderboard()
+	{
+		close();
+	}
+
+	bool Leaderboard::open(const std::string& path)
+	{
+		close();
+		if (!m_Records.open(path, initialFileSize) || !m_Index.open(path + ".index", initialFileSize)) {
+			close();
+			return false;
+		}
+		//a new file is all zeros, anything else that is not ours is left as it is
+		if (isEmpty(m_Records))
+			writeHeader(m_Records, recordsMagic, recordSize);
+		if (isEmpty(m_Index))
+			writeHeader(m_Index, indexMagic, 1);
+		if (!hasHeader(m_Records, recordsMagic) || loadLittleEndian<std::uint16_t>(m_Records.getData(), isCleanOffset) != recordSize
+			|| !hasHeader(m_Index, indexMagic)) {
+			m_Records.close();
+			m_Index.close();
+			return false;
+		}
+		m_Count = std::min<std::uint64_t>(loadLittleEndian<std::uint64_t>(m_Records.getData(), countOffset), (m_Records.getSize() - headerSize) / recordSize);
+		const bool isClean = m_Index.getData()[isCleanOffset] == 1 && loadLittleEndian<std::uint64_t>(m_Index.getData(), countOffset) == m_Count
+			&& m_Index.getSize() >= headerSize + m_Count * indexEntrySize;
+		//stays marked while open, whatever happens to the process the next open finds out
+		m_Index.getData()[isCleanOffset] = 0;
+		m_Index.flush(0, headerSize);
+		if (!isClean)
+			rebuild();
+		return true;
+	}
+
+	void Leaderboard::close()
+	{
+		if (m_Index.isOpen() && m_Records.isOpen()) {
+			m_Records.flush(0, m_Records.getSize());
+			m_Index.flush(0, m_Index.getSize());
+			//only once everything else is on the disk
+			m_Index.getData()[isCleanOffset] = 1;
+		}
+		m_Records.close();
+		m_Index.close();
+		m_Count = 0;
+	}
+
+	bool Leaderboard::isOpen() const
+	{
+		return m_Records.isOpen() && m_Index.isOpen();
+	}
+
+	std::uint64_t Leaderboard::add(const LeaderboardEntry& entry)
+	{
+		if (!isOpen() || m_Count >= 0xffffffffu || !reserve(m_Records, headerSize + (m_Count + 1) * recordSize)
+			|| !reserve(m_Index, headerSize + (m_Count + 1) * indexEntrySize))
+			return 0;
+		encodeRecord(entry, m_Records.getData() + headerSize + m_Count * recordSize);
+		//behind every game that scored as much, the entries after it move up by one
+		const std::uint64_t position = countAtLeast(entry.score);
+		std::uint8_t* at = m_Index.getData() + headerSize + position * indexEntrySize;
+		std::memmove(at + indexEntrySize, at, static_cast<size_t>(m_Count - position) * indexEntrySize);
+		storeLittleEndian(at, 0, entry.score);
+		storeLittleEndian(at, 4, static_cast<std::uint32_t>(m_Count));
+		setCounts(m_Count + 1);
+		return position + 1;
+	}
+
+	std::uint64_t Leaderboard::getCount() const
+	{
+		return m_Count;
+	}
+
+	void Leaderboard::getTop(size_t count, std::vector<LeaderboardEntry>& entries) const
+	{
+		entries.clear();
+		for (std::uint64_t i{ 0 }; i < std::min<std::uint64_t>(count, m_Count); ++i)
+			entries.push_back(getEntry(loadLittleEndian<std::uint32_t>(m_Index.getData(), headerSize + i * indexEntrySize + 4)));
+	}
+
+	std::uint64_t Leaderboard::getPlace(std::uint32_t score) const
+	{
+		return score == 0xffffffffu ? 1 : countAtLeast(score + 1) + 1;
+	}
+
+	float Leaderboard::getPercentile(std::uint32_t score) const
+	{
+		if (m_Count == 0)
+			return 0.f;
+		return 100.f * static_cast<float>(m_Count - countAtLeast(score)) / static_cast<float>(m_Count);
+	}
+
+	LeaderboardEntry Leaderboard::getEntry(std::uint64_t game) const
+	{
+		const std::uint8_t* data = m_Records.getData() + headerSize + game * recordSize;
+		return { loadLittleEndian<std::uint32_t>(data, 0), loadLittleEndian<std::uint32_t>(data, 4), loadLittleEndian<std::uint16_t>(data, 24),
+			loadLittleEndian<std::uint32_t>(data, 8), loadLittleEndian<std::uint32_t>(data, 12), loadLittleEndian<std::uint64_t>(data, 16) };
+	}
+
+	std::uint64_t Leaderboard::countAtLeast(std::uint32_t score) const
+	{
+		//the entries are sorted best first, so this is the first one below score
+		std::uint64_t first{ 0 }, last{ m_Count };
+		while (first < last) {
+			const std::uint64_t middle = first + (last - first) / 2;
+			if (loadLittleEndian<std::uint32_t>(m_Index.getData(), headerSize + middle * indexEntrySize) >= score)
+				first = middle + 1;
+			else
+				last = middle;
+		}
+		return first;
+	}
+
+	bool Leaderboard::reserve(WritableMappedFile& file, size_t size)
+	{
+		if (size <= file.getSize())
+			return true;
+		size_t newSize{ file.getSize() };
+		while (newSize < size)
+			newSize *= 2;
+		return file.resize(newSize);
+	}
+
+	void Leaderboard::rebuild()
+	{
+		//records after one that does not check out are dropped, the os wrote them back out of order before a power cut
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> entries;
+		for (std::uint64_t game{ 0 }; game < m_Count; ++game) {
+			const std::uint8_t* data = m_Records.getData() + headerSize + game * recordSize;
+			if (!isRecordValid(data))
+				break;
+			entries.emplace_back(loadLittleEndian<std::uint32_t>(data, 0), static_cast<std::uint32_t>(game));
+		}
+		std::sort(entries.begin(), entries.end(), [](const std::pair<std::uint32_t, std::uint32_t>& entry, const std::pair<std::uint32_t, std::uint32_t>& other) {
+			return entry.first != other.first ? entry.first > other.first : entry.second < other.second;
+		});
+		if (!reserve(m_Index, headerSize + entries.size() * indexEntrySize))
+			entries.clear();
+		for (size_t i{ 0 }; i < entries.size(); ++i) {
+			storeLittleEndian(m_Index.getData(), headerSize + i * indexEntrySize, entries[i].first);
+			storeLittleEndian(m_Index.getData(), headerSize + i * indexEntrySize + 4, entries[i].second);
+		}
+		setCounts(entries.size());
+	}
+
+	void Leaderboard::setCounts(std::uint64_t count)
+	{
+		m_Count = count;
+		storeLittleEndian(m_Records.getData(), countOffset, count);
+		storeLittleEndian(m_Index.getData(), countOffset, count);
+	}
+}
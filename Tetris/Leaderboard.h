@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+namespace Storage {
+	//replayOffset of a game whose replay was not kept
+	static constexpr std::uint64_t noReplay = ~std::uint64_t{ 0 };
+
+	//one finished game as the leaderboard keeps it
+	struct LeaderboardEntry
+	{
+		std::uint32_t score;
+		std::uint32_t lines;
+		std::uint16_t level;
+		//how long the game took
+		std::uint32_t ticks;
+		std::uint32_t seed;
+		//where its replay starts in the replay archive
+		std::uint64_t replayOffset;
+	};
+
+	//the leaderboard kept next to a save, path.leaderboard and path.leaderboard.index
+	std::string getLeaderboardPath(const std::string& savePath);
+
+	//every finished game in an append-only file of fixed size records, and an index of them sorted by score
+	//both are mapped, opening takes no time whatever the number of games and a query reads a few pages of the index
+	//top lists and places are a binary search, a game is added with one move of the index entries after it
+	//a crash while it was open costs a check of every record and a rebuild of the index on the next open
+	class Leaderboard
+	{
+	public:
+		Leaderboard();
+		//marks the index as consistent once it is on the disk
+		~Leaderboard();
+		Leaderboard(const Leaderboard&) = delete;
+		Leaderboard& operator=(const Leaderboard&) = delete;
+
+		//fails for files that are not a leaderboard, they are left alone
+		bool open(const std::string& path);
+		void close();
+		bool isOpen()const;
+
+		//returns the place of the game, 1 for the best and 0 when it could not be added
+		//a game that ties an earlier one is placed behind it
+		std::uint64_t add(const LeaderboardEntry& entry);
+		std::uint64_t getCount()const;
+		//the best count games, best first
+		void getTop(size_t count, std::vector<LeaderboardEntry>& entries)const;
+		//the place a game with score would get, 1 plus the games that scored more
+		std::uint64_t getPlace(std::uint32_t score)const;
+		//share of the games that scored less, from 0 to 100
+		float getPercentile(std::uint32_t score)const;
+		//in the order they were added
+		LeaderboardEntry getEntry(std::uint64_t game)const;
+	private:
+		//index entries with a score of at least score
+		std::uint64_t countAtLeast(std::uint32_t score)const;
+		bool reserve(WritableMappedFile& file, size_t size);
+		//checks every record and sorts the index again
+		void rebuild();
+		void setCounts(std::uint64_t count);
+
+		WritableMappedFile m_Records;
+		WritableMappedFile m_Index;
+		std::uint64_t m_Count;
+	};
+}
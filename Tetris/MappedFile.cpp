@@ -0,0 +1,244 @@
+#include "MappedFile.h"
+#include <cstdint>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Storage {
+#ifdef _WIN32
+	MappedFile::MappedFile()
+		:m_Data(nullptr), m_Size(0), m_File(INVALID_HANDLE_VALUE), m_Mapping(nullptr)
+	{
+	}
+#else
+	MappedFile::MappedFile()
+		:m_Data(nullptr), m_Size(0)
+	{
+	}
+#endif
+
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+	bool MappedFile::open(const std::string& path)
+	{
+		close();
+#ifdef _WIN32
+		m_File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		LARGE_INTEGER size{};
+		if (m_File == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_File, &size) || size.QuadPart == 0) {
+			close();
+			return false;
+		}
+		m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (m_Mapping)
+			m_Data = static_cast<const unsigned char*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+		if (!m_Data) {
+			close();
+			return false;
+		}
+		m_Size = static_cast<std::size_t>(size.QuadPart);
+#else
+		const int descriptor = ::open(path.c_str(), O_RDONLY);
+		if (descriptor < 0)
+			return false;
+		struct stat status {};
+		if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+			void* data = mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_SHARED, descriptor, 0);
+			if (data != MAP_FAILED) {
+				m_Data = static_cast<const unsigned char*>(data);
+				m_Size = static_cast<std::size_t>(status.st_size);
+			}
+		}
+		//the mapping keeps the file alive on its own
+		::close(descriptor);
+#endif
+		return m_Data != nullptr;
+	}
+
+	void MappedFile::close()
+	{
+#ifdef _WIN32
+		if (m_Data)
+			UnmapViewOfFile(m_Data);
+		if (m_Mapping)
+			CloseHandle(m_Mapping);
+		if (m_File != INVALID_HANDLE_VALUE)
+			CloseHandle(m_File);
+		m_Mapping = nullptr;
+		m_File = INVALID_HANDLE_VALUE;
+#else
+		if (m_Data)
+			munmap(const_cast<unsigned char*>(m_Data), m_Size);
+#endif
+		m_Data = nullptr;
+		m_Size = 0;
+	}
+
+	bool MappedFile::isOpen() const
+	{
+		return m_Data != nullptr;
+	}
+
+	const unsigned char* MappedFile::getData() const
+	{
+		return m_Data;
+	}
+
+	std::size_t MappedFile::getSize() const
+	{
+		return m_Size;
+	}
+
+#ifdef _WIN32
+	WritableMappedFile::WritableMappedFile()
+		:m_Data(nullptr), m_Size(0), m_File(INVALID_HANDLE_VALUE), m_Mapping(nullptr)
+	{
+	}
+#else
+	WritableMappedFile::WritableMappedFile()
+		:m_Data(nullptr), m_Size(0), m_File(-1)
+	{
+	}
+#endif
+
+	WritableMappedFile::~WritableMappedFile()
+	{
+		close();
+	}
+
+	bool WritableMappedFile::open(const std::string& path, std::size_t minSize)
+	{
+		close();
+#ifdef _WIN32
+		m_File = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		LARGE_INTEGER size{};
+		if (m_File == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_File, &size)) {
+			close();
+			return false;
+		}
+		const std::size_t fileSize = static_cast<std::size_t>(size.QuadPart);
+#else
+		m_File = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+		struct stat status {};
+		if (m_File < 0 || fstat(m_File, &status) != 0) {
+			close();
+			return false;
+		}
+		const std::size_t fileSize = static_cast<std::size_t>(status.st_size);
+#endif
+		if (!map(fileSize < minSize ? minSize : fileSize)) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void WritableMappedFile::close()
+	{
+		if (m_Data)
+			flush(0, m_Size);
+		unmap();
+#ifdef _WIN32
+		if (m_File != INVALID_HANDLE_VALUE)
+			CloseHandle(m_File);
+		m_File = INVALID_HANDLE_VALUE;
+#else
+		if (m_File >= 0)
+			::close(m_File);
+		m_File = -1;
+#endif
+	}
+
+	bool WritableMappedFile::resize(std::size_t size)
+	{
+		if (!isOpen() || size < m_Size)
+			return false;
+		if (size == m_Size)
+			return true;
+		unmap();
+		return map(size);
+	}
+
+	bool WritableMappedFile::flush(std::size_t offset, std::size_t size)
+	{
+		if (!m_Data || offset >= m_Size)
+			return false;
+		size = offset + size > m_Size ? m_Size - offset : size;
+#ifdef _WIN32
+		return FlushViewOfFile(m_Data + offset, size) && FlushFileBuffers(m_File);
+#else
+		//msync takes whole pages
+		const std::size_t page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+		const std::size_t start = offset / page * page;
+		return msync(m_Data + start, offset + size - start, MS_SYNC) == 0;
+#endif
+	}
+
+	bool WritableMappedFile::isOpen() const
+	{
+		return m_Data != nullptr;
+	}
+
+	unsigned char* WritableMappedFile::getData() const
+	{
+		return m_Data;
+	}
+
+	std::size_t WritableMappedFile::getSize() const
+	{
+		return m_Size;
+	}
+
+	bool WritableMappedFile::map(std::size_t size)
+	{
+		//a file cannot be mapped empty
+		if (size == 0)
+			return false;
+#ifdef _WIN32
+		//the mapping extends the file to its size with zero bytes
+		const std::uint64_t wideSize = size;
+		m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READWRITE, static_cast<DWORD>(wideSize >> 32), static_cast<DWORD>(wideSize), nullptr);
+		if (m_Mapping)
+			m_Data = static_cast<unsigned char*>(MapViewOfFile(m_Mapping, FILE_MAP_WRITE, 0, 0, size));
+#else
+		struct stat status {};
+		if (fstat(m_File, &status) != 0 || (static_cast<std::size_t>(status.st_size) < size && ftruncate(m_File, static_cast<off_t>(size)) != 0))
+			return false;
+		void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_File, 0);
+		m_Data = data == MAP_FAILED ? nullptr : static_cast<unsigned char*>(data);
+#endif
+		if (!m_Data) {
+			unmap();
+			return false;
+		}
+		m_Size = size;
+		return true;
+	}
+
+	void WritableMappedFile::unmap()
+	{
+#ifdef _WIN32
+		if (m_Data)
+			UnmapViewOfFile(m_Data);
+		if (m_Mapping)
+			CloseHandle(m_Mapping);
+		m_Mapping = nullptr;
+#else
+		if (m_Data)
+			munmap(m_Data, m_Size);
+#endif
+		m_Data = nullptr;
+		m_Size = 0;
+	}
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace Storage {
+
+	//read-only view of a whole file through the page cache, pages are only read when touched
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		//fails for missing and empty files, an open mapping is closed first
+		bool open(const std::string& path);
+		void close();
+
+		bool isOpen()const;
+		const unsigned char* getData()const;
+		std::size_t getSize()const;
+	private:
+		const unsigned char* m_Data;
+		std::size_t m_Size;
+#ifdef _WIN32
+		void* m_File;
+		void* m_Mapping;
+#endif
+	};
+
+	//read-write view of a whole file that can grow, what is written goes to the page cache and reaches the disk
+	//when the os writes it back or on flush, a crash of the process loses nothing of it
+	class WritableMappedFile
+	{
+	public:
+		WritableMappedFile();
+		//flushes before it unmaps
+		~WritableMappedFile();
+		WritableMappedFile(const WritableMappedFile&) = delete;
+		WritableMappedFile& operator=(const WritableMappedFile&) = delete;
+
+		//creates a missing file with minSize zero bytes, an existing one smaller than that grows to it
+		bool open(const std::string& path, std::size_t minSize);
+		void close();
+		//extends the file with zero bytes and maps it again, pointers into the old mapping are invalid after it
+		bool resize(std::size_t size);
+		//writes the pages of the range back to the disk
+		bool flush(std::size_t offset, std::size_t size);
+
+		bool isOpen()const;
+		unsigned char* getData()const;
+		std::size_t getSize()const;
+	private:
+		bool map(std::size_t size);
+		void unmap();
+
+		unsigned char* m_Data;
+		std::size_t m_Size;
+#ifdef _WIN32
+		void* m_File;
+		void* m_Mapping;
+#else
+		int m_File;
+#endif
+	};
+}
@@ -0,0 +1,51 @@
+#include "Match.h"
+
+namespace Rules {
+	Match::Match(const Simulation& first, const Simulation& second)
+		:m_Players{ { first, second } }, m_GarbageDelivered{ { first.getGarbageSent(), second.getGarbageSent() } }, m_Tick(first.getTick())
+	{
+	}
+
+	void Match::advance(Timing::Tick lastTick)
+	{
+		while (m_Tick < lastTick) {
+			m_Tick += 1;
+			//locks need no checkpoint here, whoever keeps the match keeps it as a whole
+			for (auto& player : m_Players)
+				while (player.advance(m_Tick)) {}
+			for (size_t i{ 0 }; i < playerCount; ++i) {
+				const std::uint32_t sent = m_Players[i].getGarbageSent();
+				if (sent == m_GarbageDelivered[i])
+					continue;
+				m_Players[playerCount - 1 - i].addGarbage(sent - m_GarbageDelivered[i]);
+				m_GarbageDelivered[i] = sent;
+			}
+		}
+	}
+
+	void Match::apply(size_t player, Input input, bool isPressed)
+	{
+		m_Players[player].apply(input, isPressed);
+	}
+
+	Timing::Tick Match::getTick() const
+	{
+		return m_Tick;
+	}
+
+	const Simulation& Match::getPlayer(size_t player) const
+	{
+		return m_Players[player];
+	}
+
+	std::uint64_t Match::getChecksum() const
+	{
+		//fnv-1a over the parts
+		std::uint64_t checksum{ 14695981039346656037ull };
+		for (size_t i{ 0 }; i < playerCount; ++i) {
+			checksum = (checksum ^ m_Players[i].getChecksum()) * 1099511628211ull;
+			checksum = (checksum ^ m_GarbageDelivered[i]) * 1099511628211ull;
+		}
+		return (checksum ^ m_Tick) * 1099511628211ull;
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "Scheduler.h"
+#include "Simulation.h"
+
+namespace Rules {
+	//two games played against each other, the garbage one sends rises in the other
+	//a plain value like the simulations in it, copying it keeps the whole match
+	class Match
+	{
+	public:
+		static constexpr size_t playerCount = 2;
+
+		//both games start at the same tick
+		Match(const Simulation& first, const Simulation& second);
+
+		//runs both games tick by tick up to lastTick, the garbage sent within a tick is handed over at its end
+		void advance(Timing::Tick lastTick);
+		//applies an input of one player at the current tick
+		void apply(size_t player, Input input, bool isPressed);
+
+		Timing::Tick getTick()const;
+		const Simulation& getPlayer(size_t player)const;
+		//the checksums of both games and the garbage in between folded into one
+		std::uint64_t getChecksum()const;
+	private:
+		std::array<Simulation, playerCount> m_Players;
+		//garbage of each player already added to the other's game
+		std::array<std::uint32_t, playerCount> m_GarbageDelivered;
+		Timing::Tick m_Tick;
+	};
+}
@@ -0,0 +1,148 @@
+#include "Metrics.h"
+#include <iomanip>
+#include <sstream>
+
+namespace Instrumentation {
+	//how often the endpoint thread looks at whether it should stop
+	static const sf::Time pollInterval = sf::milliseconds(100);
+	//a scraper sends its request at once, one that does not is not waited for
+	static const sf::Time requestTimeout = sf::seconds(1);
+	static constexpr size_t maxRequestSize = 8 * 1024;
+	static constexpr double microsecondsPerSecond = 1e6;
+
+	Counter::Counter()
+		:m_Value(0)
+	{
+	}
+
+	void Counter::add(std::uint64_t count)
+	{
+		//the only writer, so load and store cannot lose an increment
+		m_Value.store(m_Value.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+	}
+
+	std::uint64_t Counter::get() const
+	{
+		return m_Value.load(std::memory_order_relaxed);
+	}
+
+	MetricsWriter::MetricsWriter(std::string& text)
+		:m_Text(text)
+	{
+	}
+
+	void MetricsWriter::counter(const char* name, const char* help, double value)
+	{
+		header(name, help, "counter");
+		this->value(name, "", value);
+	}
+
+	void MetricsWriter::gauge(const char* name, const char* help, double value)
+	{
+		header(name, help, "gauge");
+		this->value(name, "", value);
+	}
+
+	void MetricsWriter::summary(const char* name, const char* help, const HistogramCounts& counts)
+	{
+		header(name, help, "summary");
+		value(name, "{quantile=\"0.5\"}", counts.getPercentile(50) / microsecondsPerSecond);
+		value(name, "{quantile=\"0.9\"}", counts.getPercentile(90) / microsecondsPerSecond);
+		value(name, "{quantile=\"0.99\"}", counts.getPercentile(99) / microsecondsPerSecond);
+		value(name, "_sum", counts.getSum() / microsecondsPerSecond);
+		value(name, "_count", static_cast<double>(counts.getTotal()));
+	}
+
+	void MetricsWriter::header(const char* name, const char* help, const char* type)
+	{
+		m_Text += "# HELP ";
+		m_Text += name;
+		m_Text += ' ';
+		m_Text += help;
+		m_Text += "\n# TYPE ";
+		m_Text += name;
+		m_Text += ' ';
+		m_Text += type;
+		m_Text += '\n';
+	}
+
+	void MetricsWriter::value(const char* name, const char* suffix, double value)
+	{
+		std::ostringstream line;
+		line << name << suffix << ' ' << std::setprecision(15) << value << '\n';
+		m_Text += line.str();
+	}
+
+	MetricsEndpoint::MetricsEndpoint(const Collect& collect)
+		:m_Collect(collect), m_Running(false)
+	{
+	}
+
+	MetricsEndpoint::~MetricsEndpoint()
+	{
+		m_Running = false;
+		if (m_Thread.joinable())
+			m_Thread.join();
+	}
+
+	bool MetricsEndpoint::start(unsigned short port, const sf::IpAddress& address)
+	{
+		if (m_Running || m_Listener.listen(port, address) != sf::Socket::Done)
+			return false;
+		m_Running = true;
+		m_Thread = std::thread(&MetricsEndpoint::serve, this);
+		return true;
+	}
+
+	void MetricsEndpoint::serve()
+	{
+		//one scrape at a time, a scraper asks every few seconds at most
+		sf::SocketSelector selector;
+		selector.add(m_Listener);
+		while (m_Running) {
+			if (!selector.wait(pollInterval))
+				continue;
+			sf::TcpSocket socket;
+			if (m_Listener.accept(socket) == sf::Socket::Done)
+				answer(socket);
+		}
+	}
+
+	void MetricsEndpoint::answer(sf::TcpSocket& socket)
+	{
+		sf::SocketSelector selector;
+		selector.add(socket);
+		sf::Clock clock;
+		std::string request;
+		char buffer[1024];
+		while (request.find("\r\n\r\n") == std::string::npos) {
+			const sf::Time left = requestTimeout - clock.getElapsedTime();
+			size_t received{ 0 };
+			if (request.size() > maxRequestSize || left <= sf::Time::Zero || !selector.wait(left)
+				|| socket.receive(buffer, sizeof(buffer), received) != sf::Socket::Done)
+				return;
+			request.append(buffer, received);
+		}
+
+		//only the request line matters, everything the scraper tells about itself is ignored
+		const std::string line{ request.substr(0, request.find("\r\n")) };
+		const std::string path{ line.substr(0, line.find(' ', 4)) };
+		std::string status{ "200 OK" };
+		std::string body;
+		if (line.compare(0, 4, "GET ") != 0) {
+			status = "405 Method Not Allowed";
+			body = "only GET is answered\n";
+		}
+		else if (path == "GET /metrics" || path.compare(0, 13, "GET /metrics?") == 0) {
+			MetricsWriter writer(body);
+			m_Collect(writer);
+		}
+		else {
+			status = "404 Not Found";
+			body = "metrics are at /metrics\n";
+		}
+		const std::string response{ "HTTP/1.1 " + status + "\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: "
+			+ std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body };
+		socket.send(response.data(), response.size());
+	}
+}
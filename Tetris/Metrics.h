@@ -0,0 +1,65 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include "Histogram.h"
+
+namespace Instrumentation {
+	//a count one thread adds to and any other reads at any time, a plain store like the histogram buckets
+	class Counter
+	{
+	public:
+		Counter();
+
+		//only ever from the owning thread
+		void add(std::uint64_t count = 1);
+		std::uint64_t get()const;
+	private:
+		std::atomic<std::uint64_t> m_Value;
+	};
+
+	//metrics in the prometheus text format, names are used as they are given
+	class MetricsWriter
+	{
+	public:
+		explicit MetricsWriter(std::string& text);
+
+		void counter(const char* name, const char* help, double value);
+		void gauge(const char* name, const char* help, double value);
+		//median, 90th and 99th percentile of samples in microseconds, written in seconds
+		void summary(const char* name, const char* help, const HistogramCounts& counts);
+	private:
+		void header(const char* name, const char* help, const char* type);
+		void value(const char* name, const char* suffix, double value);
+
+		std::string& m_Text;
+	};
+
+	//answers GET /metrics over http on a thread of its own, for scrapers and curl
+	//collect runs on that thread for every scrape, whoever is measured only ever writes its counters and histograms
+	class MetricsEndpoint
+	{
+	public:
+		using Collect = std::function<void(MetricsWriter&)>;
+
+		explicit MetricsEndpoint(const Collect& collect);
+		~MetricsEndpoint();
+		MetricsEndpoint(const MetricsEndpoint&) = delete;
+		MetricsEndpoint& operator=(const MetricsEndpoint&) = delete;
+
+		//false when the port cannot be listened on, only this machine can scrape unless another address is given
+		bool start(unsigned short port, const sf::IpAddress& address = sf::IpAddress::LocalHost);
+	private:
+		void serve();
+		void answer(sf::TcpSocket& socket);
+
+		Collect m_Collect;
+		sf::TcpListener m_Listener;
+		std::atomic<bool> m_Running;
+		std::thread m_Thread;
+	};
+}
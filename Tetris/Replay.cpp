@@ -0,0 +1,123 @@
+#include "Replay.h"
+#include <cstring>
+#include "ByteOrder.h"
+
+namespace Storage {
+	static constexpr char replayMagic[4] = { 'T', 'R', 'P', 'L' };
+	static constexpr std::uint16_t replayVersion = 1;
+	//two hours of play, a longer claim is not a game anyone played and would only keep a verifier busy
+	static constexpr Timing::Tick maxReplayTicks = 2 * 3600 * Timing::TicksPerSecond;
+	//a player can not press more than a few keys per tick
+	static constexpr std::uint32_t maxInputsPerTick = 8;
+
+	//7 bits per byte, the top bit says another byte follows
+	static void putVarint(std::vector<std::uint8_t>& bytes, std::uint32_t value)
+	{
+		for (; value >= 0x80; value >>= 7)
+			bytes.push_back(static_cast<std::uint8_t>(value | 0x80));
+		bytes.push_back(static_cast<std::uint8_t>(value));
+	}
+
+	static bool getVarint(const std::uint8_t* data, size_t size, size_t& offset, std::uint32_t& value)
+	{
+		value = 0;
+		for (unsigned shift{ 0 }; shift < 32 && offset < size; shift += 7) {
+			const std::uint8_t byte = data[offset++];
+			value |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+			if ((byte & 0x80) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	void encodeReplay(const Replay& replay, std::vector<std::uint8_t>& bytes)
+	{
+		bytes.clear();
+		for (char c : replayMagic)
+			appendLittleEndian(bytes, static_cast<std::uint8_t>(c));
+		appendLittleEndian(bytes, replayVersion);
+		appendLittleEndian(bytes, replay.seed);
+		appendLittleEndian(bytes, replay.startLevel);
+		appendLittleEndian(bytes, replay.endTick);
+		appendLittleEndian(bytes, replay.score);
+		appendLittleEndian(bytes, replay.lines);
+		appendLittleEndian(bytes, replay.checksum);
+		appendLittleEndian(bytes, static_cast<std::uint32_t>(replay.inputs.size()));
+		Timing::Tick tick{ 0 };
+		for (const auto& input : replay.inputs) {
+			putVarint(bytes, input.tick - tick);
+			appendLittleEndian(bytes, input.code);
+			tick = input.tick;
+		}
+		appendLittleEndian(bytes, fnv1a(bytes.data(), bytes.size()));
+	}
+
+	bool decodeReplay(const std::uint8_t* data, size_t size, Replay& replay)
+	{
+		if (size < sizeof(replayMagic) + sizeof(std::uint32_t) || std::memcmp(data, replayMagic, sizeof(replayMagic)) != 0)
+			return false;
+		size_t checksumOffset = size - sizeof(std::uint32_t);
+		std::uint32_t storedChecksum{ 0 };
+		if (!readLittleEndian(data, size, checksumOffset, storedChecksum) || storedChecksum != fnv1a(data, size - sizeof(std::uint32_t)))
+			return false;
+		size = size - sizeof(std::uint32_t);
+
+		size_t offset{ sizeof(replayMagic) };
+		std::uint16_t version{ 0 };
+		std::uint32_t inputCount{ 0 };
+		if (!readLittleEndian(data, size, offset, version) || version != replayVersion
+			|| !readLittleEndian(data, size, offset, replay.seed) || !readLittleEndian(data, size, offset, replay.startLevel) || !readLittleEndian(data, size, offset, replay.endTick)
+			|| !readLittleEndian(data, size, offset, replay.score) || !readLittleEndian(data, size, offset, replay.lines) || !readLittleEndian(data, size, offset, replay.checksum)
+			|| !readLittleEndian(data, size, offset, inputCount))
+			return false;
+		//every input takes at least two bytes, a count beyond that is a lie and must not size the vector
+		if (replay.endTick > maxReplayTicks || inputCount > (size - offset) / 2)
+			return false;
+		replay.inputs.resize(inputCount);
+		Timing::Tick tick{ 0 };
+		for (auto& input : replay.inputs) {
+			std::uint32_t delta{ 0 };
+			if (!getVarint(data, size, offset, delta) || !readLittleEndian(data, size, offset, input.code) || delta > replay.endTick - tick)
+				return false;
+			tick += delta;
+			input.tick = tick;
+		}
+		return offset == size;
+	}
+
+	ReplayVerdict verifyReplay(const Replay& replay)
+	{
+		if (replay.endTick > maxReplayTicks || replay.startLevel >= Rules::levelCount)
+			return ReplayMalformed;
+		Rules::Simulation game(replay.seed);
+		game.setStartLevel(replay.startLevel);
+		Timing::Tick inputTick{ 0 };
+		std::uint32_t inputsAtTick{ 0 };
+		for (const auto& input : replay.inputs) {
+			const std::uint8_t key = input.code & ~replayPressedBit;
+			inputsAtTick = input.tick == inputTick ? inputsAtTick + 1 : 1;
+			inputTick = input.tick;
+			if (key >= Rules::InputCount || input.tick > replay.endTick || inputsAtTick > maxInputsPerTick)
+				return ReplayMalformed;
+			//checked at every lock as well, a lost game stops the replay before the next one is played any further
+			while (game.advance(input.tick) && game.getTopOuts() == 0) {}
+			if (game.getTopOuts() != 0)
+				return ReplayToppedOut;
+			game.apply(static_cast<Rules::Input>(key), (input.code & replayPressedBit) != 0);
+		}
+		while (game.advance(replay.endTick) && game.getTopOuts() == 0) {}
+		if (game.getTopOuts() != 0)
+			return ReplayToppedOut;
+		if (game.getScore() != replay.score || game.getLines() != replay.lines)
+			return ReplayScoreDiffers;
+		if (game.getChecksum() != replay.checksum)
+			return ReplayBoardDiffers;
+		return ReplayAccepted;
+	}
+
+	const char* getVerdictName(ReplayVerdict verdict)
+	{
+		static constexpr const char* names[ReplayVerdictCount] = { "accepted", "malformed", "topped-out", "score-differs", "board-differs" };
+		return verdict < ReplayVerdictCount ? names[verdict] : "unknown";
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Scheduler.h"
+#include "Simulation.h"
+
+namespace Storage {
+	//the top bit of an input code, the rest is the Rules::Input
+	static constexpr std::uint8_t replayPressedBit = 0x80;
+
+	struct ReplayInput
+	{
+		Timing::Tick tick;
+		std::uint8_t code;
+	};
+
+	//one game as it is submitted to the leaderboard
+	//it is played from a fresh simulation of the seed with the default gravity and ends at endTick, before the game topped out
+	struct Replay
+	{
+		std::uint32_t seed;
+		std::uint8_t startLevel;
+		Timing::Tick endTick;
+		//what the player claims the game had reached at endTick
+		std::uint32_t score;
+		std::uint32_t lines;
+		std::uint64_t checksum;
+		//in the order they were applied, ticks never go back
+		std::vector<ReplayInput> inputs;
+	};
+
+	enum ReplayVerdict
+	{
+		ReplayAccepted,
+		//truncated, corrupted, a wrong version or inputs that do not fit the game
+		ReplayMalformed,
+		//the game was lost before endTick
+		ReplayToppedOut,
+		ReplayScoreDiffers,
+		ReplayBoardDiffers,
+		ReplayVerdictCount
+	};
+
+	//little endian header, tick deltas as varints and a checksum, about 2 bytes per input
+	void encodeReplay(const Replay& replay, std::vector<std::uint8_t>& bytes);
+	//the input vector of replay is reused, decoding many replays into one allocates only while they grow
+	bool decodeReplay(const std::uint8_t* data, size_t size, Replay& replay);
+	//plays the inputs on a fresh simulation without rendering and compares where it ends with the claim
+	ReplayVerdict verifyReplay(const Replay& replay);
+	const char* getVerdictName(ReplayVerdict verdict);
+}
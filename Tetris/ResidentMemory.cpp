@@ -0,0 +1,33 @@
+#include "ResidentMemory.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fstream>
+#include <unistd.h>
+#endif
+
+namespace Instrumentation {
+#ifdef _WIN32
+	std::uint64_t getResidentMemory()
+	{
+		PROCESS_MEMORY_COUNTERS counters{};
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return 0;
+		return counters.WorkingSetSize;
+	}
+#else
+	std::uint64_t getResidentMemory()
+	{
+		//pages of the whole mapping, then the resident ones
+		std::ifstream statm("/proc/self/statm");
+		std::uint64_t size{ 0 }, resident{ 0 };
+		if (!(statm >> size >> resident))
+			return 0;
+		return resident * static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+	}
+#endif
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Instrumentation {
+	//bytes of the process in physical memory right now, 0 where the system does not tell
+	std::uint64_t getResidentMemory();
+}
@@ -0,0 +1,38 @@
+#include "Resources.h"
+
+namespace Resources {
+	bool loadImage(sf::Image& image, const ImageData& data)
+	{
+		if (data.width == 0 || data.height == 0)
+			return false;
+		image.create(data.width, data.height, data.pixels);
+		return true;
+	}
+
+	bool loadTexture(sf::Texture& texture, const ImageData& data)
+	{
+		//upload straight from the embedded pixels, no png decoding and no intermediate image
+		if (!texture.create(data.width, data.height))
+			return false;
+		texture.update(data.pixels);
+		return true;
+	}
+
+	bool updateTexture(sf::Texture& texture, const ImageData& data)
+	{
+		if (texture.getSize() != sf::Vector2u(data.width, data.height))
+			return false;
+		texture.update(data.pixels);
+		return true;
+	}
+
+	bool loadFont(sf::Font& font, const FileData& data)
+	{
+		return font.loadFromMemory(data.bytes, data.size);
+	}
+
+	Skin getEmbeddedSkin()
+	{
+		return { blockTile, wallTile, scoreFont, { nullptr, 0 } };
+	}
+}
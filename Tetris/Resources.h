@@ -0,0 +1,49 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstddef>
+
+//assets compiled into the executable by ResourceCompiler, nothing is read from disk at runtime
+namespace Resources {
+
+	//pixels decoded at build time, rgba row major
+	struct ImageData
+	{
+		unsigned width;
+		unsigned height;
+		const sf::Uint8* pixels;
+	};
+
+	//file kept as is, for loaders that parse it themselves
+	struct FileData
+	{
+		const unsigned char* bytes;
+		std::size_t size;
+	};
+
+	//defined in the generated EmbeddedResources.cpp
+	//the first block texture of the atlas turned grey, the palette decides the colour
+	extern const ImageData blockTile;
+	extern const ImageData wallTile;
+	extern const FileData scoreFont;
+
+	//what a theme replaces, font and palette are optional and empty when the theme has none
+	struct Skin
+	{
+		ImageData blockTile;
+		ImageData wallTile;
+		FileData font;
+		//PieceTypeCount rgba colours, see Blocks::Palette
+		FileData palette;
+	};
+
+	//the assets compiled into the executable, used until a theme from an AssetPack replaces them
+	Skin getEmbeddedSkin();
+
+	bool loadImage(sf::Image& image, const ImageData& data);
+	bool loadTexture(sf::Texture& texture, const ImageData& data);
+	//replaces the pixels of an existing texture of the same size, sprites and shaders using it stay valid
+	bool updateTexture(sf::Texture& texture, const ImageData& data);
+	//the font keeps reading the bytes, embedded ones live as long as the program, packed ones as long as their pack
+	bool loadFont(sf::Font& font, const FileData& data);
+}
@@ -0,0 +1,74 @@
+#include "RewindBuffer.h"
+#include <cstring>
+
+namespace Storage {
+	//smaller than any encoded snapshot, bounds how many entries the budget can hold
+	static constexpr size_t minEntrySize = 64;
+
+	RewindBuffer::RewindBuffer(size_t budget)
+		:m_Bytes(budget), m_Entries(budget / minEntrySize + 1), m_First(0), m_Count(0)
+	{
+	}
+
+	void RewindBuffer::push(const std::uint8_t* data, size_t size)
+	{
+		if (size == 0 || size > m_Bytes.size())
+			return;
+		size_t offset{ 0 };
+		if (m_Count != 0) {
+			const Entry& newest = m_Entries[(m_First + m_Count - 1) % m_Entries.size()];
+			offset = newest.offset + newest.size;
+			//a state is never split, the rest of the block stays unused when it does not fit there
+			if (offset + size > m_Bytes.size()) {
+				while (m_Count != 0 && m_Entries[m_First].offset >= offset)
+					dropOldest();
+				offset = 0;
+			}
+		}
+		//the oldest states are the ones right behind the write position
+		while (m_Count != 0 && m_Entries[m_First].offset >= offset && m_Entries[m_First].offset < offset + size)
+			dropOldest();
+		if (m_Count == m_Entries.size())
+			dropOldest();
+		std::memcpy(m_Bytes.data() + offset, data, size);
+		m_Entries[(m_First + m_Count) % m_Entries.size()] = { offset, size };
+		m_Count += 1;
+	}
+
+	bool RewindBuffer::get(size_t age, const std::uint8_t*& data, size_t& size) const
+	{
+		if (age >= m_Count)
+			return false;
+		const Entry& entry = m_Entries[(m_First + m_Count - 1 - age) % m_Entries.size()];
+		data = m_Bytes.data() + entry.offset;
+		size = entry.size;
+		return true;
+	}
+
+	void RewindBuffer::dropNewest(size_t count)
+	{
+		m_Count -= count < m_Count ? count : m_Count;
+	}
+
+	void RewindBuffer::clear()
+	{
+		m_First = 0;
+		m_Count = 0;
+	}
+
+	size_t RewindBuffer::getCount() const
+	{
+		return m_Count;
+	}
+
+	size_t RewindBuffer::getBudget() const
+	{
+		return m_Bytes.size();
+	}
+
+	void RewindBuffer::dropOldest()
+	{
+		m_First = (m_First + 1) % m_Entries.size();
+		m_Count -= 1;
+	}
+}
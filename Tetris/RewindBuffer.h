@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Storage {
+	//encoded snapshots of the last pieces in one fixed block of memory, the oldest go first when it is full
+	//all memory is taken up front, pushing and reading never allocate
+	class RewindBuffer
+	{
+	public:
+		//budget in bytes, 0 keeps nothing
+		explicit RewindBuffer(size_t budget);
+
+		//drops the oldest states until the new one fits, a state larger than the budget is not kept
+		void push(const std::uint8_t* data, size_t size);
+		//age 0 is the newest state, the view stays valid until the next push
+		bool get(size_t age, const std::uint8_t*& data, size_t& size)const;
+		void dropNewest(size_t count);
+		void clear();
+		size_t getCount()const;
+		size_t getBudget()const;
+	private:
+		struct Entry
+		{
+			size_t offset;
+			size_t size;
+		};
+		void dropOldest();
+
+		std::vector<std::uint8_t> m_Bytes;
+		//ring of entries, oldest at m_First, their bytes follow each other in m_Bytes and wrap to its start
+		std::vector<Entry> m_Entries;
+		size_t m_First;
+		size_t m_Count;
+	};
+}
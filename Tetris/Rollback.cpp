@@ -0,0 +1,156 @@
+#include "Rollback.h"
+#include <algorithm>
+
+namespace Rules {
+	RollbackMatch::RollbackMatch(const Match& match, size_t localPlayer)
+		:m_Match(match), m_LocalPlayer(localPlayer), m_States(static_cast<size_t>(maxRollbackTicks), match), m_Logs{},
+		m_AcknowledgedLocalInputs(0), m_RemoteKnownUntil(match.getTick()), m_NeedsRollback(false), m_RollbackTick(0), m_Stats{}
+	{
+	}
+
+	void RollbackMatch::applyLocal(Input input, bool isPressed)
+	{
+		m_Logs[m_LocalPlayer].inputs.push_back({ getTick(), input, isPressed });
+		m_Match.apply(m_LocalPlayer, input, isPressed);
+	}
+
+	bool RollbackMatch::addRemoteInput(std::uint64_t sequence, const TimedInput& input)
+	{
+		InputLog& log = m_Logs[Match::playerCount - 1 - m_LocalPlayer];
+		const std::uint64_t count = log.firstSequence + log.inputs.size();
+		if (sequence < count)
+			return true;
+		//the opponent cannot apply an input at a tick it has declared complete, nor go back in time
+		if (sequence > count || input.input >= InputCount || input.tick < m_RemoteKnownUntil
+			|| (!log.inputs.empty() && input.tick < log.inputs.back().tick)
+			|| (input.tick <= getTick() && getTick() - input.tick >= maxRollbackTicks))
+			return false;
+		log.inputs.push_back(input);
+		//an input ahead of the match is simply applied when its tick comes
+		if (input.tick <= getTick()) {
+			m_RollbackTick = m_NeedsRollback ? std::min(m_RollbackTick, input.tick) : input.tick;
+			m_NeedsRollback = true;
+		}
+		return true;
+	}
+
+	void RollbackMatch::setRemoteKnownUntil(Timing::Tick tick)
+	{
+		m_RemoteKnownUntil = std::max(m_RemoteKnownUntil, tick);
+	}
+
+	void RollbackMatch::acknowledgeLocalInputs(std::uint64_t sequence)
+	{
+		m_AcknowledgedLocalInputs = std::max(m_AcknowledgedLocalInputs, std::min(sequence, getLocalInputCount()));
+	}
+
+	bool RollbackMatch::advance(Timing::Tick lastTick)
+	{
+		if (m_NeedsRollback)
+			rollback();
+		//any input still to come is at m_RemoteKnownUntil or later, the states have to reach back there
+		const Timing::Tick lastReachable = m_RemoteKnownUntil + maxRollbackTicks - 1;
+		const Timing::Tick target = std::min(lastTick, lastReachable);
+		while (getTick() < target)
+			step();
+		dropOldInputs();
+		return getTick() >= lastTick;
+	}
+
+	Timing::Tick RollbackMatch::getTick() const
+	{
+		return m_Match.getTick();
+	}
+
+	const Match& RollbackMatch::getMatch() const
+	{
+		return m_Match;
+	}
+
+	size_t RollbackMatch::getLocalPlayer() const
+	{
+		return m_LocalPlayer;
+	}
+
+	std::uint64_t RollbackMatch::getLocalInputCount() const
+	{
+		const InputLog& log = m_Logs[m_LocalPlayer];
+		return log.firstSequence + log.inputs.size();
+	}
+
+	std::uint64_t RollbackMatch::getAcknowledgedLocalInputs() const
+	{
+		return m_AcknowledgedLocalInputs;
+	}
+
+	const TimedInput& RollbackMatch::getLocalInput(std::uint64_t sequence) const
+	{
+		const InputLog& log = m_Logs[m_LocalPlayer];
+		return log.inputs[static_cast<size_t>(sequence - log.firstSequence)];
+	}
+
+	std::uint64_t RollbackMatch::getRemoteInputCount() const
+	{
+		const InputLog& log = m_Logs[Match::playerCount - 1 - m_LocalPlayer];
+		return log.firstSequence + log.inputs.size();
+	}
+
+	const RollbackStats& RollbackMatch::getStats() const
+	{
+		return m_Stats;
+	}
+
+	void RollbackMatch::report(std::ostream& out) const
+	{
+		out << "rollback: " << m_Stats.rollbacks << " rollbacks, " << m_Stats.resimulatedTicks << " ticks simulated again, deepest "
+			<< m_Stats.deepestRollback << " ticks\n";
+	}
+
+	void RollbackMatch::step()
+	{
+		const Timing::Tick tick = getTick() + 1;
+		m_Match.advance(tick);
+		//copying over a match of the same shape reuses its memory, a tick allocates nothing
+		m_States[static_cast<size_t>(tick % maxRollbackTicks)] = m_Match;
+		applyLogged(tick);
+	}
+
+	void RollbackMatch::applyLogged(Timing::Tick tick)
+	{
+		//the players in a fixed order, both sides of the match replay a tick the same way
+		for (size_t player{ 0 }; player < Match::playerCount; ++player) {
+			const auto& inputs = m_Logs[player].inputs;
+			auto input = std::lower_bound(inputs.begin(), inputs.end(), tick,
+				[](const TimedInput& logged, Timing::Tick at) { return logged.tick < at; });
+			for (; input != inputs.end() && input->tick == tick; ++input)
+				m_Match.apply(player, input->input, input->isPressed);
+		}
+	}
+
+	void RollbackMatch::rollback()
+	{
+		const Timing::Tick current = getTick();
+		m_Match = m_States[static_cast<size_t>(m_RollbackTick % maxRollbackTicks)];
+		applyLogged(m_RollbackTick);
+		while (getTick() < current)
+			step();
+		m_NeedsRollback = false;
+		m_Stats.rollbacks += 1;
+		m_Stats.resimulatedTicks += current - m_RollbackTick;
+		m_Stats.deepestRollback = std::max(m_Stats.deepestRollback, current - m_RollbackTick);
+	}
+
+	void RollbackMatch::dropOldInputs()
+	{
+		const Timing::Tick oldestState = getTick() < maxRollbackTicks ? 0 : getTick() - maxRollbackTicks + 1;
+		for (size_t player{ 0 }; player < Match::playerCount; ++player) {
+			InputLog& log = m_Logs[player];
+			//local inputs also wait for the opponent to have them, they are sent until then
+			while (!log.inputs.empty() && log.inputs.front().tick < oldestState
+				&& (player != m_LocalPlayer || log.firstSequence < m_AcknowledgedLocalInputs)) {
+				log.inputs.pop_front();
+				log.firstSequence += 1;
+			}
+		}
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <vector>
+#include "Match.h"
+
+namespace Rules {
+	//an input of one player and the tick it was applied at
+	struct TimedInput
+	{
+		Timing::Tick tick;
+		Input input;
+		bool isPressed;
+	};
+
+	struct RollbackStats
+	{
+		std::uint64_t rollbacks;
+		//ticks played a second time after a late input
+		std::uint64_t resimulatedTicks;
+		Timing::Tick deepestRollback;
+	};
+
+	//a match where only the local player's inputs are known on time
+	//the opponent is predicted to keep holding what it held, when its inputs arrive the match goes back to the
+	//tick of the earliest of them and plays every tick since again, all within one advance
+	class RollbackMatch
+	{
+	public:
+		//how far back a late input can reach, half a second
+		static constexpr Timing::Tick maxRollbackTicks = Timing::TicksPerSecond / 2;
+
+		RollbackMatch(const Match& match, size_t localPlayer);
+
+		//applies an input of the local player at the current tick
+		void applyLocal(Input input, bool isPressed);
+		//inputs of the opponent in the order of their sequence, inputs known already are ignored
+		//false for an input that does not follow the known ones or lies further back than a rollback reaches
+		bool addRemoteInput(std::uint64_t sequence, const TimedInput& input);
+		//the opponent has sent every input it applied before that tick
+		void setRemoteKnownUntil(Timing::Tick tick);
+		//the opponent has every local input before that sequence
+		void acknowledgeLocalInputs(std::uint64_t sequence);
+		//rolls back to the earliest late input if there is one, then plays on to lastTick
+		//stops early rather than get further ahead of the opponent's inputs than a rollback reaches, false then
+		bool advance(Timing::Tick lastTick);
+
+		Timing::Tick getTick()const;
+		const Match& getMatch()const;
+		size_t getLocalPlayer()const;
+		std::uint64_t getLocalInputCount()const;
+		std::uint64_t getAcknowledgedLocalInputs()const;
+		//local inputs from the acknowledged ones on are kept until the opponent has them
+		const TimedInput& getLocalInput(std::uint64_t sequence)const;
+		std::uint64_t getRemoteInputCount()const;
+		const RollbackStats& getStats()const;
+		void report(std::ostream& out)const;
+	private:
+		//inputs of one player in the order they were applied, the oldest are dropped once no rollback reaches them
+		struct InputLog
+		{
+			std::deque<TimedInput> inputs;
+			std::uint64_t firstSequence;
+		};
+		//the next tick, its state is kept before the inputs at it are applied
+		void step();
+		void applyLogged(Timing::Tick tick);
+		void rollback();
+		void dropOldInputs();
+
+		Match m_Match;
+		size_t m_LocalPlayer;
+		//the match at a tick before its inputs, at m_States[tick % maxRollbackTicks]
+		//allocated once, each tick is copied over the oldest
+		std::vector<Match> m_States;
+		std::array<InputLog, Match::playerCount> m_Logs;
+		std::uint64_t m_AcknowledgedLocalInputs;
+		Timing::Tick m_RemoteKnownUntil;
+		bool m_NeedsRollback;
+		Timing::Tick m_RollbackTick;
+		RollbackStats m_Stats;
+	};
+}
@@ -0,0 +1,310 @@
+#include "Royale.h"
+#include <algorithm>
+
+namespace Rules {
+	//garbage rises half a second after it was sent, clearing lines before then cancels it
+	static constexpr Timing::Tick garbageDelayTicks = Timing::TicksPerSecond / 2;
+	//a random target is kept for a while, switching every attack would spread the garbage thin
+	static constexpr Timing::Tick retargetTicks = 3 * Timing::TicksPerSecond;
+	//badge points needed for each badge level
+	static constexpr std::array<std::uint16_t, 4> badgeLevelPoints{ { 2, 6, 14, 30 } };
+	//spreads the seeds of the players over the whole range, neighbours must not get related piece sequences
+	static constexpr std::uint32_t playerSeedStep = 2654435761u;
+	//bots that are not given one of their own play at this pace
+	static constexpr Timing::Tick defaultBotTicks = 16;
+	//the pace of added bots, from a quick player to a slow one
+	static constexpr Timing::Tick fastestBotTicks = 8;
+	static constexpr Timing::Tick slowestBotTicks = 32;
+
+	Royale::Royale(std::uint32_t seed, unsigned startLevel)
+		:m_RandomState(getSeededRandomState(seed)), m_Tick(0), m_AliveCount(playerCount)
+	{
+		m_Games.reserve(playerCount);
+		m_Players.reserve(playerCount);
+		for (size_t i{ 0 }; i < playerCount; ++i) {
+			const std::uint32_t playerSeed = seed + static_cast<std::uint32_t>(i) * playerSeedStep;
+			m_Games.emplace_back(playerSeed);
+			m_Games.back().setStartLevel(startLevel);
+			m_Players.push_back({ true, false, TargetRandom, 0, {}, 0, 0, 0, false, 0, 0, 0, 0, Bot(playerSeed, defaultBotTicks) });
+		}
+		for (size_t i{ 0 }; i < playerCount; ++i)
+			chooseTarget(i);
+	}
+
+	void Royale::setGravityTable(const GravityTable& gravity)
+	{
+		for (auto& game : m_Games)
+			game.setGravityTable(gravity);
+	}
+
+	void Royale::setBot(size_t player, const Bot& bot)
+	{
+		m_Players[player].isBot = true;
+		m_Players[player].bot = bot;
+	}
+
+	void Royale::addBots(size_t firstPlayer)
+	{
+		for (size_t i{ firstPlayer }; i < playerCount; ++i) {
+			const Timing::Tick ticksPerAction = fastestBotTicks + nextRandom() % (slowestBotTicks - fastestBotTicks + 1);
+			setBot(i, Bot(nextRandom(), ticksPerAction));
+			setTargeting(i, static_cast<Targeting>(i % TargetingCount));
+		}
+	}
+
+	void Royale::setTargeting(size_t player, Targeting targeting)
+	{
+		m_Players[player].targeting = targeting;
+		if (m_Players[player].isAlive && !isOver())
+			chooseTarget(player);
+	}
+
+	void Royale::advance(Timing::Tick lastTick)
+	{
+		while (m_Tick < lastTick && !isOver())
+			step();
+	}
+
+	void Royale::apply(size_t player, Input input, bool isPressed)
+	{
+		if (m_Players[player].isAlive)
+			m_Games[player].apply(input, isPressed);
+	}
+
+	Timing::Tick Royale::getTick() const
+	{
+		return m_Tick;
+	}
+
+	bool Royale::isOver() const
+	{
+		return m_AliveCount <= 1;
+	}
+
+	size_t Royale::getAliveCount() const
+	{
+		return m_AliveCount;
+	}
+
+	const Simulation& Royale::getGame(size_t player) const
+	{
+		return m_Games[player];
+	}
+
+	const RoyalePlayer& Royale::getPlayer(size_t player) const
+	{
+		return m_Players[player];
+	}
+
+	unsigned Royale::getBadgeLevel(size_t player) const
+	{
+		const auto points = m_Players[player].badgePoints;
+		return static_cast<unsigned>(std::upper_bound(badgeLevelPoints.begin(), badgeLevelPoints.end(), points) - badgeLevelPoints.begin());
+	}
+
+	unsigned Royale::getIncomingRows(size_t player) const
+	{
+		const RoyalePlayer& target = m_Players[player];
+		unsigned rows{ 0 };
+		for (std::uint8_t i{ 0 }; i < target.queuedAttacks; ++i)
+			rows += target.queue[i].rows;
+		return rows;
+	}
+
+	size_t Royale::getAttackerCount(size_t player) const
+	{
+		size_t attackers{ 0 };
+		for (size_t i{ 0 }; i < playerCount; ++i)
+			if (i != player && m_Players[i].isAlive && m_Players[i].target == player)
+				attackers += 1;
+		return attackers;
+	}
+
+	std::uint64_t Royale::getChecksum() const
+	{
+		//fnv-1a over the parts
+		std::uint64_t checksum{ 14695981039346656037ull };
+		const auto add = [&checksum](std::uint64_t value) { checksum = (checksum ^ value) * 1099511628211ull; };
+		for (size_t i{ 0 }; i < playerCount; ++i) {
+			const RoyalePlayer& player = m_Players[i];
+			add(player.isAlive ? m_Games[i].getChecksum() : player.placement);
+			add(static_cast<std::uint64_t>(player.target) << 32 | player.badgePoints);
+			for (std::uint8_t j{ 0 }; j < player.queuedAttacks; ++j)
+				add(static_cast<std::uint64_t>(player.queue[j].due) << 16 | player.queue[j].rows << 8 | player.queue[j].from);
+		}
+		add(m_Tick);
+		return checksum;
+	}
+
+	std::uint32_t Royale::nextRandom()
+	{
+		m_RandomState = getNextRandomState(m_RandomState);
+		return m_RandomState;
+	}
+
+	void Royale::step()
+	{
+		m_Tick += 1;
+		//locks need no checkpoint here, whoever keeps the royale keeps it as a whole
+		for (size_t i{ 0 }; i < playerCount; ++i)
+			if (m_Players[i].isAlive)
+				while (m_Games[i].advance(m_Tick)) {}
+		//a game that topped out within the tick is out before anything it sent goes on
+		for (size_t i{ 0 }; i < playerCount && !isOver(); ++i)
+			if (m_Players[i].isAlive && m_Games[i].getTopOuts() != 0)
+				knockOut(i);
+		for (size_t i{ 0 }; i < playerCount; ++i) {
+			RoyalePlayer& player = m_Players[i];
+			if (!player.isAlive)
+				continue;
+			const std::uint32_t sent = m_Games[i].getGarbageSent() - player.garbageHandled;
+			player.garbageHandled += sent;
+			if (sent != 0 && !isOver())
+				attack(i, sent);
+		}
+		for (size_t i{ 0 }; i < playerCount; ++i) {
+			RoyalePlayer& player = m_Players[i];
+			if (!player.isAlive)
+				continue;
+			//due garbage goes to the game, which raises it with the next lock that clears nothing
+			size_t due{ 0 };
+			for (; due < player.queuedAttacks && player.queue[due].due <= m_Tick; ++due) {
+				m_Games[i].addGarbage(player.queue[due].rows);
+				player.lastAttacker = player.queue[due].from;
+				player.hasAttacker = true;
+			}
+			if (due != 0) {
+				std::copy(player.queue.begin() + due, player.queue.begin() + player.queuedAttacks, player.queue.begin());
+				player.queuedAttacks = static_cast<std::uint8_t>(player.queuedAttacks - due);
+			}
+			if (player.targeting == TargetRandom && player.retargetTick <= m_Tick && !isOver())
+				chooseTarget(i);
+			Input input{ InputCount };
+			bool isPressed{ false };
+			if (player.isBot && player.bot.getNextTick() <= m_Tick && player.bot.act(m_Games[i], input, isPressed))
+				m_Games[i].apply(input, isPressed);
+		}
+	}
+
+	void Royale::attack(size_t player, unsigned rows)
+	{
+		//garbage on its way to the attacker is cancelled first, oldest first
+		RoyalePlayer& attacker = m_Players[player];
+		while (rows != 0 && attacker.queuedAttacks != 0) {
+			RoyaleAttack& oldest = attacker.queue[0];
+			const unsigned cancelled = std::min<unsigned>(rows, oldest.rows);
+			oldest.rows = static_cast<std::uint8_t>(oldest.rows - cancelled);
+			rows -= cancelled;
+			if (oldest.rows != 0)
+				break;
+			std::copy(attacker.queue.begin() + 1, attacker.queue.begin() + attacker.queuedAttacks, attacker.queue.begin());
+			attacker.queuedAttacks -= 1;
+		}
+		if (rows == 0)
+			return;
+		rows += rows * getBadgeLevel(player) / 4;
+
+		//only a random target is kept for a while, the others follow the game from attack to attack
+		if (attacker.targeting != TargetRandom || !m_Players[attacker.target].isAlive || attacker.target == player)
+			chooseTarget(player);
+		RoyalePlayer& target = m_Players[attacker.target];
+		const std::uint8_t queuedRows = static_cast<std::uint8_t>(std::min(rows, 255u));
+		if (target.queuedAttacks < RoyalePlayer::maxQueuedAttacks)
+			target.queue[target.queuedAttacks++] = { m_Tick + garbageDelayTicks, queuedRows, static_cast<std::uint8_t>(player) };
+		else {
+			RoyaleAttack& newest = target.queue[RoyalePlayer::maxQueuedAttacks - 1];
+			newest.rows = static_cast<std::uint8_t>(std::min(newest.rows + rows, 255u));
+			newest.from = static_cast<std::uint8_t>(player);
+		}
+	}
+
+	void Royale::chooseTarget(size_t player)
+	{
+		RoyalePlayer& chooser = m_Players[player];
+		size_t target{ playerCount };
+		//candidates are searched from the player on, ties go to whoever comes next after it
+		switch (chooser.targeting)
+		{
+		case TargetKnockouts: {
+			unsigned highest{ 0 };
+			for (size_t offset{ 1 }; offset < playerCount; ++offset) {
+				const size_t candidate = (player + offset) % playerCount;
+				const unsigned danger = m_Players[candidate].isAlive ? getDanger(candidate) : 0;
+				if (m_Players[candidate].isAlive && (target == playerCount || danger > highest)) {
+					target = candidate;
+					highest = danger;
+				}
+			}
+			break;
+		}
+		case TargetAttackers:
+			if (chooser.hasAttacker && m_Players[chooser.lastAttacker].isAlive && m_Players[chooser.lastAttacker].target == player)
+				target = chooser.lastAttacker;
+			for (size_t offset{ 1 }; offset < playerCount && target == playerCount; ++offset) {
+				const size_t candidate = (player + offset) % playerCount;
+				if (m_Players[candidate].isAlive && m_Players[candidate].target == player)
+					target = candidate;
+			}
+			break;
+		case TargetBadges: {
+			std::uint16_t most{ 0 };
+			for (size_t offset{ 1 }; offset < playerCount; ++offset) {
+				const size_t candidate = (player + offset) % playerCount;
+				if (m_Players[candidate].isAlive && m_Players[candidate].badgePoints > most) {
+					target = candidate;
+					most = m_Players[candidate].badgePoints;
+				}
+			}
+			break;
+		}
+		default:
+			break;
+		}
+		if (target == playerCount)
+			target = getRandomOpponent(player);
+		chooser.target = static_cast<std::uint8_t>(target);
+		chooser.retargetTick = m_Tick + retargetTicks;
+	}
+
+	size_t Royale::getRandomOpponent(size_t player)
+	{
+		const size_t opponents = m_AliveCount - (m_Players[player].isAlive ? 1 : 0);
+		if (opponents == 0)
+			return player;
+		size_t skip = nextRandom() % opponents;
+		for (size_t candidate{ 0 }; candidate < playerCount; ++candidate) {
+			if (candidate == player || !m_Players[candidate].isAlive)
+				continue;
+			if (skip == 0)
+				return candidate;
+			skip -= 1;
+		}
+		return player;
+	}
+
+	unsigned Royale::getDanger(size_t player) const
+	{
+		const Blocks::Cells& cells = m_Games[player].getCells();
+		const auto top = std::find_if(cells.begin(), cells.end(), [](Blocks::PieceType cell) { return cell != Blocks::Empty; });
+		const unsigned height = static_cast<unsigned>(Blocks::BlockCountY - (top - cells.begin()) / Blocks::BlockCountX);
+		return height + getIncomingRows(player);
+	}
+
+	void Royale::knockOut(size_t player)
+	{
+		RoyalePlayer& loser = m_Players[player];
+		loser.isAlive = false;
+		loser.placement = static_cast<std::uint8_t>(m_AliveCount);
+		loser.queuedAttacks = 0;
+		m_AliveCount -= 1;
+		if (loser.hasAttacker && m_Players[loser.lastAttacker].isAlive) {
+			RoyalePlayer& winner = m_Players[loser.lastAttacker];
+			winner.knockouts += 1;
+			winner.badgePoints = static_cast<std::uint16_t>(winner.badgePoints + 1 + loser.badgePoints);
+		}
+		if (m_AliveCount == 1)
+			for (auto& last : m_Players)
+				if (last.isAlive)
+					last.placement = 1;
+	}
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Bot.h"
+#include "Scheduler.h"
+#include "Simulation.h"
+
+namespace Rules {
+	//who a player's attacks go to
+	enum Targeting : std::uint8_t
+	{
+		//someone at random, chosen again every few seconds
+		TargetRandom,
+		//whoever is closest to topping out, for the knockout
+		TargetKnockouts,
+		//whoever attacks this player, everyone at random while nobody does
+		TargetAttackers,
+		//whoever has the most badges, to take them with the knockout
+		TargetBadges,
+		TargetingCount
+	};
+
+	//garbage on its way to a player, it can still be cancelled until it is due
+	struct RoyaleAttack
+	{
+		Timing::Tick due;
+		std::uint8_t rows;
+		std::uint8_t from;
+	};
+
+	//one player of a royale, the targeting and garbage around the game
+	struct RoyalePlayer
+	{
+		static constexpr size_t maxQueuedAttacks = 8;
+
+		bool isAlive;
+		bool isBot;
+		Targeting targeting;
+		std::uint8_t target;
+		//attacks are queued oldest first, a full queue adds to its newest attack
+		std::array<RoyaleAttack, maxQueuedAttacks> queue;
+		std::uint8_t queuedAttacks;
+		//garbage of the game that was already sent on
+		std::uint32_t garbageHandled;
+		//whoever sent the garbage that rose last gets the knockout
+		std::uint8_t lastAttacker;
+		bool hasAttacker;
+		Timing::Tick retargetTick;
+		//one per knockout plus the badge points of everyone knocked out
+		std::uint16_t badgePoints;
+		std::uint16_t knockouts;
+		//1 for the winner, 0 while still playing
+		std::uint8_t placement;
+		Bot bot;
+	};
+
+	//99 games against each other, garbage goes to the target each player picks and rises after a delay
+	//every game is stepped every tick, bots play their games in the same step as the garbage is handed around
+	//a plain value like the simulations in it, the same seed and inputs give the same royale on every build
+	class Royale
+	{
+	public:
+		static constexpr size_t playerCount = 99;
+
+		//each player gets a seed of its own from the seed of the royale, all start at startLevel
+		Royale(std::uint32_t seed, unsigned startLevel);
+
+		//every game gets the same table, call before the first advance
+		void setGravityTable(const GravityTable& gravity);
+		//a bot plays the player from the current tick on, its inputs must not be applied from outside any more
+		void setBot(size_t player, const Bot& bot);
+		//bots for firstPlayer and everyone after it, each with a pace of its own and the targetings taken in turn
+		void addBots(size_t firstPlayer);
+		void setTargeting(size_t player, Targeting targeting);
+		//runs every game tick by tick up to lastTick, or until one player is left
+		void advance(Timing::Tick lastTick);
+		//applies an input of a player at the current tick
+		void apply(size_t player, Input input, bool isPressed);
+
+		Timing::Tick getTick()const;
+		bool isOver()const;
+		size_t getAliveCount()const;
+		const Simulation& getGame(size_t player)const;
+		const RoyalePlayer& getPlayer(size_t player)const;
+		//0 to 4, every level adds a quarter to the player's attacks
+		unsigned getBadgeLevel(size_t player)const;
+		//rows of garbage on their way to the player
+		unsigned getIncomingRows(size_t player)const;
+		//players whose target is the player
+		size_t getAttackerCount(size_t player)const;
+		//the checksums of the games and the state around them folded into one
+		std::uint64_t getChecksum()const;
+	private:
+		std::uint32_t nextRandom();
+		void step();
+		void attack(size_t player, unsigned rows);
+		void chooseTarget(size_t player);
+		size_t getRandomOpponent(size_t player);
+		//highest stack plus garbage on its way, the higher the closer to topping out
+		unsigned getDanger(size_t player)const;
+		void knockOut(size_t player);
+
+		std::vector<Simulation> m_Games;
+		std::vector<RoyalePlayer> m_Players;
+		std::uint32_t m_RandomState;
+		Timing::Tick m_Tick;
+		size_t m_AliveCount;
+	};
+}
@@ -0,0 +1,117 @@
+#include "Scheduler.h"
+#include <algorithm>
+
+namespace Timing {
+	Scheduler::Scheduler(size_t timerCount)
+		:m_Generations(timerCount, 0), m_Expiries(timerCount, 0), m_Pending(timerCount, false), m_CurrentTick(0), m_Sequence(0)
+	{
+		//every id keeps at most one live entry, stale ones are rare so this rarely grows
+		m_Heap.reserve(timerCount * 2);
+	}
+
+	bool Scheduler::isLater(const Entry& lhs, const Entry& rhs)
+	{
+		if (lhs.tick != rhs.tick)
+			return lhs.tick > rhs.tick;
+		return lhs.sequence > rhs.sequence;
+	}
+
+	void Scheduler::schedule(size_t id, Tick delay)
+	{
+		scheduleAt(id, m_CurrentTick + delay);
+	}
+
+	void Scheduler::scheduleAt(size_t id, Tick tick)
+	{
+		//invalidate a previous expiry of the same id
+		m_Generations[id] += 1;
+		m_Pending[id] = true;
+		m_Expiries[id] = std::max(tick, m_CurrentTick);
+		m_Heap.push_back({ m_Expiries[id], m_Sequence++, id, m_Generations[id] });
+		std::push_heap(m_Heap.begin(), m_Heap.end(), isLater);
+	}
+
+	void Scheduler::cancel(size_t id)
+	{
+		if (!m_Pending[id])
+			return;
+		m_Generations[id] += 1;
+		m_Pending[id] = false;
+		dropStaleEntries();
+	}
+
+	bool Scheduler::isPending(size_t id) const
+	{
+		return m_Pending[id];
+	}
+
+	Tick Scheduler::getExpiry(size_t id) const
+	{
+		return m_Expiries[id];
+	}
+
+	void Scheduler::dropStaleEntries()
+	{
+		while (!m_Heap.empty() && m_Heap.front().generation != m_Generations[m_Heap.front().id]) {
+			std::pop_heap(m_Heap.begin(), m_Heap.end(), isLater);
+			m_Heap.pop_back();
+		}
+	}
+
+	bool Scheduler::popDue(Tick lastTick, size_t& id)
+	{
+		dropStaleEntries();
+		if (m_Heap.empty() || m_Heap.front().tick > lastTick)
+			return false;
+		std::pop_heap(m_Heap.begin(), m_Heap.end(), isLater);
+		const Entry entry = m_Heap.back();
+		m_Heap.pop_back();
+		m_Pending[entry.id] = false;
+		m_CurrentTick = entry.tick;
+		id = entry.id;
+		return true;
+	}
+
+	void Scheduler::advanceTo(Tick tick)
+	{
+		m_CurrentTick = std::max(m_CurrentTick, tick);
+	}
+
+	Tick Scheduler::getCurrentTick() const
+	{
+		return m_CurrentTick;
+	}
+
+	void Scheduler::cancelAll()
+	{
+		m_Heap.clear();
+		for (size_t id{ 0 }; id < m_Pending.size(); ++id) {
+			m_Generations[id] += 1;
+			m_Pending[id] = false;
+		}
+	}
+
+	void Scheduler::resetTo(Tick tick)
+	{
+		cancelAll();
+		m_CurrentTick = tick;
+	}
+
+	size_t Scheduler::getPendingInFiringOrder(TimerIds& ids) const
+	{
+		//every pending id has one live entry, each is sorted in as it is found
+		std::array<Entry, maxTimers> live;
+		size_t count{ 0 };
+		for (const auto& entry : m_Heap) {
+			if (!m_Pending[entry.id] || entry.generation != m_Generations[entry.id])
+				continue;
+			size_t at{ count++ };
+			for (; at > 0 && isLater(live[at - 1], entry); --at)
+				live[at] = live[at - 1];
+			live[at] = entry;
+		}
+		for (size_t i{ 0 }; i < count; ++i)
+			ids[i] = live[i].id;
+		return count;
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Timing {
+	using Tick = std::uint64_t;
+
+	//simulation runs at a fixed rate independent from the render rate, 4 ticks per 60Hz frame
+	static constexpr unsigned TicksPerSecond = 240;
+
+	constexpr Tick secondsToTicks(float seconds)
+	{
+		return static_cast<Tick>(seconds * TicksPerSecond + 0.5f);
+	}
+
+	constexpr float ticksToSeconds(Tick ticks)
+	{
+		return static_cast<float>(ticks) / TicksPerSecond;
+	}
+
+	//integer conversions, a tick always starts at a whole microsecond count so timestamps map exactly
+	constexpr Tick microsecondsToTicks(std::int64_t microseconds)
+	{
+		return microseconds <= 0 ? 0 : static_cast<Tick>(microseconds) * TicksPerSecond / 1000000;
+	}
+
+	constexpr std::int64_t ticksToMicroseconds(Tick ticks)
+	{
+		return static_cast<std::int64_t>(ticks * 1000000 / TicksPerSecond);
+	}
+
+	//min-heap of timers keyed by simulation tick
+	//every timer id has at most one pending expiry, rescheduling an id replaces the previous one
+	//timers due at the same tick fire in the order they were scheduled, so a run is fully deterministic
+	class Scheduler
+	{
+	public:
+		//the most timer ids a scheduler has, the pending ones are listed without allocating
+		static constexpr size_t maxTimers = 8;
+		using TimerIds = std::array<size_t, maxTimers>;
+
+		//timerCount is at most maxTimers
+		explicit Scheduler(size_t timerCount);
+
+		void schedule(size_t id, Tick delay);
+		void scheduleAt(size_t id, Tick tick);
+		void cancel(size_t id);
+		bool isPending(size_t id)const;
+		Tick getExpiry(size_t id)const;
+
+		//pops the earliest timer due at or before lastTick and moves the current tick to its expiry
+		bool popDue(Tick lastTick, size_t& id);
+		//moves the current tick forward, all timers before it have to be popped already
+		void advanceTo(Tick tick);
+		Tick getCurrentTick()const;
+		//drops every pending timer, the current tick is kept
+		void cancelAll();
+		//drops every pending timer and sets the current tick, also backwards, for restoring a saved state
+		void resetTo(Tick tick);
+		//the first ids are the pending timers in the order they will fire, returns how many, scheduling them again in this order keeps ties intact
+		size_t getPendingInFiringOrder(TimerIds& ids)const;
+	private:
+		struct Entry
+		{
+			Tick tick;
+			std::uint64_t sequence;
+			size_t id;
+			unsigned generation;
+		};
+		static bool isLater(const Entry& lhs, const Entry& rhs);
+		void dropStaleEntries();
+
+		std::vector<Entry> m_Heap;
+		//generation of the pending expiry of every id, heap entries with an older generation are stale
+		std::vector<unsigned> m_Generations;
+		std::vector<Tick> m_Expiries;
+		std::vector<bool> m_Pending;
+		Tick m_CurrentTick;
+		std::uint64_t m_Sequence;
+	};
+}
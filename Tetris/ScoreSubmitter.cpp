@@ -0,0 +1,364 @@
+#include "ScoreSubmitter.h"
+#include <SFML/Network.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include "ByteOrder.h"
+#include "Snapshot.h"
+
+namespace Network {
+	static constexpr char queueMagic[4] = { 'T', 'S', 'C', 'Q' };
+	static constexpr std::uint16_t queueVersion = 1;
+	//magic, version and reserved
+	static constexpr size_t queueHeaderSize = 8;
+	//id, seed, score, lines, level, ticks, replay hash and a 16 bit checksum
+	static constexpr size_t queueRecordSize = 36;
+	//a cabinet offline for months keeps its newest games, the queue file stays below half a megabyte
+	static constexpr size_t maxQueued = 10000;
+	static constexpr size_t maxBatch = 100;
+	//how often the submitter looks for finished games, they are not in a hurry
+	static constexpr std::chrono::milliseconds pollPeriod{ 250 };
+	static const sf::Time connectTimeout = sf::seconds(5);
+	//from the connect to the status line of the answer, an endpoint that takes longer is treated like one that is down
+	static const sf::Time requestTimeout = sf::seconds(15);
+	//how often a request in flight looks whether the submitter is shutting down, the destructor waits at most this long for it
+	static const sf::Time ioPollPeriod = sf::milliseconds(20);
+	static const sf::Time firstRetryDelay = sf::seconds(1);
+	static const sf::Time maxRetryDelay = sf::seconds(300);
+
+	static void encodeRecord(const ScoreSubmission& submission, std::uint8_t* data)
+	{
+		size_t offset{ 0 };
+		Storage::putLittleEndian(data, offset, submission.id);
+		Storage::putLittleEndian(data, offset, submission.seed);
+		Storage::putLittleEndian(data, offset, submission.score);
+		Storage::putLittleEndian(data, offset, submission.lines);
+		Storage::putLittleEndian(data, offset, submission.level);
+		Storage::putLittleEndian(data, offset, submission.ticks);
+		Storage::putLittleEndian(data, offset, submission.replayHash);
+		Storage::putLittleEndian(data, offset, Storage::foldedFnv1a(data, offset));
+	}
+
+	static bool readQueue(const std::string& path, std::vector<ScoreSubmission>& queue)
+	{
+		std::ifstream file(path, std::ios::binary);
+		//no file is an empty queue
+		if (!file)
+			return true;
+		const std::vector<std::uint8_t> bytes{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+		size_t offset{ sizeof(queueMagic) };
+		if (bytes.size() < queueHeaderSize || std::memcmp(bytes.data(), queueMagic, sizeof(queueMagic)) != 0
+			|| Storage::getLittleEndian<std::uint16_t>(bytes.data(), offset) != queueVersion)
+			return false;
+		for (offset = queueHeaderSize; bytes.size() - offset >= queueRecordSize; offset += queueRecordSize) {
+			const std::uint8_t* data = bytes.data() + offset;
+			size_t field{ 0 };
+			ScoreSubmission submission;
+			submission.id = Storage::getLittleEndian<std::uint64_t>(data, field);
+			submission.seed = Storage::getLittleEndian<std::uint32_t>(data, field);
+			submission.score = Storage::getLittleEndian<std::uint32_t>(data, field);
+			submission.lines = Storage::getLittleEndian<std::uint32_t>(data, field);
+			submission.level = Storage::getLittleEndian<std::uint16_t>(data, field);
+			submission.ticks = Storage::getLittleEndian<std::uint32_t>(data, field);
+			submission.replayHash = Storage::getLittleEndian<std::uint64_t>(data, field);
+			if (Storage::getLittleEndian<std::uint16_t>(data, field) != Storage::foldedFnv1a(data, queueRecordSize - sizeof(std::uint16_t)))
+				break;
+			queue.push_back(submission);
+		}
+		return true;
+	}
+
+	//splitmix64, ids only have to differ between cabinets and runs
+	static std::uint64_t nextId(std::uint64_t& state)
+	{
+		std::uint64_t id = state += 0x9e3779b97f4a7c15ull;
+		id = (id ^ (id >> 30)) * 0xbf58476d1ce4e5b9ull;
+		id = (id ^ (id >> 27)) * 0x94d049bb133111ebull;
+		return id ^ (id >> 31);
+	}
+
+	static void writeHex(std::ostream& out, std::uint64_t value)
+	{
+		out << '"' << std::hex << std::setw(16) << std::setfill('0') << value << std::dec << '"';
+	}
+
+	bool parseScoreEndpoint(const std::string& url, ScoreEndpoint& endpoint)
+	{
+		static const std::string scheme{ "http://" };
+		if (url.compare(0, scheme.size(), scheme) != 0)
+			return false;
+		const size_t hostEnd = std::min(url.find_first_of(":/", scheme.size()), url.size());
+		endpoint.host = url.substr(scheme.size(), hostEnd - scheme.size());
+		endpoint.port = 80;
+		size_t pathStart{ hostEnd };
+		if (hostEnd < url.size() && url[hostEnd] == ':') {
+			pathStart = std::min(url.find('/', hostEnd), url.size());
+			const std::string port{ url.substr(hostEnd + 1, pathStart - hostEnd - 1) };
+			if (port.empty() || port.size() > 5 || port.find_first_not_of("0123456789") != std::string::npos || std::stoul(port) > 65535)
+				return false;
+			endpoint.port = static_cast<unsigned short>(std::stoul(port));
+		}
+		endpoint.path = pathStart < url.size() ? url.substr(pathStart) : "/";
+		return !endpoint.host.empty() && endpoint.port != 0;
+	}
+
+	std::string getScoreQueuePath(const std::string& savePath)
+	{
+		return savePath + ".scores";
+	}
+
+	ScoreSubmitter::ScoreSubmitter()
+		:m_Endpoint{ "", 0, "/" }, m_Pending(0), m_IsOpen(false), m_Running(true)
+	{
+	}
+
+	ScoreSubmitter::~ScoreSubmitter()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_WakeMutex);
+			m_Running = false;
+		}
+		m_Wake.notify_one();
+		if (m_Thread.joinable())
+			m_Thread.join();
+	}
+
+	bool ScoreSubmitter::open(const ScoreEndpoint& endpoint, const std::string& queuePath)
+	{
+		//a queue that does not read is kept for a look at it, the new one would replace it
+		if (isOpen() || !readQueue(queuePath, m_Queue))
+			return false;
+		m_Endpoint = endpoint;
+		m_QueuePath = queuePath;
+		m_Pending = m_Queue.size();
+		m_IsOpen = true;
+		m_Thread = std::thread(&ScoreSubmitter::sendLoop, this);
+		return true;
+	}
+
+	bool ScoreSubmitter::isOpen() const
+	{
+		return m_IsOpen;
+	}
+
+	bool ScoreSubmitter::submit(const ScoreSubmission& submission)
+	{
+		if (!isOpen())
+			return false;
+		if (m_Submitted.push(submission))
+			return true;
+		m_Lost.add();
+		return false;
+	}
+
+	std::uint64_t ScoreSubmitter::getQueued() const
+	{
+		return m_Queued.get();
+	}
+
+	std::uint64_t ScoreSubmitter::getPending() const
+	{
+		return m_Pending;
+	}
+
+	std::uint64_t ScoreSubmitter::getAccepted() const
+	{
+		return m_Accepted.get();
+	}
+
+	std::uint64_t ScoreSubmitter::getRejected() const
+	{
+		return m_Rejected.get();
+	}
+
+	std::uint64_t ScoreSubmitter::getDropped() const
+	{
+		return m_Dropped.get();
+	}
+
+	std::uint64_t ScoreSubmitter::getLost() const
+	{
+		return m_Lost.get();
+	}
+
+	std::uint64_t ScoreSubmitter::getRequests() const
+	{
+		return m_Requests.get();
+	}
+
+	std::uint64_t ScoreSubmitter::getFailedRequests() const
+	{
+		return m_FailedRequests.get();
+	}
+
+	void ScoreSubmitter::sendLoop()
+	{
+		std::random_device device;
+		std::uint64_t idState{ (static_cast<std::uint64_t>(device()) << 32) ^ device()
+			^ static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()) };
+		std::mt19937 jitter(device());
+		sf::Clock clock;
+		sf::Time nextAttempt;
+		sf::Time retryDelay{ firstRetryDelay };
+		for (;;) {
+			//what is submitted right before shutdown still makes it into the file
+			const bool isRunning = m_Running;
+			if (takeSubmitted(idState))
+				writeQueue();
+			if (!isRunning)
+				return;
+			bool isSent{ false };
+			if (!m_Queue.empty() && clock.getElapsedTime() >= nextAttempt) {
+				const size_t count = std::min(m_Queue.size(), maxBatch);
+				const SendResult result = sendBatch(count);
+				if (result == SendFailed) {
+					//somewhere between half the delay and all of it, cabinets that lost the endpoint together do not come back together
+					const float share = std::uniform_real_distribution<float>(0.5f, 1.f)(jitter);
+					nextAttempt = clock.getElapsedTime() + retryDelay * share;
+					retryDelay = std::min(retryDelay * 2.f, maxRetryDelay);
+				}
+				else {
+					(result == SendAccepted ? m_Accepted : m_Rejected).add(count);
+					m_Queue.erase(m_Queue.begin(), m_Queue.begin() + count);
+					m_Pending = m_Queue.size();
+					writeQueue();
+					retryDelay = firstRetryDelay;
+					isSent = true;
+				}
+			}
+			//a backlog goes out one batch after the other
+			if (isSent && !m_Queue.empty())
+				continue;
+			std::unique_lock<std::mutex> lock(m_WakeMutex);
+			m_Wake.wait_for(lock, pollPeriod, [this] { return !m_Running; });
+		}
+	}
+
+	bool ScoreSubmitter::takeSubmitted(std::uint64_t& idState)
+	{
+		bool isTaken{ false };
+		ScoreSubmission submission;
+		while (m_Submitted.pop(submission)) {
+			submission.id = nextId(idState);
+			m_Queue.push_back(submission);
+			m_Queued.add();
+			isTaken = true;
+		}
+		if (m_Queue.size() > maxQueued) {
+			m_Dropped.add(m_Queue.size() - maxQueued);
+			m_Queue.erase(m_Queue.begin(), m_Queue.end() - maxQueued);
+		}
+		m_Pending = m_Queue.size();
+		return isTaken;
+	}
+
+	bool ScoreSubmitter::writeQueue() const
+	{
+		//small enough to be written whole, and a whole file is never torn
+		std::vector<std::uint8_t> bytes(queueHeaderSize + m_Queue.size() * queueRecordSize);
+		size_t offset{ 0 };
+		for (char c : queueMagic)
+			Storage::putLittleEndian(bytes.data(), offset, static_cast<std::uint8_t>(c));
+		Storage::putLittleEndian(bytes.data(), offset, queueVersion);
+		for (size_t i{ 0 }; i < m_Queue.size(); ++i)
+			encodeRecord(m_Queue[i], bytes.data() + queueHeaderSize + i * queueRecordSize);
+		return Storage::writeFileAtomically(m_QueuePath, bytes.data(), bytes.size());
+	}
+
+	ScoreSubmitter::SendResult ScoreSubmitter::sendBatch(size_t count)
+	{
+		std::ostringstream body;
+		body << "{\"scores\":[";
+		for (size_t i{ 0 }; i < count; ++i) {
+			const ScoreSubmission& submission = m_Queue[i];
+			body << (i == 0 ? "" : ",") << "{\"id\":";
+			writeHex(body, submission.id);
+			body << ",\"seed\":" << submission.seed << ",\"score\":" << submission.score << ",\"lines\":" << submission.lines
+				<< ",\"level\":" << submission.level << ",\"ticks\":" << submission.ticks << ",\"replay\":";
+			writeHex(body, submission.replayHash);
+			body << '}';
+		}
+		body << "]}";
+
+		m_Requests.add();
+		const int status = post(body.str());
+		if (status >= 200 && status < 300)
+			return SendAccepted;
+		//the endpoint would refuse them again and again, except when it asks to come back later
+		if (status >= 400 && status < 500 && status != sf::Http::Response::Unauthorized && status != 408 && status != 429)
+			return SendRejected;
+		m_FailedRequests.add();
+		return SendFailed;
+	}
+
+	int ScoreSubmitter::post(const std::string& body)
+	{
+		//sf::Http only bounds the connect and then waits for the answer for good, so the request runs on a socket that is polled
+		//the name lookup is the one step that still blocks, it is done before anything is sent
+		const sf::IpAddress address(m_Endpoint.host);
+		if (address == sf::IpAddress::None)
+			return 0;
+		std::ostringstream request;
+		request << "POST " << m_Endpoint.path << " HTTP/1.0\r\nHost: " << m_Endpoint.host << "\r\nContent-Type: application/json\r\n"
+			<< "Content-Length: " << body.size() << "\r\nConnection: close\r\n\r\n" << body;
+		const std::string bytes{ request.str() };
+
+		const sf::Clock clock;
+		const auto isAbandoned = [&](sf::Time timeout) {
+			return !m_Running || clock.getElapsedTime() >= timeout;
+		};
+		sf::TcpSocket socket;
+		socket.setBlocking(false);
+		//a socket that is not blocking only starts connecting, it has a remote address once it is connected
+		const sf::Socket::Status connecting = socket.connect(address, m_Endpoint.port);
+		if (connecting != sf::Socket::Done && connecting != sf::Socket::NotReady)
+			return 0;
+		while (socket.getRemoteAddress() == sf::IpAddress::None) {
+			if (isAbandoned(connectTimeout))
+				return 0;
+			sf::sleep(ioPollPeriod);
+		}
+		for (size_t offset{ 0 }; offset < bytes.size();) {
+			size_t sent{ 0 };
+			const sf::Socket::Status status = socket.send(bytes.data() + offset, bytes.size() - offset, sent);
+			offset += sent;
+			if (status == sf::Socket::Done)
+				break;
+			if (status != sf::Socket::Partial && status != sf::Socket::NotReady)
+				return 0;
+			if (isAbandoned(requestTimeout))
+				return 0;
+			sf::sleep(ioPollPeriod);
+		}
+		//only the status line is read, the rest of the answer goes with the socket
+		sf::SocketSelector selector;
+		selector.add(socket);
+		std::string answer;
+		while (answer.find("\r\n") == std::string::npos) {
+			if (isAbandoned(requestTimeout))
+				return 0;
+			if (!selector.wait(ioPollPeriod))
+				continue;
+			char buffer[512];
+			size_t received{ 0 };
+			const sf::Socket::Status status = socket.receive(buffer, sizeof(buffer), received);
+			if (status == sf::Socket::Done)
+				answer.append(buffer, received);
+			else if (status != sf::Socket::NotReady)
+				break;
+		}
+		//HTTP/1.x 200 OK
+		static const std::string version{ "HTTP/1." };
+		if (answer.compare(0, version.size(), version) != 0 || answer.size() < version.size() + 5 || answer[version.size() + 1] != ' ')
+			return 0;
+		const std::string code{ answer.substr(version.size() + 2, 3) };
+		if (code.find_first_not_of("0123456789") != std::string::npos)
+			return 0;
+		return std::stoi(code);
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Metrics.h"
+#include "SpscQueue.h"
+
+namespace Network {
+	//one finished game as the endpoint gets it
+	struct ScoreSubmission
+	{
+		//random and given by the submitter, the endpoint tells a resent submission from a new one by it
+		std::uint64_t id;
+		std::uint32_t seed;
+		std::uint32_t score;
+		std::uint32_t lines;
+		std::uint16_t level;
+		//how long the game took
+		std::uint32_t ticks;
+		//fnv-1a of the state the game started from and of every input applied in it
+		std::uint64_t replayHash;
+	};
+
+	//where submissions are posted, plain http only
+	struct ScoreEndpoint
+	{
+		std::string host;
+		unsigned short port;
+		std::string path;
+	};
+
+	//http://host[:port][/path], the path is / when there is none
+	bool parseScoreEndpoint(const std::string& url, ScoreEndpoint& endpoint);
+	//the queue kept next to a save, path.scores
+	std::string getScoreQueuePath(const std::string& savePath);
+
+	//posts finished games to an http endpoint on a thread of its own, as many to a request as are waiting
+	//every game is written to the queue file before it is sent and only leaves it once the endpoint answered,
+	//so games finished offline or before a crash go out after the next start
+	//a request that fails is tried again after a delay that doubles up to a few minutes
+	class ScoreSubmitter
+	{
+	public:
+		ScoreSubmitter();
+		//games still queued stay in the file, nothing is sent on the way out and a request in flight is given up
+		~ScoreSubmitter();
+		ScoreSubmitter(const ScoreSubmitter&) = delete;
+		ScoreSubmitter& operator=(const ScoreSubmitter&) = delete;
+
+		//takes over what an earlier run left in the queue at queuePath, call once
+		bool open(const ScoreEndpoint& endpoint, const std::string& queuePath);
+		//any thread
+		bool isOpen()const;
+		//single producer, never blocks, false when the ring is full and the game is lost
+		bool submit(const ScoreSubmission& submission);
+
+		//any thread, all of them count only on the submitter thread except lost
+		std::uint64_t getQueued()const;
+		//games waiting in the queue file
+		std::uint64_t getPending()const;
+		std::uint64_t getAccepted()const;
+		//games the endpoint refused for good, they are not sent again
+		std::uint64_t getRejected()const;
+		//the oldest games are let go when the queue is full
+		std::uint64_t getDropped()const;
+		std::uint64_t getLost()const;
+		std::uint64_t getRequests()const;
+		std::uint64_t getFailedRequests()const;
+	private:
+		enum SendResult
+		{
+			SendAccepted,
+			SendRejected,
+			SendFailed
+		};
+		void sendLoop();
+		//moves the submitted games into the queue, true when there were any
+		bool takeSubmitted(std::uint64_t& idState);
+		bool writeQueue()const;
+		SendResult sendBatch(size_t count);
+		//the http status the endpoint answered with, 0 when it could not be reached, did not answer in time or the submitter is shutting down
+		int post(const std::string& body);
+
+		Concurrency::SpscQueue<ScoreSubmission, 64> m_Submitted;
+		ScoreEndpoint m_Endpoint;
+		std::string m_QueuePath;
+		//only touched by the submitter thread once it runs
+		std::vector<ScoreSubmission> m_Queue;
+		Instrumentation::Counter m_Queued;
+		Instrumentation::Counter m_Accepted;
+		Instrumentation::Counter m_Rejected;
+		Instrumentation::Counter m_Dropped;
+		Instrumentation::Counter m_Lost;
+		Instrumentation::Counter m_Requests;
+		Instrumentation::Counter m_FailedRequests;
+		std::atomic<std::uint64_t> m_Pending;
+		std::atomic<bool> m_IsOpen;
+		std::atomic<bool> m_Running;
+		std::mutex m_WakeMutex;
+		std::condition_variable m_Wake;
+		std::thread m_Thread;
+	};
+}
@@ -0,0 +1,737 @@
+#include "Simulation.h"
+#include <algorithm>
+#include <fstream>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Rules {
+	//all durations in ticks at Timing::TicksPerSecond, nothing is derived from floats at run time
+	//soft drop never falls slower than this, ten times the gravity of level 0
+	static constexpr std::uint32_t softDropGravity = 4550;
+	static constexpr std::uint32_t linesPerLevel = 10;
+	static constexpr Timing::Tick lockDelayTicks = 120;//0.5s
+	static constexpr Timing::Tick autoShiftTicks = 41;//0.17s
+	static constexpr Timing::Tick autoRepeatTicks = 12;//0.05s
+	static constexpr Timing::Tick lineClearTicks = 48;//0.2s
+	static constexpr Timing::Tick entryTicks = 24;//0.1s
+	static constexpr unsigned maxLockResets = 15;
+	static constexpr unsigned scorePerRowSquared = 100;
+	//garbage has no piece type of its own, palettes and saves know the seven pieces only
+	static constexpr Blocks::PieceType garbagePiece = Blocks::Z;
+	static constexpr std::uint32_t garbageSeed = 0x9e3779b9;
+	static const sf::Vector2i spawnOffset{ 4, 0 };
+
+	static constexpr std::uint32_t randomMultiplier = 48271;
+	static constexpr std::uint32_t randomModulus = 2147483647;
+
+	static int countTrailingZeros(std::uint32_t bits)
+	{
+#ifdef _MSC_VER
+		unsigned long index{ 0 };
+		_BitScanForward(&index, bits);
+		return static_cast<int>(index);
+#else
+		return __builtin_ctz(bits);
+#endif
+	}
+
+	Piece getLayout(Blocks::PieceType type)
+	{
+		static const std::array<Piece, Blocks::PieceTypeCount - 1> layouts{ {
+			{ Blocks::I, { { {0, 0}, {1, 0}, {2, 0}, {3, 0} } }, {1, 0} },
+			{ Blocks::L, { { {0, 1}, {1, 1}, {2, 1}, {2, 0} } }, {1, 1} },
+			{ Blocks::S, { { {0, 1}, {1, 1}, {1, 0}, {2, 0} } }, {1, 1} },
+			{ Blocks::J, { { {0, 0}, {0, 1}, {1, 1}, {2, 1} } }, {1, 1} },
+			{ Blocks::T, { { {0, 1}, {1, 1}, {2, 1}, {1, 0} } }, {1, 1} },
+			{ Blocks::Z, { { {0, 0}, {1, 0}, {1, 1}, {2, 1} } }, {1, 1} },
+			{ Blocks::O, { { {1, 0}, {2, 0}, {1, 1}, {2, 1} } }, {1, 1} }
+		} };
+		return layouts[type - Blocks::I];
+	}
+
+	Piece getSpawnPiece(Blocks::PieceType type)
+	{
+		return getMoved(getLayout(type), spawnOffset);
+	}
+
+	bool fits(const Blocks::Cells& cells, const Piece& piece)
+	{
+		for (const auto& cell : piece.cells)
+			if (cell.x < 0 || cell.x >= Blocks::BlockCountX || cell.y < 0 || cell.y >= Blocks::BlockCountY
+				|| cells[cell.y * Blocks::BlockCountX + cell.x] != Blocks::Empty)
+				return false;
+		return true;
+	}
+
+	bool isGrounded(const Blocks::Cells& cells, const Piece& piece)
+	{
+		for (const auto& cell : piece.cells)
+			if (cell.y + 1 == Blocks::BlockCountY || cells[(cell.y + 1) * Blocks::BlockCountX + cell.x] != Blocks::Empty)
+				return true;
+		return false;
+	}
+
+	Piece getMoved(const Piece& piece, sf::Vector2i offset)
+	{
+		Piece moved{ piece };
+		for (auto& cell : moved.cells)
+			cell += offset;
+		moved.rotationCell += offset;
+		return moved;
+	}
+
+	Piece getRotated(const Piece& piece)
+	{
+		Piece rotated{ piece };
+		for (auto& cell : rotated.cells) {
+			const sf::Vector2i offset{ cell - piece.rotationCell };
+			cell = piece.rotationCell + sf::Vector2i{ -offset.y, offset.x };
+		}
+		return rotated;
+	}
+
+	Columns getColumns(const Blocks::Cells& cells)
+	{
+		Columns columns{};
+		for (int y{ 0 }; y < Blocks::BlockCountY; ++y)
+			for (int x{ 0 }; x < Blocks::BlockCountX; ++x)
+				if (cells[y * Blocks::BlockCountX + x] != Blocks::Empty)
+					columns[x] |= 1 << y;
+		return columns;
+	}
+
+	int getDropDistance(const Columns& columns, const Piece& piece)
+	{
+		//the floor counts as an occupied row right below the board, so every column has a stop
+		int distance{ Blocks::BlockCountY };
+		for (const auto& cell : piece.cells) {
+			const std::uint32_t below = (std::uint32_t{ columns[cell.x] } | 1u << Blocks::BlockCountY) >> (cell.y + 1);
+			distance = std::min(distance, countTrailingZeros(below));
+		}
+		return distance;
+	}
+
+	int countFullRows(const Blocks::Cells& cells)
+	{
+		int fullRows{ 0 };
+		for (auto row = cells.begin(); row != cells.end(); row += Blocks::BlockCountX)
+			if (std::find(row, row + Blocks::BlockCountX, Blocks::Empty) == row + Blocks::BlockCountX)
+				fullRows += 1;
+		return fullRows;
+	}
+
+	int clearFullRows(Blocks::Cells& cells)
+	{
+		//bottom up, every row that is not full is copied to the lowest free target row
+		int fullRows{ 0 };
+		int target{ Blocks::BlockCountY - 1 };
+		for (int row{ Blocks::BlockCountY - 1 }; row >= 0; --row) {
+			const auto begin = cells.begin() + row * Blocks::BlockCountX;
+			if (std::find(begin, begin + Blocks::BlockCountX, Blocks::Empty) == begin + Blocks::BlockCountX) {
+				fullRows += 1;
+				continue;
+			}
+			if (target != row)
+				std::copy(begin, begin + Blocks::BlockCountX, cells.begin() + target * Blocks::BlockCountX);
+			target -= 1;
+		}
+		std::fill(cells.begin(), cells.begin() + (target + 1) * Blocks::BlockCountX, Blocks::Empty);
+		return fullRows;
+	}
+
+	bool raiseGarbage(Blocks::Cells& cells, int rows, int holeColumn)
+	{
+		rows = std::min(rows, static_cast<int>(Blocks::BlockCountY));
+		const auto pushedOut = cells.begin() + rows * Blocks::BlockCountX;
+		const bool fits = std::find_if(cells.begin(), pushedOut, [](Blocks::PieceType cell) { return cell != Blocks::Empty; }) == pushedOut;
+		std::copy(pushedOut, cells.end(), cells.begin());
+		for (int y{ Blocks::BlockCountY - rows }; y < Blocks::BlockCountY; ++y)
+			for (int x{ 0 }; x < Blocks::BlockCountX; ++x)
+				cells[y * Blocks::BlockCountX + x] = x == holeColumn ? Blocks::Empty : garbagePiece;
+		return fits;
+	}
+
+	unsigned getAttack(int clearedRows)
+	{
+		static constexpr std::array<unsigned, 5> attacks{ { 0, 0, 1, 2, 4 } };
+		return attacks[std::min(clearedRows, 4)];
+	}
+
+	std::uint32_t getSeededRandomState(std::uint32_t seed)
+	{
+		//the state has to stay in [1, modulus - 1], 0 would repeat forever
+		return seed % (randomModulus - 1) + 1;
+	}
+
+	std::uint32_t getNextRandomState(std::uint32_t state)
+	{
+		return static_cast<std::uint32_t>(std::uint64_t{ state } * randomMultiplier % randomModulus);
+	}
+
+	Blocks::PieceType getPieceOfState(std::uint32_t state)
+	{
+		return static_cast<Blocks::PieceType>(Blocks::I + state % (Blocks::PieceTypeCount - 1));
+	}
+
+	const GravityTable& getDefaultGravityTable()
+	{
+		static const GravityTable table{ {
+			455, 578, 769, 1042, 1440, 2027, 2909, 4257, 6354, 9677,
+			15042, 23871, 38686, 64047, 108356, 187399, floorGravity, floorGravity, floorGravity, floorGravity
+		} };
+		return table;
+	}
+
+	bool loadGravityTable(const std::string& path, GravityTable& table)
+	{
+		std::ifstream file(path);
+		double gravity{ 0.0 };
+		size_t level{ 0 };
+		//floats only here, the table holds whole subcells per tick
+		while (level < levelCount && file >> gravity) {
+			if (gravity <= 0.0)
+				return false;
+			const double subcells = gravity * subcellsPerCell * 60 / Timing::TicksPerSecond + 0.5;
+			table[level++] = subcells >= floorGravity ? floorGravity : std::max(static_cast<std::uint32_t>(subcells), std::uint32_t{ 1 });
+		}
+		if (level == 0)
+			return false;
+		std::fill(table.begin() + level, table.end(), table[level - 1]);
+		return true;
+	}
+
+	Simulation::Simulation(std::uint32_t seed)
+		:m_Scheduler(TimerCount), m_Cells{}, m_Columns{}, m_Gravity(getDefaultGravityTable()), m_StartLevel(0), m_Level(0), m_Lines(0), m_Score(0),
+		m_RandomState(getSeededRandomState(seed)), m_GarbageRandomState(getSeededRandomState(seed ^ garbageSeed)),
+		m_PendingGarbage(0), m_GarbageSent(0), m_TopOuts(0), m_GameStart(0), m_LastGame{}, m_LastLock{},
+		m_Current{}, m_Next(Blocks::Empty), m_PieceIsActive(false), m_SoftDrop(false), m_RotateIsReleased(true), m_ShiftDirection(0),
+		m_LockResets(0), m_LowestRow(0), m_GravityProgress(0), m_GravityTick(0), m_HasLocked(false)
+	{
+		newGame();
+	}
+
+	bool Simulation::advance(Timing::Tick lastTick)
+	{
+		//an input that locked the piece is reported by the next advance
+		if (m_HasLocked) {
+			m_HasLocked = false;
+			return true;
+		}
+		size_t timer{};
+		while (m_Scheduler.popDue(lastTick, timer)) {
+			onTimer(timer);
+			if (m_HasLocked) {
+				m_HasLocked = false;
+				return true;
+			}
+		}
+		m_Scheduler.advanceTo(lastTick);
+		return false;
+	}
+
+	void Simulation::apply(Input input, bool isPressed)
+	{
+		switch (input)
+		{
+		case MoveLeft:
+			if (isPressed)
+				startShift(-1);
+			else
+				stopShift(-1);
+			break;
+		case MoveRight:
+			if (isPressed)
+				startShift(1);
+			else
+				stopShift(1);
+			break;
+		case Rotate:
+			if (!isPressed)
+				m_RotateIsReleased = true;
+			else if (!m_SoftDrop && m_RotateIsReleased) {
+				m_RotateIsReleased = false;
+				const Piece rotated{ getRotated(m_Current) };
+				if (m_PieceIsActive && fits(m_Cells, rotated)) {
+					m_Current = rotated;
+					onPieceMoved();
+				}
+			}
+			break;
+		case SoftDrop:
+			//soft drop lasts until the piece locks
+			if (isPressed)
+				startSoftDrop();
+			break;
+		default:
+			break;
+		}
+	}
+
+	void Simulation::releaseInputs()
+	{
+		stopShift(m_ShiftDirection);
+		m_RotateIsReleased = true;
+	}
+
+	void Simulation::setStartLevel(unsigned level)
+	{
+		m_StartLevel = level;
+		if (m_Level >= level)
+			return;
+		//gravity so far still counts at the old speed
+		const bool isFalling = m_Scheduler.isPending(Gravity);
+		if (isFalling)
+			accumulateGravity();
+		m_Level = level;
+		if (isFalling)
+			scheduleGravity();
+		if (m_PieceIsActive)
+			onPieceMoved();
+	}
+
+	void Simulation::setGravityTable(const GravityTable& gravity)
+	{
+		const bool isFalling = m_Scheduler.isPending(Gravity);
+		if (isFalling)
+			accumulateGravity();
+		m_Gravity = gravity;
+		if (isFalling)
+			scheduleGravity();
+		if (m_PieceIsActive)
+			onPieceMoved();
+	}
+
+	void Simulation::addGarbage(unsigned rows)
+	{
+		m_PendingGarbage = std::min(m_PendingGarbage + rows, static_cast<unsigned>(Blocks::BlockCountY));
+	}
+
+	Timing::Tick Simulation::getTick() const
+	{
+		return m_Scheduler.getCurrentTick();
+	}
+
+	unsigned Simulation::getStartLevel() const
+	{
+		return m_StartLevel;
+	}
+
+	const GravityTable& Simulation::getGravityTable() const
+	{
+		return m_Gravity;
+	}
+
+	unsigned Simulation::getLevel() const
+	{
+		return m_Level;
+	}
+
+	std::uint32_t Simulation::getLines() const
+	{
+		return m_Lines;
+	}
+
+	std::uint32_t Simulation::getGarbageSent() const
+	{
+		return m_GarbageSent;
+	}
+
+	unsigned Simulation::getTopOuts() const
+	{
+		return m_TopOuts;
+	}
+
+	const GameResult& Simulation::getLastGame() const
+	{
+		return m_LastGame;
+	}
+
+	const LockedPiece& Simulation::getLastLock() const
+	{
+		return m_LastLock;
+	}
+
+	const Blocks::Cells& Simulation::getCells() const
+	{
+		return m_Cells;
+	}
+
+	std::uint32_t Simulation::getScore() const
+	{
+		return m_Score;
+	}
+
+	bool Simulation::isPieceActive() const
+	{
+		return m_PieceIsActive;
+	}
+
+	const Piece& Simulation::getCurrentPiece() const
+	{
+		return m_Current;
+	}
+
+	Blocks::PieceType Simulation::getNextPiece() const
+	{
+		return m_Next;
+	}
+
+	Storage::Snapshot Simulation::takeSnapshot() const
+	{
+		Storage::Snapshot snapshot;
+		snapshot.tick = m_Scheduler.getCurrentTick();
+		snapshot.journalSequence = 0;
+		snapshot.score = m_Score;
+		snapshot.randomState = m_RandomState;
+		snapshot.cells = m_Cells;
+		snapshot.current = m_Current.type;
+		snapshot.next = m_Next;
+		snapshot.hold = Blocks::Empty;
+		snapshot.currentCells = m_Current.cells;
+		snapshot.currentRotationCell = m_Current.rotationCell;
+		snapshot.blockIsActive = m_PieceIsActive;
+		snapshot.softDrop = m_SoftDrop;
+		snapshot.spaceIsReleased = m_RotateIsReleased;
+		snapshot.shiftDirection = static_cast<std::int8_t>(m_ShiftDirection);
+		snapshot.lockResets = static_cast<std::uint8_t>(m_LockResets);
+		//the progress a pending gravity timer has made so far, without one it is left over from the last piece and means nothing
+		std::uint32_t gravityProgress{ 0 };
+		if (m_Scheduler.isPending(Gravity))
+			gravityProgress = m_GravityProgress + getGravity() * static_cast<std::uint32_t>(snapshot.tick - m_GravityTick);
+		snapshot.gravityProgress = static_cast<std::uint16_t>(gravityProgress);
+		snapshot.level = static_cast<std::uint16_t>(m_Level);
+		snapshot.lines = m_Lines;
+		snapshot.lowestRow = static_cast<std::int8_t>(m_LowestRow);
+		snapshot.pendingGarbage = static_cast<std::uint8_t>(m_PendingGarbage);
+		snapshot.garbageRandomState = m_GarbageRandomState;
+		snapshot.garbageSent = m_GarbageSent;
+		snapshot.topOuts = static_cast<std::uint16_t>(m_TopOuts);
+		static_assert(TimerCount <= Timing::Scheduler::maxTimers && TimerCount <= Storage::maxSnapshotTimers, "every timer has to fit a snapshot");
+		//taken on every lock, the pending timers are listed without allocating
+		Timing::Scheduler::TimerIds timers;
+		snapshot.timerCount = static_cast<std::uint8_t>(m_Scheduler.getPendingInFiringOrder(timers));
+		for (size_t i{ 0 }; i < snapshot.timerCount; ++i) {
+			snapshot.timerIds[i] = static_cast<std::uint8_t>(timers[i]);
+			snapshot.timerTicksLeft[i] = static_cast<std::uint32_t>(m_Scheduler.getExpiry(timers[i]) - snapshot.tick);
+		}
+		return snapshot;
+	}
+
+	bool Simulation::restoreSnapshot(const Storage::Snapshot& snapshot)
+	{
+		for (const auto& cell : snapshot.currentCells)
+			if (cell.x < 0 || cell.x >= Blocks::BlockCountX || cell.y < 0 || cell.y >= Blocks::BlockCountY)
+				return false;
+		for (std::uint8_t i{ 0 }; i < snapshot.timerCount; ++i)
+			if (snapshot.timerIds[i] >= TimerCount)
+				return false;
+		m_Cells = snapshot.cells;
+		m_Columns = getColumns(m_Cells);
+		m_Level = snapshot.level;
+		m_Lines = snapshot.lines;
+		m_Score = snapshot.score;
+		m_RandomState = snapshot.randomState == 0 || snapshot.randomState >= randomModulus ? 1 : snapshot.randomState;
+		m_GarbageRandomState = snapshot.garbageRandomState == 0 || snapshot.garbageRandomState >= randomModulus ? 1 : snapshot.garbageRandomState;
+		m_PendingGarbage = std::min<unsigned>(snapshot.pendingGarbage, Blocks::BlockCountY);
+		m_GarbageSent = snapshot.garbageSent;
+		//a rewind within the game keeps its start
+		if (snapshot.topOuts != m_TopOuts || snapshot.tick < m_GameStart)
+			m_GameStart = snapshot.tick;
+		m_TopOuts = snapshot.topOuts;
+		m_Current = { snapshot.current, snapshot.currentCells, snapshot.currentRotationCell };
+		m_Next = snapshot.next;
+		m_PieceIsActive = snapshot.blockIsActive;
+		m_SoftDrop = snapshot.softDrop;
+		m_RotateIsReleased = snapshot.spaceIsReleased;
+		m_ShiftDirection = snapshot.shiftDirection;
+		m_LockResets = snapshot.lockResets;
+		m_LowestRow = std::max<int>(snapshot.lowestRow, snapshot.currentRotationCell.y);
+		m_GravityProgress = snapshot.gravityProgress;
+		m_GravityTick = snapshot.tick;
+		m_HasLocked = false;
+		//scheduling in firing order keeps timers that are due at the same tick in their order
+		m_Scheduler.resetTo(snapshot.tick);
+		for (std::uint8_t i{ 0 }; i < snapshot.timerCount; ++i)
+			m_Scheduler.scheduleAt(snapshot.timerIds[i], snapshot.tick + snapshot.timerTicksLeft[i]);
+		return true;
+	}
+
+	std::uint64_t Simulation::getChecksum() const
+	{
+		Storage::SnapshotBuffer buffer;
+		const size_t size = Storage::encodeSnapshot(takeSnapshot(), buffer);
+		//fnv-1a
+		std::uint64_t hash{ 14695981039346656037ull };
+		for (size_t i{ 0 }; i < size; ++i)
+			hash = (hash ^ buffer[i]) * 1099511628211ull;
+		return hash;
+	}
+
+	std::uint32_t Simulation::getGravity() const
+	{
+		const std::uint32_t gravity = m_Gravity[std::min<size_t>(m_Level, levelCount - 1)];
+		return m_SoftDrop ? std::max(gravity, softDropGravity) : gravity;
+	}
+
+	void Simulation::newGame()
+	{
+		m_Cells.fill(Blocks::Empty);
+		m_Columns = {};
+		m_Level = m_StartLevel;
+		m_Lines = 0;
+		m_PendingGarbage = 0;
+		m_Score = 0;
+		m_Scheduler.cancelAll();
+		m_SoftDrop = false;
+		m_ShiftDirection = 0;
+		m_LockResets = 0;
+		m_RandomState = getNextRandomState(m_RandomState);
+		m_Current = getSpawnPiece(getPieceOfState(m_RandomState));
+		m_RandomState = getNextRandomState(m_RandomState);
+		m_Next = getPieceOfState(m_RandomState);
+		m_PieceIsActive = true;
+		m_LowestRow = m_Current.rotationCell.y;
+		m_GravityProgress = 0;
+		scheduleGravity();
+		onPieceMoved();
+	}
+
+	void Simulation::onTimer(size_t timer)
+	{
+		switch (timer)
+		{
+		case Gravity:
+			applyGravity();
+			break;
+		case LockDelay:
+			lockPiece();
+			break;
+		case AutoShift:
+		case AutoRepeat:
+			shiftPiece();
+			m_Scheduler.schedule(AutoRepeat, autoRepeatTicks);
+			break;
+		case LineClear: {
+			const std::uint32_t rows = static_cast<std::uint32_t>(clearFullRows(m_Cells));
+			m_Columns = getColumns(m_Cells);
+			m_Score += rows * rows * scorePerRowSquared;
+			m_Lines += rows;
+			//an attack cancels garbage that is still waiting first
+			const unsigned attack = getAttack(static_cast<int>(rows));
+			const unsigned cancelled = std::min(attack, m_PendingGarbage);
+			m_PendingGarbage -= cancelled;
+			m_GarbageSent += attack - cancelled;
+			m_Level = std::max(m_Level, static_cast<unsigned>(m_Lines / linesPerLevel));
+			m_Scheduler.schedule(Entry, entryTicks);
+			break;
+		}
+		case Entry:
+			spawnPiece();
+			break;
+		}
+	}
+
+	void Simulation::applyGravity()
+	{
+		accumulateGravity();
+		const std::uint32_t cells = m_GravityProgress / subcellsPerCell;
+		m_GravityProgress %= subcellsPerCell;
+		//a timer restored from a save of whole cell gravity can fire short of a cell
+		if (cells == 0) {
+			scheduleGravity();
+			return;
+		}
+		const int distance = getDropDistance(m_Columns, m_Current);
+		if (distance > 0)
+			fall(std::min(static_cast<int>(cells), distance));
+		else if (m_SoftDrop) {
+			//soft drop locks on the first step that hits the ground
+			lockPiece();
+			return;
+		}
+		else if (!m_Scheduler.isPending(LockDelay))
+			startLockDelay();
+		if (m_PieceIsActive)
+			scheduleGravity();
+	}
+
+	void Simulation::accumulateGravity()
+	{
+		const Timing::Tick tick = m_Scheduler.getCurrentTick();
+		m_GravityProgress += getGravity() * static_cast<std::uint32_t>(tick - m_GravityTick);
+		m_GravityTick = tick;
+	}
+
+	void Simulation::scheduleGravity()
+	{
+		//the first tick at which the progress reaches the next whole cell
+		const std::uint32_t gravity = getGravity();
+		m_GravityTick = m_Scheduler.getCurrentTick();
+		//at 20G the piece follows the floor on every move, nothing is left to fall over time
+		if (gravity >= floorGravity) {
+			m_Scheduler.cancel(Gravity);
+			return;
+		}
+		m_Scheduler.schedule(Gravity, (subcellsPerCell - m_GravityProgress + gravity - 1) / gravity);
+	}
+
+	void Simulation::onPieceMoved()
+	{
+		if (getGravity() >= floorGravity) {
+			const int distance = getDropDistance(m_Columns, m_Current);
+			if (distance > 0) {
+				fall(distance);
+				return;
+			}
+		}
+		const bool isLocking = m_Scheduler.isPending(LockDelay);
+		if (!isGrounded(m_Cells, m_Current)) {
+			//stepping off the ground uses up a reset as well, or rotating on the spot would never lock
+			if (isLocking) {
+				m_Scheduler.cancel(LockDelay);
+				m_LockResets += 1;
+			}
+		}
+		else if (!isLocking)
+			startLockDelay();
+		else if (m_LockResets < maxLockResets) {
+			//moving on the ground postpones the lock a limited number of times
+			m_LockResets += 1;
+			m_Scheduler.schedule(LockDelay, lockDelayTicks);
+		}
+	}
+
+	void Simulation::fall(int rows)
+	{
+		//a falling piece is not locking, landing starts the delay again
+		m_Scheduler.cancel(LockDelay);
+		m_Current = getMoved(m_Current, { 0, rows });
+		if (m_Current.rotationCell.y > m_LowestRow) {
+			m_LowestRow = m_Current.rotationCell.y;
+			m_LockResets = 0;
+		}
+		if (isGrounded(m_Cells, m_Current))
+			startLockDelay();
+	}
+
+	void Simulation::startLockDelay()
+	{
+		//a piece that used up its resets in the air locks as soon as it lands again
+		if (m_LockResets >= maxLockResets)
+			lockPiece();
+		else
+			m_Scheduler.schedule(LockDelay, lockDelayTicks);
+	}
+
+	void Simulation::lockPiece()
+	{
+		if (!m_PieceIsActive || !isGrounded(m_Cells, m_Current))
+			return;
+		m_Scheduler.cancel(Gravity);
+		m_Scheduler.cancel(LockDelay);
+		m_LastLock = { m_Current, m_Columns, m_RandomState };
+		bool isGameOver{ false };
+		for (const auto& cell : m_Current.cells) {
+			m_Cells[cell.y * Blocks::BlockCountX + cell.x] = m_Current.type;
+			m_Columns[cell.x] |= 1 << cell.y;
+			isGameOver = isGameOver || cell.y == 0;
+		}
+		m_PieceIsActive = false;
+		m_HasLocked = true;
+		if (isGameOver)
+			topOut();
+		else if (countFullRows(m_Cells) > 0)
+			m_Scheduler.schedule(LineClear, lineClearTicks);
+		else if (m_PendingGarbage > 0) {
+			m_GarbageRandomState = getNextRandomState(m_GarbageRandomState);
+			const bool fits = raiseGarbage(m_Cells, static_cast<int>(m_PendingGarbage), static_cast<int>(m_GarbageRandomState % Blocks::BlockCountX));
+			m_Columns = getColumns(m_Cells);
+			m_PendingGarbage = 0;
+			if (fits)
+				m_Scheduler.schedule(Entry, entryTicks);
+			else
+				topOut();
+		}
+		else
+			m_Scheduler.schedule(Entry, entryTicks);
+	}
+
+	void Simulation::topOut()
+	{
+		m_LastGame = { m_Score, m_Lines, m_Level, m_GameStart, getTick() };
+		m_TopOuts += 1;
+		m_GameStart = getTick();
+		newGame();
+	}
+
+	void Simulation::spawnPiece()
+	{
+		m_Current = getSpawnPiece(m_Next);
+		m_RandomState = getNextRandomState(m_RandomState);
+		m_Next = getPieceOfState(m_RandomState);
+		m_SoftDrop = false;
+		m_LockResets = 0;
+		if (!fits(m_Cells, m_Current)) {
+			topOut();
+			return;
+		}
+		m_PieceIsActive = true;
+		m_LowestRow = m_Current.rotationCell.y;
+		m_GravityProgress = 0;
+		scheduleGravity();
+		onPieceMoved();
+	}
+
+	void Simulation::shiftPiece()
+	{
+		if (!m_PieceIsActive || m_SoftDrop)
+			return;
+		if (m_ShiftDirection != 0 && tryMove({ m_ShiftDirection, 0 }))
+			onPieceMoved();
+	}
+
+	void Simulation::startShift(int direction)
+	{
+		//delayed auto shift: one move now, repeats start after autoShiftTicks
+		m_ShiftDirection = direction;
+		shiftPiece();
+		m_Scheduler.cancel(AutoRepeat);
+		m_Scheduler.schedule(AutoShift, autoShiftTicks);
+	}
+
+	void Simulation::stopShift(int direction)
+	{
+		if (m_ShiftDirection != direction)
+			return;
+		m_ShiftDirection = 0;
+		m_Scheduler.cancel(AutoShift);
+		m_Scheduler.cancel(AutoRepeat);
+	}
+
+	void Simulation::startSoftDrop()
+	{
+		if (!m_PieceIsActive || m_SoftDrop)
+			return;
+		//at 20G the piece is on the floor already, soft drop locks it right away
+		if (getGravity() >= floorGravity) {
+			m_SoftDrop = true;
+			lockPiece();
+			return;
+		}
+		//the part of a cell fallen so far is kept, the rest falls at the soft drop speed
+		accumulateGravity();
+		m_SoftDrop = true;
+		scheduleGravity();
+	}
+
+	bool Simulation::tryMove(sf::Vector2i offset)
+	{
+		const Piece moved{ getMoved(m_Current, offset) };
+		if (!fits(m_Cells, moved))
+			return false;
+		m_Current = moved;
+		return true;
+	}
+}
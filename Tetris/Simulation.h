@@ -0,0 +1,201 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "Board.h"
+#include "Scheduler.h"
+#include "Snapshot.h"
+
+namespace Rules {
+	//what the player can do, independent from the keys that trigger it
+	enum Input : std::uint8_t
+	{
+		MoveLeft,
+		MoveRight,
+		Rotate,
+		SoftDrop,
+		InputCount
+	};
+
+	//gravity is counted in 1/65536 of a cell per tick, so fractions of a cell add up exactly
+	static constexpr std::uint32_t subcellsPerCell = 65536;
+	//20G, twenty cells per 60Hz frame, at and above it a piece sits on the floor from the tick it spawns
+	static constexpr std::uint32_t floorGravity = 20 * subcellsPerCell * 60 / Timing::TicksPerSecond;
+	static constexpr size_t levelCount = 20;
+	//gravity of every level in subcells per tick, levels past the last keep its gravity
+	using GravityTable = std::array<std::uint32_t, levelCount>;
+	//occupied rows of every board column as bits, bit y is row y
+	using Columns = std::array<std::uint16_t, Blocks::BlockCountX>;
+
+	//a piece on the board, in cells
+	struct Piece
+	{
+		Blocks::PieceType type;
+		std::array<sf::Vector2i, 4> cells;
+		sf::Vector2i rotationCell;
+	};
+
+	//board rules on their own, used by the simulation and by the benchmarks
+	//the layout of a piece type with its top left cell at 0, 0
+	Piece getLayout(Blocks::PieceType type);
+	Piece getSpawnPiece(Blocks::PieceType type);
+	bool fits(const Blocks::Cells& cells, const Piece& piece);
+	bool isGrounded(const Blocks::Cells& cells, const Piece& piece);
+	Piece getMoved(const Piece& piece, sf::Vector2i offset);
+	//a quarter turn around the rotation cell
+	Piece getRotated(const Piece& piece);
+	Columns getColumns(const Blocks::Cells& cells);
+	//how many cells the piece can fall, a few bit operations per piece cell whatever the distance
+	int getDropDistance(const Columns& columns, const Piece& piece);
+	int countFullRows(const Blocks::Cells& cells);
+	//compacts the rows that are not full towards the bottom and returns how many were removed
+	int clearFullRows(Blocks::Cells& cells);
+	//pushes the board up and fills the bottom rows except one hole column
+	//returns false when occupied cells were pushed out at the top
+	bool raiseGarbage(Blocks::Cells& cells, int rows, int holeColumn);
+	//garbage rows a clear of that many rows sends to the opponent
+	unsigned getAttack(int clearedRows);
+	//minstd_rand written out, the same sequence with every compiler and standard library
+	std::uint32_t getSeededRandomState(std::uint32_t seed);
+	std::uint32_t getNextRandomState(std::uint32_t state);
+	Blocks::PieceType getPieceOfState(std::uint32_t state);
+	//level 0 keeps the old 0.6s per cell, then the guideline curve, 20G from level 16
+	const GravityTable& getDefaultGravityTable();
+	//one gravity per line in G, cells per 60Hz frame, missing levels repeat the last line
+	bool loadGravityTable(const std::string& path, GravityTable& table);
+
+	//how a game ended, in ticks of the simulation it was played in
+	struct GameResult
+	{
+		std::uint32_t score;
+		std::uint32_t lines;
+		unsigned level;
+		Timing::Tick startTick;
+		Timing::Tick endTick;
+	};
+
+	//the piece that locked last and what it locked onto, kept through the top out it may have caused
+	struct LockedPiece
+	{
+		Piece piece;
+		//the board before the piece was added
+		Columns board;
+		//the state the next piece came from, the pieces after it follow from it
+		std::uint32_t randomState;
+	};
+
+	//the whole game without window, textures or clocks
+	//integers only and a plain value, so a copy runs on and the same seed and inputs give the same game on every build
+	class Simulation
+	{
+	public:
+		explicit Simulation(std::uint32_t seed);
+
+		//runs the timers due up to lastTick
+		//stops right after a piece locked and returns true, call again to go on to lastTick
+		bool advance(Timing::Tick lastTick);
+		//applies an input at the current tick
+		void apply(Input input, bool isPressed);
+		//held inputs are not part of the game once it continues in another session
+		void releaseInputs();
+		//the level every new game starts at, the current game continues at it when it has not passed it yet
+		void setStartLevel(unsigned level);
+		//replaces the default gravity of every level
+		void setGravityTable(const GravityTable& gravity);
+		unsigned getStartLevel()const;
+		const GravityTable& getGravityTable()const;
+		//garbage from the opponent, it rises under the board with the next lock that clears nothing
+		void addGarbage(unsigned rows);
+
+		Timing::Tick getTick()const;
+		const Blocks::Cells& getCells()const;
+		std::uint32_t getScore()const;
+		unsigned getLevel()const;
+		std::uint32_t getLines()const;
+		//garbage rows sent to the opponent since the simulation was created, never goes back
+		std::uint32_t getGarbageSent()const;
+		//games lost since the simulation was created
+		unsigned getTopOuts()const;
+		//the game that topped out last, all zero before the first one
+		//not part of a snapshot, a game restored from another one counts from the tick it was restored at
+		const GameResult& getLastGame()const;
+		//all zero before the first lock, not part of a snapshot either
+		const LockedPiece& getLastLock()const;
+		bool isPieceActive()const;
+		const Piece& getCurrentPiece()const;
+		Blocks::PieceType getNextPiece()const;
+
+		//journalSequence is left at 0, it belongs to whoever journals the inputs
+		Storage::Snapshot takeSnapshot()const;
+		//rejects snapshots that do not fit this board or timer set and leaves the simulation untouched then
+		bool restoreSnapshot(const Storage::Snapshot& snapshot);
+		//hash of the encoded state, equal on every build for the same game
+		std::uint64_t getChecksum()const;
+	private:
+		enum Timer : size_t
+		{
+			Gravity,
+			LockDelay,
+			AutoShift,
+			AutoRepeat,
+			LineClear,
+			Entry,
+			TimerCount
+		};
+		std::uint32_t getGravity()const;
+		void newGame();
+		void topOut();
+		void onTimer(size_t timer);
+		void applyGravity();
+		//gravity progress up to the current tick
+		void accumulateGravity();
+		void scheduleGravity();
+		//moves the piece rows down, it must fit there
+		void fall(int rows);
+		void startLockDelay();
+		void lockPiece();
+		void spawnPiece();
+		void shiftPiece();
+		void startShift(int direction);
+		void stopShift(int direction);
+		void startSoftDrop();
+		void onPieceMoved();
+		bool tryMove(sf::Vector2i offset);
+
+		Timing::Scheduler m_Scheduler;
+		Blocks::Cells m_Cells;
+		//m_Cells as column bits, kept in step with it for the drop distance
+		Columns m_Columns;
+		GravityTable m_Gravity;
+		unsigned m_StartLevel;
+		unsigned m_Level;
+		std::uint32_t m_Lines;
+		std::uint32_t m_Score;
+		std::uint32_t m_RandomState;
+		//its own sequence, garbage must not change which pieces come
+		std::uint32_t m_GarbageRandomState;
+		unsigned m_PendingGarbage;
+		std::uint32_t m_GarbageSent;
+		unsigned m_TopOuts;
+		Timing::Tick m_GameStart;
+		GameResult m_LastGame;
+		LockedPiece m_LastLock;
+		Piece m_Current;
+		Blocks::PieceType m_Next;
+		bool m_PieceIsActive;
+		bool m_SoftDrop;
+		bool m_RotateIsReleased;
+		int m_ShiftDirection;
+		unsigned m_LockResets;
+		//reaching a row below this one gives the piece its lock resets back
+		int m_LowestRow;
+		//subcells fallen since the last whole cell, as of m_GravityTick
+		std::uint32_t m_GravityProgress;
+		Timing::Tick m_GravityTick;
+		//set by a lock, advance returns there
+		bool m_HasLocked;
+	};
+}
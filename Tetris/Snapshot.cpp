@@ -0,0 +1,254 @@
+#include "Snapshot.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include "ByteOrder.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Storage {
+	static constexpr char snapshotMagic[4] = { 'T', 'S', 'A', 'V' };
+	static constexpr std::uint16_t snapshotVersion = 5;
+	static constexpr std::uint8_t blockIsActiveFlag = 1;
+	static constexpr std::uint8_t softDropFlag = 2;
+	static constexpr std::uint8_t spaceIsReleasedFlag = 4;
+	//how long the writer sleeps when a wakeup got lost between its check and its wait
+	static constexpr std::chrono::milliseconds writerPollPeriod{ 100 };
+
+	//field by field, the layout does not depend on the compiler's struct padding
+	size_t encodeSnapshot(const Snapshot& snapshot, SnapshotBuffer& buffer)
+	{
+		size_t offset{ 0 };
+		for (char c : snapshotMagic)
+			putLittleEndian(buffer.data(), offset, static_cast<std::uint8_t>(c));
+		putLittleEndian(buffer.data(), offset, snapshotVersion);
+		putLittleEndian(buffer.data(), offset, static_cast<std::uint8_t>((snapshot.blockIsActive ? blockIsActiveFlag : 0)
+			| (snapshot.softDrop ? softDropFlag : 0) | (snapshot.spaceIsReleased ? spaceIsReleasedFlag : 0)));
+		putLittleEndian(buffer.data(), offset, snapshot.shiftDirection);
+		putLittleEndian(buffer.data(), offset, snapshot.tick);
+		putLittleEndian(buffer.data(), offset, snapshot.journalSequence);
+		putLittleEndian(buffer.data(), offset, snapshot.score);
+		putLittleEndian(buffer.data(), offset, snapshot.randomState);
+		putLittleEndian(buffer.data(), offset, static_cast<std::uint8_t>(snapshot.current));
+		putLittleEndian(buffer.data(), offset, static_cast<std::uint8_t>(snapshot.next));
+		putLittleEndian(buffer.data(), offset, static_cast<std::uint8_t>(snapshot.hold));
+		putLittleEndian(buffer.data(), offset, snapshot.lockResets);
+		putLittleEndian(buffer.data(), offset, snapshot.gravityProgress);
+		putLittleEndian(buffer.data(), offset, snapshot.level);
+		putLittleEndian(buffer.data(), offset, snapshot.lines);
+		putLittleEndian(buffer.data(), offset, snapshot.lowestRow);
+		putLittleEndian(buffer.data(), offset, snapshot.pendingGarbage);
+		putLittleEndian(buffer.data(), offset, snapshot.garbageRandomState);
+		putLittleEndian(buffer.data(), offset, snapshot.garbageSent);
+		putLittleEndian(buffer.data(), offset, snapshot.topOuts);
+		for (const auto& cell : snapshot.currentCells) {
+			putLittleEndian(buffer.data(), offset, static_cast<std::int8_t>(cell.x));
+			putLittleEndian(buffer.data(), offset, static_cast<std::int8_t>(cell.y));
+		}
+		putLittleEndian(buffer.data(), offset, static_cast<std::int8_t>(snapshot.currentRotationCell.x));
+		putLittleEndian(buffer.data(), offset, static_cast<std::int8_t>(snapshot.currentRotationCell.y));
+		putLittleEndian(buffer.data(), offset, snapshot.timerCount);
+		for (std::uint8_t i{ 0 }; i < snapshot.timerCount; ++i) {
+			putLittleEndian(buffer.data(), offset, snapshot.timerIds[i]);
+			putLittleEndian(buffer.data(), offset, snapshot.timerTicksLeft[i]);
+		}
+		//one occupancy mask per row, then the type of every occupied cell in 4 bits
+		for (int y{ 0 }; y < Blocks::BlockCountY; ++y) {
+			std::uint16_t mask{ 0 };
+			for (int x{ 0 }; x < Blocks::BlockCountX; ++x)
+				if (snapshot.cells[y * Blocks::BlockCountX + x] != Blocks::Empty)
+					mask |= 1 << x;
+			putLittleEndian(buffer.data(), offset, mask);
+		}
+		bool isLowNibble{ true };
+		for (const auto cell : snapshot.cells) {
+			if (cell == Blocks::Empty)
+				continue;
+			if (isLowNibble)
+				buffer[offset] = cell;
+			else
+				buffer[offset++] |= cell << 4;
+			isLowNibble = !isLowNibble;
+		}
+		if (!isLowNibble)
+			offset += 1;
+		putLittleEndian(buffer.data(), offset, fnv1a(buffer.data(), offset));
+		return offset;
+	}
+
+	bool decodeSnapshot(const std::uint8_t* data, size_t size, Snapshot& snapshot)
+	{
+		if (size < sizeof(std::uint32_t) || size > maxSnapshotSize)
+			return false;
+		size_t checksumOffset = size - sizeof(std::uint32_t);
+		std::uint32_t storedChecksum{ 0 };
+		if (!readLittleEndian(data, size, checksumOffset, storedChecksum) || storedChecksum != fnv1a(data, size - sizeof(std::uint32_t)))
+			return false;
+		size = size - sizeof(std::uint32_t);
+
+		size_t offset{ 0 };
+		if (size < sizeof(snapshotMagic) || std::memcmp(data, snapshotMagic, sizeof(snapshotMagic)) != 0)
+			return false;
+		offset += sizeof(snapshotMagic);
+		std::uint16_t version{ 0 };
+		std::uint8_t flags{ 0 }, current{ 0 }, next{ 0 }, hold{ 0 };
+		//only saves of this build are read, the older layouts never left development
+		if (!readLittleEndian(data, size, offset, version) || version != snapshotVersion || !readLittleEndian(data, size, offset, flags)
+			|| !readLittleEndian(data, size, offset, snapshot.shiftDirection) || !readLittleEndian(data, size, offset, snapshot.tick)
+			|| !readLittleEndian(data, size, offset, snapshot.journalSequence)
+			|| !readLittleEndian(data, size, offset, snapshot.score) || !readLittleEndian(data, size, offset, snapshot.randomState)
+			|| !readLittleEndian(data, size, offset, current) || !readLittleEndian(data, size, offset, next) || !readLittleEndian(data, size, offset, hold)
+			|| !readLittleEndian(data, size, offset, snapshot.lockResets) || !readLittleEndian(data, size, offset, snapshot.gravityProgress)
+			|| !readLittleEndian(data, size, offset, snapshot.level) || !readLittleEndian(data, size, offset, snapshot.lines)
+			|| !readLittleEndian(data, size, offset, snapshot.lowestRow)
+			|| !readLittleEndian(data, size, offset, snapshot.pendingGarbage) || !readLittleEndian(data, size, offset, snapshot.garbageRandomState)
+			|| !readLittleEndian(data, size, offset, snapshot.garbageSent) || !readLittleEndian(data, size, offset, snapshot.topOuts))
+			return false;
+		if (current < Blocks::I || current >= Blocks::PieceTypeCount || next < Blocks::I || next >= Blocks::PieceTypeCount || hold >= Blocks::PieceTypeCount)
+			return false;
+		snapshot.current = static_cast<Blocks::PieceType>(current);
+		snapshot.next = static_cast<Blocks::PieceType>(next);
+		snapshot.hold = static_cast<Blocks::PieceType>(hold);
+		snapshot.blockIsActive = (flags & blockIsActiveFlag) != 0;
+		snapshot.softDrop = (flags & softDropFlag) != 0;
+		snapshot.spaceIsReleased = (flags & spaceIsReleasedFlag) != 0;
+		std::int8_t x{ 0 }, y{ 0 };
+		for (auto& cell : snapshot.currentCells) {
+			if (!readLittleEndian(data, size, offset, x) || !readLittleEndian(data, size, offset, y))
+				return false;
+			cell = { x, y };
+		}
+		if (!readLittleEndian(data, size, offset, x) || !readLittleEndian(data, size, offset, y))
+			return false;
+		snapshot.currentRotationCell = { x, y };
+		if (!readLittleEndian(data, size, offset, snapshot.timerCount) || snapshot.timerCount > maxSnapshotTimers)
+			return false;
+		for (std::uint8_t i{ 0 }; i < snapshot.timerCount; ++i)
+			if (!readLittleEndian(data, size, offset, snapshot.timerIds[i]) || !readLittleEndian(data, size, offset, snapshot.timerTicksLeft[i]))
+				return false;
+
+		std::array<std::uint16_t, Blocks::BlockCountY> masks;
+		for (auto& mask : masks)
+			if (!readLittleEndian(data, size, offset, mask))
+				return false;
+		bool isLowNibble{ true };
+		for (int cell{ 0 }; cell < Blocks::BlockCountX * Blocks::BlockCountY; ++cell) {
+			if ((masks[cell / Blocks::BlockCountX] & (1 << (cell % Blocks::BlockCountX))) == 0) {
+				snapshot.cells[cell] = Blocks::Empty;
+				continue;
+			}
+			if (offset >= size)
+				return false;
+			const std::uint8_t type = isLowNibble ? data[offset] & 0x0f : data[offset++] >> 4;
+			if (type < Blocks::I || type >= Blocks::PieceTypeCount)
+				return false;
+			snapshot.cells[cell] = static_cast<Blocks::PieceType>(type);
+			isLowNibble = !isLowNibble;
+		}
+		if (!isLowNibble)
+			offset += 1;
+		return offset == size;
+	}
+
+	bool readSnapshot(const std::string& path, Snapshot& snapshot)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		std::vector<std::uint8_t> bytes;
+		bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return decodeSnapshot(bytes.data(), bytes.size(), snapshot);
+	}
+
+	std::string getDefaultSavePath()
+	{
+#ifdef _WIN32
+		char directory[MAX_PATH];
+		const DWORD length = GetEnvironmentVariableA("LOCALAPPDATA", directory, MAX_PATH);
+		if (length > 0 && length < MAX_PATH)
+			return std::string(directory, length) + "\\tetris.sav";
+#else
+		const char* directory = std::getenv("HOME");
+		if (directory && *directory)
+			return std::string(directory) + "/.tetris.sav";
+#endif
+		return "tetris.sav";
+	}
+
+	bool writeFileAtomically(const std::string& path, const void* data, size_t size)
+	{
+		const std::string temporaryPath = path + ".tmp";
+#ifdef _WIN32
+		HANDLE file = CreateFileA(temporaryPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+		DWORD written{ 0 };
+		const bool isWritten = WriteFile(file, data, static_cast<DWORD>(size), &written, nullptr) && written == size && FlushFileBuffers(file);
+		CloseHandle(file);
+		return isWritten && MoveFileExA(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+		const int file = ::open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (file < 0)
+			return false;
+		const bool isWritten = ::write(file, data, size) == static_cast<ssize_t>(size) && ::fsync(file) == 0;
+		::close(file);
+		if (!isWritten || ::rename(temporaryPath.c_str(), path.c_str()) != 0)
+			return false;
+		//the rename itself is only durable once the directory is flushed
+		const size_t slash = path.find_last_of('/');
+		const int directory = ::open(slash == std::string::npos ? "." : path.substr(0, slash + 1).c_str(), O_RDONLY);
+		if (directory >= 0) {
+			::fsync(directory);
+			::close(directory);
+		}
+		return true;
+#endif
+	}
+
+	SnapshotWriter::SnapshotWriter(const std::string& path)
+		:m_Path(path), m_Running(true)
+	{
+		m_Thread = std::thread(&SnapshotWriter::writeLoop, this);
+	}
+
+	SnapshotWriter::~SnapshotWriter()
+	{
+		m_Running = false;
+		m_Wake.notify_one();
+		m_Thread.join();
+	}
+
+	void SnapshotWriter::submit(const SnapshotBuffer& buffer, size_t size)
+	{
+		m_Latest.getBack() = { buffer, size };
+		m_Latest.publish();
+		m_Wake.notify_one();
+	}
+
+	void SnapshotWriter::writeLoop()
+	{
+		for (;;) {
+			//read before looking for a snapshot, so one published right before shutdown is still written
+			const bool isRunning = m_Running;
+			if (m_Latest.update())
+				writeFileAtomically(m_Path, m_Latest.getFront().buffer.data(), m_Latest.getFront().size);
+			else if (!isRunning)
+				return;
+			else {
+				//a wakeup lost between the check above and the wait only delays the write by the poll period
+				std::unique_lock<std::mutex> lock(m_WakeMutex);
+				m_Wake.wait_for(lock, writerPollPeriod);
+			}
+		}
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <SFML/System/Vector2.hpp>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "Board.h"
+#include "Scheduler.h"
+#include "TripleBuffer.h"
+
+namespace Storage {
+	//upper bound of an encoded snapshot, a typical one is below 150 bytes
+	static constexpr size_t maxSnapshotSize = 256;
+	static constexpr size_t maxSnapshotTimers = 8;
+	//remaining ticks of a timer that is not pending
+	static constexpr std::uint32_t timerNotPending = 0xffffffff;
+
+	using SnapshotBuffer = std::array<std::uint8_t, maxSnapshotSize>;
+
+	//everything needed to continue a game exactly where it was
+	struct Snapshot
+	{
+		Timing::Tick tick;
+		//inputs applied before the snapshot, the input journal continues from there
+		std::uint64_t journalSequence;
+		std::uint32_t score;
+		std::uint32_t randomState;
+		Blocks::Cells cells;
+		Blocks::PieceType current;
+		Blocks::PieceType next;
+		//the game has no hold piece yet, always Empty
+		Blocks::PieceType hold;
+		//board cells of the falling block and its rotation center
+		std::array<sf::Vector2i, 4> currentCells;
+		sf::Vector2i currentRotationCell;
+		bool blockIsActive;
+		bool softDrop;
+		bool spaceIsReleased;
+		std::int8_t shiftDirection;
+		std::uint8_t lockResets;
+		//part of a cell the falling block has dropped towards the next one, in 1/65536
+		std::uint16_t gravityProgress;
+		std::uint16_t level;
+		std::uint32_t lines;
+		//lowest row the rotation cell of the falling block has reached
+		std::int8_t lowestRow;
+		//versus play, garbage waiting to rise and what was exchanged so far
+		std::uint8_t pendingGarbage;
+		std::uint32_t garbageRandomState;
+		std::uint32_t garbageSent;
+		std::uint16_t topOuts;
+		//pending timers in firing order as id and ticks left
+		std::uint8_t timerCount;
+		std::array<std::uint8_t, maxSnapshotTimers> timerIds;
+		std::array<std::uint32_t, maxSnapshotTimers> timerTicksLeft;
+	};
+
+	//fixed little endian layout with row masks, 4 bits per occupied cell and a checksum, no allocation
+	size_t encodeSnapshot(const Snapshot& snapshot, SnapshotBuffer& buffer);
+	//rejects wrong versions, truncated data and checksum mismatches
+	bool decodeSnapshot(const std::uint8_t* data, size_t size, Snapshot& snapshot);
+	bool readSnapshot(const std::string& path, Snapshot& snapshot);
+	//tetris.sav in the local app data directory on windows, ~/.tetris.sav elsewhere, the working directory as fallback
+	std::string getDefaultSavePath();
+
+	//writes to path.tmp, flushes it to the disk and renames it over path,
+	//so a crash leaves either the old or the new file, never a torn one
+	bool writeFileAtomically(const std::string& path, const void* data, size_t size);
+
+	//writes snapshots on its own thread, submitting one never blocks
+	//when the writer is still busy with a previous file only the newest snapshot is written next
+	class SnapshotWriter
+	{
+	public:
+		explicit SnapshotWriter(const std::string& path);
+		//writes what is still queued before returning
+		~SnapshotWriter();
+		SnapshotWriter(const SnapshotWriter&) = delete;
+		SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+		//single producer
+		void submit(const SnapshotBuffer& buffer, size_t size);
+	private:
+		struct Pending
+		{
+			SnapshotBuffer buffer;
+			size_t size;
+		};
+		void writeLoop();
+
+		std::string m_Path;
+		Concurrency::TripleBuffer<Pending> m_Latest;
+		std::atomic<bool> m_Running;
+		std::mutex m_WakeMutex;
+		std::condition_variable m_Wake;
+		std::thread m_Thread;
+	};
+}
@@ -0,0 +1,244 @@
+#include "SpectatorStream.h"
+#include <algorithm>
+#include "ByteOrder.h"
+
+namespace Network {
+	//two cells a byte, a row of 12 in 6
+	static constexpr size_t rowBytes = (Blocks::BlockCountX + 1) / 2;
+	static constexpr std::uint16_t allRows = (1u << Blocks::BlockCountY) - 1;
+	//what else a frame holds besides the rows
+	static constexpr std::uint8_t pieceBit = 1;
+	static constexpr std::uint8_t nextBit = 2;
+	static constexpr std::uint8_t countersBit = 4;
+	static constexpr std::uint8_t keyframeParts = pieceBit | nextBit | countersBit;
+	//on a keyframe showing what the frame before it showed already, the deltas up to it can be checked against it
+	static constexpr std::uint8_t unchangedBit = 8;
+
+	static bool isSameRow(const Blocks::Cells& cells, const Blocks::Cells& other, int y)
+	{
+		const auto row = cells.begin() + y * Blocks::BlockCountX;
+		return std::equal(row, row + Blocks::BlockCountX, other.begin() + y * Blocks::BlockCountX);
+	}
+
+	static bool isSamePiece(const SpectatorView& view, const SpectatorView& other)
+	{
+		return view.piece == other.piece && view.pieceCells == other.pieceCells;
+	}
+
+	static bool isSameCounters(const SpectatorView& view, const SpectatorView& other)
+	{
+		return view.score == other.score && view.lines == other.lines && view.level == other.level && view.topOuts == other.topOuts;
+	}
+
+	SpectatorView getSpectatorView(const Rules::Simulation& game)
+	{
+		SpectatorView view{};
+		view.cells = game.getCells();
+		if (game.isPieceActive()) {
+			const Rules::Piece& piece = game.getCurrentPiece();
+			view.piece = piece.type;
+			for (size_t i{ 0 }; i < piece.cells.size(); ++i) {
+				view.pieceCells[2 * i] = static_cast<std::int8_t>(piece.cells[i].x);
+				view.pieceCells[2 * i + 1] = static_cast<std::int8_t>(piece.cells[i].y);
+			}
+		}
+		view.next = game.getNextPiece();
+		view.score = game.getScore();
+		view.lines = game.getLines();
+		view.level = static_cast<std::uint8_t>(game.getLevel());
+		view.topOuts = static_cast<std::uint16_t>(game.getTopOuts());
+		return view;
+	}
+
+	bool isSameView(const SpectatorView& view, const SpectatorView& other)
+	{
+		return view.cells == other.cells && isSamePiece(view, other) && view.next == other.next && isSameCounters(view, other);
+	}
+
+	SpectatorEncoder::SpectatorEncoder()
+		:m_Previous{}, m_HasPrevious(false), m_Sequence(0)
+	{
+	}
+
+	bool SpectatorEncoder::encode(const SpectatorView& view, Timing::Tick tick, bool isKeyframe, std::vector<std::uint8_t>& bytes)
+	{
+		isKeyframe = isKeyframe || !m_HasPrevious;
+		std::uint16_t rows{ isKeyframe ? allRows : std::uint16_t{ 0 } };
+		if (!isKeyframe)
+			for (int y{ 0 }; y < Blocks::BlockCountY; ++y)
+				if (!isSameRow(view.cells, m_Previous.cells, y))
+					rows = static_cast<std::uint16_t>(rows | 1u << y);
+		std::uint8_t parts{ keyframeParts };
+		if (isKeyframe && m_HasPrevious && isSameView(view, m_Previous))
+			parts |= unchangedBit;
+		if (!isKeyframe) {
+			parts = static_cast<std::uint8_t>((isSamePiece(view, m_Previous) ? 0 : pieceBit) | (view.next == m_Previous.next ? 0 : nextBit)
+				| (isSameCounters(view, m_Previous) ? 0 : countersBit));
+			if (rows == 0 && parts == 0)
+				return false;
+		}
+
+		const size_t start = bytes.size();
+		Storage::appendLittleEndian(bytes, std::uint16_t{ 0 });
+		Storage::appendLittleEndian(bytes, isKeyframe ? SpectatorKeyframe : SpectatorDelta);
+		Storage::appendLittleEndian(bytes, m_Sequence);
+		Storage::appendLittleEndian(bytes, static_cast<std::uint32_t>(tick));
+		Storage::appendLittleEndian(bytes, rows);
+		for (int y{ 0 }; y < Blocks::BlockCountY; ++y) {
+			if ((rows >> y & 1) == 0)
+				continue;
+			for (size_t x{ 0 }; x < rowBytes; ++x) {
+				const size_t cell = static_cast<size_t>(y * Blocks::BlockCountX) + 2 * x;
+				Storage::appendLittleEndian(bytes, static_cast<std::uint8_t>(view.cells[cell] | view.cells[cell + 1] << 4));
+			}
+		}
+		Storage::appendLittleEndian(bytes, parts);
+		if (parts & pieceBit) {
+			Storage::appendLittleEndian(bytes, view.piece);
+			for (const auto coordinate : view.pieceCells)
+				Storage::appendLittleEndian(bytes, coordinate);
+		}
+		if (parts & nextBit)
+			Storage::appendLittleEndian(bytes, view.next);
+		if (parts & countersBit) {
+			Storage::appendLittleEndian(bytes, view.score);
+			Storage::appendLittleEndian(bytes, view.lines);
+			Storage::appendLittleEndian(bytes, view.level);
+			Storage::appendLittleEndian(bytes, view.topOuts);
+		}
+		const size_t size = bytes.size() - start - spectatorSizeBytes;
+		bytes[start] = static_cast<std::uint8_t>(size);
+		bytes[start + 1] = static_cast<std::uint8_t>(size >> 8);
+
+		m_Previous = view;
+		m_HasPrevious = true;
+		m_Sequence += 1;
+		return true;
+	}
+
+	std::uint32_t SpectatorEncoder::getSequence() const
+	{
+		return m_Sequence;
+	}
+
+	SpectatorDecoder::SpectatorDecoder()
+		:m_View{}, m_HasView(false), m_Tick(0), m_Sequence(0), m_Frames(0), m_Keyframes(0), m_SkippedFrames(0), m_Mismatches(0)
+	{
+	}
+
+	bool SpectatorDecoder::feed(const std::uint8_t* data, size_t size)
+	{
+		m_Pending.insert(m_Pending.end(), data, data + size);
+		size_t offset{ 0 };
+		while (m_Pending.size() - offset >= spectatorSizeBytes) {
+			const size_t frameSize = m_Pending[offset] | static_cast<size_t>(m_Pending[offset + 1]) << 8;
+			if (m_Pending.size() - offset - spectatorSizeBytes < frameSize)
+				break;
+			if (!decode(m_Pending.data() + offset + spectatorSizeBytes, frameSize))
+				return false;
+			offset += spectatorSizeBytes + frameSize;
+		}
+		m_Pending.erase(m_Pending.begin(), m_Pending.begin() + static_cast<std::ptrdiff_t>(offset));
+		return true;
+	}
+
+	bool SpectatorDecoder::decode(const std::uint8_t* data, size_t size)
+	{
+		size_t offset{ 0 };
+		std::uint8_t type{ 0 };
+		std::uint32_t sequence{ 0 }, tick{ 0 };
+		std::uint16_t rows{ 0 };
+		if (!Storage::readLittleEndian(data, size, offset, type) || type >= SpectatorFrameTypeCount || !Storage::readLittleEndian(data, size, offset, sequence) || !Storage::readLittleEndian(data, size, offset, tick)
+			|| !Storage::readLittleEndian(data, size, offset, rows) || rows > allRows)
+			return false;
+		//sequences only go forward, a stream from before is not this one
+		if (m_HasView && sequence <= m_Sequence)
+			return false;
+		const bool isKeyframe = type == SpectatorKeyframe;
+		const bool isNext = m_HasView && sequence == m_Sequence + 1;
+		//the server skips to keyframes only, a delta has to follow the frame it was taken against
+		if (!isKeyframe && !isNext)
+			return false;
+		if (isKeyframe && rows != allRows)
+			return false;
+
+		SpectatorView view{ m_View };
+		for (int y{ 0 }; y < Blocks::BlockCountY; ++y) {
+			if ((rows >> y & 1) == 0)
+				continue;
+			for (size_t x{ 0 }; x < rowBytes; ++x) {
+				std::uint8_t pair{ 0 };
+				if (!Storage::readLittleEndian(data, size, offset, pair) || (pair & 0xf) >= Blocks::PieceTypeCount || pair >> 4 >= Blocks::PieceTypeCount)
+					return false;
+				const size_t cell = static_cast<size_t>(y * Blocks::BlockCountX) + 2 * x;
+				view.cells[cell] = static_cast<Blocks::PieceType>(pair & 0xf);
+				view.cells[cell + 1] = static_cast<Blocks::PieceType>(pair >> 4);
+			}
+		}
+		std::uint8_t parts{ 0 };
+		if (!Storage::readLittleEndian(data, size, offset, parts) || (isKeyframe ? (parts & ~unchangedBit) != keyframeParts : (parts & ~keyframeParts) != 0))
+			return false;
+		if ((parts & pieceBit) && !Storage::readLittleEndian(data, size, offset, view.piece))
+			return false;
+		if (parts & pieceBit)
+			for (auto& coordinate : view.pieceCells)
+				if (!Storage::readLittleEndian(data, size, offset, coordinate))
+					return false;
+		if ((parts & nextBit) && !Storage::readLittleEndian(data, size, offset, view.next))
+			return false;
+		if ((parts & countersBit) && !(Storage::readLittleEndian(data, size, offset, view.score) && Storage::readLittleEndian(data, size, offset, view.lines)
+			&& Storage::readLittleEndian(data, size, offset, view.level) && Storage::readLittleEndian(data, size, offset, view.topOuts)))
+			return false;
+		if (offset != size || view.piece >= Blocks::PieceTypeCount || view.next >= Blocks::PieceTypeCount)
+			return false;
+
+		if (isKeyframe) {
+			m_Keyframes += 1;
+			if (isNext && (parts & unchangedBit) && !isSameView(view, m_View))
+				m_Mismatches += 1;
+			if (m_HasView && !isNext)
+				m_SkippedFrames += sequence - m_Sequence - 1;
+		}
+		m_View = view;
+		m_HasView = true;
+		m_Tick = tick;
+		m_Sequence = sequence;
+		m_Frames += 1;
+		return true;
+	}
+
+	bool SpectatorDecoder::hasView() const
+	{
+		return m_HasView;
+	}
+
+	const SpectatorView& SpectatorDecoder::getView() const
+	{
+		return m_View;
+	}
+
+	Timing::Tick SpectatorDecoder::getTick() const
+	{
+		return m_Tick;
+	}
+
+	std::uint64_t SpectatorDecoder::getFrames() const
+	{
+		return m_Frames;
+	}
+
+	std::uint64_t SpectatorDecoder::getKeyframes() const
+	{
+		return m_Keyframes;
+	}
+
+	std::uint64_t SpectatorDecoder::getSkippedFrames() const
+	{
+		return m_SkippedFrames;
+	}
+
+	std::uint64_t SpectatorDecoder::getMismatches() const
+	{
+		return m_Mismatches;
+	}
+}
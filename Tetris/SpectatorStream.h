@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Board.h"
+#include "Scheduler.h"
+#include "Simulation.h"
+
+//a game as spectators see it, a frame for every tick something they can see changed
+//a frame is its 16 bit little endian size, then the type, a 32 bit sequence and a 32 bit tick, then the frame itself
+//a keyframe holds the whole view, a delta only the rows that changed since the frame before it and the piece and counters when they did
+//frames are numbered as they are encoded, a gap in the sequence means frames were skipped and a keyframe follows
+namespace Network {
+	static constexpr size_t spectatorSizeBytes = sizeof(std::uint16_t);
+
+	enum SpectatorFrameType : std::uint8_t
+	{
+		SpectatorKeyframe,
+		SpectatorDelta,
+		SpectatorFrameTypeCount
+	};
+
+	//what is drawn of a game, nothing of the timers or the random state
+	struct SpectatorView
+	{
+		Blocks::Cells cells;
+		//Empty between a lock and the next spawn
+		Blocks::PieceType piece;
+		//x and y of the four cells, the piece can stick out above the board
+		std::array<std::int8_t, 8> pieceCells;
+		Blocks::PieceType next;
+		std::uint32_t score;
+		std::uint32_t lines;
+		std::uint8_t level;
+		std::uint16_t topOuts;
+	};
+
+	SpectatorView getSpectatorView(const Rules::Simulation& game);
+	bool isSameView(const SpectatorView& view, const SpectatorView& other);
+
+	//turns the views of one game into frames, each of them is encoded once whoever receives it
+	class SpectatorEncoder
+	{
+	public:
+		SpectatorEncoder();
+
+		//appends the frame of view at tick to bytes, a keyframe when asked for or when there is no frame before it
+		//returns false and appends nothing when it is not a keyframe and nothing changed
+		bool encode(const SpectatorView& view, Timing::Tick tick, bool isKeyframe, std::vector<std::uint8_t>& bytes);
+		std::uint32_t getSequence()const;
+	private:
+		SpectatorView m_Previous;
+		bool m_HasPrevious;
+		std::uint32_t m_Sequence;
+	};
+
+	//rebuilds the view from the frames of a stream as they come off a connection, in pieces of any size
+	//a keyframe right after the frame before it that shows nothing new is checked against the view the deltas built
+	class SpectatorDecoder
+	{
+	public:
+		SpectatorDecoder();
+
+		//false once the stream is broken, a delta without a keyframe before it or a frame that does not parse
+		bool feed(const std::uint8_t* data, size_t size);
+		bool hasView()const;
+		const SpectatorView& getView()const;
+		Timing::Tick getTick()const;
+		std::uint64_t getFrames()const;
+		std::uint64_t getKeyframes()const;
+		//frames the sequence jumped over
+		std::uint64_t getSkippedFrames()const;
+		//keyframes that did not match the view built from the deltas before them
+		std::uint64_t getMismatches()const;
+	private:
+		bool decode(const std::uint8_t* data, size_t size);
+
+		std::vector<std::uint8_t> m_Pending;
+		SpectatorView m_View;
+		bool m_HasView;
+		Timing::Tick m_Tick;
+		std::uint32_t m_Sequence;
+		std::uint64_t m_Frames;
+		std::uint64_t m_Keyframes;
+		std::uint64_t m_SkippedFrames;
+		std::uint64_t m_Mismatches;
+	};
+}
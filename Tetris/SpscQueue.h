@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace Concurrency {
+
+	//wait-free ring for exactly one producer thread and one consumer thread
+	//push fails instead of blocking when the ring is full, pop fails when it is empty
+	template<typename T, size_t Capacity>
+	class SpscQueue
+	{
+		static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0, "capacity has to be a power of two");
+	public:
+		SpscQueue() :m_Head(0), m_Tail(0) {}
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+
+		//producer side
+		bool push(const T& item)
+		{
+			const size_t tail = m_Tail.load(std::memory_order_relaxed);
+			if (tail - m_Head.load(std::memory_order_acquire) == Capacity)
+				return false;
+			m_Items[tail & (Capacity - 1)] = item;
+			m_Tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		//consumer side
+		bool pop(T& item)
+		{
+			const size_t head = m_Head.load(std::memory_order_relaxed);
+			if (head == m_Tail.load(std::memory_order_acquire))
+				return false;
+			item = m_Items[head & (Capacity - 1)];
+			m_Head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		static constexpr size_t capacity()
+		{
+			return Capacity;
+		}
+
+		bool empty()const
+		{
+			return m_Head.load(std::memory_order_acquire) == m_Tail.load(std::memory_order_acquire);
+		}
+	private:
+		//head and tail on their own cache lines so both threads do not fight over one line
+		alignas(64) std::atomic<size_t> m_Head;
+		alignas(64) std::atomic<size_t> m_Tail;
+		alignas(64) std::array<T, Capacity> m_Items;
+	};
+}
@@ -0,0 +1,423 @@
+#include "TrainingData.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <utility>
+#include "ByteOrder.h"
+
+namespace Storage {
+	static constexpr char fileMagic[4] = { 'T', 'T', 'R', 'N' };
+	static constexpr char chunkMagic[4] = { 'T', 'T', 'C', 'K' };
+	static constexpr std::uint16_t trainingVersion = 1;
+	//magic, version, column count, chunk rows and reserved, then the name and width of every column
+	static constexpr size_t fileHeaderSize = 256;
+	static constexpr size_t fileColumnsOffset = 16;
+	static constexpr size_t columnNameSize = 14;
+	//magic, rows and chunk size, then the offset, stored size and coding of every column and a checksum of all that
+	static constexpr size_t chunkHeaderSize = 256;
+	static constexpr size_t chunkColumnsOffset = 16;
+	static constexpr size_t columnEntrySize = 16;
+	static constexpr size_t chunkChecksumOffset = chunkColumnsOffset + TrainingColumnCount * columnEntrySize;
+	static_assert(fileColumnsOffset + TrainingColumnCount * (columnNameSize + 2) <= fileHeaderSize
+		&& chunkChecksumOffset + sizeof(std::uint32_t) <= chunkHeaderSize, "the headers have room for every column");
+	//a cache line, and the widest value a column holds is aligned whatever the width of its rows
+	static constexpr size_t columnAlignment = 64;
+	static constexpr std::uint8_t rawCoding = 0;
+	static constexpr std::uint8_t runCoding = 1;
+	//packbits, a control byte below 128 is followed by that many plus one bytes as they are,
+	//one from 128 up by a byte repeated that many minus 128 plus minRun times
+	static constexpr size_t minRun = 3;
+	static constexpr size_t maxRun = 127 + minRun;
+	static constexpr size_t maxLiterals = 128;
+	//a few chunks of 64K rows, enough to ride out a slow write without holding much memory
+	static constexpr size_t maxQueued = 8;
+
+	struct ColumnInfo
+	{
+		const char* name;
+		size_t width;
+	};
+
+	static const ColumnInfo columns[TrainingColumnCount] = {
+		{ "game", 4 },
+		{ "board", 2 * Blocks::BlockCountY },
+		{ "piece", 1 },
+		{ "preview", trainingPreviewCount },
+		{ "column", 1 },
+		{ "row", 1 },
+		{ "rotation", 1 },
+		{ "reward", 4 },
+		{ "lines", 1 },
+		{ "holes", 1 },
+		{ "height", 1 },
+		{ "bumpiness", 1 },
+		{ "max_height", 1 },
+		{ "final", 1 }
+	};
+
+	static std::uint64_t getMicroseconds(std::chrono::steady_clock::duration duration)
+	{
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+	}
+
+	//gives up and returns false as soon as the coded bytes would not be fewer than size
+	static bool appendRuns(const std::uint8_t* data, size_t size, std::vector<std::uint8_t>& bytes)
+	{
+		const size_t start{ bytes.size() };
+		for (size_t i{ 0 }; i < size;) {
+			if (bytes.size() - start >= size)
+				return false;
+			size_t run{ 1 };
+			while (i + run < size && run < maxRun && data[i + run] == data[i])
+				run += 1;
+			if (run >= minRun) {
+				bytes.push_back(static_cast<std::uint8_t>(128 + run - minRun));
+				bytes.push_back(data[i]);
+				i += run;
+				continue;
+			}
+			//up to the next run worth a control byte of its own
+			const size_t first{ i };
+			while (i < size && i - first < maxLiterals && !(size - i >= minRun && data[i] == data[i + 1] && data[i] == data[i + 2]))
+				i += 1;
+			bytes.push_back(static_cast<std::uint8_t>(i - first - 1));
+			bytes.insert(bytes.end(), data + first, data + i);
+		}
+		return bytes.size() - start < size;
+	}
+
+	static bool decodeRuns(const std::uint8_t* data, size_t size, std::uint8_t* out, size_t outSize)
+	{
+		size_t written{ 0 };
+		for (size_t i{ 0 }; i < size;) {
+			const std::uint8_t control = data[i++];
+			if (control < 128) {
+				const size_t count = control + size_t{ 1 };
+				if (size - i < count || outSize - written < count)
+					return false;
+				std::memcpy(out + written, data + i, count);
+				i += count;
+				written += count;
+			}
+			else {
+				const size_t count = control - 128 + minRun;
+				if (i == size || outSize - written < count)
+					return false;
+				std::memset(out + written, data[i++], count);
+				written += count;
+			}
+		}
+		return written == outSize;
+	}
+
+	static void pad(std::vector<std::uint8_t>& bytes)
+	{
+		bytes.resize((bytes.size() + columnAlignment - 1) / columnAlignment * columnAlignment);
+	}
+
+	const char* getTrainingColumnName(TrainingColumn column)
+	{
+		return column < TrainingColumnCount ? columns[column].name : "unknown";
+	}
+
+	size_t getTrainingColumnWidth(TrainingColumn column)
+	{
+		return column < TrainingColumnCount ? columns[column].width : 0;
+	}
+
+	TrainingChunk::TrainingChunk(size_t capacity)
+		:m_Capacity(capacity), m_RowCount(0)
+	{
+		for (size_t column{ 0 }; column < TrainingColumnCount; ++column)
+			m_Columns[column].resize(capacity * columns[column].width);
+	}
+
+	void TrainingChunk::add(const TrainingRow& row)
+	{
+		if (isFull())
+			return;
+		const size_t r{ m_RowCount++ };
+		storeLittleEndian(m_Columns[TrainingGame].data(), r * 4, row.game);
+		for (size_t y{ 0 }; y < row.board.size(); ++y)
+			storeLittleEndian(m_Columns[TrainingBoard].data(), (r * row.board.size() + y) * 2, row.board[y]);
+		m_Columns[TrainingPiece][r] = row.piece;
+		std::copy(row.preview.begin(), row.preview.end(), m_Columns[TrainingPreview].begin() + r * trainingPreviewCount);
+		m_Columns[TrainingPlacedColumn][r] = static_cast<std::uint8_t>(row.column);
+		m_Columns[TrainingPlacedRow][r] = static_cast<std::uint8_t>(row.row);
+		m_Columns[TrainingRotation][r] = row.rotation;
+		storeLittleEndian(m_Columns[TrainingReward].data(), r * 4, row.reward);
+		m_Columns[TrainingLines][r] = row.lines;
+		m_Columns[TrainingHoles][r] = row.holes;
+		m_Columns[TrainingHeight][r] = row.height;
+		m_Columns[TrainingBumpiness][r] = row.bumpiness;
+		m_Columns[TrainingMaxHeight][r] = row.maxHeight;
+		m_Columns[TrainingFinal][r] = row.isFinal;
+	}
+
+	void TrainingChunk::clear()
+	{
+		m_RowCount = 0;
+	}
+
+	size_t TrainingChunk::getRowCount() const
+	{
+		return m_RowCount;
+	}
+
+	bool TrainingChunk::isFull() const
+	{
+		return m_RowCount >= m_Capacity;
+	}
+
+	void TrainingChunk::encode(bool compress, std::vector<std::uint8_t>& bytes)
+	{
+		bytes.assign(chunkHeaderSize, 0);
+		std::memcpy(bytes.data(), chunkMagic, sizeof(chunkMagic));
+		storeLittleEndian(bytes.data(), sizeof(chunkMagic), static_cast<std::uint32_t>(m_RowCount));
+		for (size_t column{ 0 }; column < TrainingColumnCount; ++column) {
+			const size_t width{ columns[column].width };
+			const size_t size{ m_RowCount * width };
+			const std::uint8_t* data = m_Columns[column].data();
+			//the same byte of every row next to each other, the high bytes of row masks and game numbers are long runs then
+			if (compress && width > 1) {
+				m_Planes.resize(size);
+				for (size_t r{ 0 }; r < m_RowCount; ++r)
+					for (size_t b{ 0 }; b < width; ++b)
+						m_Planes[b * m_RowCount + r] = data[r * width + b];
+				data = m_Planes.data();
+			}
+			const size_t offset{ bytes.size() };
+			std::uint8_t coding{ runCoding };
+			if (!compress || !appendRuns(data, size, bytes)) {
+				bytes.resize(offset);
+				bytes.insert(bytes.end(), m_Columns[column].data(), m_Columns[column].data() + size);
+				coding = rawCoding;
+			}
+			const size_t entry{ chunkColumnsOffset + column * columnEntrySize };
+			storeLittleEndian(bytes.data(), entry, static_cast<std::uint64_t>(offset));
+			storeLittleEndian(bytes.data(), entry + 8, static_cast<std::uint32_t>(bytes.size() - offset));
+			bytes[entry + 12] = coding;
+			pad(bytes);
+		}
+		storeLittleEndian(bytes.data(), 8, static_cast<std::uint64_t>(bytes.size()));
+		storeLittleEndian(bytes.data(), chunkChecksumOffset, fnv1a(bytes.data(), chunkChecksumOffset));
+	}
+
+	TrainingWriter::TrainingWriter()
+		:m_IsClosing(false), m_HasFailed(false), m_BytesWritten(0), m_ProducerWait(0), m_WriterWait(0)
+	{
+	}
+
+	TrainingWriter::~TrainingWriter()
+	{
+		close();
+	}
+
+	bool TrainingWriter::open(const std::string& path, std::uint32_t chunkRows)
+	{
+		if (m_Thread.joinable())
+			return false;
+		m_File.open(path, std::ios::binary | std::ios::trunc);
+		std::uint8_t header[fileHeaderSize]{};
+		std::memcpy(header, fileMagic, sizeof(fileMagic));
+		storeLittleEndian(header, sizeof(fileMagic), trainingVersion);
+		storeLittleEndian(header, 6, static_cast<std::uint16_t>(TrainingColumnCount));
+		storeLittleEndian(header, 8, chunkRows);
+		for (size_t column{ 0 }; column < TrainingColumnCount; ++column) {
+			const size_t entry{ fileColumnsOffset + column * (columnNameSize + 2) };
+			std::memcpy(header + entry, columns[column].name, std::min(std::strlen(columns[column].name), columnNameSize));
+			storeLittleEndian(header, entry + columnNameSize, static_cast<std::uint16_t>(columns[column].width));
+		}
+		if (!m_File.write(reinterpret_cast<const char*>(header), sizeof(header))) {
+			m_File.close();
+			return false;
+		}
+		m_IsClosing = false;
+		m_HasFailed = false;
+		m_BytesWritten = sizeof(header);
+		m_Thread = std::thread(&TrainingWriter::writeLoop, this);
+		return true;
+	}
+
+	bool TrainingWriter::write(std::vector<std::uint8_t>&& chunk)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		if (m_Queue.size() >= maxQueued) {
+			const auto start = std::chrono::steady_clock::now();
+			m_Taken.wait(lock, [this] { return m_Queue.size() < maxQueued || m_HasFailed; });
+			m_ProducerWait += getMicroseconds(std::chrono::steady_clock::now() - start);
+		}
+		if (m_HasFailed || !m_Thread.joinable())
+			return false;
+		m_Queue.push_back(std::move(chunk));
+		m_Queued.notify_one();
+		return true;
+	}
+
+	bool TrainingWriter::close()
+	{
+		if (!m_Thread.joinable())
+			return false;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_IsClosing = true;
+		}
+		m_Queued.notify_one();
+		m_Thread.join();
+		m_File.close();
+		return !m_HasFailed && !m_File.fail();
+	}
+
+	std::uint64_t TrainingWriter::getBytesWritten() const
+	{
+		return m_BytesWritten;
+	}
+
+	std::uint64_t TrainingWriter::getProducerWait() const
+	{
+		return m_ProducerWait;
+	}
+
+	std::uint64_t TrainingWriter::getWriterWait() const
+	{
+		return m_WriterWait;
+	}
+
+	void TrainingWriter::writeLoop()
+	{
+		for (;;) {
+			std::vector<std::uint8_t> chunk;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				const auto start = std::chrono::steady_clock::now();
+				m_Queued.wait(lock, [this] { return !m_Queue.empty() || m_IsClosing; });
+				m_WriterWait += getMicroseconds(std::chrono::steady_clock::now() - start);
+				if (m_Queue.empty())
+					return;
+				chunk = std::move(m_Queue.front());
+				m_Queue.pop_front();
+			}
+			m_Taken.notify_one();
+			//after a failed write the rest is let go, a chunk further on would not be found behind a torn one
+			if (m_HasFailed)
+				continue;
+			if (m_File.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size())))
+				m_BytesWritten += chunk.size();
+			else {
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_HasFailed = true;
+				m_Taken.notify_all();
+			}
+		}
+	}
+
+	//a chunk with a header that checks out and columns that all lie within it
+	static bool isChunkWhole(const std::uint8_t* data, size_t size, std::uint32_t chunkRows)
+	{
+		if (size < chunkHeaderSize || std::memcmp(data, chunkMagic, sizeof(chunkMagic)) != 0
+			|| loadLittleEndian<std::uint32_t>(data, chunkChecksumOffset) != fnv1a(data, chunkChecksumOffset))
+			return false;
+		const std::uint32_t rows = loadLittleEndian<std::uint32_t>(data, sizeof(chunkMagic));
+		const std::uint64_t chunkSize = loadLittleEndian<std::uint64_t>(data, 8);
+		if (rows > chunkRows || chunkSize < chunkHeaderSize || chunkSize > size || chunkSize % columnAlignment != 0)
+			return false;
+		for (size_t column{ 0 }; column < TrainingColumnCount; ++column) {
+			const size_t entry{ chunkColumnsOffset + column * columnEntrySize };
+			const std::uint64_t offset = loadLittleEndian<std::uint64_t>(data, entry);
+			const std::uint32_t stored = loadLittleEndian<std::uint32_t>(data, entry + 8);
+			const std::uint8_t coding = data[entry + 12];
+			if (offset < chunkHeaderSize || offset % columnAlignment != 0 || offset + stored > chunkSize
+				|| (coding == rawCoding && stored != rows * columns[column].width) || coding > runCoding)
+				return false;
+		}
+		return true;
+	}
+
+	TrainingReader::TrainingReader()
+		:m_RowCount(0), m_IsTruncated(false)
+	{
+	}
+
+	bool TrainingReader::open(const std::string& path)
+	{
+		close();
+		if (!m_File.open(path))
+			return false;
+		const std::uint8_t* data = m_File.getData();
+		const size_t size{ m_File.getSize() };
+		bool isKnown = size >= fileHeaderSize && std::memcmp(data, fileMagic, sizeof(fileMagic)) == 0
+			&& loadLittleEndian<std::uint16_t>(data, sizeof(fileMagic)) == trainingVersion && loadLittleEndian<std::uint16_t>(data, 6) == TrainingColumnCount;
+		for (size_t column{ 0 }; isKnown && column < TrainingColumnCount; ++column) {
+			const size_t entry{ fileColumnsOffset + column * (columnNameSize + 2) };
+			isKnown = std::strncmp(reinterpret_cast<const char*>(data + entry), columns[column].name, columnNameSize) == 0
+				&& loadLittleEndian<std::uint16_t>(data, entry + columnNameSize) == columns[column].width;
+		}
+		if (!isKnown) {
+			close();
+			return false;
+		}
+		const std::uint32_t chunkRows = loadLittleEndian<std::uint32_t>(data, 8);
+		size_t offset{ fileHeaderSize };
+		while (offset < size && isChunkWhole(data + offset, size - offset, chunkRows)) {
+			m_Chunks.push_back(offset);
+			m_RowCount += loadLittleEndian<std::uint32_t>(data, offset + sizeof(chunkMagic));
+			offset += static_cast<size_t>(loadLittleEndian<std::uint64_t>(data, offset + 8));
+		}
+		m_IsTruncated = offset < size;
+		return true;
+	}
+
+	void TrainingReader::close()
+	{
+		m_File.close();
+		m_Chunks.clear();
+		m_RowCount = 0;
+		m_IsTruncated = false;
+	}
+
+	size_t TrainingReader::getChunkCount() const
+	{
+		return m_Chunks.size();
+	}
+
+	std::uint64_t TrainingReader::getRowCount() const
+	{
+		return m_RowCount;
+	}
+
+	size_t TrainingReader::getRowCount(size_t chunk) const
+	{
+		return loadLittleEndian<std::uint32_t>(m_File.getData(), m_Chunks[chunk] + sizeof(chunkMagic));
+	}
+
+	bool TrainingReader::isCompressed(size_t chunk, TrainingColumn column) const
+	{
+		return m_File.getData()[m_Chunks[chunk] + chunkColumnsOffset + column * columnEntrySize + 12] == runCoding;
+	}
+
+	bool TrainingReader::isTruncated() const
+	{
+		return m_IsTruncated;
+	}
+
+	const std::uint8_t* TrainingReader::getColumn(size_t chunk, TrainingColumn column, std::vector<std::uint8_t>& buffer) const
+	{
+		const std::uint8_t* data = m_File.getData() + m_Chunks[chunk];
+		const size_t entry{ chunkColumnsOffset + column * columnEntrySize };
+		const std::uint8_t* stored = data + loadLittleEndian<std::uint64_t>(data, entry);
+		if (!isCompressed(chunk, column))
+			return stored;
+		//the planes are decoded behind the rows and put back together in front of them
+		const size_t rows{ getRowCount(chunk) };
+		const size_t width{ columns[column].width };
+		const size_t size{ rows * width };
+		buffer.resize(width > 1 ? 2 * size : size);
+		std::uint8_t* planes = buffer.data() + (width > 1 ? size : 0);
+		if (!decodeRuns(stored, loadLittleEndian<std::uint32_t>(data, entry + 8), planes, size))
+			return nullptr;
+		for (size_t b{ 0 }; width > 1 && b < width; ++b)
+			for (size_t r{ 0 }; r < rows; ++r)
+				buffer[r * width + b] = planes[b * rows + r];
+		return buffer.data();
+	}
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Board.h"
+#include "MappedFile.h"
+
+namespace Storage {
+	//pieces that were coming after the current one, the first is the one the player sees
+	static constexpr size_t trainingPreviewCount = 5;
+
+	//one position of a game, what the player saw, where the piece went and what it brought
+	struct TrainingRow
+	{
+		std::uint32_t game;
+		//occupied cells of every board row as bits, bit x is column x and row 0 is the top, without the piece
+		std::array<std::uint16_t, Blocks::BlockCountY> board;
+		Blocks::PieceType piece;
+		std::array<Blocks::PieceType, trainingPreviewCount> preview;
+		//the top left cell of the locked piece and its quarter turns from the layout
+		std::int8_t column;
+		std::int8_t row;
+		std::uint8_t rotation;
+		//score gained from this lock until the next piece locked or the game ended
+		std::int32_t reward;
+		//the board once the piece locked and its full rows were cleared
+		std::uint8_t lines;
+		std::uint8_t holes;
+		std::uint8_t height;
+		std::uint8_t bumpiness;
+		std::uint8_t maxHeight;
+		//the game was lost with this piece or before the next one came
+		std::uint8_t isFinal;
+	};
+
+	//the columns of a training file in the order of TrainingRow, each a fixed number of bytes per row
+	enum TrainingColumn : size_t
+	{
+		TrainingGame,
+		TrainingBoard,
+		TrainingPiece,
+		TrainingPreview,
+		TrainingPlacedColumn,
+		TrainingPlacedRow,
+		TrainingRotation,
+		TrainingReward,
+		TrainingLines,
+		TrainingHoles,
+		TrainingHeight,
+		TrainingBumpiness,
+		TrainingMaxHeight,
+		TrainingFinal,
+		TrainingColumnCount
+	};
+
+	const char* getTrainingColumnName(TrainingColumn column);
+	size_t getTrainingColumnWidth(TrainingColumn column);
+
+	//a file header with the name and width of every column, then chunks of up to chunkRows rows that each carry their own header
+	//a column of a chunk is its rows back to back in little endian at an offset aligned to 64 bytes,
+	//so a mapped chunk that is not compressed is read as plain arrays, an std::uint16_t[rows][12] board for one
+	//a compressed column is run length coded byte plane by byte plane, it is only kept when that makes it smaller
+	//there is no index at the end, a reader walks the chunk headers and a file cut short by a crash loses its last chunk only
+
+	//rows of a chunk column by column, filled a row at a time by one thread
+	class TrainingChunk
+	{
+	public:
+		explicit TrainingChunk(size_t capacity);
+
+		void add(const TrainingRow& row);
+		void clear();
+		size_t getRowCount()const;
+		bool isFull()const;
+		//the chunk as it is written to the file, a few milliseconds for a chunk of 64K rows with compression
+		void encode(bool compress, std::vector<std::uint8_t>& bytes);
+	private:
+		std::array<std::vector<std::uint8_t>, TrainingColumnCount> m_Columns;
+		//a column split into its byte planes before it is compressed
+		std::vector<std::uint8_t> m_Planes;
+		size_t m_Capacity;
+		size_t m_RowCount;
+	};
+
+	//appends encoded chunks to a training file on a thread of its own, in the order they are handed over
+	//producers only wait while maxQueued chunks are waiting for the disk, so an export runs as fast as the disk takes it
+	class TrainingWriter
+	{
+	public:
+		TrainingWriter();
+		~TrainingWriter();
+		TrainingWriter(const TrainingWriter&) = delete;
+		TrainingWriter& operator=(const TrainingWriter&) = delete;
+
+		//replaces the file at path, chunkRows is the most rows a chunk handed over may have
+		bool open(const std::string& path, std::uint32_t chunkRows);
+		//any thread, blocks while the queue is full, false once a write failed
+		bool write(std::vector<std::uint8_t>&& chunk);
+		//writes what is queued, false when any write failed
+		bool close();
+
+		//any thread
+		std::uint64_t getBytesWritten()const;
+		//time producers spent waiting for the disk and time the writer spent waiting for chunks, in microseconds
+		std::uint64_t getProducerWait()const;
+		std::uint64_t getWriterWait()const;
+	private:
+		void writeLoop();
+
+		std::ofstream m_File;
+		std::deque<std::vector<std::uint8_t>> m_Queue;
+		std::mutex m_Mutex;
+		std::condition_variable m_Queued;
+		std::condition_variable m_Taken;
+		bool m_IsClosing;
+		std::atomic<bool> m_HasFailed;
+		std::atomic<std::uint64_t> m_BytesWritten;
+		std::atomic<std::uint64_t> m_ProducerWait;
+		std::atomic<std::uint64_t> m_WriterWait;
+		std::thread m_Thread;
+	};
+
+	//a whole training file mapped, opening it reads one header per chunk and columns that are not compressed are read in place
+	class TrainingReader
+	{
+	public:
+		TrainingReader();
+
+		//fails for files that are not training files or have columns this build does not know
+		bool open(const std::string& path);
+		void close();
+
+		size_t getChunkCount()const;
+		std::uint64_t getRowCount()const;
+		size_t getRowCount(size_t chunk)const;
+		bool isCompressed(size_t chunk, TrainingColumn column)const;
+		//the file ends in a chunk that was not written whole, it is left out
+		bool isTruncated()const;
+		//getRowCount(chunk) times the column width bytes, in the mapping or decompressed into buffer
+		//nullptr for a compressed column that does not decode to its size
+		const std::uint8_t* getColumn(size_t chunk, TrainingColumn column, std::vector<std::uint8_t>& buffer)const;
+	private:
+		MappedFile m_File;
+		//offsets of the whole chunks
+		std::vector<size_t> m_Chunks;
+		std::uint64_t m_RowCount;
+		bool m_IsTruncated;
+	};
+}
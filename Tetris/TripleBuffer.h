@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace Concurrency {
+
+	//wait-free hand over of the latest value from one producer thread to one consumer thread
+	//the producer never waits and never fails, values the consumer did not pick up in time are overwritten
+	template<typename T>
+	class TripleBuffer
+	{
+	public:
+		TripleBuffer() :m_Back(0), m_Shared(1), m_Front(2) {}
+		TripleBuffer(const TripleBuffer&) = delete;
+		TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+		//producer side, fill the back slot then publish it
+		T& getBack()
+		{
+			return m_Slots[m_Back];
+		}
+
+		void publish()
+		{
+			m_Back = m_Shared.exchange(static_cast<std::uint8_t>(m_Back | freshBit), std::memory_order_acq_rel) & indexMask;
+		}
+
+		//consumer side, returns true when a newer value than the current front was published
+		bool update()
+		{
+			if ((m_Shared.load(std::memory_order_relaxed) & freshBit) == 0)
+				return false;
+			m_Front = m_Shared.exchange(m_Front, std::memory_order_acq_rel) & indexMask;
+			return true;
+		}
+
+		const T& getFront()const
+		{
+			return m_Slots[m_Front];
+		}
+	private:
+		static constexpr std::uint8_t indexMask = 3;
+		static constexpr std::uint8_t freshBit = 4;
+
+		std::array<T, 3> m_Slots;
+		std::uint8_t m_Back;
+		//index of the slot in between, freshBit is set while it holds a value the consumer has not seen
+		std::atomic<std::uint8_t> m_Shared;
+		std::uint8_t m_Front;
+	};
+}
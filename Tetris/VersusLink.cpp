@@ -0,0 +1,228 @@
+#include "VersusLink.h"
+#include <algorithm>
+
+namespace Network {
+	static constexpr sf::Uint8 protocolVersion = 2;
+	//an idle side still tells the other how far it got, that is what lets the other run on
+	static const sf::Time heartbeatInterval = sf::milliseconds(66);
+	static const sf::Time connectionTimeout = sf::seconds(3);
+	//the first round trips are not known yet
+	static const sf::Time initialRoundTrip = sf::milliseconds(100);
+	//what every datagram costs on the wire besides its payload
+	static constexpr std::uint64_t udpIpHeaderSize = 28;
+	//unacknowledged inputs beyond these wait for a later packet
+	static constexpr std::uint64_t maxInputsPerPacket = 64;
+
+	static constexpr sf::Uint8 hasGreetingFlag = 1;
+	static constexpr sf::Uint8 hasAckFlag = 2;
+	static constexpr sf::Uint8 pressedBit = 0x80;
+
+	//wrap around aware, a sequence up to half the range ahead is newer
+	static bool isNewer(std::uint16_t sequence, std::uint16_t than)
+	{
+		return static_cast<std::int16_t>(sequence - than) > 0;
+	}
+
+	VersusLink::VersusLink()
+		:m_IsOpen(false), m_LocalPort(0), m_RemotePort(0), m_Greeting{}, m_HasRemoteGreeting(false), m_RemoteGreeting{},
+		m_Sequence(0), m_SendTimes{}, m_LastSentInputCount(0), m_HasReceived(false), m_LatestReceived(0), m_HasAck(false), m_LatestAck(0),
+		m_RoundTrip(initialRoundTrip), m_RemoteTick(0), m_SimulatedLoss(0), m_Random(std::random_device{}()),
+		m_BytesSent(0), m_BytesReceived(0), m_PacketsSent(0), m_PacketsReceived(0)
+	{
+	}
+
+	bool VersusLink::open(unsigned short localPort, const sf::IpAddress& remoteAddress, unsigned short remotePort)
+	{
+		m_Socket.setBlocking(false);
+		if (remoteAddress == sf::IpAddress::None || m_Socket.bind(localPort) != sf::Socket::Done)
+			return false;
+		m_RemoteAddress = remoteAddress;
+		m_LocalPort = localPort;
+		m_RemotePort = remotePort;
+		m_IsOpen = true;
+		return true;
+	}
+
+	bool VersusLink::isOpen() const
+	{
+		return m_IsOpen;
+	}
+
+	void VersusLink::simulateConditions(sf::Time latency, unsigned lossPercent)
+	{
+		m_SimulatedLatency = latency;
+		m_SimulatedLoss = std::min(lossPercent, 100u);
+	}
+
+	void VersusLink::setGreeting(const Greeting& greeting)
+	{
+		m_Greeting = greeting;
+	}
+
+	bool VersusLink::hasRemoteGreeting() const
+	{
+		return m_HasRemoteGreeting;
+	}
+
+	const Greeting& VersusLink::getRemoteGreeting() const
+	{
+		return m_RemoteGreeting;
+	}
+
+	bool VersusLink::isFirstPlayer() const
+	{
+		//equal seeds only happen when a game is played against itself, the ports tell the sides apart then
+		if (m_Greeting.seed != m_RemoteGreeting.seed)
+			return m_Greeting.seed < m_RemoteGreeting.seed;
+		return m_LocalPort < m_RemotePort;
+	}
+
+	void VersusLink::receive(Rules::RollbackMatch* match, sf::Time now)
+	{
+		if (!m_IsOpen)
+			return;
+		flushDelayed(now);
+		sf::Packet packet;
+		sf::IpAddress sender;
+		unsigned short port{ 0 };
+		while (m_Socket.receive(packet, sender, port) == sf::Socket::Done) {
+			if (sender != m_RemoteAddress || port != m_RemotePort)
+				continue;
+			m_BytesReceived += packet.getDataSize() + udpIpHeaderSize;
+			m_PacketsReceived += 1;
+			sf::Uint8 version{ 0 }, flags{ 0 }, inputCount{ 0 };
+			sf::Uint16 sequence{ 0 }, ack{ 0 }, ackDelay{ 0 };
+			sf::Uint32 tick{ 0 }, inputsReceived{ 0 }, firstInput{ 0 };
+			Greeting greeting{};
+			if (!(packet >> version >> flags >> sequence) || version != protocolVersion
+				|| ((flags & hasAckFlag) != 0 && !(packet >> ack >> ackDelay))
+				|| ((flags & hasGreetingFlag) != 0 && !(packet >> greeting.seed >> greeting.startLevel >> greeting.settings))
+				|| !(packet >> tick >> inputsReceived >> firstInput >> inputCount) || inputCount > maxInputsPerPacket)
+				continue;
+			std::array<Rules::TimedInput, maxInputsPerPacket> inputs;
+			bool isValid{ true };
+			for (sf::Uint8 i{ 0 }; i < inputCount && isValid; ++i) {
+				sf::Uint32 inputTick{ 0 };
+				sf::Uint8 code{ 0 };
+				isValid = static_cast<bool>(packet >> inputTick >> code);
+				inputs[i] = { inputTick, static_cast<Rules::Input>(code & ~pressedBit), (code & pressedBit) != 0 };
+			}
+			if (!isValid || !packet.endOfPacket())
+				continue;
+
+			if ((flags & hasGreetingFlag) != 0 && !m_HasRemoteGreeting) {
+				m_RemoteGreeting = greeting;
+				m_HasRemoteGreeting = true;
+			}
+			//a late packet still brings inputs, but the clock and the round trip go by the newest only
+			if (!m_HasReceived || isNewer(sequence, m_LatestReceived)) {
+				m_HasReceived = true;
+				m_LatestReceived = sequence;
+				m_LastReceiveTime = now;
+				m_RemoteTick = tick;
+			}
+			if ((flags & hasAckFlag) != 0 && static_cast<std::uint16_t>(m_Sequence - ack) <= sendHistorySize && (!m_HasAck || isNewer(ack, m_LatestAck))) {
+				const sf::Time roundTrip = now - m_SendTimes[ack % sendHistorySize] - sf::milliseconds(ackDelay);
+				//smoothed like tcp does, one slow packet barely moves it
+				m_RoundTrip = m_HasAck ? (m_RoundTrip * 7ll + std::max(roundTrip, sf::Time::Zero)) / 8ll : roundTrip;
+				m_HasAck = true;
+				m_LatestAck = ack;
+			}
+			if (!match)
+				continue;
+			match->acknowledgeLocalInputs(inputsReceived);
+			for (sf::Uint8 i{ 0 }; i < inputCount && isValid; ++i)
+				isValid = match->addRemoteInput(firstInput + i, inputs[i]);
+			//the tick only completes the inputs when all of them could be taken
+			if (isValid)
+				match->setRemoteKnownUntil(tick);
+		}
+	}
+
+	void VersusLink::send(const Rules::RollbackMatch* match, sf::Time now)
+	{
+		if (!m_IsOpen)
+			return;
+		flushDelayed(now);
+		const std::uint64_t inputCount = match ? match->getLocalInputCount() : 0;
+		if (m_PacketsSent != 0 && inputCount == m_LastSentInputCount && now - m_LastSendTime < heartbeatInterval)
+			return;
+
+		//inputs at the current tick can still follow, the tick sent is the first that is not complete yet
+		const std::uint64_t firstInput = match ? match->getAcknowledgedLocalInputs() : 0;
+		const std::uint64_t count = std::min(inputCount - firstInput, maxInputsPerPacket);
+		sf::Packet packet;
+		packet << protocolVersion << static_cast<sf::Uint8>((m_HasAck ? 0 : hasGreetingFlag) | (m_HasReceived ? hasAckFlag : 0)) << m_Sequence;
+		if (m_HasReceived)
+			packet << m_LatestReceived << static_cast<sf::Uint16>(std::min<sf::Int64>((now - m_LastReceiveTime).asMilliseconds(), 0xffff));
+		if (!m_HasAck)
+			packet << m_Greeting.seed << m_Greeting.startLevel << m_Greeting.settings;
+		packet << static_cast<sf::Uint32>(match ? match->getTick() : 0) << static_cast<sf::Uint32>(match ? match->getRemoteInputCount() : 0)
+			<< static_cast<sf::Uint32>(firstInput) << static_cast<sf::Uint8>(count);
+		for (std::uint64_t sequence{ firstInput }; sequence < firstInput + count; ++sequence) {
+			const Rules::TimedInput& input = match->getLocalInput(sequence);
+			packet << static_cast<sf::Uint32>(input.tick) << static_cast<sf::Uint8>(input.input | (input.isPressed ? pressedBit : 0));
+		}
+
+		transmit(packet, now);
+		m_SendTimes[m_Sequence % sendHistorySize] = now;
+		m_Sequence += 1;
+		m_LastSendTime = now;
+		m_LastSentInputCount = inputCount;
+		m_BytesSent += packet.getDataSize() + udpIpHeaderSize;
+		m_PacketsSent += 1;
+	}
+
+	bool VersusLink::isConnected(sf::Time now) const
+	{
+		return m_HasReceived && now - m_LastReceiveTime < connectionTimeout;
+	}
+
+	std::int64_t VersusLink::getTicksAhead(Timing::Tick localTick, sf::Time now) const
+	{
+		if (!m_HasReceived)
+			return 0;
+		const Timing::Tick remoteTick = m_RemoteTick + Timing::microsecondsToTicks((now - m_LastReceiveTime + m_RoundTrip / 2ll).asMicroseconds());
+		return static_cast<std::int64_t>(localTick) - static_cast<std::int64_t>(remoteTick);
+	}
+
+	sf::Time VersusLink::getRoundTrip() const
+	{
+		return m_RoundTrip;
+	}
+
+	void VersusLink::report(std::ostream& out, sf::Time elapsed) const
+	{
+		const float seconds = elapsed.asSeconds();
+		if (seconds <= 0.f)
+			return;
+		out << "versus: sent " << m_PacketsSent << " packets, " << static_cast<float>(m_BytesSent) / seconds << " B/s, "
+			<< "received " << m_PacketsReceived << " packets, " << static_cast<float>(m_BytesReceived) / seconds << " B/s, "
+			<< "round trip " << m_RoundTrip.asMilliseconds() << " ms\n";
+	}
+
+	void VersusLink::transmit(sf::Packet& packet, sf::Time now)
+	{
+		if (m_SimulatedLatency == sf::Time::Zero && m_SimulatedLoss == 0) {
+			m_Socket.send(packet, m_RemoteAddress, m_RemotePort);
+			return;
+		}
+		if (m_Random() % 100 < m_SimulatedLoss)
+			return;
+		const sf::Int64 jitter = m_SimulatedLatency.asMicroseconds() / 10;
+		const sf::Int64 delay = m_SimulatedLatency.asMicroseconds() - jitter
+			+ (jitter == 0 ? 0 : static_cast<sf::Int64>(m_Random() % static_cast<std::uint32_t>(2 * jitter + 1)));
+		const char* data = static_cast<const char*>(packet.getData());
+		m_Delayed.push_back({ now + sf::microseconds(delay), std::vector<char>(data, data + packet.getDataSize()) });
+	}
+
+	void VersusLink::flushDelayed(sf::Time now)
+	{
+		//a udp packet goes out as its bytes, nothing is added in front of them
+		const auto isDue = [now](const DelayedPacket& delayed) { return delayed.due <= now; };
+		for (const auto& delayed : m_Delayed)
+			if (isDue(delayed))
+				m_Socket.send(delayed.data.data(), delayed.data.size(), m_RemoteAddress, m_RemotePort);
+		m_Delayed.erase(std::remove_if(m_Delayed.begin(), m_Delayed.end(), isDue), m_Delayed.end());
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <SFML/Network.hpp>
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <random>
+#include <vector>
+#include "Rollback.h"
+
+namespace Network {
+	//what a side sends until the opponent answers, enough for both to set up the same match
+	struct Greeting
+	{
+		std::uint32_t seed;
+		std::uint8_t startLevel;
+		//a hash of the gravity table, both sides play both games so they must agree on it
+		std::uint32_t settings;
+	};
+
+	//one udp socket to the opponent, never blocks
+	//both sides play the whole match and exchange inputs only: every packet repeats the inputs the opponent has
+	//not acknowledged and the tick the sender is at, so a lost packet costs nothing but the wait for the next one
+	class VersusLink
+	{
+	public:
+		VersusLink();
+
+		bool open(unsigned short localPort, const sf::IpAddress& remoteAddress, unsigned short remotePort);
+		bool isOpen()const;
+		//for testing over localhost, every outgoing packet is held back for about latency and lossPercent of them are dropped
+		//the delay jitters by a tenth of it, so packets arrive out of order as well
+		void simulateConditions(sf::Time latency, unsigned lossPercent);
+		void setGreeting(const Greeting& greeting);
+		bool hasRemoteGreeting()const;
+		const Greeting& getRemoteGreeting()const;
+		//the side with the smaller seed plays the first game of the match
+		bool isFirstPlayer()const;
+		//drains the socket and hands the opponent's inputs to the match, without a match only its greeting is taken
+		void receive(Rules::RollbackMatch* match, sf::Time now);
+		//sends new local inputs right away and a heartbeat with the local tick otherwise
+		void send(const Rules::RollbackMatch* match, sf::Time now);
+		//whether the opponent was heard from recently
+		bool isConnected(sf::Time now)const;
+		//how far the local match is ahead of the opponent's, from its last tick and half the round trip
+		std::int64_t getTicksAhead(Timing::Tick localTick, sf::Time now)const;
+		sf::Time getRoundTrip()const;
+		//bytes per second both ways including udp and ip headers
+		void report(std::ostream& out, sf::Time elapsed)const;
+	private:
+		//send times by sequence, a round trip is measured whenever a newer packet is acknowledged
+		static constexpr size_t sendHistorySize = 64;
+		struct DelayedPacket
+		{
+			sf::Time due;
+			std::vector<char> data;
+		};
+		void transmit(sf::Packet& packet, sf::Time now);
+		void flushDelayed(sf::Time now);
+
+		sf::UdpSocket m_Socket;
+		bool m_IsOpen;
+		sf::IpAddress m_RemoteAddress;
+		unsigned short m_LocalPort;
+		unsigned short m_RemotePort;
+		Greeting m_Greeting;
+		bool m_HasRemoteGreeting;
+		Greeting m_RemoteGreeting;
+		std::uint16_t m_Sequence;
+		std::array<sf::Time, sendHistorySize> m_SendTimes;
+		sf::Time m_LastSendTime;
+		std::uint64_t m_LastSentInputCount;
+		//newest sequence of the opponent and the newest of ours it acknowledged
+		bool m_HasReceived;
+		std::uint16_t m_LatestReceived;
+		sf::Time m_LastReceiveTime;
+		bool m_HasAck;
+		std::uint16_t m_LatestAck;
+		sf::Time m_RoundTrip;
+		//the opponent's tick in its newest packet
+		Timing::Tick m_RemoteTick;
+		//the latency and loss simulator
+		sf::Time m_SimulatedLatency;
+		unsigned m_SimulatedLoss;
+		std::minstd_rand m_Random;
+		std::vector<DelayedPacket> m_Delayed;
+		std::uint64_t m_BytesSent;
+		std::uint64_t m_BytesReceived;
+		std::uint64_t m_PacketsSent;
+		std::uint64_t m_PacketsReceived;
+	};
+}
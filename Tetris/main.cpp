@@ -1,7 +1,72 @@
 #include "Game.h"
+#include <iostream>
+#include <string>
+#include "DeterminismCheck.h"
 
-int main()
+int main(int argc, char* argv[])
 {
+	//runs without a window, so it is handled before the game opens one
+	for (int i{ 1 }; i < argc; ++i)
+		if (std::string{ argv[i] } == "--determinism-check")
+			return Instrumentation::checkDeterminism(std::cout) ? 0 : 1;
 	Game game{};
+	std::string savePath{ Storage::getDefaultSavePath() };
+	bool resume{ true };
+	//packets to the opponent held back and dropped, for trying versus play over localhost
+	sf::Time versusLatency;
+	unsigned versusLoss{ 0 };
+	for (int i{ 1 }; i < argc; ++i) {
+		const std::string arg{ argv[i] };
+		if (arg == "--latency")
+			game.enableLatencyProbe(i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : "");
+		else if (arg == "--metrics" && i + 1 < argc) {
+			const unsigned short port = static_cast<unsigned short>(std::stoul(argv[++i]));
+			if (!game.enableMetrics(port))
+				std::cerr << "failed to serve metrics on port " << port << '\n';
+		}
+		else if (arg == "--submit-scores" && i + 1 < argc) {
+			if (!game.enableScoreSubmission(argv[++i]))
+				std::cerr << "not an http url: " << argv[i] << '\n';
+		}
+		else if (arg == "--inject" && i + 1 < argc)
+			game.enableInputInjection(static_cast<unsigned>(std::stoul(argv[++i])));
+		else if (arg == "--colourblind")
+			game.setPalette(Blocks::getColourblindPalette());
+		else if (arg == "--save" && i + 1 < argc)
+			savePath = argv[++i];
+		else if (arg == "--new-game")
+			resume = false;
+		else if (arg == "--rewind" && i + 1 < argc)
+			game.setRewindBudget(static_cast<size_t>(std::stoul(argv[++i])) * 1024);
+		else if (arg == "--level" && i + 1 < argc)
+			game.setStartLevel(static_cast<unsigned>(std::stoul(argv[++i])));
+		else if (arg == "--gravity" && i + 1 < argc) {
+			Rules::GravityTable gravity;
+			if (Rules::loadGravityTable(argv[++i], gravity))
+				game.setGravityTable(gravity);
+			else
+				std::cerr << "failed to load gravity table " << argv[i] << '\n';
+		}
+		else if (arg == "--versus" && i + 3 < argc) {
+			const unsigned short localPort = static_cast<unsigned short>(std::stoul(argv[++i]));
+			const sf::IpAddress remoteAddress{ argv[++i] };
+			if (!game.enableVersus(localPort, remoteAddress, static_cast<unsigned short>(std::stoul(argv[++i]))))
+				std::cerr << "failed to open versus port " << localPort << '\n';
+		}
+		else if (arg == "--royale") {
+			if (!game.enableRoyale())
+				std::cerr << "a royale cannot be played in a versus match\n";
+		}
+		else if (arg == "--versus-latency" && i + 1 < argc)
+			versusLatency = sf::milliseconds(std::stoi(argv[++i]));
+		else if (arg == "--versus-loss" && i + 1 < argc)
+			versusLoss = static_cast<unsigned>(std::stoul(argv[++i]));
+		else if (arg == "--skin" && i + 2 < argc) {
+			const std::string packPath{ argv[++i] };
+			game.setSkin(packPath, argv[++i]);
+		}
+	}
+	game.simulateVersusConditions(versusLatency, versusLoss);
+	game.setSavePath(savePath, resume);
 	game.run();
-}
\ No newline at end of file
+}
@@ -0,0 +1,378 @@
+#include "Exporter.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Bot.h"
+#include "Replay.h"
+#include "Simulation.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+namespace Training {
+	static const std::string replayExtension = ".replay";
+	//replays are a few kilobytes, anything this big is not one
+	static constexpr std::streamoff maxReplaySize = 1024 * 1024;
+
+	void ExportTotals::add(const ExportTotals& totals)
+	{
+		games += totals.games;
+		positions += totals.positions;
+		ticks += totals.ticks;
+		skipped += totals.skipped;
+	}
+
+	//what a thread keeps from one game to the next, rows go into its own chunk and only a full chunk is handed to the writer
+	struct Worker
+	{
+		Worker(Storage::TrainingWriter& output, const ExportSettings& settings)
+			:writer(output), chunk(settings.chunkRows), compress(settings.compress), totals{}
+		{
+		}
+
+		Storage::TrainingWriter& writer;
+		Storage::TrainingChunk chunk;
+		bool compress;
+		std::vector<std::uint8_t> bytes;
+		std::vector<std::uint8_t> file;
+		Storage::Replay replay;
+		ExportTotals totals;
+	};
+
+	//encoding and compressing happen here on the thread that played the games, the writer thread only writes
+	static void flushChunk(Worker& worker)
+	{
+		if (worker.chunk.getRowCount() == 0)
+			return;
+		worker.chunk.encode(worker.compress, worker.bytes);
+		worker.writer.write(std::move(worker.bytes));
+		worker.bytes = {};
+		worker.chunk.clear();
+	}
+
+	static void addRow(Worker& worker, const Storage::TrainingRow& row)
+	{
+		worker.chunk.add(row);
+		worker.totals.positions += 1;
+		if (worker.chunk.isFull())
+			flushChunk(worker);
+	}
+
+	//quarter turns from the layout, found by the cells relative to the rotation cell like the bot compares rotations
+	static std::uint8_t getRotation(const Rules::Piece& piece)
+	{
+		Rules::Piece layout = Rules::getLayout(piece.type);
+		for (std::uint8_t rotation{ 0 }; rotation < 4; ++rotation, layout = Rules::getRotated(layout)) {
+			bool isSame{ true };
+			for (size_t i{ 0 }; i < piece.cells.size(); ++i)
+				isSame = isSame && piece.cells[i] - piece.rotationCell == layout.cells[i] - layout.rotationCell;
+			if (isSame)
+				return rotation;
+		}
+		return 0;
+	}
+
+	//the board with the piece locked and the full rows cleared, on column bits like the bot evaluates a placement
+	static void setFeatures(Rules::Columns columns, const Rules::Piece& piece, Storage::TrainingRow& row)
+	{
+		for (const auto& cell : piece.cells)
+			columns[cell.x] = static_cast<std::uint16_t>(columns[cell.x] | 1 << cell.y);
+		std::uint32_t fullRows{ (1u << Blocks::BlockCountY) - 1 };
+		for (const auto column : columns)
+			fullRows &= column;
+		int lines{ 0 };
+		for (int y{ 0 }; y < Blocks::BlockCountY; ++y) {
+			if ((fullRows >> y & 1) == 0)
+				continue;
+			lines += 1;
+			const std::uint32_t above = (1u << y) - 1;
+			for (auto& column : columns)
+				column = static_cast<std::uint16_t>((column & ~(above | 1u << y)) | (column & above) << 1);
+		}
+		int height{ 0 }, holes{ 0 }, bumpiness{ 0 }, maxHeight{ 0 }, previous{ -1 };
+		for (const auto column : columns) {
+			int top{ 0 };
+			while (top < Blocks::BlockCountY && (column >> top & 1) == 0)
+				top += 1;
+			const int columnHeight = Blocks::BlockCountY - top;
+			int filled{ 0 };
+			for (std::uint32_t bits{ column }; bits != 0; bits &= bits - 1)
+				filled += 1;
+			holes += columnHeight - filled;
+			height += columnHeight;
+			maxHeight = std::max(maxHeight, columnHeight);
+			if (previous >= 0)
+				bumpiness += std::abs(columnHeight - previous);
+			previous = columnHeight;
+		}
+		row.lines = static_cast<std::uint8_t>(lines);
+		row.holes = static_cast<std::uint8_t>(holes);
+		row.height = static_cast<std::uint8_t>(height);
+		row.bumpiness = static_cast<std::uint8_t>(bumpiness);
+		row.maxHeight = static_cast<std::uint8_t>(maxHeight);
+	}
+
+	//everything of a row but its reward, from the lock alone
+	static Storage::TrainingRow getRow(std::uint32_t game, const Rules::LockedPiece& lock)
+	{
+		Storage::TrainingRow row{};
+		row.game = game;
+		for (int x{ 0 }; x < Blocks::BlockCountX; ++x)
+			for (std::uint32_t bits{ lock.board[x] }; bits != 0; bits &= bits - 1) {
+				int y{ 0 };
+				while ((bits >> y & 1) == 0)
+					y += 1;
+				row.board[y] = static_cast<std::uint16_t>(row.board[y] | 1 << x);
+			}
+		row.piece = lock.piece.type;
+		std::uint32_t state{ lock.randomState };
+		for (size_t i{ 0 }; i < row.preview.size(); ++i, state = Rules::getNextRandomState(state))
+			row.preview[i] = Rules::getPieceOfState(state);
+		int column{ Blocks::BlockCountX }, top{ Blocks::BlockCountY };
+		for (const auto& cell : lock.piece.cells) {
+			column = std::min(column, cell.x);
+			top = std::min(top, cell.y);
+		}
+		row.column = static_cast<std::int8_t>(column);
+		row.row = static_cast<std::int8_t>(top);
+		row.rotation = getRotation(lock.piece);
+		setFeatures(lock.board, lock.piece, row);
+		return row;
+	}
+
+	//turns the locks of one game into rows as the simulation goes, a row is written once the reward of its piece is known
+	class Recorder
+	{
+	public:
+		Recorder(std::uint32_t game, Worker& worker)
+			:m_Worker(worker), m_Game(game), m_Row{}, m_Score(0), m_IsPending(false), m_TopOuts(0)
+		{
+		}
+
+		//after every call of advance with what it returned
+		void observe(const Rules::Simulation& game, bool hasLocked)
+		{
+			//most calls end at a tick the bot acts at, with nothing to record
+			const bool hasEnded = game.getTopOuts() != m_TopOuts;
+			if (!hasLocked && !hasEnded)
+				return;
+			m_TopOuts = game.getTopOuts();
+			const std::uint32_t endScore{ game.getLastGame().score };
+			if (!hasLocked) {
+				//the next piece did not fit, the one before it lost the game
+				if (m_IsPending)
+					write(endScore, true);
+				return;
+			}
+			//a piece that locks in the top row ends the game at once, the board is the next game's by now
+			const Rules::LockedPiece& lock = game.getLastLock();
+			const bool isFinal = std::any_of(lock.piece.cells.begin(), lock.piece.cells.end(), [](const sf::Vector2i& cell) { return cell.y == 0; });
+			//lines are cleared a while after the lock, the score before the next lock holds them
+			if (m_IsPending)
+				write(hasEnded ? endScore : game.getScore(), hasEnded && !isFinal);
+			m_Row = getRow(m_Game, lock);
+			m_Score = hasEnded && isFinal ? endScore : game.getScore();
+			m_IsPending = true;
+			if (isFinal)
+				write(m_Score, true);
+		}
+
+		//the game stops before it was lost, the last piece gets the score up to here
+		void finish(const Rules::Simulation& game)
+		{
+			if (m_IsPending && game.getTopOuts() == m_TopOuts)
+				write(game.getScore(), false);
+		}
+	private:
+		void write(std::uint32_t score, bool isFinal)
+		{
+			m_Row.reward = static_cast<std::int32_t>(score - m_Score);
+			m_Row.isFinal = isFinal ? 1 : 0;
+			addRow(m_Worker, m_Row);
+			m_IsPending = false;
+		}
+
+		Worker& m_Worker;
+		std::uint32_t m_Game;
+		Storage::TrainingRow m_Row;
+		//before the piece of m_Row locked
+		std::uint32_t m_Score;
+		bool m_IsPending;
+		unsigned m_TopOuts;
+	};
+
+	//returns at tick or right after the lock that lost the game
+	static void advance(Rules::Simulation& game, Timing::Tick tick, Recorder& recorder)
+	{
+		for (;;) {
+			const bool hasLocked = game.advance(tick);
+			recorder.observe(game, hasLocked);
+			if (!hasLocked || game.getTopOuts() != 0)
+				return;
+		}
+	}
+
+	//a bot from a random seed and start level as the replay verifier generates them, until its first top out
+	static void playBot(std::uint32_t index, std::uint32_t seed, Worker& worker)
+	{
+		Rules::Simulation game(seed);
+		game.setStartLevel(seed % 8);
+		Rules::Bot bot(seed, 12 + seed % 12);
+		Recorder recorder(index, worker);
+		while (game.getTopOuts() == 0) {
+			advance(game, std::max(bot.getNextTick(), game.getTick() + 1), recorder);
+			Rules::Input key{ Rules::InputCount };
+			bool isPressed{ false };
+			if (game.getTopOuts() == 0 && bot.act(game, key, isPressed))
+				game.apply(key, isPressed);
+		}
+		worker.totals.games += 1;
+		worker.totals.ticks += game.getTick();
+	}
+
+	//inputs the simulation can take, in order and within the game
+	static bool isPlayable(const Storage::Replay& replay)
+	{
+		Timing::Tick tick{ 0 };
+		for (const auto& input : replay.inputs) {
+			if ((input.code & ~Storage::replayPressedBit) >= Rules::InputCount || input.tick < tick || input.tick > replay.endTick)
+				return false;
+			tick = input.tick;
+		}
+		return replay.startLevel < Rules::levelCount;
+	}
+
+	static void playReplay(std::uint32_t index, const Storage::Replay& replay, Worker& worker)
+	{
+		Rules::Simulation game(replay.seed);
+		game.setStartLevel(replay.startLevel);
+		Recorder recorder(index, worker);
+		for (const auto& input : replay.inputs) {
+			advance(game, input.tick, recorder);
+			if (game.getTopOuts() != 0)
+				break;
+			game.apply(static_cast<Rules::Input>(input.code & ~Storage::replayPressedBit), (input.code & Storage::replayPressedBit) != 0);
+		}
+		if (game.getTopOuts() == 0)
+			advance(game, replay.endTick, recorder);
+		recorder.finish(game);
+		worker.totals.games += 1;
+		worker.totals.ticks += game.getTick();
+	}
+
+	static bool hasReplayExtension(const std::string& name)
+	{
+		return name.size() > replayExtension.size() && name.compare(name.size() - replayExtension.size(), replayExtension.size(), replayExtension) == 0;
+	}
+
+	//names of the replay files, sorted so that game numbers stay the same from one export to the next
+	static std::vector<std::string> listReplays(const std::string& directory)
+	{
+		std::vector<std::string> names;
+#ifdef _WIN32
+		WIN32_FIND_DATAA found;
+		const HANDLE search = FindFirstFileA((directory + "\\*" + replayExtension).c_str(), &found);
+		if (search != INVALID_HANDLE_VALUE) {
+			do {
+				if ((found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0 && hasReplayExtension(found.cFileName))
+					names.push_back(found.cFileName);
+			} while (FindNextFileA(search, &found));
+			FindClose(search);
+		}
+#else
+		if (DIR* listing = opendir(directory.c_str())) {
+			while (const dirent* entry = readdir(listing))
+				if (hasReplayExtension(entry->d_name))
+					names.push_back(entry->d_name);
+			closedir(listing);
+		}
+#endif
+		std::sort(names.begin(), names.end());
+		return names;
+	}
+
+	static std::string joinPath(const std::string& directory, const std::string& name)
+	{
+#ifdef _WIN32
+		return directory + '\\' + name;
+#else
+		return directory + '/' + name;
+#endif
+	}
+
+	static bool readFile(const std::string& path, std::vector<std::uint8_t>& bytes)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file)
+			return false;
+		const std::streamoff size = file.tellg();
+		if (size <= 0 || size > maxReplaySize)
+			return false;
+		bytes.resize(static_cast<size_t>(size));
+		file.seekg(0);
+		return static_cast<bool>(file.read(reinterpret_cast<char*>(bytes.data()), size));
+	}
+
+	//runs work on every worker, one of them on the calling thread, and adds up what they did
+	template<typename Work>
+	static ExportTotals runWorkers(Storage::TrainingWriter& writer, const ExportSettings& settings, Work work)
+	{
+		std::vector<Worker> workers;
+		for (size_t i{ 0 }; i < std::max<size_t>(1, settings.threadCount); ++i)
+			workers.emplace_back(writer, settings);
+		const auto run = [&work](Worker& worker) {
+			work(worker);
+			flushChunk(worker);
+		};
+		std::vector<std::thread> threads;
+		for (size_t i{ 1 }; i < workers.size(); ++i)
+			threads.emplace_back(run, std::ref(workers[i]));
+		run(workers[0]);
+		for (auto& thread : threads)
+			thread.join();
+
+		ExportTotals totals{};
+		for (const auto& worker : workers)
+			totals.add(worker.totals);
+		return totals;
+	}
+
+	ExportTotals exportBotGames(Storage::TrainingWriter& writer, const ExportSettings& settings, std::uint64_t positions, std::uint32_t seed)
+	{
+		//games are taken one at a time from a shared counter, a long game on one thread does not hold up the others
+		std::atomic<std::uint32_t> next{ 0 };
+		std::atomic<std::uint64_t> written{ 0 };
+		return runWorkers(writer, settings, [&](Worker& worker) {
+			while (written < positions) {
+				const std::uint32_t index = next++;
+				const std::uint64_t before{ worker.totals.positions };
+				playBot(index, Rules::getSeededRandomState(seed + index * 7919), worker);
+				written += worker.totals.positions - before;
+			}
+		});
+	}
+
+	ExportTotals exportReplays(Storage::TrainingWriter& writer, const ExportSettings& settings, const std::string& directory)
+	{
+		const std::vector<std::string> names = listReplays(directory);
+		std::atomic<size_t> next{ 0 };
+		return runWorkers(writer, settings, [&](Worker& worker) {
+			for (size_t index = next++; index < names.size(); index = next++) {
+				if (readFile(joinPath(directory, names[index]), worker.file) && Storage::decodeReplay(worker.file.data(), worker.file.size(), worker.replay)
+					&& isPlayable(worker.replay))
+					playReplay(static_cast<std::uint32_t>(index), worker.replay, worker);
+				else
+					worker.totals.skipped += 1;
+			}
+		});
+	}
+}
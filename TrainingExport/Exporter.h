@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "TrainingData.h"
+
+namespace Training {
+	//what an export went through, added up over its threads
+	struct ExportTotals
+	{
+		std::uint64_t games;
+		std::uint64_t positions;
+		//game ticks simulated
+		std::uint64_t ticks;
+		//replays that did not decode and were left out
+		std::uint64_t skipped;
+
+		void add(const ExportTotals& totals);
+	};
+
+	//how the rows are cut into chunks and written
+	struct ExportSettings
+	{
+		size_t chunkRows;
+		bool compress;
+		size_t threadCount;
+	};
+
+	//bots from seeds derived from seed play a game each until they top out, on threadCount threads,
+	//games are started until positions rows are written, the last ones to finish add a few more
+	ExportTotals exportBotGames(Storage::TrainingWriter& writer, const ExportSettings& settings, std::uint64_t positions, std::uint32_t seed);
+	//plays every .replay file of directory to its end, the games of players as the leaderboard got them
+	ExportTotals exportReplays(Storage::TrainingWriter& writer, const ExportSettings& settings, const std::string& directory);
+}
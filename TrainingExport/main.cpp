@@ -0,0 +1,141 @@
+#include <SFML/System.hpp>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Exporter.h"
+
+//64K rows are about 3MB, big enough that the headers cost nothing and small enough for a reader to decompress one at a time
+static constexpr size_t defaultChunkRows = 64 * 1024;
+static constexpr size_t maxChunkRows = 1024 * 1024;
+
+static void report(const Training::ExportTotals& totals, const Storage::TrainingWriter& writer, sf::Time elapsed, size_t threadCount)
+{
+	const float seconds = std::max(elapsed.asSeconds(), 0.001f);
+	std::cerr << "exported " << totals.positions << " positions of " << totals.games << " games on " << threadCount << " threads in " << seconds << " s";
+	if (totals.skipped != 0)
+		std::cerr << ", " << totals.skipped << " replays skipped";
+	std::cerr << '\n' << totals.positions / seconds / 1e6f << " M positions/s, " << totals.ticks / seconds / 1e6f << " M ticks/s, "
+		<< writer.getBytesWritten() / seconds / 1e6f << " MB/s, " << static_cast<float>(writer.getBytesWritten()) / std::max<std::uint64_t>(1, totals.positions)
+		<< " bytes per position\n";
+	//the games waited for the disk, or the disk for the games
+	std::cerr << "producers waited " << writer.getProducerWait() / 1e6f << " s for the writer, the writer waited " << writer.getWriterWait() / 1e6f
+		<< " s for chunks\n";
+}
+
+//reads every column of every chunk and checks that the rows make sense, a row's first preview is the piece of the row after it
+static bool check(const std::string& path)
+{
+	Storage::TrainingReader reader;
+	if (!reader.open(path)) {
+		std::cerr << path << " is not a training file\n";
+		return false;
+	}
+	sf::Clock clock;
+	std::vector<std::vector<std::uint8_t>> buffers(Storage::TrainingColumnCount);
+	std::vector<const std::uint8_t*> columns(Storage::TrainingColumnCount);
+	std::uint64_t bad{ 0 }, finals{ 0 }, compressed{ 0 }, bytes{ 0 };
+	for (size_t chunk{ 0 }; chunk < reader.getChunkCount(); ++chunk) {
+		const size_t rows{ reader.getRowCount(chunk) };
+		bool isWhole{ true };
+		for (size_t column{ 0 }; column < Storage::TrainingColumnCount; ++column) {
+			const auto id = static_cast<Storage::TrainingColumn>(column);
+			columns[column] = reader.getColumn(chunk, id, buffers[column]);
+			isWhole = isWhole && columns[column] != nullptr;
+			compressed += reader.isCompressed(chunk, id) ? 1 : 0;
+			bytes += rows * Storage::getTrainingColumnWidth(id);
+		}
+		if (!isWhole) {
+			bad += rows;
+			continue;
+		}
+		for (size_t row{ 0 }; row < rows; ++row) {
+			const std::uint8_t piece{ columns[Storage::TrainingPiece][row] };
+			const std::uint8_t* preview = columns[Storage::TrainingPreview] + row * Storage::trainingPreviewCount;
+			const auto column = static_cast<std::int8_t>(columns[Storage::TrainingPlacedColumn][row]);
+			const std::uint8_t isFinal{ columns[Storage::TrainingFinal][row] };
+			bool isSane = piece != Blocks::Empty && piece < Blocks::PieceTypeCount && column >= 0 && column < Blocks::BlockCountX
+				&& columns[Storage::TrainingRotation][row] < 4 && isFinal <= 1 && columns[Storage::TrainingLines][row] <= 4;
+			for (size_t y{ 0 }; y < Blocks::BlockCountY; ++y) {
+				const std::uint8_t* mask = columns[Storage::TrainingBoard] + (row * Blocks::BlockCountY + y) * 2;
+				isSane = isSane && (mask[0] | mask[1] << 8) < 1 << Blocks::BlockCountX;
+			}
+			const std::uint8_t* game = columns[Storage::TrainingGame] + row * 4;
+			if (row + 1 < rows && isFinal == 0 && std::equal(game, game + 4, game + 4))
+				isSane = isSane && preview[0] == columns[Storage::TrainingPiece][row + 1];
+			bad += isSane ? 0 : 1;
+			finals += isFinal;
+		}
+	}
+	const float seconds = std::max(clock.getElapsedTime().asSeconds(), 0.001f);
+	std::cerr << reader.getRowCount() << " positions in " << reader.getChunkCount() << " chunks, " << finals << " games lost, "
+		<< compressed << " of " << reader.getChunkCount() * Storage::TrainingColumnCount << " columns compressed\n"
+		<< "read in " << seconds << " s, " << bytes / seconds / 1e6f << " MB/s of columns\n";
+	if (reader.isTruncated())
+		std::cerr << "the file ends in a chunk that was not written whole\n";
+	if (bad != 0)
+		std::cerr << bad << " positions do not check out\n";
+	return bad == 0;
+}
+
+//usage: TrainingExport <file> --bots positions [--seed N] [--threads N] [--chunk rows] [--compress]
+//       TrainingExport <file> --replays <directory> [--threads N] [--chunk rows] [--compress]
+//       TrainingExport --check <file>
+//plays games without rendering on every core and writes a row per locked piece to a training file, the rates go to stderr,
+//--bots plays bots until at least that many positions are written, --replays plays the games of players from a directory of .replay files
+int main(int argc, char* argv[])
+{
+	std::string path, directory;
+	std::string mode;
+	std::uint64_t positions{ 0 };
+	std::uint32_t seed{ 1 };
+	Training::ExportSettings settings{ defaultChunkRows, false, std::max(1u, std::thread::hardware_concurrency()) };
+	for (int i{ 1 }; i < argc; ++i) {
+		const std::string arg{ argv[i] };
+		if (arg == "--bots" && i + 1 < argc) {
+			mode = "bots";
+			positions = std::stoull(argv[++i]);
+		}
+		else if (arg == "--replays" && i + 1 < argc) {
+			mode = "replays";
+			directory = argv[++i];
+		}
+		else if (arg == "--check" && i + 1 < argc) {
+			mode = "check";
+			path = argv[++i];
+		}
+		else if (arg == "--seed" && i + 1 < argc)
+			seed = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+		else if (arg == "--threads" && i + 1 < argc)
+			settings.threadCount = std::max<size_t>(1, std::stoul(argv[++i]));
+		else if (arg == "--chunk" && i + 1 < argc)
+			settings.chunkRows = std::min(maxChunkRows, std::max<size_t>(1, std::stoul(argv[++i])));
+		else if (arg == "--compress")
+			settings.compress = true;
+		else
+			path = arg;
+	}
+
+	if (mode == "check")
+		return check(path) ? 0 : 1;
+	if (mode.empty() || path.empty()) {
+		std::cerr << "usage: TrainingExport <file> --bots positions | --replays <directory> [--threads N] [--chunk rows] [--compress]\n"
+			<< "       TrainingExport --check <file>\n";
+		return 1;
+	}
+	Storage::TrainingWriter writer;
+	if (!writer.open(path, static_cast<std::uint32_t>(settings.chunkRows))) {
+		std::cerr << "failed to open " << path << '\n';
+		return 1;
+	}
+	sf::Clock clock;
+	const Training::ExportTotals totals = mode == "bots" ? Training::exportBotGames(writer, settings, positions, seed)
+		: Training::exportReplays(writer, settings, directory);
+	if (!writer.close()) {
+		std::cerr << "failed to write " << path << '\n';
+		return 1;
+	}
+	report(totals, writer, clock.getElapsedTime(), settings.threadCount);
+	return 0;
+}